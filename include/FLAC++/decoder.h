@@ -112,6 +112,7 @@ namespace FLAC {
 			};
 
 			Stream();
+			explicit Stream(const ::FLAC__Allocator *allocator); ///< See FLAC__stream_decoder_new_with_allocator()
 			virtual ~Stream();
 
 			//@{
@@ -124,6 +125,10 @@ namespace FLAC {
 
 			virtual bool set_ogg_serial_number(long value);                        ///< See FLAC__stream_decoder_set_ogg_serial_number()
 			virtual bool set_md5_checking(bool value);                             ///< See FLAC__stream_decoder_set_md5_checking()
+			virtual bool set_threaded_md5(bool value);                             ///< See FLAC__stream_decoder_set_threaded_md5()
+			virtual bool set_interleaved_format(::FLAC__StreamDecoderInterleavedFormat format); ///< See FLAC__stream_decoder_set_interleaved_format()
+			virtual bool set_low_footprint(bool value);                            ///< See FLAC__stream_decoder_set_low_footprint()
+			virtual bool set_frame_index(const ::FLAC__StreamMetadata *index);     ///< See FLAC__stream_decoder_set_frame_index()
 			virtual bool set_metadata_respond(::FLAC__MetadataType type);          ///< See FLAC__stream_decoder_set_metadata_respond()
 			virtual bool set_metadata_respond_application(const FLAC__byte id[4]); ///< See FLAC__stream_decoder_set_metadata_respond_application()
 			virtual bool set_metadata_respond_all();                               ///< See FLAC__stream_decoder_set_metadata_respond_all()
@@ -134,6 +139,15 @@ namespace FLAC {
 			/* get_state() is not virtual since we want subclasses to be able to return their own state */
 			State get_state() const;                                          ///< See FLAC__stream_decoder_get_state()
 			virtual bool get_md5_checking() const;                            ///< See FLAC__stream_decoder_get_md5_checking()
+			virtual bool get_threaded_md5() const;                            ///< See FLAC__stream_decoder_get_threaded_md5()
+			virtual ::FLAC__StreamDecoderInterleavedFormat get_interleaved_format() const; ///< See FLAC__stream_decoder_get_interleaved_format()
+			virtual bool get_low_footprint() const;                           ///< See FLAC__stream_decoder_get_low_footprint()
+			virtual const void *get_interleaved_buffer() const;               ///< See FLAC__stream_decoder_get_interleaved_buffer()
+			virtual const ::FLAC__StreamMetadata *get_frame_index() const;    ///< See FLAC__stream_decoder_get_frame_index()
+			virtual void get_seek_stats(::FLAC__StreamDecoderSeekStats *stats) const; ///< See FLAC__stream_decoder_get_seek_stats()
+			virtual bool get_statistics(::FLAC__StreamDecoderStatistics *statistics) const; ///< See FLAC__stream_decoder_get_statistics()
+			virtual const char *get_kernel(::FLAC__StreamDecoderKernel kernel) const; ///< See FLAC__stream_decoder_get_kernel()
+			virtual size_t get_footprint() const;                             ///< See FLAC__stream_decoder_get_footprint()
 			virtual FLAC__uint64 get_total_samples() const;                   ///< See FLAC__stream_decoder_get_total_samples()
 			virtual uint32_t get_channels() const;                            ///< See FLAC__stream_decoder_get_channels()
 			virtual ::FLAC__ChannelAssignment get_channel_assignment() const; ///< See FLAC__stream_decoder_get_channel_assignment()
@@ -153,9 +167,11 @@ namespace FLAC {
 			virtual bool process_single();                ///< See FLAC__stream_decoder_process_single()
 			virtual bool process_until_end_of_metadata(); ///< See FLAC__stream_decoder_process_until_end_of_metadata()
 			virtual bool process_until_end_of_stream();   ///< See FLAC__stream_decoder_process_until_end_of_stream()
+			virtual bool process_parallel(uint32_t num_threads); ///< See FLAC__stream_decoder_process_parallel()
 			virtual bool skip_single_frame();             ///< See FLAC__stream_decoder_skip_single_frame()
 
 			virtual bool seek_absolute(FLAC__uint64 sample); ///< See FLAC__stream_decoder_seek_absolute()
+			virtual bool build_frame_index();                ///< See FLAC__stream_decoder_build_frame_index()
 		protected:
 			/// see FLAC__StreamDecoderReadCallback
 			virtual ::FLAC__StreamDecoderReadStatus read_callback(FLAC__byte buffer[], size_t *bytes) = 0;
@@ -223,6 +239,7 @@ namespace FLAC {
 		class FLACPP_API File: public Stream {
 		public:
 			File();
+			explicit File(const ::FLAC__Allocator *allocator); ///< See FLAC__stream_decoder_new_with_allocator()
 			virtual ~File();
 
 			using Stream::init;
@@ -233,6 +250,9 @@ namespace FLAC {
 			virtual ::FLAC__StreamDecoderInitStatus init_ogg(FILE *file);                  ///< See FLAC__stream_decoder_init_ogg_FILE()
 			virtual ::FLAC__StreamDecoderInitStatus init_ogg(const char *filename);        ///< See FLAC__stream_decoder_init_ogg_file()
 			virtual ::FLAC__StreamDecoderInitStatus init_ogg(const std::string &filename); ///< See FLAC__stream_decoder_init_ogg_file()
+			virtual ::FLAC__StreamDecoderInitStatus init_memory(const FLAC__byte *data, size_t length); ///< See FLAC__stream_decoder_init_memory()
+			virtual ::FLAC__StreamDecoderInitStatus init_mmap(const char *filename);        ///< See FLAC__stream_decoder_init_mmap()
+			virtual ::FLAC__StreamDecoderInitStatus init_mmap(const std::string &filename); ///< See FLAC__stream_decoder_init_mmap()
 		protected:
 			// this is a dummy implementation to satisfy the pure virtual in Stream that is actually supplied internally by the C layer
 			virtual ::FLAC__StreamDecoderReadStatus read_callback(FLAC__byte buffer[], size_t *bytes);
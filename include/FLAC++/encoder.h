@@ -114,6 +114,7 @@ namespace FLAC {
 			};
 
 			Stream();
+			explicit Stream(const ::FLAC__Allocator *allocator); ///< See FLAC__stream_encoder_new_with_allocator()
 			virtual ~Stream();
 
 			//@{
@@ -144,9 +145,14 @@ namespace FLAC {
 			virtual bool set_min_residual_partition_order(uint32_t value);  ///< See FLAC__stream_encoder_set_min_residual_partition_order()
 			virtual bool set_max_residual_partition_order(uint32_t value);  ///< See FLAC__stream_encoder_set_max_residual_partition_order()
 			virtual bool set_rice_parameter_search_dist(uint32_t value);    ///< See FLAC__stream_encoder_set_rice_parameter_search_dist()
+			virtual bool set_num_threads(uint32_t value);                   ///< See FLAC__stream_encoder_set_num_threads()
+			virtual bool set_parallel_subframes(bool value);                ///< See FLAC__stream_encoder_set_parallel_subframes()
+			virtual bool set_threaded_md5(bool value);                      ///< See FLAC__stream_encoder_set_threaded_md5()
+			virtual bool set_keep_buffers(bool value);                      ///< See FLAC__stream_encoder_set_keep_buffers()
 			virtual bool set_total_samples_estimate(FLAC__uint64 value);    ///< See FLAC__stream_encoder_set_total_samples_estimate()
 			virtual bool set_metadata(::FLAC__StreamMetadata **metadata, uint32_t num_blocks);    ///< See FLAC__stream_encoder_set_metadata()
 			virtual bool set_metadata(FLAC::Metadata::Prototype **metadata, uint32_t num_blocks); ///< See FLAC__stream_encoder_set_metadata()
+			virtual bool set_frame_index(::FLAC__StreamMetadata *index);                         ///< See FLAC__stream_encoder_set_frame_index()
 
 			/* get_state() is not virtual since we want subclasses to be able to return their own state */
 			State get_state() const;                                   ///< See FLAC__stream_encoder_get_state()
@@ -168,7 +174,13 @@ namespace FLAC {
 			virtual uint32_t get_min_residual_partition_order() const; ///< See FLAC__stream_encoder_get_min_residual_partition_order()
 			virtual uint32_t get_max_residual_partition_order() const; ///< See FLAC__stream_encoder_get_max_residual_partition_order()
 			virtual uint32_t get_rice_parameter_search_dist() const;   ///< See FLAC__stream_encoder_get_rice_parameter_search_dist()
+			virtual uint32_t get_num_threads() const;                  ///< See FLAC__stream_encoder_get_num_threads()
+			virtual bool     get_parallel_subframes() const;           ///< See FLAC__stream_encoder_get_parallel_subframes()
+			virtual bool     get_threaded_md5() const;                 ///< See FLAC__stream_encoder_get_threaded_md5()
+			virtual bool     get_keep_buffers() const;                 ///< See FLAC__stream_encoder_get_keep_buffers()
 			virtual FLAC__uint64 get_total_samples_estimate() const;   ///< See FLAC__stream_encoder_get_total_samples_estimate()
+			virtual bool     get_statistics(::FLAC__StreamEncoderStatistics *statistics) const; ///< See FLAC__stream_encoder_get_statistics()
+			virtual const char *get_kernel(::FLAC__StreamEncoderKernel kernel) const; ///< See FLAC__stream_encoder_get_kernel()
 
 			virtual ::FLAC__StreamEncoderInitStatus init();            ///< See FLAC__stream_encoder_init_stream()
 			virtual ::FLAC__StreamEncoderInitStatus init_ogg();        ///< See FLAC__stream_encoder_init_ogg_stream()
@@ -177,6 +189,9 @@ namespace FLAC {
 
 			virtual bool process(const FLAC__int32 * const buffer[], uint32_t samples);     ///< See FLAC__stream_encoder_process()
 			virtual bool process_interleaved(const FLAC__int32 buffer[], uint32_t samples); ///< See FLAC__stream_encoder_process_interleaved()
+			virtual bool process_interleaved_int16(const FLAC__int16 buffer[], uint32_t samples); ///< See FLAC__stream_encoder_process_interleaved_int16()
+			virtual bool process_interleaved_int24(const FLAC__byte buffer[], uint32_t samples); ///< See FLAC__stream_encoder_process_interleaved_int24()
+			virtual bool process_interleaved_float32(const float buffer[], uint32_t samples); ///< See FLAC__stream_encoder_process_interleaved_float32()
 		protected:
 			/// See FLAC__StreamEncoderReadCallback
 			virtual ::FLAC__StreamEncoderReadStatus read_callback(FLAC__byte buffer[], size_t *bytes);
@@ -233,6 +248,7 @@ namespace FLAC {
 		class FLACPP_API File: public Stream {
 		public:
 			File();
+			explicit File(const ::FLAC__Allocator *allocator); ///< See FLAC__stream_encoder_new_with_allocator()
 			virtual ~File();
 
 			using Stream::init;
@@ -243,6 +259,9 @@ namespace FLAC {
 			virtual ::FLAC__StreamEncoderInitStatus init_ogg(FILE *file);                  ///< See FLAC__stream_encoder_init_ogg_FILE()
 			virtual ::FLAC__StreamEncoderInitStatus init_ogg(const char *filename);        ///< See FLAC__stream_encoder_init_ogg_file()
 			virtual ::FLAC__StreamEncoderInitStatus init_ogg(const std::string &filename); ///< See FLAC__stream_encoder_init_ogg_file()
+			virtual ::FLAC__StreamEncoderInitStatus init_memory();                         ///< See FLAC__stream_encoder_init_memory()
+
+			virtual bool finish_memory(FLAC__byte **data, size_t *length);                 ///< See FLAC__stream_encoder_finish_memory()
 		protected:
 			/// See FLAC__StreamEncoderProgressCallback
 			virtual void progress_callback(FLAC__uint64 bytes_written, FLAC__uint64 samples_written, uint32_t frames_written, uint32_t total_frames_estimate);
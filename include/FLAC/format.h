@@ -33,6 +33,7 @@
 #ifndef FLAC__FORMAT_H
 #define FLAC__FORMAT_H
 
+#include <stddef.h> /* for size_t */
 #include "export.h"
 #include "ordinals.h"
 
@@ -1016,6 +1017,121 @@ FLAC_API FLAC__bool FLAC__format_cuesheet_is_legal(const FLAC__StreamMetadata_Cu
  */
 FLAC_API FLAC__bool FLAC__format_picture_is_legal(const FLAC__StreamMetadata_Picture *picture, const char **violation);
 
+/** CPU features that libFLAC can choose routines by, for use with
+ *  FLAC__set_cpu_feature_mask() and FLAC__get_cpu_features().
+ */
+typedef enum {
+	FLAC__CPU_FEATURE_ASM = 1u << 0,
+	/**< Any architecture-specific routine at all, including the hand
+	 * written IA-32 assembly that needs no particular extension.  Clearing
+	 * this bit leaves only the portable C routines. */
+
+	FLAC__CPU_FEATURE_X86_CMOV = 1u << 1,
+	FLAC__CPU_FEATURE_X86_MMX = 1u << 2,
+	FLAC__CPU_FEATURE_X86_SSE = 1u << 3,
+	FLAC__CPU_FEATURE_X86_SSE2 = 1u << 4,
+	FLAC__CPU_FEATURE_X86_SSE3 = 1u << 5,
+	FLAC__CPU_FEATURE_X86_SSSE3 = 1u << 6,
+	FLAC__CPU_FEATURE_X86_SSE41 = 1u << 7,
+	FLAC__CPU_FEATURE_X86_SSE42 = 1u << 8,
+	FLAC__CPU_FEATURE_X86_PCLMUL = 1u << 9,
+	FLAC__CPU_FEATURE_X86_AVX = 1u << 10,
+	FLAC__CPU_FEATURE_X86_AVX2 = 1u << 11,
+	FLAC__CPU_FEATURE_X86_FMA = 1u << 12,
+	FLAC__CPU_FEATURE_X86_BMI2 = 1u << 13,
+	FLAC__CPU_FEATURE_X86_LZCNT = 1u << 14,
+	FLAC__CPU_FEATURE_PPC_ARCH_2_07 = 1u << 15, /**< POWER8 */
+	FLAC__CPU_FEATURE_PPC_ARCH_3_00 = 1u << 16  /**< POWER9 */
+} FLAC__CPUFeature;
+
+/** The FLAC__set_cpu_feature_mask() value that allows every feature. */
+#define FLAC__CPU_FEATURE_ALL 0xffffffffu
+
+/** Restrict the CPU features libFLAC will use, for example to compare
+ *  the SSE4.1 and AVX2 routines on the same machine, or to keep AVX2
+ *  code (and the clock throttling it can cause on some CPUs) out of a
+ *  process.  Encoders and decoders initialized afterwards only use the
+ *  features that are both detected and set in \a mask; ones already
+ *  initialized keep their routines.  The setting is process-wide, so
+ *  it should be made before starting threads that initialize encoders
+ *  or decoders.  The default is \c FLAC__CPU_FEATURE_ALL.
+ *
+ *  Clearing a feature also clears the ones that extend it: clearing
+ *  \c FLAC__CPU_FEATURE_X86_SSE2, for example, leaves out SSE3, SSSE3,
+ *  SSE4.1, SSE4.2, PCLMUL, AVX, AVX2 and FMA too, and clearing
+ *  \c FLAC__CPU_FEATURE_PPC_ARCH_2_07 leaves out POWER9.
+ *
+ *  FLAC__stream_encoder_get_kernel() and FLAC__stream_decoder_get_kernel()
+ *  report what an instance ended up with.
+ *
+ * \param mask  A combination of FLAC__CPUFeature bits.
+ */
+FLAC_API void FLAC__set_cpu_feature_mask(FLAC__uint32 mask);
+
+/** Get the mask set by FLAC__set_cpu_feature_mask().
+ *
+ * \retval FLAC__uint32
+ *    The current mask.
+ */
+FLAC_API FLAC__uint32 FLAC__get_cpu_feature_mask(void);
+
+/** Detect the CPU features libFLAC will use for new encoders and
+ *  decoders: the ones this CPU and OS support and libFLAC has routines
+ *  for, restricted by FLAC__set_cpu_feature_mask().
+ *
+ * \retval FLAC__uint32
+ *    A combination of FLAC__CPUFeature bits.
+ */
+FLAC_API FLAC__uint32 FLAC__get_cpu_features(void);
+
+/** A memory allocator for libFLAC to use instead of the C library's
+ *  malloc(), realloc() and free(), so that an application can put
+ *  libFLAC's memory in an arena or a per-request pool, or account for
+ *  it.  See FLAC__set_allocator(),
+ *  FLAC__stream_decoder_new_with_allocator() and
+ *  FLAC__stream_encoder_new_with_allocator().
+ *
+ *  libFLAC never calls \a allocate or \a reallocate with a size of 0,
+ *  never calls \a reallocate or \a release with a \c NULL address,
+ *  and only passes \a reallocate and \a release addresses it got from
+ *  the same allocator.  Returned memory must be aligned as for malloc().
+ *  \a reallocate must behave like realloc(): keep the contents, and
+ *  leave the old block alone if it returns \c NULL.
+ */
+typedef struct {
+	void *(*allocate)(void *context, size_t bytes);
+	/**< Return a new block of \a bytes bytes, or \c NULL. */
+
+	void *(*reallocate)(void *context, void *address, size_t bytes);
+	/**< Resize the block at \a address to \a bytes bytes. */
+
+	void (*release)(void *context, void *address);
+	/**< Free the block at \a address. */
+
+	void *context;
+	/**< Passed unchanged as the first argument to the functions above. */
+} FLAC__Allocator;
+
+/** Set the allocator libFLAC uses for everything that is not owned by
+ *  an encoder or decoder created with an allocator of its own: metadata
+ *  objects and chains, and the encoders and decoders created with
+ *  FLAC__stream_encoder_new() and FLAC__stream_decoder_new().  The
+ *  allocator is copied, and \a allocator may be \c NULL to go back to
+ *  the C library, which is the default.
+ *
+ *  Memory libFLAC has allocated must be freed by the allocator that
+ *  allocated it, so the global allocator should be set before any
+ *  libFLAC objects are created and not changed while any exist.  The
+ *  setting is process-wide and not synchronized.  Memory handed over to
+ *  libFLAC to own, as with the metadata object functions when \a copy
+ *  is \c false, must come from the same allocator.
+ *
+ * \param allocator  The allocator, or \c NULL for the C library.
+ * \assert
+ *    \code allocator == NULL || (allocator->allocate != NULL && allocator->reallocate != NULL && allocator->release != NULL) \endcode
+ */
+FLAC_API void FLAC__set_allocator(const FLAC__Allocator *allocator);
+
 /* \} */
 
 #ifdef __cplusplus
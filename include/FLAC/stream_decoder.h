@@ -448,6 +448,187 @@ typedef enum {
 extern FLAC_API const char * const FLAC__StreamDecoderErrorStatusString[];
 
 
+/** Sample formats for interleaved output; see
+ *  FLAC__stream_decoder_set_interleaved_format().
+ *
+ *  Samples are written in the host's byte order.  Integer formats are
+ *  scaled to their width by shifting, so e.g. 16-bit audio comes out
+ *  unchanged as \c FLAC__STREAM_DECODER_INTERLEAVED_INT16, 8-bit audio
+ *  is shifted up by 8 bits and 24-bit audio is truncated to its top 16
+ *  bits (without dither).  \c FLAC__STREAM_DECODER_INTERLEAVED_FLOAT32
+ *  scales to the range [-1.0,1.0).
+ */
+typedef enum {
+
+	FLAC__STREAM_DECODER_INTERLEAVED_NONE,
+	/**< No interleaved output; only the per-channel buffers are passed
+	 * to the write callback.  This is the default. */
+
+	FLAC__STREAM_DECODER_INTERLEAVED_INT16,
+	/**< 16-bit signed integers. */
+
+	FLAC__STREAM_DECODER_INTERLEAVED_INT24,
+	/**< 24-bit signed integers, packed in 3 bytes each. */
+
+	FLAC__STREAM_DECODER_INTERLEAVED_INT32,
+	/**< 32-bit signed integers. */
+
+	FLAC__STREAM_DECODER_INTERLEAVED_FLOAT32
+	/**< 32-bit floats.  Not available if libFLAC was built as an
+	 * integer-only library. */
+
+} FLAC__StreamDecoderInterleavedFormat;
+
+/** Maps a FLAC__StreamDecoderInterleavedFormat to a C string.
+ *
+ *  Using a FLAC__StreamDecoderInterleavedFormat as the index to this array
+ *  will give the string equivalent.  The contents should not be modified.
+ */
+extern FLAC_API const char * const FLAC__StreamDecoderInterleavedFormatString[];
+
+
+/** What the last call to FLAC__stream_decoder_seek_absolute() cost; see
+ *  FLAC__stream_decoder_get_seek_stats().
+ */
+typedef struct {
+	FLAC__uint64 bytes_read;
+	/**< The number of bytes returned by the read callback, or taken
+	 * from the buffer for FLAC__stream_decoder_init_memory() and
+	 * FLAC__stream_decoder_init_mmap(). */
+
+	uint32_t read_callbacks;
+	/**< The number of calls to the read callback, or of reads from the
+	 * buffer. */
+
+	uint32_t seek_callbacks;
+	/**< The number of calls to the seek callback. */
+
+	uint32_t frames_decoded;
+	/**< The number of frames decoded, including the one holding the
+	 * target sample. */
+
+	uint32_t iterations;
+	/**< The number of steps the search took, each trying to decode a
+	 * frame at a new guess of the position. */
+} FLAC__StreamDecoderSeekStats;
+
+
+/** The decoder stages timed by FLAC__stream_decoder_get_statistics().
+ */
+typedef enum {
+
+	FLAC__STREAM_DECODER_STAGE_FRAME_SYNC,
+	/**< Searching for the next frame sync code, including reading more
+	 * input. */
+
+	FLAC__STREAM_DECODER_STAGE_FRAME_HEADER,
+	/**< Parsing and checking frame headers. */
+
+	FLAC__STREAM_DECODER_STAGE_RESIDUAL,
+	/**< Reading the Rice coded (or escaped) residual of fixed and LPC
+	 * subframes. */
+
+	FLAC__STREAM_DECODER_STAGE_RESTORE,
+	/**< Restoring the signal from the residual with the fixed or LPC
+	 * predictor. */
+
+	FLAC__STREAM_DECODER_STAGE_DECORRELATION,
+	/**< Undoing left/side, right/side or mid/side channel coding. */
+
+	FLAC__STREAM_DECODER_STAGE_MD5,
+	/**< Updating the MD5 signature of the decoded audio (or handing the
+	 * samples to the MD5 thread when FLAC__stream_decoder_set_threaded_md5()
+	 * is in effect). */
+
+	FLAC__STREAM_DECODER_STAGE_WRITE_CALLBACK,
+	/**< Time spent in the client's write callback. */
+
+	FLAC__STREAM_DECODER_STAGE_COUNT
+	/**< The number of stages; not a stage itself. */
+
+} FLAC__StreamDecoderStage;
+
+/** Maps a FLAC__StreamDecoderStage to a C string.
+ *
+ *  Using a FLAC__StreamDecoderStage as the index to this array
+ *  will give the string equivalent.  The contents should not be modified.
+ */
+extern FLAC_API const char * const FLAC__StreamDecoderStageString[];
+
+/** Per-stage timings and coding histograms returned by
+ *  FLAC__stream_decoder_get_statistics().
+ */
+typedef struct {
+	FLAC__uint64 nanoseconds[FLAC__STREAM_DECODER_STAGE_COUNT];
+	/**< Total wall-clock time spent in each stage, indexed by
+	 * FLAC__StreamDecoderStage.  With
+	 * FLAC__stream_decoder_process_parallel(), time spent by the worker
+	 * threads is summed. */
+
+	FLAC__uint64 calls[FLAC__STREAM_DECODER_STAGE_COUNT];
+	/**< The number of times each stage was entered. */
+
+	FLAC__uint64 subframe_types[4];
+	/**< The number of subframes of each type, indexed by
+	 * FLAC__SubframeType. */
+
+	FLAC__uint64 fixed_orders[FLAC__MAX_FIXED_ORDER+1];
+	/**< The number of fixed subframes of each predictor order. */
+
+	FLAC__uint64 lpc_orders[FLAC__MAX_LPC_ORDER+1];
+	/**< The number of LPC subframes of each predictor order; index 0 is
+	 * unused. */
+
+	FLAC__uint64 rice_parameters[31];
+	/**< The number of residual partitions coded with each Rice
+	 * parameter. */
+
+	FLAC__uint64 escaped_partitions;
+	/**< The number of residual partitions stored unencoded (with the
+	 * escape code) rather than Rice coded. */
+
+	FLAC__uint64 blocksizes[16];
+	/**< The number of frames by blocksize; entry \c n counts the frames
+	 * with a blocksize from \c 2^n up to \c 2^(n+1)-1, so for example
+	 * the common 4096 and 4608 both count in entry 12. */
+} FLAC__StreamDecoderStatistics;
+
+
+/** The CPU-dependent routines reported by
+ *  FLAC__stream_decoder_get_kernel().
+ */
+typedef enum {
+
+	FLAC__STREAM_DECODER_KERNEL_LPC_RESTORE,
+	/**< Restores LPC subframes whose samples fit in 32 bits. */
+
+	FLAC__STREAM_DECODER_KERNEL_LPC_RESTORE_64BIT,
+	/**< Restores LPC subframes that need 64-bit intermediates. */
+
+	FLAC__STREAM_DECODER_KERNEL_LPC_RESTORE_16BIT,
+	/**< Restores LPC subframes with small enough samples and coefficients
+	 * for 16-bit arithmetic. */
+
+	FLAC__STREAM_DECODER_KERNEL_READ_RICE_SIGNED_BLOCK,
+	/**< Reads a partition of Rice coded residual. */
+
+	FLAC__STREAM_DECODER_KERNEL_PCM_INTERLEAVE,
+	/**< Fills the buffer set up by
+	 * FLAC__stream_decoder_set_interleaved_format(). */
+
+	FLAC__STREAM_DECODER_KERNEL_COUNT
+	/**< The number of kernels; not a kernel itself. */
+
+} FLAC__StreamDecoderKernel;
+
+/** Maps a FLAC__StreamDecoderKernel to a C string.
+ *
+ *  Using a FLAC__StreamDecoderKernel as the index to this array
+ *  will give the string equivalent.  The contents should not be modified.
+ */
+extern FLAC_API const char * const FLAC__StreamDecoderKernelString[];
+
+
 /***********************************************************************
  *
  * class FLAC__StreamDecoder
@@ -742,6 +923,20 @@ typedef void (*FLAC__StreamDecoderErrorCallback)(const FLAC__StreamDecoder *deco
  */
 FLAC_API FLAC__StreamDecoder *FLAC__stream_decoder_new(void);
 
+/** Create a new stream decoder instance like FLAC__stream_decoder_new(),
+ *  but with all of the memory it allocates, for itself and while it
+ *  runs, coming from \a allocator instead of the global allocator (see
+ *  FLAC__set_allocator()).  The allocator is copied, and must be usable
+ *  until FLAC__stream_decoder_delete() returns; it may be called from
+ *  the decoder's worker threads, if any.
+ *
+ * \param allocator  The allocator, or \c NULL for the current global
+ *                   allocator.
+ * \retval FLAC__StreamDecoder*
+ *    \c NULL if there was an error allocating memory, else the new instance.
+ */
+FLAC_API FLAC__StreamDecoder *FLAC__stream_decoder_new_with_allocator(const FLAC__Allocator *allocator);
+
 /** Free a decoder instance.  Deletes the object pointed to by \a decoder.
  *
  * \param decoder  A pointer to an existing decoder.
@@ -797,6 +992,110 @@ FLAC_API FLAC__bool FLAC__stream_decoder_set_ogg_serial_number(FLAC__StreamDecod
  */
 FLAC_API FLAC__bool FLAC__stream_decoder_set_md5_checking(FLAC__StreamDecoder *decoder, FLAC__bool value);
 
+/** Set to \c true to compute the MD5 signature checked with
+ *  FLAC__stream_decoder_set_md5_checking() on a thread of its own.
+ *  The decoding thread only converts each frame to the byte layout
+ *  that is hashed and queues it; the hashing itself overlaps with
+ *  decoding and with the write callback.  At most a few frames are
+ *  queued at a time, and the thread is joined in
+ *  FLAC__stream_decoder_finish() and FLAC__stream_decoder_reset().  If
+ *  the thread cannot be started, the signature is computed inline as
+ *  usual.
+ *
+ * \note
+ * This setting is only available if libFLAC was built with
+ * multithreading support.  Otherwise only \c false is accepted.
+ *
+ * \default \c false
+ * \param  decoder  A decoder instance to set.
+ * \param  value    Flag value (see above).
+ * \assert
+ *    \code decoder != NULL \endcode
+ * \retval FLAC__bool
+ *    \c false if the decoder is already initialized, or if \a value
+ *    is \c true and multithreading is not supported, else \c true.
+ */
+FLAC_API FLAC__bool FLAC__stream_decoder_set_threaded_md5(FLAC__StreamDecoder *decoder, FLAC__bool value);
+
+/** Have the decoder interleave each frame into a single buffer of
+ *  samples in the given format before calling the write callback.  The
+ *  write callback still gets the usual per-channel \a buffer and can
+ *  fetch the interleaved samples with
+ *  FLAC__stream_decoder_get_interleaved_buffer().  The conversion uses
+ *  SIMD code where the CPU supports it, which saves clients their own
+ *  per-sample conversion loop and output buffer.
+ *
+ * \default \c FLAC__STREAM_DECODER_INTERLEAVED_NONE
+ * \param  decoder  A decoder instance to set.
+ * \param  format   See FLAC__StreamDecoderInterleavedFormat.
+ * \assert
+ *    \code decoder != NULL \endcode
+ * \retval FLAC__bool
+ *    \c false if the decoder is already initialized, or if \a format
+ *    is not supported by this build, else \c true.
+ */
+FLAC_API FLAC__bool FLAC__stream_decoder_set_interleaved_format(FLAC__StreamDecoder *decoder, FLAC__StreamDecoderInterleavedFormat format);
+
+/** Set to \c true to keep the memory the decoder holds to a minimum, for
+ *  applications that run very many decoders at once.  Buffers are still
+ *  only allocated for the largest frame actually decoded, but:
+ *  - one residual buffer and one set of Rice partition parameters are
+ *    shared by all channels instead of one per channel;
+ *  - the input buffer is 1K bytes instead of 8K bytes, at the cost of
+ *    more read callbacks, and the Rice decoding lookup tables are not
+ *    built;
+ *  - the \c SEEKTABLE is not kept after it has been passed to the
+ *    metadata callback if the decoder was initialized without a seek
+ *    callback, since it cannot seek anyway.
+ *
+ *  Decoding is otherwise unchanged.  The one visible difference is in
+ *  the \a frame passed to the write callback: since the channels share
+ *  the residual buffer, the \c residual (and for verbatim subframes
+ *  \c data) and \c partitioned_rice.contents pointers of all subframes
+ *  refer to those of the last subframe.  The decoded samples in
+ *  \a buffer are not affected.
+ *
+ *  FLAC__stream_decoder_get_footprint() tells how much memory the
+ *  decoder holds.
+ *
+ * \default \c false
+ * \param  decoder  A decoder instance to set.
+ * \param  value    Flag value (see above).
+ * \assert
+ *    \code decoder != NULL \endcode
+ * \retval FLAC__bool
+ *    \c false if the decoder is already initialized, else \c true.
+ */
+FLAC_API FLAC__bool FLAC__stream_decoder_set_low_footprint(FLAC__StreamDecoder *decoder, FLAC__bool value);
+
+/** Give the decoder an index of the frames in the stream to seek with.
+ *  The index is a \c SEEKTABLE object with one seek point per frame,
+ *  such as one recorded by FLAC__stream_encoder_set_frame_index() or
+ *  built by FLAC__stream_decoder_build_frame_index() and saved by the
+ *  client, e.g. in a sidecar file or as the stream's own SEEKTABLE.
+ *  When the index has a point for the frame holding the target sample,
+ *  FLAC__stream_decoder_seek_absolute() seeks straight to that frame
+ *  and decodes only it, instead of searching.  Points for other frames
+ *  are simply not used, so a sparse table does no harm, and if the
+ *  index turns out not to match the stream the decoder falls back to
+ *  the usual search.  The stream's own SEEKTABLE is used the same way
+ *  when the index has no point for the target.  The index is not used
+ *  for Ogg FLAC.
+ *
+ *  The decoder does not copy the index; it must stay valid until
+ *  FLAC__stream_decoder_finish() is called.
+ *
+ * \default \c NULL
+ * \param  decoder  A decoder instance to set.
+ * \param  index    A \c SEEKTABLE object, or \c NULL for none.
+ * \assert
+ *    \code decoder != NULL \endcode
+ * \retval FLAC__bool
+ *    \c false if the decoder is already initialized, or if \a index is
+ *    not a \c SEEKTABLE, else \c true.
+ */
+FLAC_API FLAC__bool FLAC__stream_decoder_set_frame_index(FLAC__StreamDecoder *decoder, const FLAC__StreamMetadata *index);
+
 /** Direct the decoder to pass on all metadata blocks of type \a type.
  *
  * \default By default, only the \c STREAMINFO block is returned via the
@@ -913,6 +1212,65 @@ FLAC_API const char *FLAC__stream_decoder_get_resolved_state_string(const FLAC__
  */
 FLAC_API FLAC__bool FLAC__stream_decoder_get_md5_checking(const FLAC__StreamDecoder *decoder);
 
+/** Get the "threaded MD5" flag.
+ *
+ * \param  decoder  A decoder instance to query.
+ * \assert
+ *    \code decoder != NULL \endcode
+ * \retval FLAC__bool
+ *    See FLAC__stream_decoder_set_threaded_md5().
+ */
+FLAC_API FLAC__bool FLAC__stream_decoder_get_threaded_md5(const FLAC__StreamDecoder *decoder);
+
+/** Get the interleaved output format.
+ *
+ * \param  decoder  A decoder instance to query.
+ * \assert
+ *    \code decoder != NULL \endcode
+ * \retval FLAC__StreamDecoderInterleavedFormat
+ *    See FLAC__stream_decoder_set_interleaved_format().
+ */
+FLAC_API FLAC__StreamDecoderInterleavedFormat FLAC__stream_decoder_get_interleaved_format(const FLAC__StreamDecoder *decoder);
+
+/** Get the "low footprint" flag.
+ *
+ * \param  decoder  A decoder instance to query.
+ * \assert
+ *    \code decoder != NULL \endcode
+ * \retval FLAC__bool
+ *    See FLAC__stream_decoder_set_low_footprint().
+ */
+FLAC_API FLAC__bool FLAC__stream_decoder_get_low_footprint(const FLAC__StreamDecoder *decoder);
+
+/** Get the interleaved samples of the frame being written.
+ *  Only valid from within the write callback, where it holds
+ *  \c frame->header.blocksize * \c frame->header.channels samples in the
+ *  format set with FLAC__stream_decoder_set_interleaved_format().  The
+ *  buffer is owned by the decoder and is overwritten by the next frame.
+ *
+ * \param  decoder  A decoder instance to query.
+ * \assert
+ *    \code decoder != NULL \endcode
+ * \retval const void*
+ *    The samples, or \c NULL if the format is
+ *    \c FLAC__STREAM_DECODER_INTERLEAVED_NONE or no frame has been
+ *    written yet.
+ */
+FLAC_API const void *FLAC__stream_decoder_get_interleaved_buffer(const FLAC__StreamDecoder *decoder);
+
+/** Get the frame index used for seeking.
+ *
+ * \param  decoder  A decoder instance to query.
+ * \assert
+ *    \code decoder != NULL \endcode
+ * \retval const FLAC__StreamMetadata*
+ *    The index set with FLAC__stream_decoder_set_frame_index() or made
+ *    by FLAC__stream_decoder_build_frame_index(), or \c NULL.  An index
+ *    built by the decoder belongs to it and is freed by
+ *    FLAC__stream_decoder_finish().
+ */
+FLAC_API const FLAC__StreamMetadata *FLAC__stream_decoder_get_frame_index(const FLAC__StreamDecoder *decoder);
+
 /** Get the total number of samples in the stream being decoded.
  *  Will only be valid after decoding has started and will contain the
  *  value from the \c STREAMINFO block.  A value of \c 0 means "unknown".
@@ -1056,7 +1414,9 @@ FLAC_API FLAC__bool FLAC__stream_decoder_get_decode_position(const FLAC__StreamD
  *                            may also be supplied, all though this is slightly
  *                            less efficient for the decoder.
  * \param  write_callback     See FLAC__StreamDecoderWriteCallback.  This
- *                            pointer must not be \c NULL.
+ *                            pointer may be \c NULL, in which case the
+ *                            audio must be pulled with
+ *                            FLAC__stream_decoder_read_samples().
  * \param  metadata_callback  See FLAC__StreamDecoderMetadataCallback.  This
  *                            pointer may be \c NULL if the callback is not
  *                            desired.
@@ -1137,7 +1497,9 @@ FLAC_API FLAC__StreamDecoderInitStatus FLAC__stream_decoder_init_stream(
  *                            may also be supplied, all though this is slightly
  *                            less efficient for the decoder.
  * \param  write_callback     See FLAC__StreamDecoderWriteCallback.  This
- *                            pointer must not be \c NULL.
+ *                            pointer may be \c NULL, in which case the
+ *                            audio must be pulled with
+ *                            FLAC__stream_decoder_read_samples().
  * \param  metadata_callback  See FLAC__StreamDecoderMetadataCallback.  This
  *                            pointer may be \c NULL if the callback is not
  *                            desired.
@@ -1186,7 +1548,9 @@ FLAC_API FLAC__StreamDecoderInitStatus FLAC__stream_decoder_init_ogg_stream(
  *                            Note however that seeking will not work when
  *                            decoding from \c stdin since it is not seekable.
  * \param  write_callback     See FLAC__StreamDecoderWriteCallback.  This
- *                            pointer must not be \c NULL.
+ *                            pointer may be \c NULL, in which case the
+ *                            audio must be pulled with
+ *                            FLAC__stream_decoder_read_samples().
  * \param  metadata_callback  See FLAC__StreamDecoderMetadataCallback.  This
  *                            pointer may be \c NULL if the callback is not
  *                            desired.
@@ -1236,7 +1600,9 @@ FLAC_API FLAC__StreamDecoderInitStatus FLAC__stream_decoder_init_FILE(
  *                            Note however that seeking will not work when
  *                            decoding from \c stdin since it is not seekable.
  * \param  write_callback     See FLAC__StreamDecoderWriteCallback.  This
- *                            pointer must not be \c NULL.
+ *                            pointer may be \c NULL, in which case the
+ *                            audio must be pulled with
+ *                            FLAC__stream_decoder_read_samples().
  * \param  metadata_callback  See FLAC__StreamDecoderMetadataCallback.  This
  *                            pointer may be \c NULL if the callback is not
  *                            desired.
@@ -1279,7 +1645,9 @@ FLAC_API FLAC__StreamDecoderInitStatus FLAC__stream_decoder_init_ogg_FILE(
  *                            be opened with fopen().  Use \c NULL to decode from
  *                            \c stdin.  Note that \c stdin is not seekable.
  * \param  write_callback     See FLAC__StreamDecoderWriteCallback.  This
- *                            pointer must not be \c NULL.
+ *                            pointer may be \c NULL, in which case the
+ *                            audio must be pulled with
+ *                            FLAC__stream_decoder_read_samples().
  * \param  metadata_callback  See FLAC__StreamDecoderMetadataCallback.  This
  *                            pointer may be \c NULL if the callback is not
  *                            desired.
@@ -1325,7 +1693,9 @@ FLAC_API FLAC__StreamDecoderInitStatus FLAC__stream_decoder_init_file(
  *                            be opened with fopen().  Use \c NULL to decode from
  *                            \c stdin.  Note that \c stdin is not seekable.
  * \param  write_callback     See FLAC__StreamDecoderWriteCallback.  This
- *                            pointer must not be \c NULL.
+ *                            pointer may be \c NULL, in which case the
+ *                            audio must be pulled with
+ *                            FLAC__stream_decoder_read_samples().
  * \param  metadata_callback  See FLAC__StreamDecoderMetadataCallback.  This
  *                            pointer may be \c NULL if the callback is not
  *                            desired.
@@ -1348,6 +1718,95 @@ FLAC_API FLAC__StreamDecoderInitStatus FLAC__stream_decoder_init_ogg_file(
 	void *client_data
 );
 
+/** Initialize the decoder instance to decode native FLAC from memory.
+ *
+ *  This flavor of initialization sets up the decoder to decode a complete
+ *  native FLAC stream that is already in memory.  Instead of copying the
+ *  input through a read callback, the decoder reads the frames straight
+ *  out of \a data, and seeking is just a matter of moving a position, so
+ *  this is the cheapest way to decode a stream the client already holds.
+ *  The memory is not copied and must stay valid and unchanged until
+ *  FLAC__stream_decoder_finish() is called.
+ *
+ *  This function should be called after FLAC__stream_decoder_new() and
+ *  FLAC__stream_decoder_set_*() but before any of the
+ *  FLAC__stream_decoder_process_*() functions.  Will set and return the
+ *  decoder state, which will be FLAC__STREAM_DECODER_SEARCH_FOR_METADATA
+ *  if initialization succeeded.
+ *
+ * \param  decoder            An uninitialized decoder instance.
+ * \param  data               The encoded stream.  This pointer may only be
+ *                            \c NULL if \a length is \c 0.
+ * \param  length             The number of bytes in \a data.
+ * \param  write_callback     See FLAC__StreamDecoderWriteCallback.  This
+ *                            pointer may be \c NULL, in which case the
+ *                            audio must be pulled with
+ *                            FLAC__stream_decoder_read_samples().
+ * \param  metadata_callback  See FLAC__StreamDecoderMetadataCallback.  This
+ *                            pointer may be \c NULL if the callback is not
+ *                            desired.
+ * \param  error_callback     See FLAC__StreamDecoderErrorCallback.  This
+ *                            pointer must not be \c NULL.
+ * \param  client_data        This value will be supplied to callbacks in their
+ *                            \a client_data argument.
+ * \assert
+ *    \code decoder != NULL \endcode
+ * \retval FLAC__StreamDecoderInitStatus
+ *    \c FLAC__STREAM_DECODER_INIT_STATUS_OK if initialization was successful;
+ *    see FLAC__StreamDecoderInitStatus for the meanings of other return values.
+ */
+FLAC_API FLAC__StreamDecoderInitStatus FLAC__stream_decoder_init_memory(
+	FLAC__StreamDecoder *decoder,
+	const FLAC__byte *data,
+	size_t length,
+	FLAC__StreamDecoderWriteCallback write_callback,
+	FLAC__StreamDecoderMetadataCallback metadata_callback,
+	FLAC__StreamDecoderErrorCallback error_callback,
+	void *client_data
+);
+
+/** Initialize the decoder instance to decode native FLAC files through a
+ *  memory mapping.
+ *
+ *  This is the same as FLAC__stream_decoder_init_file() except that, where
+ *  the platform supports mmap(), the file is mapped into memory and decoded
+ *  as with FLAC__stream_decoder_init_memory().  The mapping is released by
+ *  FLAC__stream_decoder_finish().  If the file cannot be mapped (or
+ *  \a filename is \c NULL) the file is read as FLAC__stream_decoder_init_file()
+ *  would.
+ *
+ *  \note The file must not be truncated while it is mapped.
+ *
+ * \param  decoder            An uninitialized decoder instance.
+ * \param  filename           The name of the file to decode from.  Use \c NULL
+ *                            to decode from \c stdin.  Note that \c stdin is
+ *                            not seekable.
+ * \param  write_callback     See FLAC__StreamDecoderWriteCallback.  This
+ *                            pointer may be \c NULL, in which case the
+ *                            audio must be pulled with
+ *                            FLAC__stream_decoder_read_samples().
+ * \param  metadata_callback  See FLAC__StreamDecoderMetadataCallback.  This
+ *                            pointer may be \c NULL if the callback is not
+ *                            desired.
+ * \param  error_callback     See FLAC__StreamDecoderErrorCallback.  This
+ *                            pointer must not be \c NULL.
+ * \param  client_data        This value will be supplied to callbacks in their
+ *                            \a client_data argument.
+ * \assert
+ *    \code decoder != NULL \endcode
+ * \retval FLAC__StreamDecoderInitStatus
+ *    \c FLAC__STREAM_DECODER_INIT_STATUS_OK if initialization was successful;
+ *    see FLAC__StreamDecoderInitStatus for the meanings of other return values.
+ */
+FLAC_API FLAC__StreamDecoderInitStatus FLAC__stream_decoder_init_mmap(
+	FLAC__StreamDecoder *decoder,
+	const char *filename,
+	FLAC__StreamDecoderWriteCallback write_callback,
+	FLAC__StreamDecoderMetadataCallback metadata_callback,
+	FLAC__StreamDecoderErrorCallback error_callback,
+	void *client_data
+);
+
 /** Finish the decoding process.
  *  Flushes the decoding buffer, releases resources, resets the decoder
  *  settings to their defaults, and returns the decoder state to
@@ -1491,6 +1950,80 @@ FLAC_API FLAC__bool FLAC__stream_decoder_process_until_end_of_metadata(FLAC__Str
  */
 FLAC_API FLAC__bool FLAC__stream_decoder_process_until_end_of_stream(FLAC__StreamDecoder *decoder);
 
+/** Decode until the end of the stream, using several threads.
+ *  This function produces the same calls to the metadata, write and
+ *  error callbacks as FLAC__stream_decoder_process_until_end_of_stream(),
+ *  in the same order, but decodes the audio frames on up to
+ *  \a num_threads threads.  The input is read ahead in large pieces
+ *  which are split into byte ranges, one per thread, using the
+ *  SEEKTABLE if the stream has one or else by scanning for frame sync
+ *  codes.  The frames are passed to the write callback in sample order
+ *  from the calling thread, and if MD5 checking is on, the signature of
+ *  the decoded audio is computed on a separate thread while the write
+ *  callback runs.
+ *
+ *  Parallel decoding requires the seek and tell callbacks and a
+ *  STREAMINFO block.  If they are missing, if the stream is Ogg FLAC,
+ *  if \a num_threads is \c 1 or less, or if libFLAC was built without
+ *  thread support, this function just calls
+ *  FLAC__stream_decoder_process_until_end_of_stream().  The same
+ *  happens, from the point of the problem on, when a corrupt frame is
+ *  found, so that errors are reported exactly as in serial decoding.
+ *
+ *  While frames are decoded in parallel, the subframe residual and
+ *  data pointers in the frame passed to the write callback are \c NULL
+ *  and FLAC__stream_decoder_get_decode_position() does not return
+ *  meaningful results from within the write callback.
+ *
+ * \param  decoder      An initialized decoder instance.
+ * \param  num_threads  The maximum number of threads to decode with.
+ * \assert
+ *    \code decoder != NULL \endcode
+ * \retval FLAC__bool
+ *    \c false if any fatal read, write, or memory allocation error
+ *    occurred (meaning decoding must stop), else \c true; for more
+ *    information about the decoder, check the decoder state with
+ *    FLAC__stream_decoder_get_state().
+ */
+FLAC_API FLAC__bool FLAC__stream_decoder_process_parallel(FLAC__StreamDecoder *decoder, uint32_t num_threads);
+
+/** Read decoded samples into buffers owned by the caller.
+ *  This is the pull-style alternative to the write callback.  It can
+ *  only be used if the decoder was initialized with a \c NULL
+ *  \a write_callback; otherwise it returns \c 0 without doing anything.
+ *  The function decodes as many frames as it needs (reading any
+ *  metadata first, with the same metadata and error callbacks as
+ *  FLAC__stream_decoder_process_single()) and copies the samples of
+ *  each channel into \a buffer, carrying over the rest of a frame that
+ *  does not fit to the next call.  Whole frames that fit into the part
+ *  of \a buffer past its first four samples are decoded directly into
+ *  it, without an intermediate copy.
+ *
+ *  After FLAC__stream_decoder_seek_absolute(), the next call returns
+ *  samples starting at the target sample.  With no write callback the
+ *  other process functions still decode, but the audio they produce is
+ *  only available to this function until the next frame is decoded;
+ *  FLAC__stream_decoder_process_parallel() decodes serially.
+ *
+ * \param  decoder  An initialized decoder instance with no write callback.
+ * \param  buffer   An array of pointers to one buffer per channel, each
+ *                  with room for \a samples samples.  The number of
+ *                  channels is available from
+ *                  FLAC__stream_decoder_get_channels() once the
+ *                  STREAMINFO block has been read, e.g. with
+ *                  FLAC__stream_decoder_process_until_end_of_metadata().
+ * \param  samples  The number of samples per channel to read.
+ * \assert
+ *    \code decoder != NULL \endcode
+ *    \code buffer != NULL \endcode
+ * \retval uint32_t
+ *    The number of samples per channel written to \a buffer.  If this
+ *    is less than \a samples, the end of the stream was reached or an
+ *    error occurred; check the decoder state with
+ *    FLAC__stream_decoder_get_state().
+ */
+FLAC_API uint32_t FLAC__stream_decoder_read_samples(FLAC__StreamDecoder *decoder, FLAC__int32 * const buffer[], uint32_t samples);
+
 /** Skip one audio frame.
  *  This version instructs the decoder to 'skip' a single frame and stop,
  *  unless the callbacks return a fatal error or the read callback returns
@@ -1550,6 +2083,107 @@ FLAC_API FLAC__bool FLAC__stream_decoder_skip_single_frame(FLAC__StreamDecoder *
  */
 FLAC_API FLAC__bool FLAC__stream_decoder_seek_absolute(FLAC__StreamDecoder *decoder, FLAC__uint64 sample);
 
+/** Get the cost of the last seek.
+ *  Fills \a stats with the I/O and decoding done by the last call to
+ *  FLAC__stream_decoder_seek_absolute(), whether or not it succeeded.
+ *  The counters are all zero until the first seek.
+ *
+ *  Without a frame index (see FLAC__stream_decoder_set_frame_index()),
+ *  the decoder remembers the frame boundaries it finds while seeking
+ *  and uses them to narrow down later seeks in the same stream, so
+ *  seeks close to earlier ones, as when scrubbing, take fewer
+ *  iterations.  FLAC__stream_decoder_reset() forgets them.
+ *
+ * \param  decoder  A decoder instance to query.
+ * \param  stats    Where to store the counters.
+ * \assert
+ *    \code decoder != NULL \endcode
+ *    \code stats != NULL \endcode
+ */
+FLAC_API void FLAC__stream_decoder_get_seek_stats(const FLAC__StreamDecoder *decoder, FLAC__StreamDecoderSeekStats *stats);
+
+/** Get the time spent in each decoding stage and how the frames decoded
+ *  since the decoder was last initialized were coded, for example how
+ *  many LPC subframes of each order or escaped residual partitions
+ *  there were.  Frames decoded while seeking are included, as are
+ *  frames that FLAC__stream_decoder_process_parallel() decodes twice
+ *  where its chunks overlap.
+ *
+ *  Statistics are only compiled in when libFLAC is configured with
+ *  \c --enable-statistics (autotools) or \c -DENABLE_STATISTICS=ON
+ *  (CMake); otherwise this returns \c false and \a statistics is
+ *  zeroed.
+ *
+ * \param  decoder     A decoder instance to query.
+ * \param  statistics  Address where the statistics will be stored.
+ * \assert
+ *    \code decoder != NULL \endcode
+ *    \code statistics != NULL \endcode
+ * \retval FLAC__bool
+ *    \c false if the library was built without statistics, else \c true.
+ */
+FLAC_API FLAC__bool FLAC__stream_decoder_get_statistics(const FLAC__StreamDecoder *decoder, FLAC__StreamDecoderStatistics *statistics);
+
+/** Get the name of the routine the decoder picked for one of its
+ *  CPU-dependent kernels when it was initialized, for example
+ *  \c "FLAC__lpc_restore_signal_intrin_avx2".  The choice depends on the
+ *  CPU features found at that time, restricted by
+ *  FLAC__set_cpu_feature_mask().
+ *
+ * \param  decoder  A decoder instance to query.
+ * \param  kernel   The kernel to look up.
+ * \assert
+ *    \code decoder != NULL \endcode
+ *    \code kernel < FLAC__STREAM_DECODER_KERNEL_COUNT \endcode
+ * \retval const char*
+ *    The routine's name, or \c NULL if the decoder has not been
+ *    initialized or does not use the kernel, as for
+ *    \c FLAC__STREAM_DECODER_KERNEL_PCM_INTERLEAVE without an interleaved
+ *    format.  The string is static and must not be freed.
+ */
+FLAC_API const char *FLAC__stream_decoder_get_kernel(const FLAC__StreamDecoder *decoder, FLAC__StreamDecoderKernel kernel);
+
+/** Get the number of bytes of memory the decoder instance currently
+ *  holds: the instance itself, its sample, residual, input and MD5
+ *  buffers, the seek table and any frame index it built.  The buffers
+ *  grow with the largest frame decoded so far and are released by
+ *  FLAC__stream_decoder_finish(), so the figure is most telling while
+ *  decoding.  Memory passed in by the client, such as the data given
+ *  to FLAC__stream_decoder_init_memory(), and any overhead of the
+ *  allocator itself are not counted, nor are the short-lived buffers
+ *  of FLAC__stream_decoder_process_parallel().
+ *
+ * \param  decoder  A decoder instance to query.
+ * \assert
+ *    \code decoder != NULL \endcode
+ * \retval size_t
+ *    The footprint in bytes.
+ */
+FLAC_API size_t FLAC__stream_decoder_get_footprint(const FLAC__StreamDecoder *decoder);
+
+/** Scan the stream once and index every frame for seeking.
+ *  The decoder reads any remaining metadata, then skips through all the
+ *  frames from the first one as FLAC__stream_decoder_skip_single_frame()
+ *  does, recording the offset, first sample and size of each.  The
+ *  result becomes the decoder's frame index (see
+ *  FLAC__stream_decoder_set_frame_index()) and is available from
+ *  FLAC__stream_decoder_get_frame_index(), for instance to clone with
+ *  FLAC__metadata_object_clone() and store for the next time the
+ *  stream is opened.  Afterwards the decoder is back at the first frame,
+ *  as after a seek, so MD5 checking is off.
+ *
+ *  Like seeking, this needs the seek callback, and it does not work
+ *  with Ogg FLAC.
+ *
+ * \param  decoder  An initialized decoder instance.
+ * \assert
+ *    \code decoder != NULL \endcode
+ * \retval FLAC__bool
+ *    \c true if successful, else \c false; check the decoder state
+ *    with FLAC__stream_decoder_get_state() for the reason.
+ */
+FLAC_API FLAC__bool FLAC__stream_decoder_build_frame_index(FLAC__StreamDecoder *decoder);
+
 /** Return client_data from decoder.
  *  The data pointed to by the pointer should not be modified.
  *
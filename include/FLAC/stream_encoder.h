@@ -450,6 +450,124 @@ typedef enum {
 extern FLAC_API const char * const FLAC__StreamEncoderTellStatusString[];
 
 
+/** The encoder stages timed by FLAC__stream_encoder_get_statistics().
+ */
+typedef enum {
+
+	FLAC__STREAM_ENCODER_STAGE_WINDOW,
+	/**< Applying apodization windows to the signal before LPC analysis. */
+
+	FLAC__STREAM_ENCODER_STAGE_AUTOCORRELATION,
+	/**< Computing the autocorrelation of the windowed signal. */
+
+	FLAC__STREAM_ENCODER_STAGE_LP_COEFFICIENTS,
+	/**< Levinson-Durbin recursion producing the LP coefficients. */
+
+	FLAC__STREAM_ENCODER_STAGE_QUANTIZATION,
+	/**< Quantizing LP coefficients to the chosen precision. */
+
+	FLAC__STREAM_ENCODER_STAGE_RESIDUAL,
+	/**< Computing fixed and LPC prediction residuals. */
+
+	FLAC__STREAM_ENCODER_STAGE_PARTITION_SUMS,
+	/**< Precomputing per-partition residual sums. */
+
+	FLAC__STREAM_ENCODER_STAGE_RICE_SEARCH,
+	/**< Searching for the best partition order and Rice parameters. */
+
+	FLAC__STREAM_ENCODER_STAGE_PACKING,
+	/**< Packing frame headers, subframes and footers into the bitwriter. */
+
+	FLAC__STREAM_ENCODER_STAGE_MD5,
+	/**< Updating the MD5 signature of the input (or handing the samples
+	 * to the MD5 thread when FLAC__stream_encoder_set_threaded_md5() is
+	 * in effect). */
+
+	FLAC__STREAM_ENCODER_STAGE_VERIFY,
+	/**< Decoding frames again when FLAC__stream_encoder_set_verify() is
+	 * in effect. */
+
+	FLAC__STREAM_ENCODER_STAGE_WRITE_CALLBACK,
+	/**< Time spent in the client's write callback. */
+
+	FLAC__STREAM_ENCODER_STAGE_COUNT
+	/**< The number of stages; not a stage itself. */
+
+} FLAC__StreamEncoderStage;
+
+/** Maps a FLAC__StreamEncoderStage to a C string.
+ *
+ *  Using a FLAC__StreamEncoderStage as the index to this array
+ *  will give the string equivalent.  The contents should not be modified.
+ */
+extern FLAC_API const char * const FLAC__StreamEncoderStageString[];
+
+/** Per-stage timings returned by FLAC__stream_encoder_get_statistics().
+ *  Both arrays are indexed by FLAC__StreamEncoderStage.
+ */
+typedef struct {
+	FLAC__uint64 nanoseconds[FLAC__STREAM_ENCODER_STAGE_COUNT];
+	/**< Total wall-clock time spent in each stage.  When frames are
+	 * encoded by several threads, time spent in parallel is summed. */
+
+	FLAC__uint64 calls[FLAC__STREAM_ENCODER_STAGE_COUNT];
+	/**< The number of times each stage was entered. */
+} FLAC__StreamEncoderStatistics;
+
+
+/** The CPU-dependent routines reported by
+ *  FLAC__stream_encoder_get_kernel().
+ */
+typedef enum {
+
+	FLAC__STREAM_ENCODER_KERNEL_LPC_AUTOCORRELATION,
+	/**< Computes the autocorrelation of the windowed signal.  Some
+	 * routines are specialized for the maximum LPC order, so the choice
+	 * also depends on FLAC__stream_encoder_set_max_lpc_order(). */
+
+	FLAC__STREAM_ENCODER_KERNEL_FIXED_BEST_PREDICTOR,
+	/**< Estimates the best fixed predictor order. */
+
+	FLAC__STREAM_ENCODER_KERNEL_FIXED_BEST_PREDICTOR_WIDE,
+	/**< Estimates the best fixed predictor order for signals that need
+	 * 64-bit intermediates. */
+
+	FLAC__STREAM_ENCODER_KERNEL_LPC_RESIDUAL,
+	/**< Computes the LPC residual when the samples fit in 32 bits. */
+
+	FLAC__STREAM_ENCODER_KERNEL_LPC_RESIDUAL_64BIT,
+	/**< Computes the LPC residual when 64-bit intermediates are needed. */
+
+	FLAC__STREAM_ENCODER_KERNEL_LPC_RESIDUAL_16BIT,
+	/**< Computes the LPC residual with small enough samples and
+	 * coefficients for 16-bit arithmetic. */
+
+	FLAC__STREAM_ENCODER_KERNEL_PARTITION_SUMS,
+	/**< Sums the absolute residual of each partition for the Rice
+	 * parameter search. */
+
+	FLAC__STREAM_ENCODER_KERNEL_PCM_DEINTERLEAVE_INT16,
+	/**< Splits the input of FLAC__stream_encoder_process_interleaved_int16(). */
+
+	FLAC__STREAM_ENCODER_KERNEL_PCM_DEINTERLEAVE_INT24,
+	/**< Splits the input of FLAC__stream_encoder_process_interleaved_int24(). */
+
+	FLAC__STREAM_ENCODER_KERNEL_PCM_DEINTERLEAVE_FLOAT32,
+	/**< Splits the input of FLAC__stream_encoder_process_interleaved_float32(). */
+
+	FLAC__STREAM_ENCODER_KERNEL_COUNT
+	/**< The number of kernels; not a kernel itself. */
+
+} FLAC__StreamEncoderKernel;
+
+/** Maps a FLAC__StreamEncoderKernel to a C string.
+ *
+ *  Using a FLAC__StreamEncoderKernel as the index to this array
+ *  will give the string equivalent.  The contents should not be modified.
+ */
+extern FLAC_API const char * const FLAC__StreamEncoderKernelString[];
+
+
 /***********************************************************************
  *
  * class FLAC__StreamEncoder
@@ -693,6 +811,23 @@ typedef void (*FLAC__StreamEncoderProgressCallback)(const FLAC__StreamEncoder *e
  */
 FLAC_API FLAC__StreamEncoder *FLAC__stream_encoder_new(void);
 
+/** Create a new stream encoder instance like FLAC__stream_encoder_new(),
+ *  but with all of the memory it allocates, for itself and while it
+ *  runs, coming from \a allocator instead of the global allocator (see
+ *  FLAC__set_allocator()).  The allocator is copied, and must be usable
+ *  until FLAC__stream_encoder_delete() returns; it may be called from
+ *  the encoder's worker threads, if any.  The apodization windows,
+ *  which encoders with the same settings share, come from the global
+ *  allocator, as do the points of the client's \c SEEKTABLE given to
+ *  FLAC__stream_encoder_set_frame_index(), since the client frees it.
+ *
+ * \param allocator  The allocator, or \c NULL for the current global
+ *                   allocator.
+ * \retval FLAC__StreamEncoder*
+ *    \c NULL if there was an error allocating memory, else the new instance.
+ */
+FLAC_API FLAC__StreamEncoder *FLAC__stream_encoder_new_with_allocator(const FLAC__Allocator *allocator);
+
 /** Free an encoder instance.  Deletes the object pointed to by \a encoder.
  *
  * \param encoder  A pointer to an existing encoder.
@@ -1103,6 +1238,106 @@ FLAC_API FLAC__bool FLAC__stream_encoder_set_max_residual_partition_order(FLAC__
  */
 FLAC_API FLAC__bool FLAC__stream_encoder_set_rice_parameter_search_dist(FLAC__StreamEncoder *encoder, uint32_t value);
 
+/** Set the number of threads used to encode frames.  With a value
+ *  greater than \c 1, the encoder hands whole blocks to a pool of
+ *  worker threads so that several frames are encoded at the same
+ *  time.  Frames are still passed to the write callback in order and
+ *  with the same contents the single-threaded encoder would produce,
+ *  except that loose mid-side stereo is turned off, since it makes
+ *  each frame depend on the previous one.
+ *
+ *  The encoder buffers up to twice \a value blocks of input before
+ *  the first frame is written, so the callbacks lag further behind
+ *  the calls to FLAC__stream_encoder_process() than usual.
+ *
+ * \note
+ * This setting is only available if libFLAC was built with
+ * multithreading support.  Otherwise only \c 1 is accepted.
+ *
+ * \default \c 1
+ * \param  encoder  An encoder instance to set.
+ * \param  value    The number of worker threads, from \c 1 up to
+ *                  \c 64.
+ * \assert
+ *    \code encoder != NULL \endcode
+ * \retval FLAC__bool
+ *    \c false if the encoder is already initialized, if \a value is
+ *    out of range, or if multithreading is not supported, else
+ *    \c true.
+ */
+FLAC_API FLAC__bool FLAC__stream_encoder_set_num_threads(FLAC__StreamEncoder *encoder, uint32_t value);
+
+/** Set to \c true to have the threads set by
+ *  FLAC__stream_encoder_set_num_threads() search the subframes of
+ *  each frame in parallel instead of encoding several frames at once.
+ *  Every channel (and for stereo, the mid and side channels) is
+ *  searched on its own thread, and each frame is written as soon as it
+ *  is finished, so the callbacks do not lag behind as they do with
+ *  frame-parallel encoding.  This is meant for low-latency encoding of
+ *  streams with many channels; no more threads are used than there
+ *  are subframes to search, and loose mid-side stereo stays available.
+ *
+ * \default \c false
+ * \param  encoder  An encoder instance to set.
+ * \param  value    Flag value (see above).
+ * \assert
+ *    \code encoder != NULL \endcode
+ * \retval FLAC__bool
+ *    \c false if the encoder is already initialized, else \c true.
+ */
+FLAC_API FLAC__bool FLAC__stream_encoder_set_parallel_subframes(FLAC__StreamEncoder *encoder, FLAC__bool value);
+
+/** Set to \c true to compute the MD5 signature (see
+ *  FLAC__stream_encoder_set_do_md5()) on a thread of its own.  The
+ *  calling thread only converts each block to the byte layout that is
+ *  hashed and queues it; the hashing itself overlaps with encoding.
+ *  At most a few blocks are queued at a time, and the thread is joined
+ *  in FLAC__stream_encoder_finish().  The signature is the same either
+ *  way.  If the thread cannot be started, the signature is computed
+ *  inline as usual.
+ *
+ * \note
+ * This setting is only available if libFLAC was built with
+ * multithreading support.  Otherwise only \c false is accepted.
+ *
+ * \default \c false
+ * \param  encoder  An encoder instance to set.
+ * \param  value    Flag value (see above).
+ * \assert
+ *    \code encoder != NULL \endcode
+ * \retval FLAC__bool
+ *    \c false if the encoder is already initialized, or if \a value
+ *    is \c true and multithreading is not supported, else \c true.
+ */
+FLAC_API FLAC__bool FLAC__stream_encoder_set_threaded_md5(FLAC__StreamEncoder *encoder, FLAC__bool value);
+
+/** Set to \c true to have the next FLAC__stream_encoder_finish() leave
+ *  the signal and residual buffers in place, so that the following
+ *  init can reuse them instead of allocating them again.  This is
+ *  meant for applications that encode many short streams with one
+ *  encoder instance.  The buffers are reused as long as the new
+ *  blocksize fits; otherwise they are freed and allocated anew.  Other
+ *  settings may change between the streams; buffers that the new ones
+ *  need and the old ones did not, such as those for another channel or
+ *  for mid-side stereo, are allocated by the init.  Kept buffers are
+ *  freed by FLAC__stream_encoder_delete() at the latest.
+ *
+ * \note
+ * FLAC__stream_encoder_finish() resets this flag to \c false, like all
+ * other settings, once it has kept the buffers.  It has to be set
+ * before \b every init whose buffers should be kept, not only the
+ * first one; a finish after an init without it frees the buffers.
+ *
+ * \default \c false
+ * \param  encoder  An encoder instance to set.
+ * \param  value    Flag value (see above).
+ * \assert
+ *    \code encoder != NULL \endcode
+ * \retval FLAC__bool
+ *    \c false if the encoder is already initialized, else \c true.
+ */
+FLAC_API FLAC__bool FLAC__stream_encoder_set_keep_buffers(FLAC__StreamEncoder *encoder, FLAC__bool value);
+
 /** Set an estimate of the total samples that will be encoded.
  *  This is merely an estimate and may be set to \c 0 if unknown.
  *  This value will be written to the STREAMINFO block before encoding,
@@ -1202,6 +1437,36 @@ FLAC_API FLAC__bool FLAC__stream_encoder_set_total_samples_estimate(FLAC__Stream
  */
 FLAC_API FLAC__bool FLAC__stream_encoder_set_metadata(FLAC__StreamEncoder *encoder, FLAC__StreamMetadata **metadata, uint32_t num_blocks);
 
+/** Record an index of every frame while encoding.
+ *  The encoder replaces the points of \a index, which must be a
+ *  \c SEEKTABLE object, with one seek point per frame written, giving
+ *  the frame's first sample, its offset from the first frame and its
+ *  number of samples.  Once FLAC__stream_encoder_finish() returns the
+ *  index is complete and can be stored by the client, e.g. in a sidecar
+ *  file, and given to FLAC__stream_decoder_set_frame_index() to seek in
+ *  the stream without searching.
+ *
+ *  Like the seek points of a SEEKTABLE, the offsets are only known if
+ *  the encoder can tell the output position, i.e. when encoding to a
+ *  file or memory, or with a tell callback.  No index is recorded for
+ *  Ogg FLAC.
+ *
+ * \note
+ * The encoder does not copy \a index; it must survive at least until
+ * after FLAC__stream_encoder_finish() returns, and it is up to the
+ * caller to free it.
+ *
+ * \default \c NULL
+ * \param  encoder  An encoder instance to set.
+ * \param  index    A \c SEEKTABLE object to fill, or \c NULL for none.
+ * \assert
+ *    \code encoder != NULL \endcode
+ * \retval FLAC__bool
+ *    \c false if the encoder is already initialized, or if \a index is
+ *    not a \c SEEKTABLE, else \c true.
+ */
+FLAC_API FLAC__bool FLAC__stream_encoder_set_frame_index(FLAC__StreamEncoder *encoder, FLAC__StreamMetadata *index);
+
 /** Get the current encoder state.
  *
  * \param  encoder  An encoder instance to query.
@@ -1416,6 +1681,46 @@ FLAC_API uint32_t FLAC__stream_encoder_get_max_residual_partition_order(const FL
  */
 FLAC_API uint32_t FLAC__stream_encoder_get_rice_parameter_search_dist(const FLAC__StreamEncoder *encoder);
 
+/** Get the number of encoding threads.
+ *
+ * \param  encoder  An encoder instance to query.
+ * \assert
+ *    \code encoder != NULL \endcode
+ * \retval uint32_t
+ *    See FLAC__stream_encoder_set_num_threads().
+ */
+FLAC_API uint32_t FLAC__stream_encoder_get_num_threads(const FLAC__StreamEncoder *encoder);
+
+/** Get the "parallel subframes" flag.
+ *
+ * \param  encoder  An encoder instance to query.
+ * \assert
+ *    \code encoder != NULL \endcode
+ * \retval FLAC__bool
+ *    See FLAC__stream_encoder_set_parallel_subframes().
+ */
+FLAC_API FLAC__bool FLAC__stream_encoder_get_parallel_subframes(const FLAC__StreamEncoder *encoder);
+
+/** Get the "threaded MD5" flag.
+ *
+ * \param  encoder  An encoder instance to query.
+ * \assert
+ *    \code encoder != NULL \endcode
+ * \retval FLAC__bool
+ *    See FLAC__stream_encoder_set_threaded_md5().
+ */
+FLAC_API FLAC__bool FLAC__stream_encoder_get_threaded_md5(const FLAC__StreamEncoder *encoder);
+
+/** Get the "keep buffers" flag.
+ *
+ * \param  encoder  An encoder instance to query.
+ * \assert
+ *    \code encoder != NULL \endcode
+ * \retval FLAC__bool
+ *    See FLAC__stream_encoder_set_keep_buffers().
+ */
+FLAC_API FLAC__bool FLAC__stream_encoder_get_keep_buffers(const FLAC__StreamEncoder *encoder);
+
 /** Get the previously set estimate of the total samples to be encoded.
  *  The encoder merely mimics back the value given to
  *  FLAC__stream_encoder_set_total_samples_estimate() since it has no
@@ -1429,6 +1734,45 @@ FLAC_API uint32_t FLAC__stream_encoder_get_rice_parameter_search_dist(const FLAC
  */
 FLAC_API FLAC__uint64 FLAC__stream_encoder_get_total_samples_estimate(const FLAC__StreamEncoder *encoder);
 
+/** Get the time spent in each encoder stage since the encoder was last
+ *  initialized.  The counters are kept across
+ *  FLAC__stream_encoder_finish(), so they can be read once encoding is
+ *  complete, and are reset by the next init.
+ *
+ *  Timing is only compiled in when libFLAC is configured with
+ *  \c --enable-statistics (autotools) or \c -DENABLE_STATISTICS=ON
+ *  (CMake); otherwise this returns \c false and \a statistics is
+ *  zeroed.
+ *
+ * \param  encoder     An encoder instance to query.
+ * \param  statistics  Address where the statistics will be stored.
+ * \assert
+ *    \code encoder != NULL \endcode
+ *    \code statistics != NULL \endcode
+ * \retval FLAC__bool
+ *    \c false if the library was built without statistics, else \c true.
+ */
+FLAC_API FLAC__bool FLAC__stream_encoder_get_statistics(const FLAC__StreamEncoder *encoder, FLAC__StreamEncoderStatistics *statistics);
+
+/** Get the name of the routine the encoder picked for one of its
+ *  CPU-dependent kernels when it was initialized, for example
+ *  \c "FLAC__lpc_compute_residual_from_qlp_coefficients_intrin_avx2".
+ *  The choice depends on the CPU features found at that time, restricted
+ *  by FLAC__set_cpu_feature_mask().
+ *
+ * \param  encoder  An encoder instance to query.
+ * \param  kernel   The kernel to look up.
+ * \assert
+ *    \code encoder != NULL \endcode
+ *    \code kernel < FLAC__STREAM_ENCODER_KERNEL_COUNT \endcode
+ * \retval const char*
+ *    The routine's name, or \c NULL if the encoder has not been
+ *    initialized or the library does not have the kernel, as for the
+ *    floating-point LPC kernels in an integer-only build.  The string is
+ *    static and must not be freed.
+ */
+FLAC_API const char *FLAC__stream_encoder_get_kernel(const FLAC__StreamEncoder *encoder, FLAC__StreamEncoderKernel kernel);
+
 /** Initialize the encoder instance to encode native FLAC streams.
  *
  *  This flavor of initialization sets up the encoder to encode to a
@@ -1694,10 +2038,44 @@ FLAC_API FLAC__StreamEncoderInitStatus FLAC__stream_encoder_init_file(FLAC__Stre
  */
 FLAC_API FLAC__StreamEncoderInitStatus FLAC__stream_encoder_init_ogg_file(FLAC__StreamEncoder *encoder, const char *filename, FLAC__StreamEncoderProgressCallback progress_callback, void *client_data);
 
+/** Initialize the encoder instance to encode native FLAC into memory.
+ *
+ *  This flavor of initialization sets up the encoder to encode into a
+ *  buffer that the library allocates and grows as needed.  Since the buffer
+ *  is seekable, the STREAMINFO and SEEKTABLE blocks are fixed up at the end
+ *  just as with FLAC__stream_encoder_init_file().  Use
+ *  FLAC__stream_encoder_finish_memory() instead of
+ *  FLAC__stream_encoder_finish() to take the encoded stream; plain
+ *  FLAC__stream_encoder_finish() discards it.
+ *
+ *  If FLAC__stream_encoder_set_total_samples_estimate() was called, the
+ *  first allocation is sized from the estimate.
+ *
+ *  This function should be called after FLAC__stream_encoder_new() and
+ *  FLAC__stream_encoder_set_*() but before FLAC__stream_encoder_process()
+ *  or FLAC__stream_encoder_process_interleaved().
+ *  initialization succeeded.
+ *
+ * \param  encoder            An uninitialized encoder instance.
+ * \param  progress_callback  See FLAC__StreamEncoderProgressCallback.  This
+ *                            pointer may be \c NULL if the callback is not
+ *                            desired.
+ * \param  client_data        This value will be supplied to callbacks in their
+ *                            \a client_data argument.
+ * \assert
+ *    \code encoder != NULL \endcode
+ * \retval FLAC__StreamEncoderInitStatus
+ *    \c FLAC__STREAM_ENCODER_INIT_STATUS_OK if initialization was successful;
+ *    see FLAC__StreamEncoderInitStatus for the meanings of other return values.
+ */
+FLAC_API FLAC__StreamEncoderInitStatus FLAC__stream_encoder_init_memory(FLAC__StreamEncoder *encoder, FLAC__StreamEncoderProgressCallback progress_callback, void *client_data);
+
 /** Finish the encoding process.
  *  Flushes the encoding buffer, releases resources, resets the encoder
  *  settings to their defaults, and returns the encoder state to
- *  FLAC__STREAM_ENCODER_UNINITIALIZED.  Note that this can generate
+ *  FLAC__STREAM_ENCODER_UNINITIALIZED.  The settings reset include the
+ *  one made with FLAC__stream_encoder_set_keep_buffers(), which is
+ *  honored before it is reset.  Note that this can generate
  *  one or more write callbacks before returning, and will generate
  *  a metadata callback.
  *
@@ -1722,6 +2100,31 @@ FLAC_API FLAC__StreamEncoderInitStatus FLAC__stream_encoder_init_ogg_file(FLAC__
  */
 FLAC_API FLAC__bool FLAC__stream_encoder_finish(FLAC__StreamEncoder *encoder);
 
+/** Finish the encoding process and take the encoded stream.
+ *  The same as FLAC__stream_encoder_finish(), but for an encoder set up
+ *  with FLAC__stream_encoder_init_memory() it also hands over the buffer
+ *  holding the complete stream, with the STREAMINFO and SEEKTABLE blocks
+ *  already updated.  The caller owns the buffer from then on and must
+ *  release it with free(), or with the release function of the
+ *  allocator the encoder was created with if it was created by
+ *  FLAC__stream_encoder_new_with_allocator() or while an allocator was
+ *  set with FLAC__set_allocator().
+ *
+ * \param  encoder  An encoder instance.
+ * \param  data     Where to store the address of the encoded stream.
+ *                  This is set to \c NULL if there is no stream to return,
+ *                  i.e. on an error or if the encoder was not initialized
+ *                  with FLAC__stream_encoder_init_memory().
+ * \param  length   Where to store the length of the stream in bytes.
+ * \assert
+ *    \code encoder != NULL \endcode
+ *    \code data != NULL \endcode
+ *    \code length != NULL \endcode
+ * \retval FLAC__bool
+ *    As for FLAC__stream_encoder_finish().
+ */
+FLAC_API FLAC__bool FLAC__stream_encoder_finish_memory(FLAC__StreamEncoder *encoder, FLAC__byte **data, size_t *length);
+
 /** Submit data for encoding.
  *  This version allows you to supply the input data via an array of
  *  pointers, each pointer pointing to an array of \a samples samples
@@ -1781,6 +2184,77 @@ FLAC_API FLAC__bool FLAC__stream_encoder_process(FLAC__StreamEncoder *encoder, c
  */
 FLAC_API FLAC__bool FLAC__stream_encoder_process_interleaved(FLAC__StreamEncoder *encoder, const FLAC__int32 buffer[], uint32_t samples);
 
+/** Submit interleaved 16-bit data for encoding.
+ *  This is the same as FLAC__stream_encoder_process_interleaved() except
+ *  that each sample is a \c FLAC__int16, which saves the client widening
+ *  its buffer to \c FLAC__int32 first.  The samples are not rescaled, so
+ *  they must still be right-justified to the resolution set by
+ *  FLAC__stream_encoder_set_bits_per_sample(); usually that is 16.
+ *
+ *  If a sample is out of range for the resolution, the encoder state is
+ *  set to \c FLAC__STREAM_ENCODER_CLIENT_ERROR and \c false is returned.
+ *
+ * \param  encoder  An initialized encoder instance in the OK state.
+ * \param  buffer   An array of channel-interleaved data.
+ * \param  samples  The number of samples in one channel.
+ * \assert
+ *    \code encoder != NULL \endcode
+ *    \code FLAC__stream_encoder_get_state(encoder) == FLAC__STREAM_ENCODER_OK \endcode
+ * \retval FLAC__bool
+ *    \c true if successful, else \c false; in this case, check the
+ *    encoder state with FLAC__stream_encoder_get_state() to see what
+ *    went wrong.
+ */
+FLAC_API FLAC__bool FLAC__stream_encoder_process_interleaved_int16(FLAC__StreamEncoder *encoder, const FLAC__int16 buffer[], uint32_t samples);
+
+/** Submit interleaved packed 24-bit data for encoding.
+ *  This is the same as FLAC__stream_encoder_process_interleaved_int16()
+ *  except that each sample is 3 bytes, little-endian, with no padding,
+ *  as found in 24-bit WAVE files.  \a buffer therefore holds
+ *  3 * channels * \a samples bytes.
+ *
+ * \param  encoder  An initialized encoder instance in the OK state.
+ * \param  buffer   An array of channel-interleaved data.
+ * \param  samples  The number of samples in one channel.
+ * \assert
+ *    \code encoder != NULL \endcode
+ *    \code FLAC__stream_encoder_get_state(encoder) == FLAC__STREAM_ENCODER_OK \endcode
+ * \retval FLAC__bool
+ *    \c true if successful, else \c false; in this case, check the
+ *    encoder state with FLAC__stream_encoder_get_state() to see what
+ *    went wrong.
+ */
+FLAC_API FLAC__bool FLAC__stream_encoder_process_interleaved_int24(FLAC__StreamEncoder *encoder, const FLAC__byte buffer[], uint32_t samples);
+
+/** Submit interleaved floating-point data for encoding.
+ *  This is the same as FLAC__stream_encoder_process_interleaved() except
+ *  that each sample is a \c float in the range [-1.0,1.0), which is
+ *  scaled by 2^(bits_per_sample-1) to get the integer sample.
+ *
+ *  Since FLAC is lossless, every scaled sample must be exactly an
+ *  integer in range, e.g. a multiple of 1/32768 for 16 bits per sample.
+ *  This holds for float data that was converted from integer PCM of the
+ *  same or lower resolution and not processed since.  If any sample does
+ *  not pass the check (including NaN), the encoder state is set to
+ *  \c FLAC__STREAM_ENCODER_CLIENT_ERROR and \c false is returned.
+ *
+ *  This function is not available if the library was built with
+ *  FLAC__INTEGER_ONLY_LIBRARY; it always sets the state to
+ *  \c FLAC__STREAM_ENCODER_CLIENT_ERROR in that case.
+ *
+ * \param  encoder  An initialized encoder instance in the OK state.
+ * \param  buffer   An array of channel-interleaved data.
+ * \param  samples  The number of samples in one channel.
+ * \assert
+ *    \code encoder != NULL \endcode
+ *    \code FLAC__stream_encoder_get_state(encoder) == FLAC__STREAM_ENCODER_OK \endcode
+ * \retval FLAC__bool
+ *    \c true if successful, else \c false; in this case, check the
+ *    encoder state with FLAC__stream_encoder_get_state() to see what
+ *    went wrong.
+ */
+FLAC_API FLAC__bool FLAC__stream_encoder_process_interleaved_float32(FLAC__StreamEncoder *encoder, const float buffer[], uint32_t samples);
+
 /* \} */
 
 #ifdef __cplusplus
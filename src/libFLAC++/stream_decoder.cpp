@@ -55,6 +55,10 @@ namespace FLAC {
 		decoder_(::FLAC__stream_decoder_new())
 		{ }
 
+		Stream::Stream(const ::FLAC__Allocator *allocator):
+		decoder_(::FLAC__stream_decoder_new_with_allocator(allocator))
+		{ }
+
 		Stream::~Stream()
 		{
 			if(0 != decoder_) {
@@ -80,6 +84,30 @@ namespace FLAC {
 			return static_cast<bool>(::FLAC__stream_decoder_set_md5_checking(decoder_, value));
 		}
 
+		bool Stream::set_threaded_md5(bool value)
+		{
+			FLAC__ASSERT(is_valid());
+			return static_cast<bool>(::FLAC__stream_decoder_set_threaded_md5(decoder_, value));
+		}
+
+		bool Stream::set_interleaved_format(::FLAC__StreamDecoderInterleavedFormat format)
+		{
+			FLAC__ASSERT(is_valid());
+			return static_cast<bool>(::FLAC__stream_decoder_set_interleaved_format(decoder_, format));
+		}
+
+		bool Stream::set_low_footprint(bool value)
+		{
+			FLAC__ASSERT(is_valid());
+			return static_cast<bool>(::FLAC__stream_decoder_set_low_footprint(decoder_, value));
+		}
+
+		bool Stream::set_frame_index(const ::FLAC__StreamMetadata *index)
+		{
+			FLAC__ASSERT(is_valid());
+			return static_cast<bool>(::FLAC__stream_decoder_set_frame_index(decoder_, index));
+		}
+
 		bool Stream::set_metadata_respond(::FLAC__MetadataType type)
 		{
 			FLAC__ASSERT(is_valid());
@@ -128,6 +156,60 @@ namespace FLAC {
 			return static_cast<bool>(::FLAC__stream_decoder_get_md5_checking(decoder_));
 		}
 
+		bool Stream::get_threaded_md5() const
+		{
+			FLAC__ASSERT(is_valid());
+			return static_cast<bool>(::FLAC__stream_decoder_get_threaded_md5(decoder_));
+		}
+
+		::FLAC__StreamDecoderInterleavedFormat Stream::get_interleaved_format() const
+		{
+			FLAC__ASSERT(is_valid());
+			return ::FLAC__stream_decoder_get_interleaved_format(decoder_);
+		}
+
+		bool Stream::get_low_footprint() const
+		{
+			FLAC__ASSERT(is_valid());
+			return static_cast<bool>(::FLAC__stream_decoder_get_low_footprint(decoder_));
+		}
+
+		const void *Stream::get_interleaved_buffer() const
+		{
+			FLAC__ASSERT(is_valid());
+			return ::FLAC__stream_decoder_get_interleaved_buffer(decoder_);
+		}
+
+		const ::FLAC__StreamMetadata *Stream::get_frame_index() const
+		{
+			FLAC__ASSERT(is_valid());
+			return ::FLAC__stream_decoder_get_frame_index(decoder_);
+		}
+
+		void Stream::get_seek_stats(::FLAC__StreamDecoderSeekStats *stats) const
+		{
+			FLAC__ASSERT(is_valid());
+			::FLAC__stream_decoder_get_seek_stats(decoder_, stats);
+		}
+
+		bool Stream::get_statistics(::FLAC__StreamDecoderStatistics *statistics) const
+		{
+			FLAC__ASSERT(is_valid());
+			return static_cast<bool>(::FLAC__stream_decoder_get_statistics(decoder_, statistics));
+		}
+
+		const char *Stream::get_kernel(::FLAC__StreamDecoderKernel kernel) const
+		{
+			FLAC__ASSERT(is_valid());
+			return ::FLAC__stream_decoder_get_kernel(decoder_, kernel);
+		}
+
+		size_t Stream::get_footprint() const
+		{
+			FLAC__ASSERT(is_valid());
+			return ::FLAC__stream_decoder_get_footprint(decoder_);
+		}
+
 		FLAC__uint64 Stream::get_total_samples() const
 		{
 			FLAC__ASSERT(is_valid());
@@ -218,6 +300,12 @@ namespace FLAC {
 			return static_cast<bool>(::FLAC__stream_decoder_process_until_end_of_stream(decoder_));
 		}
 
+		bool Stream::process_parallel(uint32_t num_threads)
+		{
+			FLAC__ASSERT(is_valid());
+			return static_cast<bool>(::FLAC__stream_decoder_process_parallel(decoder_, num_threads));
+		}
+
 		bool Stream::skip_single_frame()
 		{
 			FLAC__ASSERT(is_valid());
@@ -230,6 +318,12 @@ namespace FLAC {
 			return static_cast<bool>(::FLAC__stream_decoder_seek_absolute(decoder_, sample));
 		}
 
+		bool Stream::build_frame_index()
+		{
+			FLAC__ASSERT(is_valid());
+			return static_cast<bool>(::FLAC__stream_decoder_build_frame_index(decoder_));
+		}
+
 		::FLAC__StreamDecoderSeekStatus Stream::seek_callback(FLAC__uint64 absolute_byte_offset)
 		{
 			(void)absolute_byte_offset;
@@ -340,6 +434,10 @@ namespace FLAC {
 			Stream()
 		{ }
 
+		File::File(const ::FLAC__Allocator *allocator):
+			Stream(allocator)
+		{ }
+
 		File::~File()
 		{
 		}
@@ -378,6 +476,23 @@ namespace FLAC {
 			return init_ogg(filename.c_str());
 		}
 
+		::FLAC__StreamDecoderInitStatus File::init_memory(const FLAC__byte *data, size_t length)
+		{
+			FLAC__ASSERT(0 != decoder_);
+			return ::FLAC__stream_decoder_init_memory(decoder_, data, length, write_callback_, metadata_callback_, error_callback_, /*client_data=*/(void*)this);
+		}
+
+		::FLAC__StreamDecoderInitStatus File::init_mmap(const char *filename)
+		{
+			FLAC__ASSERT(0 != decoder_);
+			return ::FLAC__stream_decoder_init_mmap(decoder_, filename, write_callback_, metadata_callback_, error_callback_, /*client_data=*/(void*)this);
+		}
+
+		::FLAC__StreamDecoderInitStatus File::init_mmap(const std::string &filename)
+		{
+			return init_mmap(filename.c_str());
+		}
+
 		// This is a dummy to satisfy the pure virtual from Stream; the
 		// read callback will never be called since we are initializing
 		// with FLAC__stream_decoder_init_FILE() or
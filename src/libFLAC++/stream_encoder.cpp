@@ -56,6 +56,10 @@ namespace FLAC {
 		encoder_(::FLAC__stream_encoder_new())
 		{ }
 
+		Stream::Stream(const ::FLAC__Allocator *allocator):
+		encoder_(::FLAC__stream_encoder_new_with_allocator(allocator))
+		{ }
+
 		Stream::~Stream()
 		{
 			if(0 != encoder_) {
@@ -183,6 +187,30 @@ namespace FLAC {
 			return static_cast<bool>(::FLAC__stream_encoder_set_rice_parameter_search_dist(encoder_, value));
 		}
 
+		bool Stream::set_num_threads(uint32_t value)
+		{
+			FLAC__ASSERT(is_valid());
+			return static_cast<bool>(::FLAC__stream_encoder_set_num_threads(encoder_, value));
+		}
+
+		bool Stream::set_parallel_subframes(bool value)
+		{
+			FLAC__ASSERT(is_valid());
+			return static_cast<bool>(::FLAC__stream_encoder_set_parallel_subframes(encoder_, value));
+		}
+
+		bool Stream::set_threaded_md5(bool value)
+		{
+			FLAC__ASSERT(is_valid());
+			return static_cast<bool>(::FLAC__stream_encoder_set_threaded_md5(encoder_, value));
+		}
+
+		bool Stream::set_keep_buffers(bool value)
+		{
+			FLAC__ASSERT(is_valid());
+			return static_cast<bool>(::FLAC__stream_encoder_set_keep_buffers(encoder_, value));
+		}
+
 		bool Stream::set_total_samples_estimate(FLAC__uint64 value)
 		{
 			FLAC__ASSERT(is_valid());
@@ -220,6 +248,12 @@ namespace FLAC {
 #endif
 		}
 
+		bool Stream::set_frame_index(::FLAC__StreamMetadata *index)
+		{
+			FLAC__ASSERT(is_valid());
+			return static_cast<bool>(::FLAC__stream_encoder_set_frame_index(encoder_, index));
+		}
+
 		Stream::State Stream::get_state() const
 		{
 			FLAC__ASSERT(is_valid());
@@ -334,12 +368,48 @@ namespace FLAC {
 			return ::FLAC__stream_encoder_get_rice_parameter_search_dist(encoder_);
 		}
 
+		uint32_t Stream::get_num_threads() const
+		{
+			FLAC__ASSERT(is_valid());
+			return ::FLAC__stream_encoder_get_num_threads(encoder_);
+		}
+
+		bool Stream::get_parallel_subframes() const
+		{
+			FLAC__ASSERT(is_valid());
+			return static_cast<bool>(::FLAC__stream_encoder_get_parallel_subframes(encoder_));
+		}
+
+		bool Stream::get_threaded_md5() const
+		{
+			FLAC__ASSERT(is_valid());
+			return static_cast<bool>(::FLAC__stream_encoder_get_threaded_md5(encoder_));
+		}
+
+		bool Stream::get_keep_buffers() const
+		{
+			FLAC__ASSERT(is_valid());
+			return static_cast<bool>(::FLAC__stream_encoder_get_keep_buffers(encoder_));
+		}
+
 		FLAC__uint64 Stream::get_total_samples_estimate() const
 		{
 			FLAC__ASSERT(is_valid());
 			return ::FLAC__stream_encoder_get_total_samples_estimate(encoder_);
 		}
 
+		bool Stream::get_statistics(::FLAC__StreamEncoderStatistics *statistics) const
+		{
+			FLAC__ASSERT(is_valid());
+			return static_cast<bool>(::FLAC__stream_encoder_get_statistics(encoder_, statistics));
+		}
+
+		const char *Stream::get_kernel(::FLAC__StreamEncoderKernel kernel) const
+		{
+			FLAC__ASSERT(is_valid());
+			return ::FLAC__stream_encoder_get_kernel(encoder_, kernel);
+		}
+
 		::FLAC__StreamEncoderInitStatus Stream::init()
 		{
 			FLAC__ASSERT(is_valid());
@@ -370,6 +440,24 @@ namespace FLAC {
 			return static_cast<bool>(::FLAC__stream_encoder_process_interleaved(encoder_, buffer, samples));
 		}
 
+		bool Stream::process_interleaved_int16(const FLAC__int16 buffer[], uint32_t samples)
+		{
+			FLAC__ASSERT(is_valid());
+			return static_cast<bool>(::FLAC__stream_encoder_process_interleaved_int16(encoder_, buffer, samples));
+		}
+
+		bool Stream::process_interleaved_int24(const FLAC__byte buffer[], uint32_t samples)
+		{
+			FLAC__ASSERT(is_valid());
+			return static_cast<bool>(::FLAC__stream_encoder_process_interleaved_int24(encoder_, buffer, samples));
+		}
+
+		bool Stream::process_interleaved_float32(const float buffer[], uint32_t samples)
+		{
+			FLAC__ASSERT(is_valid());
+			return static_cast<bool>(::FLAC__stream_encoder_process_interleaved_float32(encoder_, buffer, samples));
+		}
+
 		::FLAC__StreamEncoderReadStatus Stream::read_callback(FLAC__byte buffer[], size_t *bytes)
 		{
 			(void)buffer, (void)bytes;
@@ -448,6 +536,10 @@ namespace FLAC {
 			Stream()
 		{ }
 
+		File::File(const ::FLAC__Allocator *allocator):
+			Stream(allocator)
+		{ }
+
 		File::~File()
 		{
 		}
@@ -486,6 +578,18 @@ namespace FLAC {
 			return init_ogg(filename.c_str());
 		}
 
+		::FLAC__StreamEncoderInitStatus File::init_memory()
+		{
+			FLAC__ASSERT(is_valid());
+			return ::FLAC__stream_encoder_init_memory(encoder_, progress_callback_, /*client_data=*/(void*)this);
+		}
+
+		bool File::finish_memory(FLAC__byte **data, size_t *length)
+		{
+			FLAC__ASSERT(is_valid());
+			return static_cast<bool>(::FLAC__stream_encoder_finish_memory(encoder_, data, length));
+		}
+
 		// This is a dummy to satisfy the pure virtual from Stream; the
 		// read callback will never be called since we are initializing
 		// with FLAC__stream_decoder_init_FILE() or
@@ -40,6 +40,7 @@
 #include "private/bitreader.h"
 #include "private/crc.h"
 #include "private/macros.h"
+#include "private/memory.h"
 #include "FLAC/assert.h"
 #include "share/compat.h"
 #include "share/endswap.h"
@@ -99,6 +100,36 @@ typedef FLAC__uint64 brword;
  */
 static const uint32_t FLAC__BITREADER_DEFAULT_CAPACITY = 65536u / FLAC__BITS_PER_WORD; /* in words */
 
+/* what FLAC__bitreader_set_low_footprint() shrinks it to, the practical minimum from above */
+static const uint32_t FLAC__BITREADER_LOW_FOOTPRINT_CAPACITY = 8192u / FLAC__BITS_PER_WORD; /* in words */
+
+/*
+ * Rice codes with a small parameter are only a few bits long, so for
+ * parameters below FLAC__BITREADER_RICE_TABLE_PARAMETERS the next
+ * FLAC__BITREADER_RICE_TABLE_BITS bits of input are looked up in a
+ * table that decodes up to 4 whole codes at once.  Each entry packs
+ * the number of bits used (bits 0-7, 0 if not even the first code
+ * fits), the number of codes (bits 8-15) and the decoded values as
+ * signed bytes (bits 16-47).
+ */
+#define FLAC__BITREADER_RICE_TABLE_BITS 10
+#define FLAC__BITREADER_RICE_TABLE_PARAMETERS 4
+
+#if (defined FLAC__CPU_IA32 || defined FLAC__CPU_X86_64) && FLAC__HAS_X86INTRIN && defined FLAC__PCLMUL_SUPPORTED && !defined FLAC__NO_ASM && (FLAC__BYTES_PER_WORD == 4 || FLAC__BYTES_PER_WORD == 8)
+#define FLAC__BITREADER_HAS_PCLMUL_ 1
+#else
+#define FLAC__BITREADER_HAS_PCLMUL_ 0
+#endif
+
+#if (defined FLAC__CPU_IA32 || defined FLAC__CPU_X86_64) && FLAC__HAS_X86INTRIN && defined FLAC__SSE2_SUPPORTED && !defined FLAC__NO_ASM
+#define FLAC__BITREADER_HAS_SSE2_ 1
+#else
+#define FLAC__BITREADER_HAS_SSE2_ 0
+#endif
+
+/* the byte at 'pos' counting from the front of the buffer */
+#define BYTE_AT_(br, pos) ((FLAC__byte)((br)->buffer[(pos) / FLAC__BYTES_PER_WORD] >> (FLAC__BITS_PER_WORD - 8 - 8 * ((pos) % FLAC__BYTES_PER_WORD))))
+
 struct FLAC__BitReader {
 	/* any partially-consumed word at the head will stay right-justified as bits are consumed from the left */
 	/* any incomplete word at the tail will be left-justified, and bytes from the read callback are added on the right */
@@ -111,8 +142,17 @@ struct FLAC__BitReader {
 	uint32_t read_crc16; /* the running frame CRC */
 	uint32_t crc16_offset; /* the number of words in the current buffer that should not be CRC'd */
 	uint32_t crc16_align; /* the number of bits in the current consumed word that should not be CRC'd */
+	FLAC__bool use_pclmul; /* see FLAC__bitreader_set_cpu_info() */
+	FLAC__bool use_sse2; /* ditto */
+	FLAC__bool low_footprint; /* see FLAC__bitreader_set_low_footprint() */
+#if FLAC__BYTES_PER_WORD == 4
+	FLAC__uint64 *rice_table; /* multi-code lookup tables for the smallest Rice parameters, built on demand */
+	uint32_t rice_table_built; /* bit n set when the table for parameter n is filled in */
+#endif
 	FLAC__BitReaderReadCallback read_callback;
+	FLAC__BitReaderBorrowCallback borrow_callback; /* see FLAC__bitreader_set_borrow_callback() */
 	void *client_data;
+	const FLAC__Allocator *allocator; /* owned by the caller of FLAC__bitreader_new() */
 };
 
 static inline void crc16_update_word_(FLAC__BitReader *br, brword word)
@@ -135,6 +175,17 @@ static inline void crc16_update_block_(FLAC__BitReader *br)
 
 	/* Prevent OOB read due to wrap-around. */
 	if (br->consumed_words > br->crc16_offset) {
+#if FLAC__BITREADER_HAS_PCLMUL_
+		if (br->use_pclmul) {
+#if FLAC__BYTES_PER_WORD == 4
+			br->read_crc16 = FLAC__crc16_update_words32_intrin_pclmul(br->buffer + br->crc16_offset, br->consumed_words - br->crc16_offset, br->read_crc16);
+#else
+			br->read_crc16 = FLAC__crc16_update_words64_intrin_pclmul(br->buffer + br->crc16_offset, br->consumed_words - br->crc16_offset, br->read_crc16);
+#endif
+			br->crc16_offset = 0;
+			return;
+		}
+#endif
 #if FLAC__BYTES_PER_WORD == 4
 		br->read_crc16 = FLAC__crc16_update_words32(br->buffer + br->crc16_offset, br->consumed_words - br->crc16_offset, br->read_crc16);
 #elif FLAC__BYTES_PER_WORD == 8
@@ -150,6 +201,59 @@ static inline void crc16_update_block_(FLAC__BitReader *br)
 	br->crc16_offset = 0;
 }
 
+/* when the client lends us its buffer there is no read syscall to amortize,
+ * so only convert about as much as a frame or two needs; after a seek the
+ * rest of a full buffer would just be thrown away
+ */
+#define FLAC__BITREADER_BORROW_CHUNK 8192u /* in bytes */
+
+static FLAC__bool bitreader_borrow_from_client_(FLAC__BitReader *br, size_t bytes)
+{
+	const FLAC__byte *source;
+	size_t n;
+	brword word;
+
+	if(bytes > FLAC__BITREADER_BORROW_CHUNK)
+		bytes = FLAC__BITREADER_BORROW_CHUNK;
+
+	if(!br->borrow_callback(&source, &bytes, br->client_data))
+		return false;
+
+	/* complete the left-justified tail word one byte at a time */
+	if(br->bytes) {
+		word = br->buffer[br->words] & ~(FLAC__WORD_ALL_ONES >> (8 * br->bytes));
+		while(bytes && br->bytes < FLAC__BYTES_PER_WORD) {
+			word |= (brword)(*source++) << (FLAC__BITS_PER_WORD - 8 - 8 * br->bytes);
+			br->bytes++;
+			bytes--;
+		}
+		br->buffer[br->words] = word;
+		if(br->bytes < FLAC__BYTES_PER_WORD)
+			return true;
+		br->words++;
+		br->bytes = 0;
+	}
+
+	/* whole words go straight from the client's memory into host order */
+	for(n = bytes / FLAC__BYTES_PER_WORD; n; n--) {
+		memcpy(&word, source, FLAC__BYTES_PER_WORD);
+		br->buffer[br->words++] = SWAP_BE_WORD_TO_HOST(word);
+		source += FLAC__BYTES_PER_WORD;
+	}
+
+	/* and whatever is left starts a new left-justified tail word */
+	bytes %= FLAC__BYTES_PER_WORD;
+	if(bytes) {
+		word = 0;
+		for(n = 0; n < bytes; n++)
+			word |= (brword)source[n] << (FLAC__BITS_PER_WORD - 8 - 8 * n);
+		br->buffer[br->words] = word;
+		br->bytes = (uint32_t)bytes;
+	}
+
+	return true;
+}
+
 static FLAC__bool bitreader_read_from_client_(FLAC__BitReader *br)
 {
 	uint32_t start, end;
@@ -174,6 +278,8 @@ static FLAC__bool bitreader_read_from_client_(FLAC__BitReader *br)
 	bytes = (br->capacity - br->words) * FLAC__BYTES_PER_WORD - br->bytes;
 	if(bytes == 0)
 		return false; /* no space left, buffer is too small; see note for FLAC__BITREADER_DEFAULT_CAPACITY  */
+	if(br->borrow_callback)
+		return bitreader_borrow_from_client_(br, bytes);
 	target = ((FLAC__byte*)(br->buffer+br->words)) + br->bytes;
 
 	/* before reading, if the existing reader looks like this (say brword is 32 bits wide)
@@ -233,9 +339,9 @@ static FLAC__bool bitreader_read_from_client_(FLAC__BitReader *br)
  *
  ***********************************************************************/
 
-FLAC__BitReader *FLAC__bitreader_new(void)
+FLAC__BitReader *FLAC__bitreader_new(const FLAC__Allocator *allocator)
 {
-	FLAC__BitReader *br = calloc(1, sizeof(FLAC__BitReader));
+	FLAC__BitReader *br = FLAC__memory_calloc(allocator, 1, sizeof(FLAC__BitReader));
 
 	/* calloc() implies:
 		memset(br, 0, sizeof(FLAC__BitReader));
@@ -246,6 +352,8 @@ FLAC__BitReader *FLAC__bitreader_new(void)
 		br->read_callback = 0;
 		br->client_data = 0;
 	*/
+	if(0 != br)
+		br->allocator = allocator;
 	return br;
 }
 
@@ -254,7 +362,7 @@ void FLAC__bitreader_delete(FLAC__BitReader *br)
 	FLAC__ASSERT(0 != br);
 
 	FLAC__bitreader_free(br);
-	free(br);
+	FLAC__memory_free(br->allocator, br);
 }
 
 /***********************************************************************
@@ -269,27 +377,64 @@ FLAC__bool FLAC__bitreader_init(FLAC__BitReader *br, FLAC__BitReaderReadCallback
 
 	br->words = br->bytes = 0;
 	br->consumed_words = br->consumed_bits = 0;
-	br->capacity = FLAC__BITREADER_DEFAULT_CAPACITY;
-	br->buffer = malloc(sizeof(brword) * br->capacity);
+	br->capacity = br->low_footprint? FLAC__BITREADER_LOW_FOOTPRINT_CAPACITY : FLAC__BITREADER_DEFAULT_CAPACITY;
+	br->buffer = FLAC__memory_malloc(br->allocator, sizeof(brword) * br->capacity);
 	if(br->buffer == 0)
 		return false;
 	br->read_callback = rcb;
+	br->borrow_callback = 0;
 	br->client_data = cd;
 
 	return true;
 }
 
+void FLAC__bitreader_set_borrow_callback(FLAC__BitReader *br, FLAC__BitReaderBorrowCallback bcb)
+{
+	FLAC__ASSERT(0 != br);
+
+	br->borrow_callback = bcb;
+}
+
+void FLAC__bitreader_set_low_footprint(FLAC__BitReader *br, FLAC__bool value)
+{
+	FLAC__ASSERT(0 != br);
+
+	br->low_footprint = value;
+}
+
+void FLAC__bitreader_set_cpu_info(FLAC__BitReader *br, const FLAC__CPUInfo *cpuinfo)
+{
+	FLAC__ASSERT(0 != br);
+	FLAC__ASSERT(0 != cpuinfo);
+
+	br->use_pclmul = false;
+#if FLAC__BITREADER_HAS_PCLMUL_
+	br->use_pclmul = cpuinfo->use_asm && cpuinfo->x86.pclmul && cpuinfo->x86.ssse3;
+#endif
+	br->use_sse2 = false;
+#if FLAC__BITREADER_HAS_SSE2_
+	br->use_sse2 = cpuinfo->use_asm && cpuinfo->x86.sse2;
+#endif
+	(void)cpuinfo;
+}
+
 void FLAC__bitreader_free(FLAC__BitReader *br)
 {
 	FLAC__ASSERT(0 != br);
 
 	if(0 != br->buffer)
-		free(br->buffer);
+		FLAC__memory_free(br->allocator, br->buffer);
 	br->buffer = 0;
+#if FLAC__BYTES_PER_WORD == 4
+	FLAC__memory_free(br->allocator, br->rice_table);
+	br->rice_table = 0;
+	br->rice_table_built = 0;
+#endif
 	br->capacity = 0;
 	br->words = br->bytes = 0;
 	br->consumed_words = br->consumed_bits = 0;
 	br->read_callback = 0;
+	br->borrow_callback = 0;
 	br->client_data = 0;
 }
 
@@ -300,6 +445,20 @@ FLAC__bool FLAC__bitreader_clear(FLAC__BitReader *br)
 	return true;
 }
 
+size_t FLAC__bitreader_get_footprint(const FLAC__BitReader *br)
+{
+	size_t bytes;
+
+	FLAC__ASSERT(0 != br);
+
+	bytes = sizeof(FLAC__BitReader) + sizeof(brword) * br->capacity;
+#if FLAC__BYTES_PER_WORD == 4
+	if(0 != br->rice_table)
+		bytes += sizeof(FLAC__uint64) * (1u << FLAC__BITREADER_RICE_TABLE_BITS) * FLAC__BITREADER_RICE_TABLE_PARAMETERS;
+#endif
+	return bytes;
+}
+
 void FLAC__bitreader_dump(const FLAC__BitReader *br, FILE *out)
 {
 	uint32_t i, j;
@@ -642,6 +801,78 @@ FLAC__bool FLAC__bitreader_read_byte_block_aligned_no_crc(FLAC__BitReader *br, F
 	return true;
 }
 
+/* 'word' has a byte equal to 0xff; a zero byte in ~word shows up as a borrow into its top bit */
+#if FLAC__BYTES_PER_WORD == 4
+#define WORD_HAS_FF_(word) (((~(word) - 0x01010101u) & (word) & 0x80808080u) != 0)
+#else
+#define WORD_HAS_FF_(word) (((~(word) - FLAC__U64L(0x0101010101010101)) & (word) & FLAC__U64L(0x8080808080808080)) != 0)
+#endif
+
+FLAC__bool FLAC__bitreader_skip_to_frame_sync_no_crc(FLAC__BitReader *br, uint32_t *skipped)
+{
+	uint32_t pos, start, end, i;
+
+	FLAC__ASSERT(0 != br);
+	FLAC__ASSERT(0 != br->buffer);
+	FLAC__ASSERT(FLAC__bitreader_is_consumed_byte_aligned(br));
+
+	*skipped = 0;
+	while(1) {
+		/* positions are in bytes from the front of the buffer */
+		pos = start = br->consumed_words * FLAC__BYTES_PER_WORD + br->consumed_bits / 8;
+		end = br->words * FLAC__BYTES_PER_WORD + br->bytes;
+
+		while(pos + 1 < end) {
+			/* at a word boundary, pass over whole words with no 0xff in them at once */
+			if(pos % FLAC__BYTES_PER_WORD == 0) {
+				i = pos / FLAC__BYTES_PER_WORD;
+#if FLAC__BITREADER_HAS_SSE2_
+				if(br->use_sse2)
+					i += FLAC__bitreader_skip_no_ff_blocks_intrin_sse2((const FLAC__byte*)(br->buffer + i), (br->words - i) * FLAC__BYTES_PER_WORD) / FLAC__BYTES_PER_WORD;
+#endif
+				while(i < br->words && !WORD_HAS_FF_(br->buffer[i]))
+					i++;
+				if(i * FLAC__BYTES_PER_WORD > pos) {
+					pos = i * FLAC__BYTES_PER_WORD;
+					continue;
+				}
+			}
+			if(BYTE_AT_(br, pos) == 0xff && (BYTE_AT_(br, pos + 1) >> 1) == 0x7c) /* MAGIC NUMBERs for the sync code and reserved bit */
+				break;
+			pos++;
+		}
+
+		/* consume up to the candidate, or up to the last byte since it may be the first half of one */
+		br->consumed_words = pos / FLAC__BYTES_PER_WORD;
+		br->consumed_bits = 8 * (pos % FLAC__BYTES_PER_WORD);
+		/* none of it belongs to a frame, so keep it out of the CRC too */
+		br->crc16_offset = br->consumed_words;
+		br->crc16_align = br->consumed_bits;
+		*skipped += pos - start;
+
+		if(pos + 1 < end)
+			return true;
+		if(!bitreader_read_from_client_(br))
+			return false;
+	}
+}
+
+uint32_t FLAC__bitreader_peek_byte_block_aligned(const FLAC__BitReader *br, FLAC__byte *val, uint32_t nvals)
+{
+	uint32_t pos, end, n;
+
+	FLAC__ASSERT(0 != br);
+	FLAC__ASSERT(0 != br->buffer);
+	FLAC__ASSERT(FLAC__bitreader_is_consumed_byte_aligned(br));
+
+	pos = br->consumed_words * FLAC__BYTES_PER_WORD + br->consumed_bits / 8;
+	end = br->words * FLAC__BYTES_PER_WORD + br->bytes;
+	for(n = 0; n < nvals && pos < end; n++, pos++)
+		val[n] = BYTE_AT_(br, pos);
+
+	return n;
+}
+
 FLAC__bool FLAC__bitreader_read_unary_unsigned(FLAC__BitReader *br, uint32_t *val)
 #if 0 /* slow but readable version */
 {
@@ -749,7 +980,11 @@ FLAC__bool FLAC__bitreader_read_rice_signed(FLAC__BitReader *br, int *val, uint3
 }
 
 /* this is by far the most heavily used reader call.  it ain't pretty but it's fast */
+#if FLAC__BYTES_PER_WORD == 4
+static FLAC__bool read_rice_signed_block_words_(FLAC__BitReader *br, int vals[], uint32_t nvals, uint32_t parameter)
+#else
 FLAC__bool FLAC__bitreader_read_rice_signed_block(FLAC__BitReader *br, int vals[], uint32_t nvals, uint32_t parameter)
+#endif
 {
 	/* try and get br->consumed_words and br->consumed_bits into register;
 	 * must remember to flush them back to *br before calling other
@@ -888,6 +1123,141 @@ incomplete_lsbs:
 	return true;
 }
 
+#if FLAC__BYTES_PER_WORD == 4
+static const FLAC__uint64 *get_rice_table_(FLAC__BitReader *br, uint32_t parameter)
+{
+	const uint32_t size = 1u << FLAC__BITREADER_RICE_TABLE_BITS;
+	FLAC__uint64 *table;
+	uint32_t i;
+
+	FLAC__ASSERT(parameter < FLAC__BITREADER_RICE_TABLE_PARAMETERS);
+
+	if(br->low_footprint)
+		return 0;
+	if(0 == br->rice_table) {
+		if(0 == (br->rice_table = FLAC__memory_malloc(br->allocator, sizeof(FLAC__uint64) * size * FLAC__BITREADER_RICE_TABLE_PARAMETERS)))
+			return 0; /* not fatal, the codes just get decoded one at a time */
+	}
+	table = br->rice_table + parameter * size;
+	if(br->rice_table_built & (1u << parameter))
+		return table;
+
+	for(i = 0; i < size; i++) {
+		FLAC__uint64 entry = 0;
+		uint32_t pos = 0, count = 0;
+		while(count < 4) {
+			uint32_t msbs = 0, uval;
+			while(pos + msbs < FLAC__BITREADER_RICE_TABLE_BITS && !(i & (1u << (FLAC__BITREADER_RICE_TABLE_BITS - 1 - pos - msbs))))
+				msbs++;
+			if(pos + msbs + 1 + parameter > FLAC__BITREADER_RICE_TABLE_BITS)
+				break;
+			pos += msbs + 1;
+			uval = (msbs << parameter) | ((i >> (FLAC__BITREADER_RICE_TABLE_BITS - pos - parameter)) & ((1u << parameter) - 1));
+			pos += parameter;
+			entry |= (FLAC__uint64)(FLAC__byte)((int)(uval >> 1) ^ -(int)(uval & 1)) << (16 + 8 * count);
+			count++;
+		}
+		table[i] = entry | (count << 8) | pos;
+	}
+	br->rice_table_built |= 1u << parameter;
+	return table;
+}
+
+/*
+ * Decodes out of a 64-bit accumulator that is topped up a whole word at
+ * a time, so most codes need no refill or word boundary check of their
+ * own.  It stops at the first code that does not fit or when the
+ * complete words run out, and leaves the rest to the word-at-a-time
+ * routine above.  Also compiled with BMI2 enabled below, where the
+ * shifts and bit extraction map onto shlx/shrx/bzhi and the leading
+ * zero count onto lzcnt; without those it is no faster than the
+ * word-at-a-time routine for codes that have no table, so unless
+ * 'all_parameters' is set those are passed straight on.
+ */
+static inline FLAC__bool read_rice_signed_block_(FLAC__BitReader *br, int vals[], uint32_t nvals, uint32_t parameter, FLAC__bool all_parameters)
+{
+	const FLAC__uint64 *table = 0;
+	const FLAC__uint32 lsbs_mask = (1u << parameter) - 1;
+	FLAC__uint64 acc;
+	uint32_t cwords, words, n, msbs, uval, pos;
+	int *val, *end;
+
+	FLAC__ASSERT(0 != br);
+	FLAC__ASSERT(0 != br->buffer);
+	FLAC__ASSERT(parameter < 32);
+
+	val = vals;
+	end = vals + nvals;
+
+	cwords = br->consumed_words;
+	words = br->words;
+	if(cwords >= words || nvals == 0 || (!all_parameters && parameter >= FLAC__BITREADER_RICE_TABLE_PARAMETERS))
+		return read_rice_signed_block_words_(br, vals, nvals, parameter);
+
+	if(parameter < FLAC__BITREADER_RICE_TABLE_PARAMETERS)
+		table = get_rice_table_(br, parameter);
+
+	/* n is the number of valid bits, left-aligned in acc */
+	acc = (FLAC__uint64)br->buffer[cwords++] << (32 + br->consumed_bits);
+	n = 32 - br->consumed_bits;
+
+	while(val < end) {
+		if(n <= 32) {
+			if(cwords >= words)
+				break;
+			acc |= (FLAC__uint64)br->buffer[cwords++] << (32 - n);
+			n += 32;
+		}
+		if(0 != table && end - val >= 4) {
+			const FLAC__uint64 entry = table[acc >> (64 - FLAC__BITREADER_RICE_TABLE_BITS)];
+			if(entry & 0xff) {
+				/* always store all 4, only the first 'count' are kept */
+				val[0] = (FLAC__int8)(entry >> 16);
+				val[1] = (FLAC__int8)(entry >> 24);
+				val[2] = (FLAC__int8)(entry >> 32);
+				val[3] = (FLAC__int8)(entry >> 40);
+				val += (entry >> 8) & 0xff;
+				acc <<= entry & 0xff;
+				n -= entry & 0xff;
+				continue;
+			}
+		}
+		if(acc == 0)
+			break; /* unary part longer than the accumulator */
+		msbs = FLAC__clz_uint64(acc);
+		if(msbs + 1 + parameter > n)
+			break;
+		acc <<= msbs;
+		uval = (msbs << parameter) | ((FLAC__uint32)(acc >> (63 - parameter)) & lsbs_mask);
+		acc <<= 1 + parameter;
+		n -= msbs + 1 + parameter;
+		*val++ = (int)(uval >> 1) ^ -(int)(uval & 1);
+	}
+
+	/* put back the bits that were loaded but not used */
+	pos = cwords * FLAC__BITS_PER_WORD - n;
+	br->consumed_words = pos / FLAC__BITS_PER_WORD;
+	br->consumed_bits = pos % FLAC__BITS_PER_WORD;
+
+	if(val < end)
+		return read_rice_signed_block_words_(br, val, (uint32_t)(end - val), parameter);
+	return true;
+}
+
+FLAC__bool FLAC__bitreader_read_rice_signed_block(FLAC__BitReader *br, int vals[], uint32_t nvals, uint32_t parameter)
+{
+	return read_rice_signed_block_(br, vals, nvals, parameter, /*all_parameters=*/false);
+}
+
+#if (defined FLAC__CPU_IA32 || defined FLAC__CPU_X86_64) && FLAC__HAS_X86INTRIN && defined FLAC__BMI2_SUPPORTED && !defined FLAC__NO_ASM
+FLAC__SSE_TARGET("bmi2,lzcnt")
+FLAC__bool FLAC__bitreader_read_rice_signed_block_bmi2(FLAC__BitReader *br, int vals[], uint32_t nvals, uint32_t parameter)
+{
+	return read_rice_signed_block_(br, vals, nvals, parameter, /*all_parameters=*/true);
+}
+#endif
+#endif /* FLAC__BYTES_PER_WORD == 4 */
+
 #if 0 /* UNUSED */
 FLAC__bool FLAC__bitreader_read_golomb_signed(FLAC__BitReader *br, int *val, uint32_t parameter)
 {
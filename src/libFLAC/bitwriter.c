@@ -39,8 +39,8 @@
 #include "private/bitwriter.h"
 #include "private/crc.h"
 #include "private/macros.h"
+#include "private/memory.h"
 #include "FLAC/assert.h"
-#include "share/alloc.h"
 #include "share/compat.h"
 #include "share/endswap.h"
 
@@ -74,6 +74,18 @@ typedef FLAC__uint64 bwword;
 
 #endif
 
+#if (defined FLAC__CPU_IA32 || defined FLAC__CPU_X86_64) && FLAC__HAS_X86INTRIN && defined FLAC__BMI2_SUPPORTED && !defined FLAC__NO_ASM && FLAC__BYTES_PER_WORD == 4
+#define FLAC__BITWRITER_HAS_BMI2_ 1
+#else
+#define FLAC__BITWRITER_HAS_BMI2_ 0
+#endif
+
+#if (defined FLAC__CPU_IA32 || defined FLAC__CPU_X86_64) && FLAC__HAS_X86INTRIN && defined FLAC__PCLMUL_SUPPORTED && !defined FLAC__NO_ASM
+#define FLAC__BITWRITER_HAS_PCLMUL_ 1
+#else
+#define FLAC__BITWRITER_HAS_PCLMUL_ 0
+#endif
+
 /*
  * The default capacity here doesn't matter too much.  The buffer always grows
  * to hold whatever is written to it.  Usually the encoder will stop adding at
@@ -93,6 +105,9 @@ struct FLAC__BitWriter {
 	uint32_t capacity; /* capacity of buffer in words */
 	uint32_t words; /* # of complete words in buffer */
 	uint32_t bits; /* # of used bits in accum */
+	FLAC__bool use_bmi2; /* see FLAC__bitwriter_set_cpu_info() */
+	FLAC__bool use_pclmul; /* ditto */
+	const FLAC__Allocator *allocator; /* owned by the caller of FLAC__bitwriter_new() */
 };
 
 /* * WATCHOUT: The current implementation only grows the buffer. */
@@ -124,7 +139,7 @@ FLAC__bool bitwriter_grow_(FLAC__BitWriter *bw, uint32_t bits_to_add)
 	FLAC__ASSERT(new_capacity > bw->capacity);
 	FLAC__ASSERT(new_capacity >= bw->words + ((bw->bits + bits_to_add + FLAC__BITS_PER_WORD - 1) / FLAC__BITS_PER_WORD));
 
-	new_buffer = safe_realloc_mul_2op_(bw->buffer, sizeof(bwword), /*times*/new_capacity);
+	new_buffer = FLAC__memory_realloc_mul_2op(bw->allocator, bw->buffer, sizeof(bwword), /*times*/new_capacity);
 	if(new_buffer == 0)
 		return false;
 	bw->buffer = new_buffer;
@@ -139,10 +154,12 @@ FLAC__bool bitwriter_grow_(FLAC__BitWriter *bw, uint32_t bits_to_add)
  *
  ***********************************************************************/
 
-FLAC__BitWriter *FLAC__bitwriter_new(void)
+FLAC__BitWriter *FLAC__bitwriter_new(const FLAC__Allocator *allocator)
 {
-	FLAC__BitWriter *bw = calloc(1, sizeof(FLAC__BitWriter));
+	FLAC__BitWriter *bw = FLAC__memory_calloc(allocator, 1, sizeof(FLAC__BitWriter));
 	/* note that calloc() sets all members to 0 for us */
+	if(0 != bw)
+		bw->allocator = allocator;
 	return bw;
 }
 
@@ -151,7 +168,7 @@ void FLAC__bitwriter_delete(FLAC__BitWriter *bw)
 	FLAC__ASSERT(0 != bw);
 
 	FLAC__bitwriter_free(bw);
-	free(bw);
+	FLAC__memory_free(bw->allocator, bw);
 }
 
 /***********************************************************************
@@ -165,8 +182,10 @@ FLAC__bool FLAC__bitwriter_init(FLAC__BitWriter *bw)
 	FLAC__ASSERT(0 != bw);
 
 	bw->words = bw->bits = 0;
+	if(0 != bw->buffer) /* not freed since the last init, so reuse it */
+		return true;
 	bw->capacity = FLAC__BITWRITER_DEFAULT_CAPACITY;
-	bw->buffer = malloc(sizeof(bwword) * bw->capacity);
+	bw->buffer = FLAC__memory_malloc(bw->allocator, sizeof(bwword) * bw->capacity);
 	if(bw->buffer == 0)
 		return false;
 
@@ -178,7 +197,7 @@ void FLAC__bitwriter_free(FLAC__BitWriter *bw)
 	FLAC__ASSERT(0 != bw);
 
 	if(0 != bw->buffer)
-		free(bw->buffer);
+		FLAC__memory_free(bw->allocator, bw->buffer);
 	bw->buffer = 0;
 	bw->capacity = 0;
 	bw->words = bw->bits = 0;
@@ -189,6 +208,22 @@ void FLAC__bitwriter_clear(FLAC__BitWriter *bw)
 	bw->words = bw->bits = 0;
 }
 
+void FLAC__bitwriter_set_cpu_info(FLAC__BitWriter *bw, const FLAC__CPUInfo *cpuinfo)
+{
+	FLAC__ASSERT(0 != bw);
+	FLAC__ASSERT(0 != cpuinfo);
+
+	bw->use_bmi2 = false;
+	bw->use_pclmul = false;
+#if FLAC__BITWRITER_HAS_BMI2_
+	bw->use_bmi2 = cpuinfo->use_asm && cpuinfo->x86.bmi2;
+#endif
+#if FLAC__BITWRITER_HAS_PCLMUL_
+	bw->use_pclmul = cpuinfo->use_asm && cpuinfo->x86.pclmul && cpuinfo->x86.ssse3;
+#endif
+	(void)cpuinfo;
+}
+
 void FLAC__bitwriter_dump(const FLAC__BitWriter *bw, FILE *out)
 {
 	uint32_t i, j;
@@ -223,6 +258,11 @@ FLAC__bool FLAC__bitwriter_get_write_crc16(FLAC__BitWriter *bw, FLAC__uint16 *cr
 	if(!FLAC__bitwriter_get_buffer(bw, &buffer, &bytes))
 		return false;
 
+#if FLAC__BITWRITER_HAS_PCLMUL_
+	if(bw->use_pclmul)
+		*crc = FLAC__crc16_intrin_pclmul(buffer, bytes);
+	else
+#endif
 	*crc = (FLAC__uint16)FLAC__crc16(buffer, bytes);
 	FLAC__bitwriter_release_buffer(bw);
 	return true;
@@ -539,7 +579,11 @@ FLAC__bool FLAC__bitwriter_write_rice_signed(FLAC__BitWriter *bw, FLAC__int32 va
 			FLAC__bitwriter_write_raw_uint32(bw, pattern, interesting_bits); /* write the unary end bit and binary LSBs */
 }
 
+#if FLAC__BYTES_PER_WORD == 4
+static FLAC__bool write_rice_signed_block_words_(FLAC__BitWriter *bw, const FLAC__int32 *vals, uint32_t nvals, uint32_t parameter)
+#else
 FLAC__bool FLAC__bitwriter_write_rice_signed_block(FLAC__BitWriter *bw, const FLAC__int32 *vals, uint32_t nvals, uint32_t parameter)
+#endif
 {
 	const FLAC__uint32 mask1 = (FLAC__uint32)0xffffffff << parameter; /* we val|=mask1 to set the stop bit above it... */
 	const FLAC__uint32 mask2 = (FLAC__uint32)0xffffffff >> (31-parameter); /* ...then mask off the bits above the stop bit with val&=mask2 */
@@ -633,6 +677,89 @@ break1:
 	return true;
 }
 
+#if FLAC__BYTES_PER_WORD == 4
+/*
+ * The whole block is sized up front so the buffer only has to be checked
+ * once, then the codes are packed through a 64-bit accumulator that can
+ * take any code of up to 32 bits without first having to split it at a
+ * word boundary.  The rare longer code is handed to the routine above.
+ * Also compiled with BMI2 enabled, which turns the variable shifts into
+ * shlx/shrx.
+ */
+static inline FLAC__bool write_rice_signed_block_(FLAC__BitWriter *bw, const FLAC__int32 *vals, uint32_t nvals, uint32_t parameter)
+{
+	const FLAC__uint32 stop_bit = (FLAC__uint32)1 << parameter;
+	const FLAC__uint32 lsbs_mask = stop_bit - 1;
+	FLAC__uint64 msbits = 0, accum;
+	uint32_t i, bits, words, full;
+
+	FLAC__ASSERT(0 != bw);
+	FLAC__ASSERT(0 != bw->buffer);
+	FLAC__ASSERT(parameter < 31);
+
+	/* this loop is simple enough for the compiler to vectorize */
+	for(i = 0; i < nvals; i++)
+		msbits += ((FLAC__uint32)vals[i] << 1 ^ (FLAC__uint32)(vals[i] >> 31)) >> parameter;
+	msbits += (FLAC__uint64)nvals * (1 + parameter);
+	if(msbits > (FLAC__uint64)UINT32_MAX - FLAC__BITS_PER_WORD)
+		return write_rice_signed_block_words_(bw, vals, nvals, parameter);
+	/* one word more than needed, see below */
+	if(bw->capacity <= bw->words + (bw->bits + (uint32_t)msbits + FLAC__BITS_PER_WORD) / FLAC__BITS_PER_WORD && !bitwriter_grow_(bw, (uint32_t)msbits + FLAC__BITS_PER_WORD))
+		return false;
+
+	accum = bw->accum;
+	bits = bw->bits;
+	words = bw->words;
+	for(i = 0; i < nvals; i++) {
+		const FLAC__uint32 uval = (FLAC__uint32)vals[i] << 1 ^ (FLAC__uint32)(vals[i] >> 31);
+		const uint32_t total_bits = (uval >> parameter) + 1 + parameter;
+		if(total_bits > 32) {
+			bw->accum = (bwword)accum;
+			bw->bits = bits;
+			bw->words = words;
+			if(!write_rice_signed_block_words_(bw, vals + i, 1, parameter))
+				return false;
+			accum = bw->accum;
+			bits = bw->bits;
+			words = bw->words;
+			continue;
+		}
+		/* bits above 'bits' in accum may be garbage, they are never stored */
+		accum <<= total_bits;
+		accum |= stop_bit | (uval & lsbs_mask);
+		bits += total_bits;
+		/* store the top word whether or not it is complete yet, whether one
+		 * is due is too unpredictable to branch on; an incomplete one is
+		 * overwritten later */
+		full = bits / FLAC__BITS_PER_WORD;
+		bits -= full * FLAC__BITS_PER_WORD;
+		bw->buffer[words] = SWAP_BE_WORD_TO_HOST((bwword)(accum >> bits));
+		words += full;
+	}
+	bw->accum = (bwword)accum;
+	bw->bits = bits;
+	bw->words = words;
+	return true;
+}
+
+#if FLAC__BITWRITER_HAS_BMI2_
+FLAC__SSE_TARGET("bmi2")
+static FLAC__bool write_rice_signed_block_bmi2_(FLAC__BitWriter *bw, const FLAC__int32 *vals, uint32_t nvals, uint32_t parameter)
+{
+	return write_rice_signed_block_(bw, vals, nvals, parameter);
+}
+#endif
+
+FLAC__bool FLAC__bitwriter_write_rice_signed_block(FLAC__BitWriter *bw, const FLAC__int32 *vals, uint32_t nvals, uint32_t parameter)
+{
+#if FLAC__BITWRITER_HAS_BMI2_
+	if(bw->use_bmi2)
+		return write_rice_signed_block_bmi2_(bw, vals, nvals, parameter);
+#endif
+	return write_rice_signed_block_(bw, vals, nvals, parameter);
+}
+#endif
+
 #if 0 /* UNUSED */
 FLAC__bool FLAC__bitwriter_write_golomb_signed(FLAC__BitWriter *bw, int val, uint32_t parameter)
 {
@@ -36,8 +36,12 @@
 
 #include "private/cpu.h"
 #include "share/compat.h"
+#include "FLAC/format.h"
 #include <stdlib.h>
 #include <string.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 
 #if defined _MSC_VER
 #include <intrin.h> /* for __cpuid() and _xgetbv() */
@@ -69,6 +73,7 @@ static const uint32_t FLAC__CPUINFO_X86_CPUID_SSE2    = 0x04000000;
 
 /* these are flags in ECX of CPUID AX=00000001 */
 static const uint32_t FLAC__CPUINFO_X86_CPUID_SSE3    = 0x00000001;
+static const uint32_t FLAC__CPUINFO_X86_CPUID_PCLMUL  = 0x00000002;
 static const uint32_t FLAC__CPUINFO_X86_CPUID_SSSE3   = 0x00000200;
 static const uint32_t FLAC__CPUINFO_X86_CPUID_SSE41   = 0x00080000;
 static const uint32_t FLAC__CPUINFO_X86_CPUID_SSE42   = 0x00100000;
@@ -78,6 +83,10 @@ static const uint32_t FLAC__CPUINFO_X86_CPUID_FMA     = 0x00001000;
 
 /* these are flags in EBX of CPUID AX=00000007 */
 static const uint32_t FLAC__CPUINFO_X86_CPUID_AVX2    = 0x00000020;
+static const uint32_t FLAC__CPUINFO_X86_CPUID_BMI2    = 0x00000100;
+
+/* these are flags in ECX of CPUID AX=80000001 */
+static const uint32_t FLAC__CPUINFO_X86_CPUID_LZCNT   = 0x00000020;
 
 static uint32_t
 cpu_xgetbv_x86(void)
@@ -186,6 +195,7 @@ x86_cpu_info (FLAC__CPUInfo *info)
 	info->x86.ssse3 = (flags_ecx & FLAC__CPUINFO_X86_CPUID_SSSE3) ? true : false;
 	info->x86.sse41 = (flags_ecx & FLAC__CPUINFO_X86_CPUID_SSE41) ? true : false;
 	info->x86.sse42 = (flags_ecx & FLAC__CPUINFO_X86_CPUID_SSE42) ? true : false;
+	info->x86.pclmul= (flags_ecx & FLAC__CPUINFO_X86_CPUID_PCLMUL) ? true : false;
 
 	if (FLAC__AVX_SUPPORTED) {
 		x86_osxsave     = (flags_ecx & FLAC__CPUINFO_X86_CPUID_OSXSAVE) ? true : false;
@@ -195,6 +205,12 @@ x86_cpu_info (FLAC__CPUInfo *info)
 		info->x86.avx2  = (flags_ebx & FLAC__CPUINFO_X86_CPUID_AVX2   ) ? true : false;
 	}
 
+	/* BMI2 and LZCNT only touch general purpose registers, so need no OS support */
+	cpuinfo_x86(7, &flags_eax, &flags_ebx, &flags_ecx, &flags_edx);
+	info->x86.bmi2  = (flags_ebx & FLAC__CPUINFO_X86_CPUID_BMI2   ) ? true : false;
+	cpuinfo_x86(0x80000001, &flags_eax, &flags_ebx, &flags_ecx, &flags_edx);
+	info->x86.lzcnt = (flags_ecx & FLAC__CPUINFO_X86_CPUID_LZCNT  ) ? true : false;
+
 #if defined FLAC__CPU_IA32
 	dfprintf(stderr, "CPU info (IA-32):\n");
 #else
@@ -208,6 +224,9 @@ x86_cpu_info (FLAC__CPUInfo *info)
 	dfprintf(stderr, "  SSSE3 ...... %c\n", info->x86.ssse3   ? 'Y' : 'n');
 	dfprintf(stderr, "  SSE41 ...... %c\n", info->x86.sse41   ? 'Y' : 'n');
 	dfprintf(stderr, "  SSE42 ...... %c\n", info->x86.sse42   ? 'Y' : 'n');
+	dfprintf(stderr, "  PCLMUL ..... %c\n", info->x86.pclmul  ? 'Y' : 'n');
+	dfprintf(stderr, "  BMI2 ....... %c\n", info->x86.bmi2    ? 'Y' : 'n');
+	dfprintf(stderr, "  LZCNT ...... %c\n", info->x86.lzcnt   ? 'Y' : 'n');
 
 	if (FLAC__AVX_SUPPORTED) {
 		dfprintf(stderr, "  AVX ........ %c\n", info->x86.avx     ? 'Y' : 'n');
@@ -276,7 +295,48 @@ ppc_cpu_info (FLAC__CPUInfo *info)
 #endif
 }
 
-void FLAC__cpu_info (FLAC__CPUInfo *info)
+/* see FLAC__set_cpu_feature_mask() */
+static FLAC__uint32 cpu_feature_mask = FLAC__CPU_FEATURE_ALL;
+
+static void
+apply_feature_mask (FLAC__CPUInfo *info)
+{
+	FLAC__uint32 mask = cpu_feature_mask;
+
+	/* each of these extends the one before, so clearing a feature clears everything built on it */
+	if (!(mask & FLAC__CPU_FEATURE_X86_SSE))    mask &= ~FLAC__CPU_FEATURE_X86_SSE2;
+	if (!(mask & FLAC__CPU_FEATURE_X86_SSE2))   mask &= ~(FLAC__CPU_FEATURE_X86_SSE3 | FLAC__CPU_FEATURE_X86_PCLMUL);
+	if (!(mask & FLAC__CPU_FEATURE_X86_SSE3))   mask &= ~FLAC__CPU_FEATURE_X86_SSSE3;
+	if (!(mask & FLAC__CPU_FEATURE_X86_SSSE3))  mask &= ~FLAC__CPU_FEATURE_X86_SSE41;
+	if (!(mask & FLAC__CPU_FEATURE_X86_SSE41))  mask &= ~FLAC__CPU_FEATURE_X86_SSE42;
+	if (!(mask & FLAC__CPU_FEATURE_X86_SSE42))  mask &= ~FLAC__CPU_FEATURE_X86_AVX;
+	if (!(mask & FLAC__CPU_FEATURE_X86_AVX))    mask &= ~(FLAC__CPU_FEATURE_X86_AVX2 | FLAC__CPU_FEATURE_X86_FMA);
+	if (!(mask & FLAC__CPU_FEATURE_PPC_ARCH_2_07)) mask &= ~FLAC__CPU_FEATURE_PPC_ARCH_3_00;
+
+	if (!(mask & FLAC__CPU_FEATURE_ASM))
+		info->use_asm = false;
+
+	if (!(mask & FLAC__CPU_FEATURE_X86_CMOV))   info->x86.cmov   = false;
+	if (!(mask & FLAC__CPU_FEATURE_X86_MMX))    info->x86.mmx    = false;
+	if (!(mask & FLAC__CPU_FEATURE_X86_SSE))    info->x86.sse    = false;
+	if (!(mask & FLAC__CPU_FEATURE_X86_SSE2))   info->x86.sse2   = false;
+	if (!(mask & FLAC__CPU_FEATURE_X86_SSE3))   info->x86.sse3   = false;
+	if (!(mask & FLAC__CPU_FEATURE_X86_SSSE3))  info->x86.ssse3  = false;
+	if (!(mask & FLAC__CPU_FEATURE_X86_SSE41))  info->x86.sse41  = false;
+	if (!(mask & FLAC__CPU_FEATURE_X86_SSE42))  info->x86.sse42  = false;
+	if (!(mask & FLAC__CPU_FEATURE_X86_PCLMUL)) info->x86.pclmul = false;
+	if (!(mask & FLAC__CPU_FEATURE_X86_AVX))    info->x86.avx    = false;
+	if (!(mask & FLAC__CPU_FEATURE_X86_AVX2))   info->x86.avx2   = false;
+	if (!(mask & FLAC__CPU_FEATURE_X86_FMA))    info->x86.fma    = false;
+	if (!(mask & FLAC__CPU_FEATURE_X86_BMI2))   info->x86.bmi2   = false;
+	if (!(mask & FLAC__CPU_FEATURE_X86_LZCNT))  info->x86.lzcnt  = false;
+
+	if (!(mask & FLAC__CPU_FEATURE_PPC_ARCH_2_07)) info->ppc.arch_2_07 = false;
+	if (!(mask & FLAC__CPU_FEATURE_PPC_ARCH_3_00)) info->ppc.arch_3_00 = false;
+}
+
+static void
+detect_cpu_info (FLAC__CPUInfo *info)
 {
 	memset(info, 0, sizeof(*info));
 
@@ -303,3 +363,77 @@ void FLAC__cpu_info (FLAC__CPUInfo *info)
 		break;
 	}
 }
+
+/* CPUID and XGETBV are slow (and trap to the hypervisor in many VMs),
+ * so the CPU is probed once per process rather than once per encoder or
+ * decoder.  Without pthreads there is nothing to run the probe exactly
+ * once, so threads racing on the first call may each probe the CPU, but
+ * they only read the shared copy once one of them has filled it in, and
+ * any later stores to it write the same bytes again.
+ */
+static FLAC__CPUInfo detected_cpu_info;
+#ifdef HAVE_PTHREAD
+static pthread_once_t detected_cpu_info_once = PTHREAD_ONCE_INIT;
+
+static void
+detect_cpu_info_once (void)
+{
+	detect_cpu_info (&detected_cpu_info);
+}
+#else
+static volatile FLAC__bool detected_cpu_info_valid = false;
+#endif
+
+void FLAC__cpu_info (FLAC__CPUInfo *info)
+{
+#ifdef HAVE_PTHREAD
+	pthread_once (&detected_cpu_info_once, detect_cpu_info_once);
+	*info = detected_cpu_info;
+#else
+	if (!detected_cpu_info_valid) {
+		detect_cpu_info (info);
+		detected_cpu_info = *info;
+		detected_cpu_info_valid = true;
+	}
+	else
+		*info = detected_cpu_info;
+#endif
+
+	apply_feature_mask (info);
+}
+
+FLAC_API void FLAC__set_cpu_feature_mask(FLAC__uint32 mask)
+{
+	cpu_feature_mask = mask;
+}
+
+FLAC_API FLAC__uint32 FLAC__get_cpu_feature_mask(void)
+{
+	return cpu_feature_mask;
+}
+
+FLAC_API FLAC__uint32 FLAC__get_cpu_features(void)
+{
+	FLAC__CPUInfo info;
+	FLAC__uint32 features = 0;
+
+	FLAC__cpu_info (&info);
+	if (info.use_asm)       features |= FLAC__CPU_FEATURE_ASM;
+	if (info.x86.cmov)      features |= FLAC__CPU_FEATURE_X86_CMOV;
+	if (info.x86.mmx)       features |= FLAC__CPU_FEATURE_X86_MMX;
+	if (info.x86.sse)       features |= FLAC__CPU_FEATURE_X86_SSE;
+	if (info.x86.sse2)      features |= FLAC__CPU_FEATURE_X86_SSE2;
+	if (info.x86.sse3)      features |= FLAC__CPU_FEATURE_X86_SSE3;
+	if (info.x86.ssse3)     features |= FLAC__CPU_FEATURE_X86_SSSE3;
+	if (info.x86.sse41)     features |= FLAC__CPU_FEATURE_X86_SSE41;
+	if (info.x86.sse42)     features |= FLAC__CPU_FEATURE_X86_SSE42;
+	if (info.x86.pclmul)    features |= FLAC__CPU_FEATURE_X86_PCLMUL;
+	if (info.x86.avx)       features |= FLAC__CPU_FEATURE_X86_AVX;
+	if (info.x86.avx2)      features |= FLAC__CPU_FEATURE_X86_AVX2;
+	if (info.x86.fma)       features |= FLAC__CPU_FEATURE_X86_FMA;
+	if (info.x86.bmi2)      features |= FLAC__CPU_FEATURE_X86_BMI2;
+	if (info.x86.lzcnt)     features |= FLAC__CPU_FEATURE_X86_LZCNT;
+	if (info.ppc.arch_2_07) features |= FLAC__CPU_FEATURE_PPC_ARCH_2_07;
+	if (info.ppc.arch_3_00) features |= FLAC__CPU_FEATURE_PPC_ARCH_3_00;
+	return features;
+}
@@ -0,0 +1,150 @@
+/* libFLAC - Free Lossless Audio Codec library
+ * Copyright (C) 2000-2009  Josh Coalson
+ * Copyright (C) 2011-2018  Xiph.Org Foundation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of the Xiph.org Foundation nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "private/cpu.h"
+
+#ifndef FLAC__NO_ASM
+#if (defined FLAC__CPU_IA32 || defined FLAC__CPU_X86_64) && FLAC__HAS_X86INTRIN
+#include "private/crc.h"
+#ifdef FLAC__PCLMUL_SUPPORTED
+
+#include <tmmintrin.h> /* SSSE3 */
+#include <wmmintrin.h> /* PCLMUL */
+#include "FLAC/assert.h"
+
+/*
+ * CRC-16 by folding with carry-less multiplies, after "Fast CRC
+ * Computation for Generic Polynomials Using PCLMULQDQ Instruction"
+ * (Intel, 2009).
+ *
+ * With bit n of an integer standing for x^n, and each 128-bit block
+ * loaded so that the first bit of the stream is x^127, a running
+ * remainder A = H*x^64 + L is carried over the next k*128 bits with
+ *   A * x^(k*128) = H * x^(k*128+64) + L * x^(k*128)
+ * where both powers are replaced by their (16-bit) remainders modulo
+ * P = x^16 + x^15 + x^2 + 1, so the result stays under 128 bits.  Four
+ * independent remainders are carried 512 bits at a time to hide the
+ * latency of the multiplies, then combined.  The CRC is A * x^16 mod P,
+ * which is just the table CRC of the 16 bytes of A.
+ */
+
+#define FOLD_(a, k) _mm_xor_si128(_mm_clmulepi64_si128((a), (k), 0x11), _mm_clmulepi64_si128((a), (k), 0x00))
+
+FLAC__SSE_TARGET("pclmul,ssse3")
+static FLAC__uint16 crc16_blocks_(const void *data, uint32_t nblocks, FLAC__uint16 crc, const __m128i to_big_endian)
+{
+	const __m128i *p = (const __m128i*)data;
+	const __m128i k512 = _mm_set_epi64x(0x1446, 0x8107); /* x^576 mod P, x^512 mod P */
+	const __m128i k128 = _mm_set_epi64x(0x1666, 0x0106); /* x^192 mod P, x^128 mod P */
+	const __m128i reverse = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+	__m128i a0, a1, a2, a3;
+	FLAC__byte bytes[16];
+
+	FLAC__ASSERT(nblocks >= 4);
+
+	/* starting from a non-zero CRC is the same as adding it to the first 16 bits of the data */
+	a0 = _mm_xor_si128(_mm_shuffle_epi8(_mm_loadu_si128(p + 0), to_big_endian), _mm_slli_si128(_mm_cvtsi32_si128(crc), 14));
+	a1 = _mm_shuffle_epi8(_mm_loadu_si128(p + 1), to_big_endian);
+	a2 = _mm_shuffle_epi8(_mm_loadu_si128(p + 2), to_big_endian);
+	a3 = _mm_shuffle_epi8(_mm_loadu_si128(p + 3), to_big_endian);
+	p += 4;
+	nblocks -= 4;
+
+	for( ; nblocks >= 4; nblocks -= 4, p += 4) {
+		a0 = _mm_xor_si128(FOLD_(a0, k512), _mm_shuffle_epi8(_mm_loadu_si128(p + 0), to_big_endian));
+		a1 = _mm_xor_si128(FOLD_(a1, k512), _mm_shuffle_epi8(_mm_loadu_si128(p + 1), to_big_endian));
+		a2 = _mm_xor_si128(FOLD_(a2, k512), _mm_shuffle_epi8(_mm_loadu_si128(p + 2), to_big_endian));
+		a3 = _mm_xor_si128(FOLD_(a3, k512), _mm_shuffle_epi8(_mm_loadu_si128(p + 3), to_big_endian));
+	}
+
+	a1 = _mm_xor_si128(FOLD_(a0, k128), a1);
+	a2 = _mm_xor_si128(FOLD_(a1, k128), a2);
+	a3 = _mm_xor_si128(FOLD_(a2, k128), a3);
+	for( ; nblocks; nblocks--, p++)
+		a3 = _mm_xor_si128(FOLD_(a3, k128), _mm_shuffle_epi8(_mm_loadu_si128(p), to_big_endian));
+
+	_mm_storeu_si128((__m128i*)bytes, _mm_shuffle_epi8(a3, reverse));
+	return FLAC__crc16(bytes, 16);
+}
+
+FLAC__SSE_TARGET("pclmul,ssse3")
+FLAC__uint16 FLAC__crc16_intrin_pclmul(const FLAC__byte *data, uint32_t len)
+{
+	FLAC__uint16 crc = 0;
+
+	if(len >= 64) {
+		const uint32_t nblocks = len / 16;
+		crc = crc16_blocks_(data, nblocks, crc, _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0));
+		data += nblocks * 16;
+		len -= nblocks * 16;
+	}
+
+	while(len--)
+		crc = FLAC__CRC16_UPDATE(*data++, crc);
+
+	return crc;
+}
+
+FLAC__SSE_TARGET("pclmul,ssse3")
+FLAC__uint16 FLAC__crc16_update_words32_intrin_pclmul(const FLAC__uint32 *words, uint32_t len, FLAC__uint16 crc)
+{
+	/* the words are already in host order, so only their order needs reversing */
+	if(len >= 16) {
+		const uint32_t nblocks = len / 4;
+		crc = crc16_blocks_(words, nblocks, crc, _mm_setr_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3));
+		words += nblocks * 4;
+		len -= nblocks * 4;
+	}
+
+	return FLAC__crc16_update_words32(words, len, crc);
+}
+
+FLAC__SSE_TARGET("pclmul,ssse3")
+FLAC__uint16 FLAC__crc16_update_words64_intrin_pclmul(const FLAC__uint64 *words, uint32_t len, FLAC__uint16 crc)
+{
+	if(len >= 8) {
+		const uint32_t nblocks = len / 2;
+		crc = crc16_blocks_(words, nblocks, crc, _mm_setr_epi8(8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7));
+		words += nblocks * 2;
+		len -= nblocks * 2;
+	}
+
+	return FLAC__crc16_update_words64(words, len, crc);
+}
+
+#endif /* FLAC__PCLMUL_SUPPORTED */
+#endif /* (FLAC__CPU_IA32 || FLAC__CPU_X86_64) && FLAC__HAS_X86INTRIN */
+#endif /* FLAC__NO_ASM */
@@ -43,6 +43,7 @@
 #include "share/compat.h"
 #include "private/format.h"
 #include "private/macros.h"
+#include "private/memory.h"
 
 /* PACKAGE_VERSION should come from configure */
 FLAC_API const char *FLAC__VERSION_STRING = PACKAGE_VERSION;
@@ -559,27 +560,27 @@ void FLAC__format_entropy_coding_method_partitioned_rice_contents_init(FLAC__Ent
 	object->capacity_by_order = 0;
 }
 
-void FLAC__format_entropy_coding_method_partitioned_rice_contents_clear(FLAC__EntropyCodingMethod_PartitionedRiceContents *object)
+void FLAC__format_entropy_coding_method_partitioned_rice_contents_clear(FLAC__EntropyCodingMethod_PartitionedRiceContents *object, const FLAC__Allocator *allocator)
 {
 	FLAC__ASSERT(0 != object);
 
 	if(0 != object->parameters)
-		free(object->parameters);
+		FLAC__memory_free(allocator, object->parameters);
 	if(0 != object->raw_bits)
-		free(object->raw_bits);
+		FLAC__memory_free(allocator, object->raw_bits);
 	FLAC__format_entropy_coding_method_partitioned_rice_contents_init(object);
 }
 
-FLAC__bool FLAC__format_entropy_coding_method_partitioned_rice_contents_ensure_size(FLAC__EntropyCodingMethod_PartitionedRiceContents *object, uint32_t max_partition_order)
+FLAC__bool FLAC__format_entropy_coding_method_partitioned_rice_contents_ensure_size(FLAC__EntropyCodingMethod_PartitionedRiceContents *object, uint32_t max_partition_order, const FLAC__Allocator *allocator)
 {
 	FLAC__ASSERT(0 != object);
 
 	FLAC__ASSERT(object->capacity_by_order > 0 || (0 == object->parameters && 0 == object->raw_bits));
 
 	if(object->capacity_by_order < max_partition_order) {
-		if(0 == (object->parameters = safe_realloc_(object->parameters, sizeof(uint32_t)*(1 << max_partition_order))))
+		if(0 == (object->parameters = FLAC__memory_safe_realloc(allocator, object->parameters, sizeof(uint32_t)*(1 << max_partition_order))))
 			return false;
-		if(0 == (object->raw_bits = safe_realloc_(object->raw_bits, sizeof(uint32_t)*(1 << max_partition_order))))
+		if(0 == (object->raw_bits = FLAC__memory_safe_realloc(allocator, object->raw_bits, sizeof(uint32_t)*(1 << max_partition_order))))
 			return false;
 		memset(object->raw_bits, 0, sizeof(uint32_t)*(1 << max_partition_order));
 		object->capacity_by_order = max_partition_order;
@@ -34,6 +34,7 @@
 #define FLAC__PRIVATE__BITREADER_H
 
 #include <stdio.h> /* for FILE */
+#include "FLAC/format.h" /* for FLAC__Allocator */
 #include "FLAC/ordinals.h"
 #include "cpu.h"
 
@@ -44,16 +45,22 @@ struct FLAC__BitReader;
 typedef struct FLAC__BitReader FLAC__BitReader;
 
 typedef FLAC__bool (*FLAC__BitReaderReadCallback)(FLAC__byte buffer[], size_t *bytes, void *client_data);
+/* like FLAC__BitReaderReadCallback but hands back a pointer into memory the client owns, up to *bytes long */
+typedef FLAC__bool (*FLAC__BitReaderBorrowCallback)(const FLAC__byte **buffer, size_t *bytes, void *client_data);
 
 /*
  * construction, deletion, initialization, etc functions
  */
-FLAC__BitReader *FLAC__bitreader_new(void);
+FLAC__BitReader *FLAC__bitreader_new(const FLAC__Allocator *allocator); /* allocator must outlive br; NULL means the global one */
 void FLAC__bitreader_delete(FLAC__BitReader *br);
 FLAC__bool FLAC__bitreader_init(FLAC__BitReader *br, FLAC__BitReaderReadCallback rcb, void *cd);
+void FLAC__bitreader_set_cpu_info(FLAC__BitReader *br, const FLAC__CPUInfo *cpuinfo); /* lets the reader pick instruction set specific routines */
+void FLAC__bitreader_set_borrow_callback(FLAC__BitReader *br, FLAC__BitReaderBorrowCallback bcb); /* when set, used instead of the read callback */
+void FLAC__bitreader_set_low_footprint(FLAC__BitReader *br, FLAC__bool value); /* a smaller buffer from the next init on, and no Rice lookup tables */
 void FLAC__bitreader_free(FLAC__BitReader *br); /* does not 'free(br)' */
 FLAC__bool FLAC__bitreader_clear(FLAC__BitReader *br);
 void FLAC__bitreader_dump(const FLAC__BitReader *br, FILE *out);
+size_t FLAC__bitreader_get_footprint(const FLAC__BitReader *br); /* bytes held, including br itself */
 
 /*
  * CRC functions
@@ -79,9 +86,17 @@ FLAC__bool FLAC__bitreader_read_uint32_little_endian(FLAC__BitReader *br, FLAC__
 FLAC__bool FLAC__bitreader_skip_bits_no_crc(FLAC__BitReader *br, uint32_t bits); /* WATCHOUT: does not CRC the skipped data! */ /*@@@@ add to unit tests */
 FLAC__bool FLAC__bitreader_skip_byte_block_aligned_no_crc(FLAC__BitReader *br, uint32_t nvals); /* WATCHOUT: does not CRC the read data! */
 FLAC__bool FLAC__bitreader_read_byte_block_aligned_no_crc(FLAC__BitReader *br, FLAC__byte *val, uint32_t nvals); /* WATCHOUT: does not CRC the read data! */
+FLAC__bool FLAC__bitreader_skip_to_frame_sync_no_crc(FLAC__BitReader *br, uint32_t *skipped); /* stops in front of the next 0xff 0xf8/0xf9 pair; WATCHOUT: does not CRC the skipped data! */
+uint32_t FLAC__bitreader_peek_byte_block_aligned(const FLAC__BitReader *br, FLAC__byte *val, uint32_t nvals); /* copies up to nvals bytes already in the buffer without consuming them, returns how many */
 FLAC__bool FLAC__bitreader_read_unary_unsigned(FLAC__BitReader *br, uint32_t *val);
 FLAC__bool FLAC__bitreader_read_rice_signed(FLAC__BitReader *br, int *val, uint32_t parameter);
 FLAC__bool FLAC__bitreader_read_rice_signed_block(FLAC__BitReader *br, int vals[], uint32_t nvals, uint32_t parameter);
+#if (defined FLAC__CPU_IA32 || defined FLAC__CPU_X86_64) && FLAC__HAS_X86INTRIN && defined FLAC__BMI2_SUPPORTED && !defined FLAC__NO_ASM && (ENABLE_64_BIT_WORDS == 0)
+FLAC__bool FLAC__bitreader_read_rice_signed_block_bmi2(FLAC__BitReader *br, int vals[], uint32_t nvals, uint32_t parameter);
+#endif
+#if (defined FLAC__CPU_IA32 || defined FLAC__CPU_X86_64) && FLAC__HAS_X86INTRIN && defined FLAC__SSE2_SUPPORTED && !defined FLAC__NO_ASM
+uint32_t FLAC__bitreader_skip_no_ff_blocks_intrin_sse2(const FLAC__byte *data, uint32_t len); /* returns how many leading bytes, in blocks of 16, hold no 0xff */
+#endif
 #if 0 /* UNUSED */
 FLAC__bool FLAC__bitreader_read_golomb_signed(FLAC__BitReader *br, int *val, uint32_t parameter);
 FLAC__bool FLAC__bitreader_read_golomb_unsigned(FLAC__BitReader *br, uint32_t *val, uint32_t parameter);
@@ -34,7 +34,9 @@
 #define FLAC__PRIVATE__BITWRITER_H
 
 #include <stdio.h> /* for FILE */
+#include "FLAC/format.h" /* for FLAC__Allocator */
 #include "FLAC/ordinals.h"
+#include "cpu.h"
 
 /*
  * opaque structure definition
@@ -45,12 +47,13 @@ typedef struct FLAC__BitWriter FLAC__BitWriter;
 /*
  * construction, deletion, initialization, etc functions
  */
-FLAC__BitWriter *FLAC__bitwriter_new(void);
+FLAC__BitWriter *FLAC__bitwriter_new(const FLAC__Allocator *allocator); /* allocator must outlive bw; NULL means the global one */
 void FLAC__bitwriter_delete(FLAC__BitWriter *bw);
-FLAC__bool FLAC__bitwriter_init(FLAC__BitWriter *bw);
+FLAC__bool FLAC__bitwriter_init(FLAC__BitWriter *bw); /* keeps the buffer of an earlier init if there was no FLAC__bitwriter_free() since */
 void FLAC__bitwriter_free(FLAC__BitWriter *bw); /* does not 'free(buffer)' */
 void FLAC__bitwriter_clear(FLAC__BitWriter *bw);
 void FLAC__bitwriter_dump(const FLAC__BitWriter *bw, FILE *out);
+void FLAC__bitwriter_set_cpu_info(FLAC__BitWriter *bw, const FLAC__CPUInfo *cpuinfo); /* lets the writer pick instruction set specific routines */
 
 /*
  * CRC functions
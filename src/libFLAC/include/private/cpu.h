@@ -71,10 +71,12 @@
   #endif
   #if (__INTEL_COMPILER >= 1110) /* Intel C++ Compiler 11.1 */
     #define FLAC__AVX_SUPPORTED 1
+    #define FLAC__PCLMUL_SUPPORTED 1
   #endif
   #if (__INTEL_COMPILER >= 1300) /* Intel C++ Compiler 13.0 */
     #define FLAC__AVX2_SUPPORTED 1
     #define FLAC__FMA_SUPPORTED 1
+    #define FLAC__BMI2_SUPPORTED 1
   #endif
 #elif defined __clang__ && __has_attribute(__target__) /* clang */
   #define FLAC__SSE_TARGET(x) __attribute__ ((__target__ (x)))
@@ -90,19 +92,30 @@
   #if __has_builtin(__builtin_ia32_pmuldq128)
     #define FLAC__SSE4_1_SUPPORTED 1
   #endif
+  #if __has_builtin(__builtin_ia32_pclmulqdq128)
+    #define FLAC__PCLMUL_SUPPORTED 1
+  #endif
   #if __has_builtin(__builtin_ia32_pabsd256)
     #define FLAC__AVX2_SUPPORTED 1
   #endif
+  #if __has_builtin(__builtin_ia32_vfmaddps256)
+    #define FLAC__FMA_SUPPORTED 1
+  #endif
+  #if __has_builtin(__builtin_ia32_bzhi_si)
+    #define FLAC__BMI2_SUPPORTED 1
+  #endif
 #elif defined __GNUC__ && !defined __clang__ && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) /* GCC 4.9+ */
   #define FLAC__SSE_TARGET(x) __attribute__ ((__target__ (x)))
   #define FLAC__SSE_SUPPORTED 1
   #define FLAC__SSE2_SUPPORTED 1
   #define FLAC__SSSE3_SUPPORTED 1
   #define FLAC__SSE4_1_SUPPORTED 1
+  #define FLAC__PCLMUL_SUPPORTED 1
   #ifdef FLAC__USE_AVX
     #define FLAC__AVX_SUPPORTED 1
     #define FLAC__AVX2_SUPPORTED 1
     #define FLAC__FMA_SUPPORTED 1
+    #define FLAC__BMI2_SUPPORTED 1
   #endif
 #elif defined _MSC_VER
   #define FLAC__SSE_TARGET(x)
@@ -112,12 +125,16 @@
     #define FLAC__SSSE3_SUPPORTED 1
     #define FLAC__SSE4_1_SUPPORTED 1
   #endif
+  #if (_MSC_VER >= 1600) /* MS Visual Studio 2010 */
+    #define FLAC__PCLMUL_SUPPORTED 1
+  #endif
   #if (_MSC_FULL_VER >= 160040219) /* MS Visual Studio 2010 SP1 */
     #define FLAC__AVX_SUPPORTED 1
   #endif
   #if (_MSC_VER >= 1700) /* MS Visual Studio 2012 */
     #define FLAC__AVX2_SUPPORTED 1
     #define FLAC__FMA_SUPPORTED 1
+    #define FLAC__BMI2_SUPPORTED 1
   #endif
 #else
   #define FLAC__SSE_TARGET(x)
@@ -133,6 +150,9 @@
   #ifdef __SSE4_1__
     #define FLAC__SSE4_1_SUPPORTED 1
   #endif
+  #ifdef __PCLMUL__
+    #define FLAC__PCLMUL_SUPPORTED 1
+  #endif
   #ifdef __AVX__
     #define FLAC__AVX_SUPPORTED 1
   #endif
@@ -142,6 +162,9 @@
   #ifdef __FMA__
     #define FLAC__FMA_SUPPORTED 1
   #endif
+  #ifdef __BMI2__
+    #define FLAC__BMI2_SUPPORTED 1
+  #endif
 #endif /* compiler version */
 #endif /* intrinsics support */
 
@@ -169,9 +192,12 @@ typedef struct {
 	FLAC__bool ssse3;
 	FLAC__bool sse41;
 	FLAC__bool sse42;
+	FLAC__bool pclmul;
 	FLAC__bool avx;
 	FLAC__bool avx2;
 	FLAC__bool fma;
+	FLAC__bool bmi2;
+	FLAC__bool lzcnt;
 } FLAC__CPUInfo_x86;
 
 typedef struct {
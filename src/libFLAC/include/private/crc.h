@@ -33,6 +33,7 @@
 #ifndef FLAC__PRIVATE__CRC_H
 #define FLAC__PRIVATE__CRC_H
 
+#include "private/cpu.h"
 #include "FLAC/ordinals.h"
 
 /* 8 bit CRC generator, MSB shifted first
@@ -57,4 +58,15 @@ FLAC__uint16 FLAC__crc16(const FLAC__byte *data, uint32_t len);
 FLAC__uint16 FLAC__crc16_update_words32(const FLAC__uint32 *words, uint32_t len, FLAC__uint16 crc);
 FLAC__uint16 FLAC__crc16_update_words64(const FLAC__uint64 *words, uint32_t len, FLAC__uint16 crc);
 
+#ifndef FLAC__NO_ASM
+#if (defined FLAC__CPU_IA32 || defined FLAC__CPU_X86_64) && FLAC__HAS_X86INTRIN
+#ifdef FLAC__PCLMUL_SUPPORTED
+/* same results as above; need PCLMULQDQ and SSSE3 */
+FLAC__uint16 FLAC__crc16_intrin_pclmul(const FLAC__byte *data, uint32_t len);
+FLAC__uint16 FLAC__crc16_update_words32_intrin_pclmul(const FLAC__uint32 *words, uint32_t len, FLAC__uint16 crc);
+FLAC__uint16 FLAC__crc16_update_words64_intrin_pclmul(const FLAC__uint64 *words, uint32_t len, FLAC__uint16 crc);
+#endif
+#endif
+#endif
+
 #endif
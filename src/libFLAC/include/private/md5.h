@@ -26,6 +26,7 @@
  * Still in the public domain, with no warranty.
  */
 
+#include "FLAC/format.h" /* for FLAC__Allocator */
 #include "FLAC/ordinals.h"
 
 typedef union {
@@ -40,11 +41,29 @@ typedef struct {
 	FLAC__uint32 bytes[2];
 	FLAC__multibyte internal_buf;
 	size_t capacity;
+	const FLAC__Allocator *allocator; /* for internal_buf; NULL means the global one */
 } FLAC__MD5Context;
 
-void FLAC__MD5Init(FLAC__MD5Context *context);
+void FLAC__MD5Init(FLAC__MD5Context *context, const FLAC__Allocator *allocator);
 void FLAC__MD5Final(FLAC__byte digest[16], FLAC__MD5Context *context);
 
 FLAC__bool FLAC__MD5Accumulate(FLAC__MD5Context *ctx, const FLAC__int32 * const signal[], uint32_t channels, uint32_t samples, uint32_t bytes_per_sample);
 
+#ifdef HAVE_PTHREAD
+/*
+ * FLAC__MD5Accumulate() split in two: the calling thread only formats
+ * the signal, and a worker thread started by FLAC__MD5WorkerStart()
+ * does the hashing.  The context must not be touched otherwise until
+ * FLAC__MD5WorkerFinish() has hashed whatever is still queued and
+ * stopped the thread; then it can be passed to FLAC__MD5Final() as
+ * usual.
+ */
+typedef struct FLAC__MD5Worker FLAC__MD5Worker;
+
+FLAC__MD5Worker *FLAC__MD5WorkerStart(FLAC__MD5Context *ctx);
+FLAC__bool FLAC__MD5WorkerAccumulate(FLAC__MD5Worker *worker, const FLAC__int32 * const signal[], uint32_t channels, uint32_t samples, uint32_t bytes_per_sample);
+void FLAC__MD5WorkerFinish(FLAC__MD5Worker *worker);
+size_t FLAC__MD5WorkerGetFootprint(const FLAC__MD5Worker *worker); /* bytes held, including the worker itself; only from the accumulating thread */
+#endif
+
 #endif
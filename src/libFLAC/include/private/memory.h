@@ -40,19 +40,41 @@
 #include <stdlib.h> /* for size_t */
 
 #include "private/float.h"
+#include "FLAC/format.h" /* for FLAC__Allocator */
 #include "FLAC/ordinals.h" /* for FLAC__bool */
 
-/* Returns the unaligned address returned by malloc.
- * Use free() on this address to deallocate.
+/* Everything here takes the allocator to use first; NULL means the one
+ * set with FLAC__set_allocator(), i.e. the C library by default.  The
+ * functions mirror the ones in share/alloc.h: FLAC__memory_malloc()
+ * always allocates at least one byte, FLAC__memory_realloc() has
+ * realloc()'s semantics, and FLAC__memory_safe_realloc() and the
+ * realloc_*op functions free the old block when they fail.
  */
-void *FLAC__memory_alloc_aligned(size_t bytes, void **aligned_address);
-FLAC__bool FLAC__memory_alloc_aligned_int32_array(size_t elements, FLAC__int32 **unaligned_pointer, FLAC__int32 **aligned_pointer);
-FLAC__bool FLAC__memory_alloc_aligned_uint32_array(size_t elements, FLAC__uint32 **unaligned_pointer, FLAC__uint32 **aligned_pointer);
-FLAC__bool FLAC__memory_alloc_aligned_uint64_array(size_t elements, FLAC__uint64 **unaligned_pointer, FLAC__uint64 **aligned_pointer);
-FLAC__bool FLAC__memory_alloc_aligned_unsigned_array(size_t elements, uint32_t **unaligned_pointer, uint32_t **aligned_pointer);
+void FLAC__memory_get_allocator(FLAC__Allocator *dest, const FLAC__Allocator *allocator);
+void *FLAC__memory_malloc(const FLAC__Allocator *allocator, size_t size);
+void *FLAC__memory_calloc(const FLAC__Allocator *allocator, size_t nmemb, size_t size);
+void *FLAC__memory_realloc(const FLAC__Allocator *allocator, void *ptr, size_t size);
+void FLAC__memory_free(const FLAC__Allocator *allocator, void *ptr);
+char *FLAC__memory_strdup(const FLAC__Allocator *allocator, const char *s);
+void *FLAC__memory_malloc_add_2op(const FLAC__Allocator *allocator, size_t size1, size_t size2);
+void *FLAC__memory_malloc_add_4op(const FLAC__Allocator *allocator, size_t size1, size_t size2, size_t size3, size_t size4);
+void *FLAC__memory_malloc_mul_2op(const FLAC__Allocator *allocator, size_t size1, size_t size2);
+void *FLAC__memory_malloc_muladd2(const FLAC__Allocator *allocator, size_t size1, size_t size2, size_t size3);
+void *FLAC__memory_safe_realloc(const FLAC__Allocator *allocator, void *ptr, size_t size);
+void *FLAC__memory_realloc_add_2op(const FLAC__Allocator *allocator, void *ptr, size_t size1, size_t size2);
+void *FLAC__memory_realloc_mul_2op(const FLAC__Allocator *allocator, void *ptr, size_t size1, size_t size2);
+
+/* Returns the unaligned address returned by the allocator.
+ * Use FLAC__memory_free() with the same allocator on this address to
+ * deallocate.
+ */
+void *FLAC__memory_alloc_aligned(const FLAC__Allocator *allocator, size_t bytes, void **aligned_address);
+FLAC__bool FLAC__memory_alloc_aligned_int32_array(const FLAC__Allocator *allocator, size_t elements, FLAC__int32 **unaligned_pointer, FLAC__int32 **aligned_pointer);
+FLAC__bool FLAC__memory_alloc_aligned_uint32_array(const FLAC__Allocator *allocator, size_t elements, FLAC__uint32 **unaligned_pointer, FLAC__uint32 **aligned_pointer);
+FLAC__bool FLAC__memory_alloc_aligned_uint64_array(const FLAC__Allocator *allocator, size_t elements, FLAC__uint64 **unaligned_pointer, FLAC__uint64 **aligned_pointer);
+FLAC__bool FLAC__memory_alloc_aligned_unsigned_array(const FLAC__Allocator *allocator, size_t elements, uint32_t **unaligned_pointer, uint32_t **aligned_pointer);
 #ifndef FLAC__INTEGER_ONLY_LIBRARY
-FLAC__bool FLAC__memory_alloc_aligned_real_array(size_t elements, FLAC__real **unaligned_pointer, FLAC__real **aligned_pointer);
+FLAC__bool FLAC__memory_alloc_aligned_real_array(const FLAC__Allocator *allocator, size_t elements, FLAC__real **unaligned_pointer, FLAC__real **aligned_pointer);
 #endif
-void *safe_malloc_mul_2op_p(size_t size1, size_t size2);
 
 #endif
@@ -0,0 +1,119 @@
+/* libFLAC - Free Lossless Audio Codec library
+ * Copyright (C) 2000-2009  Josh Coalson
+ * Copyright (C) 2011-2018  Xiph.Org Foundation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of the Xiph.org Foundation nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FLAC__PRIVATE__PCM_H
+#define FLAC__PRIVATE__PCM_H
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "private/cpu.h"
+#include "FLAC/format.h"
+
+/*
+ *	FLAC__pcm_interleave_*()
+ *	--------------------------------------------------------------------
+ *	Interleave the decoded channels of a block into one buffer of
+ *	samples in the host's byte order.  Integer output is scaled to the
+ *	width of the output type by shifting (so narrowing just truncates
+ *	the low bits); float output is scaled to [-1.0,1.0).  The int24
+ *	flavor writes 3 bytes per sample with no padding.
+ *
+ *	IN input[0,channels-1][0,samples-1]  the decoded channels
+ *	IN channels
+ *	IN samples                           samples per channel
+ *	IN bps                               bits per sample of input
+ *	OUT output[0,channels*samples-1]
+ */
+typedef void (*FLAC__PCMInterleaveFunction)(const FLAC__int32 * const input[], uint32_t channels, uint32_t samples, uint32_t bps, void *output);
+
+void FLAC__pcm_interleave_int16(const FLAC__int32 * const input[], uint32_t channels, uint32_t samples, uint32_t bps, void *output);
+void FLAC__pcm_interleave_int24(const FLAC__int32 * const input[], uint32_t channels, uint32_t samples, uint32_t bps, void *output);
+void FLAC__pcm_interleave_int32(const FLAC__int32 * const input[], uint32_t channels, uint32_t samples, uint32_t bps, void *output);
+#ifndef FLAC__INTEGER_ONLY_LIBRARY
+void FLAC__pcm_interleave_float32(const FLAC__int32 * const input[], uint32_t channels, uint32_t samples, uint32_t bps, void *output);
+#endif
+#ifndef FLAC__NO_ASM
+# if (defined FLAC__CPU_IA32 || defined FLAC__CPU_X86_64) && FLAC__HAS_X86INTRIN
+#  ifdef FLAC__SSE2_SUPPORTED
+void FLAC__pcm_interleave_int16_intrin_sse2(const FLAC__int32 * const input[], uint32_t channels, uint32_t samples, uint32_t bps, void *output);
+void FLAC__pcm_interleave_int32_intrin_sse2(const FLAC__int32 * const input[], uint32_t channels, uint32_t samples, uint32_t bps, void *output);
+#   ifndef FLAC__INTEGER_ONLY_LIBRARY
+void FLAC__pcm_interleave_float32_intrin_sse2(const FLAC__int32 * const input[], uint32_t channels, uint32_t samples, uint32_t bps, void *output);
+#   endif
+#  endif
+#  ifdef FLAC__SSSE3_SUPPORTED
+void FLAC__pcm_interleave_int24_intrin_ssse3(const FLAC__int32 * const input[], uint32_t channels, uint32_t samples, uint32_t bps, void *output);
+#  endif
+# endif
+#endif
+
+/*
+ *	FLAC__pcm_deinterleave_*()
+ *	--------------------------------------------------------------------
+ *	The reverse, for the encoder: split an interleaved buffer into one
+ *	array per channel.  Integer input is taken at face value, i.e. not
+ *	rescaled; the int24 flavor reads packed 3-byte little-endian
+ *	samples.  Float input is scaled by 2^(bps-1), so [-1.0,1.0) covers
+ *	the full range.  Returns false if any sample does not fit in bps
+ *	bits or, for float, is not exactly an integer after scaling; the
+ *	contents of output are undefined in that case.
+ *
+ *	IN input[0,channels*samples-1]
+ *	IN channels
+ *	IN samples                           samples per channel
+ *	IN bps                               bits per sample of output
+ *	OUT output[0,channels-1][0,samples-1]
+ */
+typedef FLAC__bool (*FLAC__PCMDeinterleaveFunction)(const void *input, uint32_t channels, uint32_t samples, uint32_t bps, FLAC__int32 * const output[]);
+
+FLAC__bool FLAC__pcm_deinterleave_int16(const void *input, uint32_t channels, uint32_t samples, uint32_t bps, FLAC__int32 * const output[]);
+FLAC__bool FLAC__pcm_deinterleave_int24(const void *input, uint32_t channels, uint32_t samples, uint32_t bps, FLAC__int32 * const output[]);
+#ifndef FLAC__INTEGER_ONLY_LIBRARY
+FLAC__bool FLAC__pcm_deinterleave_float32(const void *input, uint32_t channels, uint32_t samples, uint32_t bps, FLAC__int32 * const output[]);
+#endif
+#ifndef FLAC__NO_ASM
+# if (defined FLAC__CPU_IA32 || defined FLAC__CPU_X86_64) && FLAC__HAS_X86INTRIN
+#  ifdef FLAC__SSE2_SUPPORTED
+FLAC__bool FLAC__pcm_deinterleave_int16_intrin_sse2(const void *input, uint32_t channels, uint32_t samples, uint32_t bps, FLAC__int32 * const output[]);
+#   ifndef FLAC__INTEGER_ONLY_LIBRARY
+FLAC__bool FLAC__pcm_deinterleave_float32_intrin_sse2(const void *input, uint32_t channels, uint32_t samples, uint32_t bps, FLAC__int32 * const output[]);
+#   endif
+#  endif
+#  ifdef FLAC__SSSE3_SUPPORTED
+FLAC__bool FLAC__pcm_deinterleave_int24_intrin_ssse3(const void *input, uint32_t channels, uint32_t samples, uint32_t bps, FLAC__int32 * const output[]);
+#  endif
+# endif
+#endif
+
+#endif
@@ -0,0 +1,91 @@
+/* libFLAC - Free Lossless Audio Codec library
+ * Copyright (C) 2000-2009  Josh Coalson
+ * Copyright (C) 2011-2018  Xiph.Org Foundation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of the Xiph.org Foundation nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FLAC__PRIVATE__STATISTICS_H
+#define FLAC__PRIVATE__STATISTICS_H
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef FLAC__ENABLE_STATISTICS
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#include "FLAC/ordinals.h"
+
+/*
+ *	FLAC__statistics_clock()
+ *	--------------------------------------------------------------------
+ *	Read a monotonic clock, in nanoseconds from an arbitrary origin.
+ */
+static inline FLAC__uint64 FLAC__statistics_clock(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER now, frequency;
+	QueryPerformanceCounter(&now);
+	QueryPerformanceFrequency(&frequency);
+	return (FLAC__uint64)(now.QuadPart / frequency.QuadPart) * 1000000000 +
+		(FLAC__uint64)(now.QuadPart % frequency.QuadPart) * 1000000000 / (FLAC__uint64)frequency.QuadPart;
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (FLAC__uint64)now.tv_sec * 1000000000 + (FLAC__uint64)now.tv_nsec;
+#endif
+}
+
+/*
+ *	FLAC__STATISTICS_TIME()
+ *	--------------------------------------------------------------------
+ *	Run a statement and charge its wall-clock time and one call to
+ *	stage 'stage' of 'counters', which must point to a structure with
+ *	'nanoseconds' and 'calls' arrays.  When statistics are not compiled
+ *	in, the statement runs bare and 'counters' is never evaluated, so
+ *	it may name fields that only exist in statistics builds.
+ */
+#define FLAC__STATISTICS_TIME(counters, stage, ...) do { \
+	const FLAC__uint64 statistics_start_ = FLAC__statistics_clock(); \
+	__VA_ARGS__; \
+	(counters)->nanoseconds[stage] += FLAC__statistics_clock() - statistics_start_; \
+	(counters)->calls[stage]++; \
+} while(0)
+
+#else
+
+#define FLAC__STATISTICS_TIME(counters, stage, ...) do { __VA_ARGS__; } while(0)
+
+#endif
+
+#endif
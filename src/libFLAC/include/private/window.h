@@ -38,6 +38,7 @@
 #endif
 
 #include "private/float.h"
+#include "protected/stream_encoder.h"
 #include "FLAC/format.h"
 
 #ifndef FLAC__INTEGER_ONLY_LIBRARY
@@ -69,6 +70,23 @@ void FLAC__window_partial_tukey(FLAC__real *window, const FLAC__int32 L, const F
 void FLAC__window_punchout_tukey(FLAC__real *window, const FLAC__int32 L, const FLAC__real p, const FLAC__real start, const FLAC__real end);
 void FLAC__window_welch(FLAC__real *window, const FLAC__int32 L);
 
+/* computes the window given by spec, with any of the functions above */
+void FLAC__window_compute(FLAC__real *window, const FLAC__int32 L, const FLAC__ApodizationSpecification *spec);
+
+/*
+ *	FLAC__window_cache_*()
+ *	--------------------------------------------------------------------
+ *	A process-wide cache of computed windows, so that encoders with the
+ *	same apodization and blocksize share one read-only copy.  Each
+ *	successful acquire, which computes the window if need be, must be
+ *	paired with a release.  Acquire returns NULL if out of memory.
+ */
+typedef struct FLAC__WindowCacheEntry FLAC__WindowCacheEntry;
+
+FLAC__WindowCacheEntry *FLAC__window_cache_acquire(const FLAC__ApodizationSpecification *spec, const FLAC__int32 L);
+const FLAC__real *FLAC__window_cache_get_window(const FLAC__WindowCacheEntry *entry);
+void FLAC__window_cache_release(FLAC__WindowCacheEntry *entry);
+
 #endif /* !defined FLAC__INTEGER_ONLY_LIBRARY */
 
 #endif
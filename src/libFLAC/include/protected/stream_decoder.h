@@ -38,6 +38,8 @@
 #include "private/ogg_decoder_aspect.h"
 #endif
 
+#define FLAC__STREAM_DECODER_MAX_THREADS 64
+
 typedef struct FLAC__StreamDecoderProtected {
 	FLAC__StreamDecoderState state;
 	FLAC__StreamDecoderInitStatus initstate;
@@ -47,6 +49,9 @@ typedef struct FLAC__StreamDecoderProtected {
 	uint32_t sample_rate; /* in Hz */
 	uint32_t blocksize; /* in samples (per channel) */
 	FLAC__bool md5_checking; /* if true, generate MD5 signature of decoded data and compare against signature in the STREAMINFO metadata block */
+	FLAC__bool threaded_md5; /* if true, the MD5 signature is computed on a thread of its own */
+	FLAC__StreamDecoderInterleavedFormat interleaved_format; /* if not NONE, each frame is also interleaved in this format before the write callback */
+	FLAC__bool low_footprint; /* if true, keep as little memory as possible; see FLAC__stream_decoder_set_low_footprint() */
 #if FLAC__HAS_OGG
 	FLAC__OggDecoderAspect ogg_decoder_aspect;
 #endif
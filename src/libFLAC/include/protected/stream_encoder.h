@@ -38,6 +38,8 @@
 #include "private/ogg_encoder_aspect.h"
 #endif
 
+#define FLAC__STREAM_ENCODER_MAX_THREADS 64
+
 #ifndef FLAC__INTEGER_ONLY_LIBRARY
 
 #include "private/float.h"
@@ -106,6 +108,10 @@ typedef struct FLAC__StreamEncoderProtected {
 	uint32_t min_residual_partition_order;
 	uint32_t max_residual_partition_order;
 	uint32_t rice_parameter_search_dist;
+	uint32_t num_threads;
+	FLAC__bool parallel_subframes;
+	FLAC__bool threaded_md5;
+	FLAC__bool keep_buffers; /* if true, FLAC__stream_encoder_finish() leaves the signal and residual buffers for the next init */
 	FLAC__uint64 total_samples_estimate;
 	FLAC__StreamMetadata **metadata;
 	uint32_t num_metadata_blocks;
@@ -46,6 +46,7 @@
 #include "FLAC/format.h"
 
 #include <immintrin.h> /* AVX2 */
+#include <string.h> /* for memset() */
 
 FLAC__SSE_TARGET("avx2")
 void FLAC__lpc_compute_residual_from_qlp_coefficients_16_intrin_avx2(const FLAC__int32 *data, uint32_t data_len, const FLAC__int32 qlp_coeff[], uint32_t order, int lp_quantization, FLAC__int32 residual[])
@@ -1116,6 +1117,255 @@ void FLAC__lpc_compute_residual_from_qlp_coefficients_wide_intrin_avx2(const FLA
 	_mm256_zeroupper();
 }
 
+/*
+ * The restore routines cannot vectorize across samples the way the
+ * residual routines do, since each sample depends on the ones before
+ * it.  Instead the output is produced in blocks: the contribution of
+ * the samples preceding a block is computed for all of its samples at
+ * once with vector multiplies (coefficients whose history sample lies
+ * inside the block are masked to zero), then the few remaining terms
+ * are added serially as each sample of the block is reconstructed.
+ * The two most recent blocks are kept in registers, since reloading
+ * samples that were only just stored would stall on store forwarding.
+ */
+
+FLAC__SSE_TARGET("avx2")
+static void restore_signal_avx2_(const FLAC__int32 residual[], uint32_t data_len, const FLAC__int32 qlp_coeff[], uint32_t order, int lp_quantization, FLAC__int32 data[], FLAC__bool is_16bit)
+{
+	__m256i q[32], idx[16], blend[8];
+	__m256i prev, prev2; /* data[i-8,i-1] and data[i-16,i-9] */
+	FLAC__int32 c[7], hist[16], partial[8];
+	const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	int i, k;
+
+	FLAC__ASSERT(order > 0);
+	FLAC__ASSERT(order <= 32);
+
+	for(k = 1; k <= (int)order; k++) {
+		q[k-1] = _mm256_set1_epi32(is_16bit? 0xffff & qlp_coeff[k-1] : qlp_coeff[k-1]);
+		if(k < 8) /* lane t needs data[i+t-k], which is inside the block for t >= k */
+			q[k-1] = _mm256_and_si256(q[k-1], _mm256_cmpgt_epi32(_mm256_set1_epi32(k), lane));
+	}
+	for(k = 1; k < 16; k++)
+		idx[k] = _mm256_and_si256(_mm256_sub_epi32(lane, _mm256_set1_epi32(k)), _mm256_set1_epi32(7));
+	for(k = 1; k < 8; k++) /* for 8 < k < 16, lanes t < k-8 come from prev2 */
+		blend[k] = _mm256_cmpgt_epi32(_mm256_set1_epi32(k), lane);
+	for(k = 0; k < 7; k++)
+		c[k] = k < (int)order? qlp_coeff[k] : 0;
+
+	/* only data[-order,-1] is guaranteed to be there */
+	memset(hist, 0, sizeof(hist));
+	for(k = 1; k <= (int)order && k <= 16; k++)
+		hist[16-k] = data[-k];
+	prev2 = _mm256_loadu_si256((const __m256i*)(hist+0));
+	prev  = _mm256_loadu_si256((const __m256i*)(hist+8));
+
+	for(i = 0; i <= (int)data_len-8; i += 8) {
+		__m256i summ = _mm256_setzero_si256();
+		FLAC__int32 d0, d1, d2, d3, d4, d5, d6, d7;
+
+#define FLAC__RESTORE_MADD_(k, d) summ = _mm256_add_epi32(summ, is_16bit? _mm256_madd_epi16(q[(k)-1], (d)) : _mm256_mullo_epi32(q[(k)-1], (d)))
+		for(k = 1; k < 8 && k <= (int)order; k++)
+			FLAC__RESTORE_MADD_(k, _mm256_permutevar8x32_epi32(prev, idx[k]));
+		if(order >= 8)
+			FLAC__RESTORE_MADD_(8, prev);
+		for(k = 9; k < 16 && k <= (int)order; k++)
+			FLAC__RESTORE_MADD_(k, _mm256_blendv_epi8(_mm256_permutevar8x32_epi32(prev, idx[k]), _mm256_permutevar8x32_epi32(prev2, idx[k]), blend[k-8]));
+		if(order >= 16)
+			FLAC__RESTORE_MADD_(16, prev2);
+		for(k = 17; k <= (int)order; k++)
+			FLAC__RESTORE_MADD_(k, _mm256_loadu_si256((const __m256i*)(data+i-k)));
+#undef FLAC__RESTORE_MADD_
+		_mm256_storeu_si256((__m256i*)partial, summ);
+
+		d0 = residual[i  ] + ( partial[0]                                                                                   >> lp_quantization);
+		d1 = residual[i+1] + ((partial[1] + c[0]*d0)                                                                        >> lp_quantization);
+		d2 = residual[i+2] + ((partial[2] + c[0]*d1 + c[1]*d0)                                                              >> lp_quantization);
+		d3 = residual[i+3] + ((partial[3] + c[0]*d2 + c[1]*d1 + c[2]*d0)                                                    >> lp_quantization);
+		d4 = residual[i+4] + ((partial[4] + c[0]*d3 + c[1]*d2 + c[2]*d1 + c[3]*d0)                                          >> lp_quantization);
+		d5 = residual[i+5] + ((partial[5] + c[0]*d4 + c[1]*d3 + c[2]*d2 + c[3]*d1 + c[4]*d0)                                >> lp_quantization);
+		d6 = residual[i+6] + ((partial[6] + c[0]*d5 + c[1]*d4 + c[2]*d3 + c[3]*d2 + c[4]*d1 + c[5]*d0)                      >> lp_quantization);
+		d7 = residual[i+7] + ((partial[7] + c[0]*d6 + c[1]*d5 + c[2]*d4 + c[3]*d3 + c[4]*d2 + c[5]*d1 + c[6]*d0)            >> lp_quantization);
+		data[i  ] = d0; data[i+1] = d1; data[i+2] = d2; data[i+3] = d3;
+		data[i+4] = d4; data[i+5] = d5; data[i+6] = d6; data[i+7] = d7;
+
+		prev2 = prev;
+		prev = _mm256_setr_epi32(d0, d1, d2, d3, d4, d5, d6, d7);
+	}
+	for(; i < (int)data_len; i++) {
+		FLAC__int32 sum = 0;
+		for(k = 1; k <= (int)order; k++)
+			sum += qlp_coeff[k-1] * data[i-k];
+		data[i] = residual[i] + (sum >> lp_quantization);
+	}
+}
+
+FLAC__SSE_TARGET("avx2")
+static void restore_signal_wide_avx2_(const FLAC__int32 residual[], uint32_t data_len, const FLAC__int32 qlp_coeff[], uint32_t order, int lp_quantization, FLAC__int32 data[])
+{
+	__m256i q[32], idx[8], blend[4];
+	__m256i prev, prev2; /* data[i-4,i-1] and data[i-8,i-5], one per 64-bit lane */
+	FLAC__int64 c[3], partial[4];
+	const __m256i lane = _mm256_setr_epi64x(0, 1, 2, 3);
+	int i, k;
+
+	FLAC__ASSERT(order > 0);
+	FLAC__ASSERT(order <= 32);
+
+	/* _mm256_mul_epi32() only looks at the low half of each 64-bit lane, so there is no need to sign-extend */
+	for(k = 1; k <= (int)order; k++) {
+		q[k-1] = _mm256_set1_epi64x(qlp_coeff[k-1]);
+		if(k < 4)
+			q[k-1] = _mm256_and_si256(q[k-1], _mm256_cmpgt_epi64(_mm256_set1_epi64x(k), lane));
+	}
+	for(k = 1; k < 8; k++) {
+		/* 32-bit permute indices that move 64-bit lane (t-k)&3 to lane t */
+		const __m256i src = _mm256_and_si256(_mm256_sub_epi64(lane, _mm256_set1_epi64x(k)), _mm256_set1_epi64x(3));
+		idx[k] = _mm256_or_si256(_mm256_slli_epi64(src, 1), _mm256_slli_epi64(_mm256_add_epi64(_mm256_slli_epi64(src, 1), _mm256_set1_epi64x(1)), 32));
+	}
+	for(k = 1; k < 4; k++)
+		blend[k] = _mm256_cmpgt_epi64(_mm256_set1_epi64x(k), lane);
+	for(k = 0; k < 3; k++)
+		c[k] = k < (int)order? qlp_coeff[k] : 0;
+
+	prev2 = _mm256_setzero_si256();
+	prev = _mm256_setzero_si256();
+	{
+		FLAC__int32 hist[8] = { 0 };
+		for(k = 1; k <= (int)order && k <= 8; k++)
+			hist[8-k] = data[-k];
+		prev2 = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i*)(hist+0)));
+		prev  = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i*)(hist+4)));
+	}
+
+	for(i = 0; i <= (int)data_len-4; i += 4) {
+		__m256i summ = _mm256_setzero_si256();
+		FLAC__int32 d0, d1, d2, d3;
+
+		for(k = 1; k < 4 && k <= (int)order; k++)
+			summ = _mm256_add_epi64(summ, _mm256_mul_epi32(q[k-1], _mm256_permutevar8x32_epi32(prev, idx[k])));
+		if(order >= 4)
+			summ = _mm256_add_epi64(summ, _mm256_mul_epi32(q[3], prev));
+		for(k = 5; k < 8 && k <= (int)order; k++)
+			summ = _mm256_add_epi64(summ, _mm256_mul_epi32(q[k-1], _mm256_blendv_epi8(_mm256_permutevar8x32_epi32(prev, idx[k]), _mm256_permutevar8x32_epi32(prev2, idx[k]), blend[k-4])));
+		if(order >= 8)
+			summ = _mm256_add_epi64(summ, _mm256_mul_epi32(q[7], prev2));
+		for(k = 9; k <= (int)order; k++)
+			summ = _mm256_add_epi64(summ, _mm256_mul_epi32(q[k-1], _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i*)(data+i-k)))));
+		_mm256_storeu_si256((__m256i*)partial, summ);
+
+		d0 = residual[i  ] + (FLAC__int32)( partial[0]                                     >> lp_quantization);
+		d1 = residual[i+1] + (FLAC__int32)((partial[1] + c[0]*d0)                          >> lp_quantization);
+		d2 = residual[i+2] + (FLAC__int32)((partial[2] + c[0]*d1 + c[1]*d0)                >> lp_quantization);
+		d3 = residual[i+3] + (FLAC__int32)((partial[3] + c[0]*d2 + c[1]*d1 + c[2]*d0)      >> lp_quantization);
+		data[i] = d0; data[i+1] = d1; data[i+2] = d2; data[i+3] = d3;
+
+		prev2 = prev;
+		prev = _mm256_setr_epi64x(d0, d1, d2, d3);
+	}
+	for(; i < (int)data_len; i++) {
+		FLAC__int64 sum = 0;
+		for(k = 1; k <= (int)order; k++)
+			sum += qlp_coeff[k-1] * (FLAC__int64)data[i-k];
+		data[i] = residual[i] + (FLAC__int32)(sum >> lp_quantization);
+	}
+}
+
+/*
+ * Below order 10 the serial part dominates and the plain C routines are
+ * as fast or faster, so those are handed back.
+ */
+
+FLAC__SSE_TARGET("avx2")
+void FLAC__lpc_restore_signal_16_intrin_avx2(const FLAC__int32 residual[], uint32_t data_len, const FLAC__int32 qlp_coeff[], uint32_t order, int lp_quantization, FLAC__int32 data[])
+{
+	if(order < 10) {
+		FLAC__lpc_restore_signal(residual, data_len, qlp_coeff, order, lp_quantization, data);
+		return;
+	}
+	restore_signal_avx2_(residual, data_len, qlp_coeff, order, lp_quantization, data, /*is_16bit=*/true);
+	_mm256_zeroupper();
+}
+
+FLAC__SSE_TARGET("avx2")
+void FLAC__lpc_restore_signal_intrin_avx2(const FLAC__int32 residual[], uint32_t data_len, const FLAC__int32 qlp_coeff[], uint32_t order, int lp_quantization, FLAC__int32 data[])
+{
+	if(order < 10) {
+		FLAC__lpc_restore_signal(residual, data_len, qlp_coeff, order, lp_quantization, data);
+		return;
+	}
+	restore_signal_avx2_(residual, data_len, qlp_coeff, order, lp_quantization, data, /*is_16bit=*/false);
+	_mm256_zeroupper();
+}
+
+FLAC__SSE_TARGET("avx2")
+void FLAC__lpc_restore_signal_wide_intrin_avx2(const FLAC__int32 residual[], uint32_t data_len, const FLAC__int32 qlp_coeff[], uint32_t order, int lp_quantization, FLAC__int32 data[])
+{
+	if(order < 10) {
+		FLAC__lpc_restore_signal_wide(residual, data_len, qlp_coeff, order, lp_quantization, data);
+		return;
+	}
+	restore_signal_wide_avx2_(residual, data_len, qlp_coeff, order, lp_quantization, data);
+	_mm256_zeroupper();
+}
+
+#ifdef FLAC__FMA_SUPPORTED
+FLAC__SSE_TARGET("avx")
+static inline float hsum_ps_avx_(__m256 v)
+{
+	__m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+	s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+	s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+	return _mm_cvtss_f32(s);
+}
+
+/* Computes the lags four at a time, each pass sharing the loads of
+ * data[i] between them; unlike the SSE routines, this only ever writes
+ * autoc[0,lag-1], so it can be used for any lag up to 33 (LPC order 32).
+ */
+FLAC__SSE_TARGET("avx2,fma")
+void FLAC__lpc_compute_autocorrelation_intrin_avx2_fma(const FLAC__real data[], uint32_t data_len, uint32_t lag, FLAC__real autoc[])
+{
+	int i, j;
+	uint32_t coeff;
+
+	FLAC__ASSERT(lag > 0);
+	FLAC__ASSERT(lag <= FLAC__MAX_LPC_ORDER+1);
+	FLAC__ASSERT(lag <= data_len);
+
+	for(coeff = 0; coeff < lag; coeff += 4) {
+		/* last i for which data[i+coeff+3 .. i+coeff+10] are all in range */
+		const int limit = (int)data_len - (int)coeff - 11;
+		__m256 sum0 = _mm256_setzero_ps();
+		__m256 sum1 = _mm256_setzero_ps();
+		__m256 sum2 = _mm256_setzero_ps();
+		__m256 sum3 = _mm256_setzero_ps();
+		FLAC__real sum[4];
+
+		for(i = 0; i <= limit; i += 8) {
+			const __m256 d = _mm256_loadu_ps(data+i);
+			sum0 = _mm256_fmadd_ps(d, _mm256_loadu_ps(data+i+coeff  ), sum0);
+			sum1 = _mm256_fmadd_ps(d, _mm256_loadu_ps(data+i+coeff+1), sum1);
+			sum2 = _mm256_fmadd_ps(d, _mm256_loadu_ps(data+i+coeff+2), sum2);
+			sum3 = _mm256_fmadd_ps(d, _mm256_loadu_ps(data+i+coeff+3), sum3);
+		}
+		sum[0] = hsum_ps_avx_(sum0);
+		sum[1] = hsum_ps_avx_(sum1);
+		sum[2] = hsum_ps_avx_(sum2);
+		sum[3] = hsum_ps_avx_(sum3);
+
+		/* finish off the samples the vector loop could not reach */
+		for(j = 0; j < 4 && coeff + j < lag; j++) {
+			int k;
+			for(k = i; k < (int)(data_len - coeff) - j; k++)
+				sum[j] += data[k] * data[k+coeff+j];
+			autoc[coeff+j] = sum[j];
+		}
+	}
+	_mm256_zeroupper();
+}
+#endif /* FLAC__FMA_SUPPORTED */
+
 #endif /* FLAC__AVX2_SUPPORTED */
 #endif /* (FLAC__CPU_IA32 || FLAC__CPU_X86_64) && FLAC__HAS_X86INTRIN */
 #endif /* FLAC__NO_ASM */
@@ -4,8 +4,12 @@
 
 #include <stdlib.h>		/* for malloc() */
 #include <string.h>		/* for memcpy() */
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 
 #include "private/md5.h"
+#include "private/memory.h"
 #include "share/alloc.h"
 #include "share/compat.h"
 #include "share/endswap.h"
@@ -215,7 +219,7 @@ static void FLAC__MD5Update(FLAC__MD5Context *ctx, FLAC__byte const *buf, uint32
  * Start MD5 accumulation.  Set bit count to 0 and buffer to mysterious
  * initialization constants.
  */
-void FLAC__MD5Init(FLAC__MD5Context *ctx)
+void FLAC__MD5Init(FLAC__MD5Context *ctx, const FLAC__Allocator *allocator)
 {
 	ctx->buf[0] = 0x67452301;
 	ctx->buf[1] = 0xefcdab89;
@@ -227,6 +231,7 @@ void FLAC__MD5Init(FLAC__MD5Context *ctx)
 
 	ctx->internal_buf.p8 = 0;
 	ctx->capacity = 0;
+	ctx->allocator = allocator;
 }
 
 /*
@@ -262,7 +267,7 @@ void FLAC__MD5Final(FLAC__byte digest[16], FLAC__MD5Context *ctx)
 	byteSwap(ctx->buf, 4);
 	memcpy(digest, ctx->buf, 16);
 	if (0 != ctx->internal_buf.p8) {
-		free(ctx->internal_buf.p8);
+		FLAC__memory_free(ctx->allocator, ctx->internal_buf.p8);
 		ctx->internal_buf.p8 = 0;
 		ctx->capacity = 0;
 	}
@@ -487,9 +492,9 @@ static void format_input_(FLAC__multibyte *mbuf, const FLAC__int32 * const signa
 }
 
 /*
- * Convert the incoming audio signal to a byte stream and FLAC__MD5Update it.
+ * Make sure the buffer can hold the formatted signal
  */
-FLAC__bool FLAC__MD5Accumulate(FLAC__MD5Context *ctx, const FLAC__int32 * const signal[], uint32_t channels, uint32_t samples, uint32_t bytes_per_sample)
+static FLAC__bool reserve_input_(const FLAC__Allocator *allocator, FLAC__multibyte *mbuf, size_t *capacity, uint32_t channels, uint32_t samples, uint32_t bytes_per_sample, size_t *bytes)
 {
 	const size_t bytes_needed = (size_t)channels * (size_t)samples * (size_t)bytes_per_sample;
 
@@ -499,19 +504,178 @@ FLAC__bool FLAC__MD5Accumulate(FLAC__MD5Context *ctx, const FLAC__int32 * const
 	if ((size_t)channels * (size_t)bytes_per_sample > SIZE_MAX / (size_t)samples)
 		return false;
 
-	if (ctx->capacity < bytes_needed) {
-		if (0 == (ctx->internal_buf.p8 = safe_realloc_(ctx->internal_buf.p8, bytes_needed))) {
-			if (0 == (ctx->internal_buf.p8 = safe_malloc_(bytes_needed))) {
-				ctx->capacity = 0;
+	if (*capacity < bytes_needed) {
+		if (0 == (mbuf->p8 = FLAC__memory_safe_realloc(allocator, mbuf->p8, bytes_needed))) {
+			if (0 == (mbuf->p8 = FLAC__memory_malloc(allocator, bytes_needed))) {
+				*capacity = 0;
 				return false;
 			}
 		}
-		ctx->capacity = bytes_needed;
+		*capacity = bytes_needed;
 	}
 
+	*bytes = bytes_needed;
+	return true;
+}
+
+/*
+ * Convert the incoming audio signal to a byte stream and FLAC__MD5Update it.
+ */
+FLAC__bool FLAC__MD5Accumulate(FLAC__MD5Context *ctx, const FLAC__int32 * const signal[], uint32_t channels, uint32_t samples, uint32_t bytes_per_sample)
+{
+	size_t bytes_needed;
+
+	if (!reserve_input_(ctx->allocator, &ctx->internal_buf, &ctx->capacity, channels, samples, bytes_per_sample, &bytes_needed))
+		return false;
+
 	format_input_(&ctx->internal_buf, signal, channels, samples, bytes_per_sample);
 
 	FLAC__MD5Update(ctx, ctx->internal_buf.p8, bytes_needed);
 
 	return true;
 }
+
+#ifdef HAVE_PTHREAD
+/*
+ * The worker keeps a ring of FLAC__MD5_WORKER_SLOTS buffers.  The
+ * caller formats the signal into the next free one, waiting while all
+ * of them are queued, and the worker thread feeds the queued buffers to
+ * FLAC__MD5Update() in order.
+ */
+#define FLAC__MD5_WORKER_SLOTS 8
+
+typedef struct {
+	FLAC__multibyte buf;
+	size_t capacity;
+	size_t bytes; /* # of bytes of formatted signal in buf */
+} FLAC__MD5WorkerSlot;
+
+struct FLAC__MD5Worker {
+	FLAC__MD5Context *ctx;
+	pthread_t thread;
+	pthread_mutex_t mutex; /* protects num_queued and finish */
+	pthread_cond_t cond_queued; /* signalled when a slot is queued or the thread is to finish */
+	pthread_cond_t cond_hashed; /* signalled when a slot is free again */
+	FLAC__MD5WorkerSlot slots[FLAC__MD5_WORKER_SLOTS];
+	uint32_t next_to_fill; /* only used by the caller */
+	uint32_t next_to_hash; /* only used by the worker thread */
+	uint32_t num_queued;
+	FLAC__bool finish;
+};
+
+static void *md5_worker_thread_(void *arg)
+{
+	FLAC__MD5Worker *worker = (FLAC__MD5Worker *)arg;
+	FLAC__MD5WorkerSlot *slot;
+
+	for (;;) {
+		pthread_mutex_lock(&worker->mutex);
+		while (worker->num_queued == 0 && !worker->finish)
+			pthread_cond_wait(&worker->cond_queued, &worker->mutex);
+		if (worker->num_queued == 0) {
+			pthread_mutex_unlock(&worker->mutex);
+			break;
+		}
+		pthread_mutex_unlock(&worker->mutex);
+
+		slot = &worker->slots[worker->next_to_hash];
+		FLAC__MD5Update(worker->ctx, slot->buf.p8, slot->bytes);
+		if (++worker->next_to_hash == FLAC__MD5_WORKER_SLOTS)
+			worker->next_to_hash = 0;
+
+		pthread_mutex_lock(&worker->mutex);
+		worker->num_queued--;
+		pthread_cond_signal(&worker->cond_hashed);
+		pthread_mutex_unlock(&worker->mutex);
+	}
+
+	return 0;
+}
+
+FLAC__MD5Worker *FLAC__MD5WorkerStart(FLAC__MD5Context *ctx)
+{
+	FLAC__MD5Worker *worker = FLAC__memory_calloc(ctx->allocator, 1, sizeof(FLAC__MD5Worker));
+
+	if (0 == worker)
+		return 0;
+	worker->ctx = ctx;
+
+	if (pthread_mutex_init(&worker->mutex, 0) != 0) {
+		FLAC__memory_free(ctx->allocator, worker);
+		return 0;
+	}
+	if (pthread_cond_init(&worker->cond_queued, 0) != 0) {
+		pthread_mutex_destroy(&worker->mutex);
+		FLAC__memory_free(ctx->allocator, worker);
+		return 0;
+	}
+	if (pthread_cond_init(&worker->cond_hashed, 0) != 0) {
+		pthread_cond_destroy(&worker->cond_queued);
+		pthread_mutex_destroy(&worker->mutex);
+		FLAC__memory_free(ctx->allocator, worker);
+		return 0;
+	}
+	if (pthread_create(&worker->thread, 0, md5_worker_thread_, worker) != 0) {
+		pthread_cond_destroy(&worker->cond_hashed);
+		pthread_cond_destroy(&worker->cond_queued);
+		pthread_mutex_destroy(&worker->mutex);
+		FLAC__memory_free(ctx->allocator, worker);
+		return 0;
+	}
+
+	return worker;
+}
+
+FLAC__bool FLAC__MD5WorkerAccumulate(FLAC__MD5Worker *worker, const FLAC__int32 * const signal[], uint32_t channels, uint32_t samples, uint32_t bytes_per_sample)
+{
+	FLAC__MD5WorkerSlot *slot = &worker->slots[worker->next_to_fill];
+
+	pthread_mutex_lock(&worker->mutex);
+	while (worker->num_queued == FLAC__MD5_WORKER_SLOTS)
+		pthread_cond_wait(&worker->cond_hashed, &worker->mutex);
+	pthread_mutex_unlock(&worker->mutex);
+
+	/* the slot is ours until it is queued */
+	if (!reserve_input_(worker->ctx->allocator, &slot->buf, &slot->capacity, channels, samples, bytes_per_sample, &slot->bytes))
+		return false;
+	format_input_(&slot->buf, signal, channels, samples, bytes_per_sample);
+	if (++worker->next_to_fill == FLAC__MD5_WORKER_SLOTS)
+		worker->next_to_fill = 0;
+
+	pthread_mutex_lock(&worker->mutex);
+	worker->num_queued++;
+	pthread_cond_signal(&worker->cond_queued);
+	pthread_mutex_unlock(&worker->mutex);
+
+	return true;
+}
+
+size_t FLAC__MD5WorkerGetFootprint(const FLAC__MD5Worker *worker)
+{
+	size_t bytes = sizeof(FLAC__MD5Worker);
+	uint32_t i;
+
+	for (i = 0; i < FLAC__MD5_WORKER_SLOTS; i++)
+		bytes += worker->slots[i].capacity;
+	return bytes;
+}
+
+void FLAC__MD5WorkerFinish(FLAC__MD5Worker *worker)
+{
+	uint32_t i;
+
+	pthread_mutex_lock(&worker->mutex);
+	worker->finish = true;
+	pthread_cond_signal(&worker->cond_queued);
+	pthread_mutex_unlock(&worker->mutex);
+
+	pthread_join(worker->thread, 0);
+
+	pthread_cond_destroy(&worker->cond_hashed);
+	pthread_cond_destroy(&worker->cond_queued);
+	pthread_mutex_destroy(&worker->mutex);
+	for (i = 0; i < FLAC__MD5_WORKER_SLOTS; i++)
+		FLAC__memory_free(worker->ctx->allocator, worker->slots[i].buf.p8);
+	FLAC__memory_free(worker->ctx->allocator, worker);
+}
+#endif
@@ -38,12 +38,170 @@
 #include <stdint.h>
 #endif
 
+#include <string.h> /* for memcpy(), memset(), strlen() */
 #include "private/memory.h"
 #include "FLAC/assert.h"
 #include "share/compat.h"
 #include "share/alloc.h"
 
-void *FLAC__memory_alloc_aligned(size_t bytes, void **aligned_address)
+/* All NULL means the C library. */
+static FLAC__Allocator global_allocator_ = { 0, 0, 0, 0 };
+
+FLAC_API void FLAC__set_allocator(const FLAC__Allocator *allocator)
+{
+	if(0 == allocator) {
+		memset(&global_allocator_, 0, sizeof(global_allocator_));
+	}
+	else {
+		FLAC__ASSERT(0 != allocator->allocate);
+		FLAC__ASSERT(0 != allocator->reallocate);
+		FLAC__ASSERT(0 != allocator->release);
+		global_allocator_ = *allocator;
+	}
+}
+
+void FLAC__memory_get_allocator(FLAC__Allocator *dest, const FLAC__Allocator *allocator)
+{
+	FLAC__ASSERT(0 != dest);
+	*dest = 0 != allocator? *allocator : global_allocator_;
+}
+
+void *FLAC__memory_malloc(const FLAC__Allocator *allocator, size_t size)
+{
+	if(0 == allocator)
+		allocator = &global_allocator_;
+	/* malloc(0) is undefined; FLAC src convention is to always allocate */
+	if(!size)
+		size++;
+	if(0 == allocator->allocate)
+		return malloc(size);
+	return allocator->allocate(allocator->context, size);
+}
+
+void *FLAC__memory_calloc(const FLAC__Allocator *allocator, size_t nmemb, size_t size)
+{
+	void *x;
+
+	if(0 == allocator)
+		allocator = &global_allocator_;
+	if(!nmemb || !size)
+		return FLAC__memory_malloc(allocator, 1);
+	if(0 == allocator->allocate)
+		return calloc(nmemb, size);
+	if(nmemb > SIZE_MAX / size)
+		return 0;
+	if(0 != (x = allocator->allocate(allocator->context, nmemb * size)))
+		memset(x, 0, nmemb * size);
+	return x;
+}
+
+void *FLAC__memory_realloc(const FLAC__Allocator *allocator, void *ptr, size_t size)
+{
+	if(0 == allocator)
+		allocator = &global_allocator_;
+	if(0 == ptr)
+		return FLAC__memory_malloc(allocator, size);
+	if(!size) { /* POSIX realloc(ptr, 0) semantics */
+		FLAC__memory_free(allocator, ptr);
+		return 0;
+	}
+	if(0 == allocator->reallocate)
+		return realloc(ptr, size);
+	return allocator->reallocate(allocator->context, ptr, size);
+}
+
+void FLAC__memory_free(const FLAC__Allocator *allocator, void *ptr)
+{
+	if(0 == ptr)
+		return;
+	if(0 == allocator)
+		allocator = &global_allocator_;
+	if(0 == allocator->release)
+		free(ptr);
+	else
+		allocator->release(allocator->context, ptr);
+}
+
+char *FLAC__memory_strdup(const FLAC__Allocator *allocator, const char *s)
+{
+	const size_t bytes = strlen(s) + 1;
+	char *x = FLAC__memory_malloc(allocator, bytes);
+	if(0 != x)
+		memcpy(x, s, bytes);
+	return x;
+}
+
+void *FLAC__memory_malloc_add_2op(const FLAC__Allocator *allocator, size_t size1, size_t size2)
+{
+	size2 += size1;
+	if(size2 < size1)
+		return 0;
+	return FLAC__memory_malloc(allocator, size2);
+}
+
+void *FLAC__memory_malloc_add_4op(const FLAC__Allocator *allocator, size_t size1, size_t size2, size_t size3, size_t size4)
+{
+	size2 += size1;
+	if(size2 < size1)
+		return 0;
+	size3 += size2;
+	if(size3 < size2)
+		return 0;
+	size4 += size3;
+	if(size4 < size3)
+		return 0;
+	return FLAC__memory_malloc(allocator, size4);
+}
+
+void *FLAC__memory_malloc_mul_2op(const FLAC__Allocator *allocator, size_t size1, size_t size2)
+{
+	if(!size1 || !size2)
+		return FLAC__memory_malloc(allocator, 1);
+	if(size1 > SIZE_MAX / size2)
+		return 0;
+	return FLAC__memory_malloc(allocator, size1*size2);
+}
+
+void *FLAC__memory_malloc_muladd2(const FLAC__Allocator *allocator, size_t size1, size_t size2, size_t size3)
+{
+	if(!size1 || (!size2 && !size3))
+		return FLAC__memory_malloc(allocator, 1);
+	size2 += size3;
+	if(size2 < size3)
+		return 0;
+	if(size1 > SIZE_MAX / size2)
+		return 0;
+	return FLAC__memory_malloc(allocator, size1*size2);
+}
+
+void *FLAC__memory_safe_realloc(const FLAC__Allocator *allocator, void *ptr, size_t size)
+{
+	void *newptr = FLAC__memory_realloc(allocator, ptr, size);
+	if(size > 0 && newptr == 0)
+		FLAC__memory_free(allocator, ptr);
+	return newptr;
+}
+
+void *FLAC__memory_realloc_add_2op(const FLAC__Allocator *allocator, void *ptr, size_t size1, size_t size2)
+{
+	size2 += size1;
+	if(size2 < size1) {
+		FLAC__memory_free(allocator, ptr);
+		return 0;
+	}
+	return FLAC__memory_realloc(allocator, ptr, size2);
+}
+
+void *FLAC__memory_realloc_mul_2op(const FLAC__Allocator *allocator, void *ptr, size_t size1, size_t size2)
+{
+	if(!size1 || !size2)
+		return FLAC__memory_realloc(allocator, ptr, 0);
+	if(size1 > SIZE_MAX / size2)
+		return 0;
+	return FLAC__memory_safe_realloc(allocator, ptr, size1*size2);
+}
+
+void *FLAC__memory_alloc_aligned(const FLAC__Allocator *allocator, size_t bytes, void **aligned_address)
 {
 	void *x;
 
@@ -51,16 +209,16 @@ void *FLAC__memory_alloc_aligned(size_t bytes, void **aligned_address)
 
 #ifdef FLAC__ALIGN_MALLOC_DATA
 	/* align on 32-byte (256-bit) boundary */
-	x = safe_malloc_add_2op_(bytes, /*+*/31L);
+	x = FLAC__memory_malloc_add_2op(allocator, bytes, /*+*/31L);
 	*aligned_address = (void*)(((uintptr_t)x + 31L) & -32L);
 #else
-	x = safe_malloc_(bytes);
+	x = FLAC__memory_malloc(allocator, bytes);
 	*aligned_address = x;
 #endif
 	return x;
 }
 
-FLAC__bool FLAC__memory_alloc_aligned_int32_array(size_t elements, FLAC__int32 **unaligned_pointer, FLAC__int32 **aligned_pointer)
+FLAC__bool FLAC__memory_alloc_aligned_int32_array(const FLAC__Allocator *allocator, size_t elements, FLAC__int32 **unaligned_pointer, FLAC__int32 **aligned_pointer)
 {
 	FLAC__int32 *pu; /* unaligned pointer */
 	union { /* union needed to comply with C99 pointer aliasing rules */
@@ -76,20 +234,20 @@ FLAC__bool FLAC__memory_alloc_aligned_int32_array(size_t elements, FLAC__int32 *
 	if(elements > SIZE_MAX / sizeof(*pu)) /* overflow check */
 		return false;
 
-	pu = FLAC__memory_alloc_aligned(sizeof(*pu) * elements, &u.pv);
+	pu = FLAC__memory_alloc_aligned(allocator, sizeof(*pu) * elements, &u.pv);
 	if(0 == pu) {
 		return false;
 	}
 	else {
 		if(*unaligned_pointer != 0)
-			free(*unaligned_pointer);
+			FLAC__memory_free(allocator, *unaligned_pointer);
 		*unaligned_pointer = pu;
 		*aligned_pointer = u.pa;
 		return true;
 	}
 }
 
-FLAC__bool FLAC__memory_alloc_aligned_uint32_array(size_t elements, FLAC__uint32 **unaligned_pointer, FLAC__uint32 **aligned_pointer)
+FLAC__bool FLAC__memory_alloc_aligned_uint32_array(const FLAC__Allocator *allocator, size_t elements, FLAC__uint32 **unaligned_pointer, FLAC__uint32 **aligned_pointer)
 {
 	FLAC__uint32 *pu; /* unaligned pointer */
 	union { /* union needed to comply with C99 pointer aliasing rules */
@@ -105,20 +263,20 @@ FLAC__bool FLAC__memory_alloc_aligned_uint32_array(size_t elements, FLAC__uint32
 	if(elements > SIZE_MAX / sizeof(*pu)) /* overflow check */
 		return false;
 
-	pu = FLAC__memory_alloc_aligned(sizeof(*pu) * elements, &u.pv);
+	pu = FLAC__memory_alloc_aligned(allocator, sizeof(*pu) * elements, &u.pv);
 	if(0 == pu) {
 		return false;
 	}
 	else {
 		if(*unaligned_pointer != 0)
-			free(*unaligned_pointer);
+			FLAC__memory_free(allocator, *unaligned_pointer);
 		*unaligned_pointer = pu;
 		*aligned_pointer = u.pa;
 		return true;
 	}
 }
 
-FLAC__bool FLAC__memory_alloc_aligned_uint64_array(size_t elements, FLAC__uint64 **unaligned_pointer, FLAC__uint64 **aligned_pointer)
+FLAC__bool FLAC__memory_alloc_aligned_uint64_array(const FLAC__Allocator *allocator, size_t elements, FLAC__uint64 **unaligned_pointer, FLAC__uint64 **aligned_pointer)
 {
 	FLAC__uint64 *pu; /* unaligned pointer */
 	union { /* union needed to comply with C99 pointer aliasing rules */
@@ -134,20 +292,20 @@ FLAC__bool FLAC__memory_alloc_aligned_uint64_array(size_t elements, FLAC__uint64
 	if(elements > SIZE_MAX / sizeof(*pu)) /* overflow check */
 		return false;
 
-	pu = FLAC__memory_alloc_aligned(sizeof(*pu) * elements, &u.pv);
+	pu = FLAC__memory_alloc_aligned(allocator, sizeof(*pu) * elements, &u.pv);
 	if(0 == pu) {
 		return false;
 	}
 	else {
 		if(*unaligned_pointer != 0)
-			free(*unaligned_pointer);
+			FLAC__memory_free(allocator, *unaligned_pointer);
 		*unaligned_pointer = pu;
 		*aligned_pointer = u.pa;
 		return true;
 	}
 }
 
-FLAC__bool FLAC__memory_alloc_aligned_unsigned_array(size_t elements, uint32_t **unaligned_pointer, uint32_t **aligned_pointer)
+FLAC__bool FLAC__memory_alloc_aligned_unsigned_array(const FLAC__Allocator *allocator, size_t elements, uint32_t **unaligned_pointer, uint32_t **aligned_pointer)
 {
 	uint32_t *pu; /* unaligned pointer */
 	union { /* union needed to comply with C99 pointer aliasing rules */
@@ -163,13 +321,13 @@ FLAC__bool FLAC__memory_alloc_aligned_unsigned_array(size_t elements, uint32_t *
 	if(elements > SIZE_MAX / sizeof(*pu)) /* overflow check */
 		return false;
 
-	pu = FLAC__memory_alloc_aligned(sizeof(*pu) * elements, &u.pv);
+	pu = FLAC__memory_alloc_aligned(allocator, sizeof(*pu) * elements, &u.pv);
 	if(0 == pu) {
 		return false;
 	}
 	else {
 		if(*unaligned_pointer != 0)
-			free(*unaligned_pointer);
+			FLAC__memory_free(allocator, *unaligned_pointer);
 		*unaligned_pointer = pu;
 		*aligned_pointer = u.pa;
 		return true;
@@ -178,7 +336,7 @@ FLAC__bool FLAC__memory_alloc_aligned_unsigned_array(size_t elements, uint32_t *
 
 #ifndef FLAC__INTEGER_ONLY_LIBRARY
 
-FLAC__bool FLAC__memory_alloc_aligned_real_array(size_t elements, FLAC__real **unaligned_pointer, FLAC__real **aligned_pointer)
+FLAC__bool FLAC__memory_alloc_aligned_real_array(const FLAC__Allocator *allocator, size_t elements, FLAC__real **unaligned_pointer, FLAC__real **aligned_pointer)
 {
 	FLAC__real *pu; /* unaligned pointer */
 	union { /* union needed to comply with C99 pointer aliasing rules */
@@ -194,13 +352,13 @@ FLAC__bool FLAC__memory_alloc_aligned_real_array(size_t elements, FLAC__real **u
 	if(elements > SIZE_MAX / sizeof(*pu)) /* overflow check */
 		return false;
 
-	pu = FLAC__memory_alloc_aligned(sizeof(*pu) * elements, &u.pv);
+	pu = FLAC__memory_alloc_aligned(allocator, sizeof(*pu) * elements, &u.pv);
 	if(0 == pu) {
 		return false;
 	}
 	else {
 		if(*unaligned_pointer != 0)
-			free(*unaligned_pointer);
+			FLAC__memory_free(allocator, *unaligned_pointer);
 		*unaligned_pointer = pu;
 		*aligned_pointer = u.pa;
 		return true;
@@ -208,12 +366,3 @@ FLAC__bool FLAC__memory_alloc_aligned_real_array(size_t elements, FLAC__real **u
 }
 
 #endif
-
-void *safe_malloc_mul_2op_p(size_t size1, size_t size2)
-{
-	if(!size1 || !size2)
-		return malloc(1); /* malloc(0) is undefined; FLAC src convention is to always allocate */
-	if(size1 > SIZE_MAX / size2)
-		return 0;
-	return malloc(size1*size2);
-}
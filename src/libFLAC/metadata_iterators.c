@@ -53,9 +53,6 @@
 #include "private/macros.h"
 #include "private/memory.h"
 
-/* Alias the first (in share/alloc.h) to the second (in src/libFLAC/memory.c). */
-#define safe_malloc_mul_2op_ safe_malloc_mul_2op_p
-
 /****************************************************************************
  *
  * Local function declarations
@@ -360,7 +357,7 @@ FLAC_API const char * const FLAC__Metadata_SimpleIteratorStatusString[] = {
 
 FLAC_API FLAC__Metadata_SimpleIterator *FLAC__metadata_simple_iterator_new(void)
 {
-	FLAC__Metadata_SimpleIterator *iterator = calloc(1, sizeof(FLAC__Metadata_SimpleIterator));
+	FLAC__Metadata_SimpleIterator *iterator = FLAC__memory_calloc(0, 1, sizeof(FLAC__Metadata_SimpleIterator));
 
 	if(0 != iterator) {
 		iterator->file = 0;
@@ -387,11 +384,11 @@ static void simple_iterator_free_guts_(FLAC__Metadata_SimpleIterator *iterator)
 			set_file_stats_(iterator->filename, &iterator->stats);
 	}
 	if(0 != iterator->filename) {
-		free(iterator->filename);
+		FLAC__memory_free(0, iterator->filename);
 		iterator->filename = 0;
 	}
 	if(0 != iterator->tempfile_path_prefix) {
-		free(iterator->tempfile_path_prefix);
+		FLAC__memory_free(0, iterator->tempfile_path_prefix);
 		iterator->tempfile_path_prefix = 0;
 	}
 }
@@ -401,7 +398,7 @@ FLAC_API void FLAC__metadata_simple_iterator_delete(FLAC__Metadata_SimpleIterato
 	FLAC__ASSERT(0 != iterator);
 
 	simple_iterator_free_guts_(iterator);
-	free(iterator);
+	FLAC__memory_free(0, iterator);
 }
 
 FLAC_API FLAC__Metadata_SimpleIteratorStatus FLAC__metadata_simple_iterator_status(FLAC__Metadata_SimpleIterator *iterator)
@@ -489,11 +486,11 @@ FLAC_API FLAC__bool FLAC__metadata_simple_iterator_init(FLAC__Metadata_SimpleIte
 	if(!read_only && preserve_file_stats)
 		iterator->has_stats = get_file_stats_(filename, &iterator->stats);
 
-	if(0 == (iterator->filename = strdup(filename))) {
+	if(0 == (iterator->filename = FLAC__memory_strdup(0, filename))) {
 		iterator->status = FLAC__METADATA_SIMPLE_ITERATOR_STATUS_MEMORY_ALLOCATION_ERROR;
 		return false;
 	}
-	if(0 != tempfile_path_prefix && 0 == (iterator->tempfile_path_prefix = strdup(tempfile_path_prefix))) {
+	if(0 != tempfile_path_prefix && 0 == (iterator->tempfile_path_prefix = FLAC__memory_strdup(0, tempfile_path_prefix))) {
 		iterator->status = FLAC__METADATA_SIMPLE_ITERATOR_STATUS_MEMORY_ALLOCATION_ERROR;
 		return false;
 	}
@@ -933,7 +930,7 @@ FLAC_API const char * const FLAC__Metadata_ChainStatusString[] = {
 
 static FLAC__Metadata_Node *node_new_(void)
 {
-	return calloc(1, sizeof(FLAC__Metadata_Node));
+	return FLAC__memory_calloc(0, 1, sizeof(FLAC__Metadata_Node));
 }
 
 static void node_delete_(FLAC__Metadata_Node *node)
@@ -941,7 +938,7 @@ static void node_delete_(FLAC__Metadata_Node *node)
 	FLAC__ASSERT(0 != node);
 	if(0 != node->data)
 		FLAC__metadata_object_delete(node->data);
-	free(node);
+	FLAC__memory_free(0, node);
 }
 
 static void chain_init_(FLAC__Metadata_Chain *chain)
@@ -970,7 +967,7 @@ static void chain_clear_(FLAC__Metadata_Chain *chain)
 	}
 
 	if(0 != chain->filename)
-		free(chain->filename);
+		FLAC__memory_free(0, chain->filename);
 
 	chain_init_(chain);
 }
@@ -1505,7 +1502,7 @@ static FLAC__bool chain_rewrite_file_cb_(FLAC__Metadata_Chain *chain, FLAC__IOHa
 
 FLAC_API FLAC__Metadata_Chain *FLAC__metadata_chain_new(void)
 {
-	FLAC__Metadata_Chain *chain = calloc(1, sizeof(FLAC__Metadata_Chain));
+	FLAC__Metadata_Chain *chain = FLAC__memory_calloc(0, 1, sizeof(FLAC__Metadata_Chain));
 
 	if(0 != chain)
 		chain_init_(chain);
@@ -1519,7 +1516,7 @@ FLAC_API void FLAC__metadata_chain_delete(FLAC__Metadata_Chain *chain)
 
 	chain_clear_(chain);
 
-	free(chain);
+	FLAC__memory_free(0, chain);
 }
 
 FLAC_API FLAC__Metadata_ChainStatus FLAC__metadata_chain_status(FLAC__Metadata_Chain *chain)
@@ -1543,7 +1540,7 @@ static FLAC__bool chain_read_(FLAC__Metadata_Chain *chain, const char *filename,
 
 	chain_clear_(chain);
 
-	if(0 == (chain->filename = strdup(filename))) {
+	if(0 == (chain->filename = FLAC__memory_strdup(0, filename))) {
 		chain->status = FLAC__METADATA_CHAIN_STATUS_MEMORY_ALLOCATION_ERROR;
 		return false;
 	}
@@ -1890,7 +1887,7 @@ FLAC_API void FLAC__metadata_chain_sort_padding(FLAC__Metadata_Chain *chain)
 
 FLAC_API FLAC__Metadata_Iterator *FLAC__metadata_iterator_new(void)
 {
-	FLAC__Metadata_Iterator *iterator = calloc(1, sizeof(FLAC__Metadata_Iterator));
+	FLAC__Metadata_Iterator *iterator = FLAC__memory_calloc(0, 1, sizeof(FLAC__Metadata_Iterator));
 
 	/* calloc() implies:
 		iterator->current = 0;
@@ -1904,7 +1901,7 @@ FLAC_API void FLAC__metadata_iterator_delete(FLAC__Metadata_Iterator *iterator)
 {
 	FLAC__ASSERT(0 != iterator);
 
-	free(iterator);
+	FLAC__memory_free(0, iterator);
 }
 
 FLAC_API void FLAC__metadata_iterator_init(FLAC__Metadata_Iterator *iterator, FLAC__Metadata_Chain *chain)
@@ -2226,7 +2223,7 @@ FLAC__Metadata_SimpleIteratorStatus read_metadata_block_data_application_cb_(FLA
 		block->data = 0;
 	}
 	else {
-		if(0 == (block->data = malloc(block_length)))
+		if(0 == (block->data = FLAC__memory_malloc(0, block_length)))
 			return FLAC__METADATA_SIMPLE_ITERATOR_STATUS_MEMORY_ALLOCATION_ERROR;
 
 		if(read_cb(block->data, 1, block_length, handle) != block_length)
@@ -2247,7 +2244,7 @@ FLAC__Metadata_SimpleIteratorStatus read_metadata_block_data_seektable_cb_(FLAC_
 
 	if(block->num_points == 0)
 		block->points = 0;
-	else if(0 == (block->points = safe_malloc_mul_2op_p(block->num_points, /*times*/sizeof(FLAC__StreamMetadata_SeekPoint))))
+	else if(0 == (block->points = FLAC__memory_malloc_mul_2op(0, block->num_points, /*times*/sizeof(FLAC__StreamMetadata_SeekPoint))))
 		return FLAC__METADATA_SIMPLE_ITERATOR_STATUS_MEMORY_ALLOCATION_ERROR;
 
 	for(i = 0; i < block->num_points; i++) {
@@ -2282,13 +2279,13 @@ FLAC__Metadata_SimpleIteratorStatus read_metadata_block_data_vorbis_comment_entr
 	} else max_length -= entry->length;
 
 	if(0 != entry->entry)
-		free(entry->entry);
+		FLAC__memory_free(0, entry->entry);
 
 	if(entry->length == 0) {
 		entry->entry = 0;
 	}
 	else {
-		if(0 == (entry->entry = safe_malloc_add_2op_(entry->length, /*+*/1)))
+		if(0 == (entry->entry = FLAC__memory_malloc_add_2op(0, entry->length, /*+*/1)))
 			return FLAC__METADATA_SIMPLE_ITERATOR_STATUS_MEMORY_ALLOCATION_ERROR;
 
 		if(read_cb(entry->entry, 1, entry->length, handle) != entry->length)
@@ -2326,7 +2323,7 @@ FLAC__Metadata_SimpleIteratorStatus read_metadata_block_data_vorbis_comment_cb_(
 	if(block->num_comments == 0) {
 		block->comments = 0;
 	}
-	else if(0 == (block->comments = calloc(block->num_comments, sizeof(FLAC__StreamMetadata_VorbisComment_Entry)))) {
+	else if(0 == (block->comments = FLAC__memory_calloc(0, block->num_comments, sizeof(FLAC__StreamMetadata_VorbisComment_Entry)))) {
 		block->num_comments = 0;
 		return FLAC__METADATA_SIMPLE_ITERATOR_STATUS_MEMORY_ALLOCATION_ERROR;
 	}
@@ -2396,7 +2393,7 @@ FLAC__Metadata_SimpleIteratorStatus read_metadata_block_data_cuesheet_track_cb_(
 	if(track->num_indices == 0) {
 		track->indices = 0;
 	}
-	else if(0 == (track->indices = calloc(track->num_indices, sizeof(FLAC__StreamMetadata_CueSheet_Index))))
+	else if(0 == (track->indices = FLAC__memory_calloc(0, track->num_indices, sizeof(FLAC__StreamMetadata_CueSheet_Index))))
 		return FLAC__METADATA_SIMPLE_ITERATOR_STATUS_MEMORY_ALLOCATION_ERROR;
 
 	for(i = 0; i < track->num_indices; i++) {
@@ -2456,7 +2453,7 @@ FLAC__Metadata_SimpleIteratorStatus read_metadata_block_data_cuesheet_cb_(FLAC__
 	if(block->num_tracks == 0) {
 		block->tracks = 0;
 	}
-	else if(0 == (block->tracks = calloc(block->num_tracks, sizeof(FLAC__StreamMetadata_CueSheet_Track))))
+	else if(0 == (block->tracks = FLAC__memory_calloc(0, block->num_tracks, sizeof(FLAC__StreamMetadata_CueSheet_Track))))
 		return FLAC__METADATA_SIMPLE_ITERATOR_STATUS_MEMORY_ALLOCATION_ERROR;
 
 	for(i = 0; i < block->num_tracks; i++) {
@@ -2483,9 +2480,9 @@ static FLAC__Metadata_SimpleIteratorStatus read_metadata_block_data_picture_cstr
 	*length = unpack_uint32_(buffer, length_len);
 
 	if(0 != *data)
-		free(*data);
+		FLAC__memory_free(0, *data);
 
-	if(0 == (*data = safe_malloc_add_2op_(*length, /*+*/1)))
+	if(0 == (*data = FLAC__memory_malloc_add_2op(0, *length, /*+*/1)))
 		return FLAC__METADATA_SIMPLE_ITERATOR_STATUS_MEMORY_ALLOCATION_ERROR;
 
 	if(*length > 0) {
@@ -2559,7 +2556,7 @@ FLAC__Metadata_SimpleIteratorStatus read_metadata_block_data_unknown_cb_(FLAC__I
 		block->data = 0;
 	}
 	else {
-		if(0 == (block->data = malloc(block_length)))
+		if(0 == (block->data = FLAC__memory_malloc(0, block_length)))
 			return FLAC__METADATA_SIMPLE_ITERATOR_STATUS_MEMORY_ALLOCATION_ERROR;
 
 		if(read_cb(block->data, 1, block_length, handle) != block_length)
@@ -3335,7 +3332,7 @@ FLAC__bool open_tempfile_(const char *filename, const char *tempfile_path_prefix
 	static const char *tempfile_suffix = ".metadata_edit";
 	if(0 == tempfile_path_prefix) {
 		size_t dest_len = strlen(filename) + strlen(tempfile_suffix) + 1;
-		if(0 == (*tempfilename = safe_malloc_(dest_len))) {
+		if(0 == (*tempfilename = FLAC__memory_malloc(0, dest_len))) {
 			*status = FLAC__METADATA_SIMPLE_ITERATOR_STATUS_MEMORY_ALLOCATION_ERROR;
 			return false;
 		}
@@ -3351,7 +3348,7 @@ FLAC__bool open_tempfile_(const char *filename, const char *tempfile_path_prefix
 
 		dest_len = strlen(tempfile_path_prefix) + strlen(p) + strlen(tempfile_suffix) + 2;
 
-		if(0 == (*tempfilename = safe_malloc_(dest_len))) {
+		if(0 == (*tempfilename = FLAC__memory_malloc(0, dest_len))) {
 			*status = FLAC__METADATA_SIMPLE_ITERATOR_STATUS_MEMORY_ALLOCATION_ERROR;
 			return false;
 		}
@@ -3408,7 +3405,7 @@ void cleanup_tempfile_(FILE **tempfile, char **tempfilename)
 
 	if(0 != *tempfilename) {
 		(void)flac_unlink(*tempfilename);
-		free(*tempfilename);
+		FLAC__memory_free(0, *tempfilename);
 		*tempfilename = 0;
 	}
 }
@@ -44,9 +44,6 @@
 #include "share/alloc.h"
 #include "share/compat.h"
 
-/* Alias the first (in share/alloc.h) to the second (in src/libFLAC/memory.c). */
-#define safe_malloc_mul_2op_ safe_malloc_mul_2op_p
-
 
 /****************************************************************************
  *
@@ -67,7 +64,7 @@ static FLAC__bool copy_bytes_(FLAC__byte **to, const FLAC__byte *from, uint32_t
 	FLAC__ASSERT(to != NULL);
 	if (bytes > 0 && from != NULL) {
 		FLAC__byte *x;
-		if ((x = safe_malloc_(bytes)) == NULL)
+		if ((x = FLAC__memory_malloc(0, bytes)) == NULL)
 			return false;
 		memcpy(x, from, bytes);
 		*to = x;
@@ -85,7 +82,7 @@ static FLAC__bool free_copy_bytes_(FLAC__byte **to, const FLAC__byte *from, uint
 	FLAC__byte *copy;
 	FLAC__ASSERT(to != NULL);
 	if (copy_bytes_(&copy, from, bytes)) {
-		free(*to);
+		FLAC__memory_free(0, *to);
 		*to = copy;
 		return true;
 	}
@@ -98,7 +95,7 @@ static FLAC__bool free_copy_bytes_(FLAC__byte **to, const FLAC__byte *from, uint
 /* realloc() failure leaves entry unchanged */
 static FLAC__bool ensure_null_terminated_(FLAC__byte **entry, uint32_t length)
 {
-	FLAC__byte *x = safe_realloc_add_2op_(*entry, length, /*+*/1);
+	FLAC__byte *x = FLAC__memory_realloc_add_2op(0, *entry, length, /*+*/1);
 	if (x != NULL) {
 		x[length] = '\0';
 		*entry = x;
@@ -114,10 +111,10 @@ static FLAC__bool ensure_null_terminated_(FLAC__byte **entry, uint32_t length)
  */
 static FLAC__bool copy_cstring_(char **to, const char *from)
 {
-	char *copy = strdup(from);
+	char *copy = FLAC__memory_strdup(0, from);
 	FLAC__ASSERT(to != NULL);
 	if (copy) {
-		free(*to);
+		FLAC__memory_free(0, *to);
 		*to = copy;
 		return true;
 	}
@@ -135,7 +132,7 @@ static FLAC__bool copy_vcentry_(FLAC__StreamMetadata_VorbisComment_Entry *to, co
 	else {
 		FLAC__byte *x;
 		FLAC__ASSERT(from->length > 0);
-		if ((x = safe_malloc_add_2op_(from->length, /*+*/1)) == NULL)
+		if ((x = FLAC__memory_malloc_add_2op(0, from->length, /*+*/1)) == NULL)
 			return false;
 		memcpy(x, from->entry, from->length);
 		x[from->length] = '\0';
@@ -153,7 +150,7 @@ static FLAC__bool copy_track_(FLAC__StreamMetadata_CueSheet_Track *to, const FLA
 	else {
 		FLAC__StreamMetadata_CueSheet_Index *x;
 		FLAC__ASSERT(from->num_indices > 0);
-		if ((x = safe_malloc_mul_2op_p(from->num_indices, /*times*/sizeof(FLAC__StreamMetadata_CueSheet_Index))) == NULL)
+		if ((x = FLAC__memory_malloc_mul_2op(0, from->num_indices, /*times*/sizeof(FLAC__StreamMetadata_CueSheet_Index))) == NULL)
 			return false;
 		memcpy(x, from->indices, from->num_indices * sizeof(FLAC__StreamMetadata_CueSheet_Index));
 		to->indices = x;
@@ -175,7 +172,7 @@ static FLAC__StreamMetadata_SeekPoint *seekpoint_array_new_(uint32_t num_points)
 
 	FLAC__ASSERT(num_points > 0);
 
-	object_array = safe_malloc_mul_2op_p(num_points, /*times*/sizeof(FLAC__StreamMetadata_SeekPoint));
+	object_array = FLAC__memory_malloc_mul_2op(0, num_points, /*times*/sizeof(FLAC__StreamMetadata_SeekPoint));
 
 	if (object_array != NULL) {
 		uint32_t i;
@@ -208,7 +205,7 @@ static FLAC__StreamMetadata_VorbisComment_Entry *vorbiscomment_entry_array_new_(
 {
 	FLAC__ASSERT(num_comments > 0);
 
-	return safe_calloc_(num_comments, sizeof(FLAC__StreamMetadata_VorbisComment_Entry));
+	return FLAC__memory_calloc(0, num_comments, sizeof(FLAC__StreamMetadata_VorbisComment_Entry));
 }
 
 static void vorbiscomment_entry_array_delete_(FLAC__StreamMetadata_VorbisComment_Entry *object_array, uint32_t num_comments)
@@ -218,9 +215,9 @@ static void vorbiscomment_entry_array_delete_(FLAC__StreamMetadata_VorbisComment
 	FLAC__ASSERT(object_array != NULL && num_comments > 0);
 
 	for (i = 0; i < num_comments; i++)
-		free(object_array[i].entry);
+		FLAC__memory_free(0, object_array[i].entry);
 
-	free(object_array);
+	FLAC__memory_free(0, object_array);
 }
 
 static FLAC__StreamMetadata_VorbisComment_Entry *vorbiscomment_entry_array_copy_(const FLAC__StreamMetadata_VorbisComment_Entry *object_array, uint32_t num_comments)
@@ -285,7 +282,7 @@ static FLAC__bool vorbiscomment_set_entry_(FLAC__StreamMetadata *object, FLAC__S
 		*dest = *src;
 	}
 
-	free(save);
+	FLAC__memory_free(0, save);
 
 	vorbiscomment_calculate_length_(object);
 	return true;
@@ -344,14 +341,14 @@ static FLAC__StreamMetadata_CueSheet_Index *cuesheet_track_index_array_new_(uint
 {
 	FLAC__ASSERT(num_indices > 0);
 
-	return safe_calloc_(num_indices, sizeof(FLAC__StreamMetadata_CueSheet_Index));
+	return FLAC__memory_calloc(0, num_indices, sizeof(FLAC__StreamMetadata_CueSheet_Index));
 }
 
 static FLAC__StreamMetadata_CueSheet_Track *cuesheet_track_array_new_(uint32_t num_tracks)
 {
 	FLAC__ASSERT(num_tracks > 0);
 
-	return safe_calloc_(num_tracks, sizeof(FLAC__StreamMetadata_CueSheet_Track));
+	return FLAC__memory_calloc(0, num_tracks, sizeof(FLAC__StreamMetadata_CueSheet_Track));
 }
 
 static void cuesheet_track_array_delete_(FLAC__StreamMetadata_CueSheet_Track *object_array, uint32_t num_tracks)
@@ -363,11 +360,11 @@ static void cuesheet_track_array_delete_(FLAC__StreamMetadata_CueSheet_Track *ob
 	for (i = 0; i < num_tracks; i++) {
 		if (object_array[i].indices != 0) {
 			FLAC__ASSERT(object_array[i].num_indices > 0);
-			free(object_array[i].indices);
+			FLAC__memory_free(0, object_array[i].indices);
 		}
 	}
 
-	free(object_array);
+	FLAC__memory_free(0, object_array);
 }
 
 static FLAC__StreamMetadata_CueSheet_Track *cuesheet_track_array_copy_(const FLAC__StreamMetadata_CueSheet_Track *object_array, uint32_t num_tracks)
@@ -414,7 +411,7 @@ static FLAC__bool cuesheet_set_track_(FLAC__StreamMetadata *object, FLAC__Stream
 		*dest = *src;
 	}
 
-	free(save);
+	FLAC__memory_free(0, save);
 
 	cuesheet_calculate_length_(object);
 	return true;
@@ -434,7 +431,7 @@ FLAC_API FLAC__StreamMetadata *FLAC__metadata_object_new(FLAC__MetadataType type
 	if (type > FLAC__MAX_METADATA_TYPE)
 		return 0;
 
-	object = calloc(1, sizeof(FLAC__StreamMetadata));
+	object = FLAC__memory_calloc(0, 1, sizeof(FLAC__StreamMetadata));
 	if (object != NULL) {
 		object->is_last = false;
 		object->type = type;
@@ -463,7 +460,7 @@ FLAC_API FLAC__StreamMetadata *FLAC__metadata_object_new(FLAC__MetadataType type
 			case FLAC__METADATA_TYPE_VORBIS_COMMENT:
 				object->data.vorbis_comment.vendor_string.length = (uint32_t)strlen(FLAC__VENDOR_STRING);
 				if (!copy_bytes_(&object->data.vorbis_comment.vendor_string.entry, (const FLAC__byte*)FLAC__VENDOR_STRING, object->data.vorbis_comment.vendor_string.length+1)) {
-					free(object);
+					FLAC__memory_free(0, object);
 					return 0;
 				}
 				vorbiscomment_calculate_length_(object);
@@ -496,12 +493,12 @@ FLAC_API FLAC__StreamMetadata *FLAC__metadata_object_new(FLAC__MetadataType type
 				*/
 				/* now initialize mime_type and description with empty strings to make things easier on the client */
 				if (!copy_cstring_(&object->data.picture.mime_type, "")) {
-					free(object);
+					FLAC__memory_free(0, object);
 					return 0;
 				}
 				if (!copy_cstring_((char**)(&object->data.picture.description), "")) {
-					free(object->data.picture.mime_type);
-					free(object);
+					FLAC__memory_free(0, object->data.picture.mime_type);
+					FLAC__memory_free(0, object);
 					return 0;
 				}
 				break;
@@ -557,7 +554,7 @@ FLAC_API FLAC__StreamMetadata *FLAC__metadata_object_clone(const FLAC__StreamMet
 				break;
 			case FLAC__METADATA_TYPE_VORBIS_COMMENT:
 				if (to->data.vorbis_comment.vendor_string.entry != NULL) {
-					free(to->data.vorbis_comment.vendor_string.entry);
+					FLAC__memory_free(0, to->data.vorbis_comment.vendor_string.entry);
 					to->data.vorbis_comment.vendor_string.entry = 0;
 				}
 				if (!copy_vcentry_(&to->data.vorbis_comment.vendor_string, &object->data.vorbis_comment.vendor_string)) {
@@ -633,19 +630,19 @@ void FLAC__metadata_object_delete_data(FLAC__StreamMetadata *object)
 			break;
 		case FLAC__METADATA_TYPE_APPLICATION:
 			if (object->data.application.data != NULL) {
-				free(object->data.application.data);
+				FLAC__memory_free(0, object->data.application.data);
 				object->data.application.data = NULL;
 			}
 			break;
 		case FLAC__METADATA_TYPE_SEEKTABLE:
 			if (object->data.seek_table.points != NULL) {
-				free(object->data.seek_table.points);
+				FLAC__memory_free(0, object->data.seek_table.points);
 				object->data.seek_table.points = NULL;
 			}
 			break;
 		case FLAC__METADATA_TYPE_VORBIS_COMMENT:
 			if (object->data.vorbis_comment.vendor_string.entry != NULL) {
-				free(object->data.vorbis_comment.vendor_string.entry);
+				FLAC__memory_free(0, object->data.vorbis_comment.vendor_string.entry);
 				object->data.vorbis_comment.vendor_string.entry = 0;
 			}
 			if (object->data.vorbis_comment.comments != NULL) {
@@ -665,21 +662,21 @@ void FLAC__metadata_object_delete_data(FLAC__StreamMetadata *object)
 			break;
 		case FLAC__METADATA_TYPE_PICTURE:
 			if (object->data.picture.mime_type != NULL) {
-				free(object->data.picture.mime_type);
+				FLAC__memory_free(0, object->data.picture.mime_type);
 				object->data.picture.mime_type = NULL;
 			}
 			if (object->data.picture.description != NULL) {
-				free(object->data.picture.description);
+				FLAC__memory_free(0, object->data.picture.description);
 				object->data.picture.description = NULL;
 			}
 			if (object->data.picture.data != NULL) {
-				free(object->data.picture.data);
+				FLAC__memory_free(0, object->data.picture.data);
 				object->data.picture.data = NULL;
 			}
 			break;
 		default:
 			if (object->data.unknown.data != NULL) {
-				free(object->data.unknown.data);
+				FLAC__memory_free(0, object->data.unknown.data);
 				object->data.unknown.data = NULL;
 			}
 			break;
@@ -689,7 +686,7 @@ void FLAC__metadata_object_delete_data(FLAC__StreamMetadata *object)
 FLAC_API void FLAC__metadata_object_delete(FLAC__StreamMetadata *object)
 {
 	FLAC__metadata_object_delete_data(object);
-	free(object);
+	FLAC__memory_free(0, object);
 }
 
 static FLAC__bool compare_block_data_streaminfo_(const FLAC__StreamMetadata_StreamInfo *block1, const FLAC__StreamMetadata_StreamInfo *block2)
@@ -918,7 +915,7 @@ FLAC_API FLAC__bool FLAC__metadata_object_application_set_data(FLAC__StreamMetad
 		object->data.application.data = data;
 	}
 
-	free(save);
+	FLAC__memory_free(0, save);
 
 	object->length = FLAC__STREAM_METADATA_APPLICATION_ID_LEN / 8 + length;
 	return true;
@@ -947,10 +944,10 @@ FLAC_API FLAC__bool FLAC__metadata_object_seektable_resize_points(FLAC__StreamMe
 		FLAC__ASSERT(object->data.seek_table.num_points > 0);
 
 		if (new_size == 0) {
-			free(object->data.seek_table.points);
+			FLAC__memory_free(0, object->data.seek_table.points);
 			object->data.seek_table.points = 0;
 		}
-		else if ((object->data.seek_table.points = safe_realloc_(object->data.seek_table.points, new_size)) == NULL)
+		else if ((object->data.seek_table.points = FLAC__memory_safe_realloc(0, object->data.seek_table.points, new_size)) == NULL)
 			return false;
 
 		/* if growing, set new elements to placeholders */
@@ -1189,16 +1186,16 @@ FLAC_API FLAC__bool FLAC__metadata_object_vorbiscomment_resize_comments(FLAC__St
 			uint32_t i;
 			for (i = new_num_comments; i < object->data.vorbis_comment.num_comments; i++)
 				if (object->data.vorbis_comment.comments[i].entry != NULL)
-					free(object->data.vorbis_comment.comments[i].entry);
+					FLAC__memory_free(0, object->data.vorbis_comment.comments[i].entry);
 		}
 
 		if (new_size == 0) {
-			free(object->data.vorbis_comment.comments);
+			FLAC__memory_free(0, object->data.vorbis_comment.comments);
 			object->data.vorbis_comment.comments = 0;
 		}
 		else {
 			FLAC__StreamMetadata_VorbisComment_Entry *oldptr = object->data.vorbis_comment.comments;
-			if ((object->data.vorbis_comment.comments = realloc(object->data.vorbis_comment.comments, new_size)) == NULL) {
+			if ((object->data.vorbis_comment.comments = FLAC__memory_realloc(0, object->data.vorbis_comment.comments, new_size)) == NULL) {
 				vorbiscomment_entry_array_delete_(oldptr, object->data.vorbis_comment.num_comments);
 				object->data.vorbis_comment.num_comments = 0;
 				return false;
@@ -1311,7 +1308,7 @@ FLAC_API FLAC__bool FLAC__metadata_object_vorbiscomment_delete_comment(FLAC__Str
 	vc = &object->data.vorbis_comment;
 
 	/* free the comment at comment_num */
-	free(vc->comments[comment_num].entry);
+	FLAC__memory_free(0, vc->comments[comment_num].entry);
 
 	/* move all comments > comment_num backward one space */
 	memmove(&vc->comments[comment_num], &vc->comments[comment_num+1], sizeof(FLAC__StreamMetadata_VorbisComment_Entry)*(vc->num_comments-comment_num-1));
@@ -1336,7 +1333,7 @@ FLAC_API FLAC__bool FLAC__metadata_object_vorbiscomment_entry_from_name_value_pa
 		const size_t nn = strlen(field_name);
 		const size_t nv = strlen(field_value);
 		entry->length = nn + 1 /*=*/ + nv;
-		if ((entry->entry = safe_malloc_add_4op_(nn, /*+*/1, /*+*/nv, /*+*/1)) == NULL)
+		if ((entry->entry = FLAC__memory_malloc_add_4op(0, nn, /*+*/1, /*+*/nv, /*+*/1)) == NULL)
 			return false;
 		memcpy(entry->entry, field_name, nn);
 		entry->entry[nn] = '=';
@@ -1363,10 +1360,10 @@ FLAC_API FLAC__bool FLAC__metadata_object_vorbiscomment_entry_to_name_value_pair
 
 		if (eq == NULL)
 			return false; /* double protection */
-		if ((*field_name = safe_malloc_add_2op_(nn, /*+*/1)) == NULL)
+		if ((*field_name = FLAC__memory_malloc_add_2op(0, nn, /*+*/1)) == NULL)
 			return false;
-		if ((*field_value = safe_malloc_add_2op_(nv, /*+*/1)) == NULL) {
-			free(*field_name);
+		if ((*field_value = FLAC__memory_malloc_add_2op(0, nv, /*+*/1)) == NULL) {
+			FLAC__memory_free(0, *field_name);
 			return false;
 		}
 		memcpy(*field_name, entry.entry, nn);
@@ -1437,7 +1434,7 @@ FLAC_API int FLAC__metadata_object_vorbiscomment_remove_entries_matching(FLAC__S
 
 FLAC_API FLAC__StreamMetadata_CueSheet_Track *FLAC__metadata_object_cuesheet_track_new(void)
 {
-	return calloc(1, sizeof(FLAC__StreamMetadata_CueSheet_Track));
+	return FLAC__memory_calloc(0, 1, sizeof(FLAC__StreamMetadata_CueSheet_Track));
 }
 
 FLAC_API FLAC__StreamMetadata_CueSheet_Track *FLAC__metadata_object_cuesheet_track_clone(const FLAC__StreamMetadata_CueSheet_Track *object)
@@ -1462,14 +1459,14 @@ void FLAC__metadata_object_cuesheet_track_delete_data(FLAC__StreamMetadata_CueSh
 
 	if (object->indices != NULL) {
 		FLAC__ASSERT(object->num_indices > 0);
-		free(object->indices);
+		FLAC__memory_free(0, object->indices);
 	}
 }
 
 FLAC_API void FLAC__metadata_object_cuesheet_track_delete(FLAC__StreamMetadata_CueSheet_Track *object)
 {
 	FLAC__metadata_object_cuesheet_track_delete_data(object);
-	free(object);
+	FLAC__memory_free(0, object);
 }
 
 FLAC_API FLAC__bool FLAC__metadata_object_cuesheet_track_resize_indices(FLAC__StreamMetadata *object, uint32_t track_num, uint32_t new_num_indices)
@@ -1499,10 +1496,10 @@ FLAC_API FLAC__bool FLAC__metadata_object_cuesheet_track_resize_indices(FLAC__St
 		FLAC__ASSERT(track->num_indices > 0);
 
 		if (new_size == 0) {
-			free(track->indices);
+			FLAC__memory_free(0, track->indices);
 			track->indices = 0;
 		}
-		else if ((track->indices = safe_realloc_(track->indices, new_size)) == NULL)
+		else if ((track->indices = FLAC__memory_safe_realloc(0, track->indices, new_size)) == NULL)
 			return false;
 
 		/* if growing, zero all the lengths/pointers of new elements */
@@ -1590,14 +1587,14 @@ FLAC_API FLAC__bool FLAC__metadata_object_cuesheet_resize_tracks(FLAC__StreamMet
 		if (new_num_tracks < object->data.cue_sheet.num_tracks) {
 			uint32_t i;
 			for (i = new_num_tracks; i < object->data.cue_sheet.num_tracks; i++)
-				free(object->data.cue_sheet.tracks[i].indices);
+				FLAC__memory_free(0, object->data.cue_sheet.tracks[i].indices);
 		}
 
 		if (new_size == 0) {
-			free(object->data.cue_sheet.tracks);
+			FLAC__memory_free(0, object->data.cue_sheet.tracks);
 			object->data.cue_sheet.tracks = 0;
 		}
-		else if ((object->data.cue_sheet.tracks = safe_realloc_(object->data.cue_sheet.tracks, new_size)) == NULL)
+		else if ((object->data.cue_sheet.tracks = FLAC__memory_safe_realloc(0, object->data.cue_sheet.tracks, new_size)) == NULL)
 			return false;
 
 		/* if growing, zero all the lengths/pointers of new elements */
@@ -1658,7 +1655,7 @@ FLAC_API FLAC__bool FLAC__metadata_object_cuesheet_delete_track(FLAC__StreamMeta
 	cs = &object->data.cue_sheet;
 
 	/* free the track at track_num */
-	free(cs->tracks[track_num].indices);
+	FLAC__memory_free(0, cs->tracks[track_num].indices);
 
 	/* move all tracks > track_num backward one space */
 	memmove(&cs->tracks[track_num], &cs->tracks[track_num+1], sizeof(FLAC__StreamMetadata_CueSheet_Track)*(cs->num_tracks-track_num-1));
@@ -1747,7 +1744,7 @@ FLAC_API FLAC__bool FLAC__metadata_object_picture_set_mime_type(FLAC__StreamMeta
 		object->data.picture.mime_type = mime_type;
 	}
 
-	free(old);
+	FLAC__memory_free(0, old);
 
 	object->length -= old_length;
 	object->length += new_length;
@@ -1778,7 +1775,7 @@ FLAC_API FLAC__bool FLAC__metadata_object_picture_set_description(FLAC__StreamMe
 		object->data.picture.description = description;
 	}
 
-	free(old);
+	FLAC__memory_free(0, old);
 
 	object->length -= old_length;
 	object->length += new_length;
@@ -1804,7 +1801,7 @@ FLAC_API FLAC__bool FLAC__metadata_object_picture_set_data(FLAC__StreamMetadata
 		object->data.picture.data = data;
 	}
 
-	free(old);
+	FLAC__memory_free(0, old);
 
 	object->length -= object->data.picture.data_length;
 	object->data.picture.data_length = length;
@@ -0,0 +1,173 @@
+/* libFLAC - Free Lossless Audio Codec library
+ * Copyright (C) 2000-2009  Josh Coalson
+ * Copyright (C) 2011-2018  Xiph.Org Foundation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of the Xiph.org Foundation nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "private/pcm.h"
+#include "FLAC/assert.h"
+
+/* rescales a sample to the output width; at most one of the shifts is non-zero */
+#define SCALE_(x, lshift, rshift) ((FLAC__int32)((FLAC__uint32)(x) << (lshift)) >> (rshift))
+
+void FLAC__pcm_interleave_int16(const FLAC__int32 * const input[], uint32_t channels, uint32_t samples, uint32_t bps, void *output)
+{
+	FLAC__int16 *out = output;
+	const uint32_t lshift = bps < 16? 16 - bps : 0, rshift = bps > 16? bps - 16 : 0;
+	uint32_t i, channel;
+
+	FLAC__ASSERT(bps > 0 && bps <= 32);
+
+	for(i = 0; i < samples; i++)
+		for(channel = 0; channel < channels; channel++)
+			*out++ = (FLAC__int16)SCALE_(input[channel][i], lshift, rshift);
+}
+
+void FLAC__pcm_interleave_int24(const FLAC__int32 * const input[], uint32_t channels, uint32_t samples, uint32_t bps, void *output)
+{
+	FLAC__byte *out = output;
+	const uint32_t lshift = bps < 24? 24 - bps : 0, rshift = bps > 24? bps - 24 : 0;
+	uint32_t i, channel;
+
+	FLAC__ASSERT(bps > 0 && bps <= 32);
+
+	for(i = 0; i < samples; i++) {
+		for(channel = 0; channel < channels; channel++) {
+			const FLAC__int32 x = SCALE_(input[channel][i], lshift, rshift);
+#if WORDS_BIGENDIAN
+			*out++ = (FLAC__byte)(x >> 16);
+			*out++ = (FLAC__byte)(x >> 8);
+			*out++ = (FLAC__byte)x;
+#else
+			*out++ = (FLAC__byte)x;
+			*out++ = (FLAC__byte)(x >> 8);
+			*out++ = (FLAC__byte)(x >> 16);
+#endif
+		}
+	}
+}
+
+void FLAC__pcm_interleave_int32(const FLAC__int32 * const input[], uint32_t channels, uint32_t samples, uint32_t bps, void *output)
+{
+	FLAC__int32 *out = output;
+	const uint32_t lshift = 32 - bps;
+	uint32_t i, channel;
+
+	FLAC__ASSERT(bps > 0 && bps <= 32);
+
+	for(i = 0; i < samples; i++)
+		for(channel = 0; channel < channels; channel++)
+			*out++ = SCALE_(input[channel][i], lshift, 0);
+}
+
+#ifndef FLAC__INTEGER_ONLY_LIBRARY
+void FLAC__pcm_interleave_float32(const FLAC__int32 * const input[], uint32_t channels, uint32_t samples, uint32_t bps, void *output)
+{
+	float *out = output;
+	const float scale = 1.0f / (float)((FLAC__uint32)1 << (bps - 1));
+	uint32_t i, channel;
+
+	FLAC__ASSERT(bps > 0 && bps <= 32);
+
+	for(i = 0; i < samples; i++)
+		for(channel = 0; channel < channels; channel++)
+			*out++ = (float)input[channel][i] * scale;
+}
+#endif
+
+/* non-zero if x does not fit in (32-shift) bits */
+#define OVERFLOW_(x, shift) ((x) ^ SCALE_(x, shift, shift))
+
+FLAC__bool FLAC__pcm_deinterleave_int16(const void *input, uint32_t channels, uint32_t samples, uint32_t bps, FLAC__int32 * const output[])
+{
+	const FLAC__int16 *in = input;
+	const uint32_t shift = 32 - bps;
+	FLAC__int32 overflow = 0;
+	uint32_t i, channel;
+
+	FLAC__ASSERT(bps > 0 && bps <= 32);
+
+	for(i = 0; i < samples; i++) {
+		for(channel = 0; channel < channels; channel++) {
+			const FLAC__int32 x = *in++;
+			output[channel][i] = x;
+			overflow |= OVERFLOW_(x, shift);
+		}
+	}
+	return overflow == 0;
+}
+
+FLAC__bool FLAC__pcm_deinterleave_int24(const void *input, uint32_t channels, uint32_t samples, uint32_t bps, FLAC__int32 * const output[])
+{
+	const FLAC__byte *in = input;
+	const uint32_t shift = 32 - bps;
+	FLAC__int32 overflow = 0;
+	uint32_t i, channel;
+
+	FLAC__ASSERT(bps > 0 && bps <= 32);
+
+	for(i = 0; i < samples; i++) {
+		for(channel = 0; channel < channels; channel++, in += 3) {
+			const FLAC__int32 x = (FLAC__int32)(((FLAC__uint32)in[2] << 24) | ((FLAC__uint32)in[1] << 16) | ((FLAC__uint32)in[0] << 8)) >> 8;
+			output[channel][i] = x;
+			overflow |= OVERFLOW_(x, shift);
+		}
+	}
+	return overflow == 0;
+}
+
+#ifndef FLAC__INTEGER_ONLY_LIBRARY
+FLAC__bool FLAC__pcm_deinterleave_float32(const void *input, uint32_t channels, uint32_t samples, uint32_t bps, FLAC__int32 * const output[])
+{
+	const float *in = input;
+	const float scale = (float)((FLAC__uint32)1 << (bps - 1));
+	uint32_t i, channel;
+
+	FLAC__ASSERT(bps > 0 && bps <= 32);
+
+	for(i = 0; i < samples; i++) {
+		for(channel = 0; channel < channels; channel++) {
+			const float f = *in++ * scale;
+			FLAC__int32 x;
+			/* written so that NaN fails too */
+			if(!(f >= -scale && f < scale))
+				return false;
+			x = (FLAC__int32)f;
+			if((float)x != f)
+				return false;
+			output[channel][i] = x;
+		}
+	}
+	return true;
+}
+#endif
@@ -0,0 +1,267 @@
+/* libFLAC - Free Lossless Audio Codec library
+ * Copyright (C) 2000-2009  Josh Coalson
+ * Copyright (C) 2011-2018  Xiph.Org Foundation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of the Xiph.org Foundation nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "private/cpu.h"
+
+#ifndef FLAC__NO_ASM
+#if (defined FLAC__CPU_IA32 || defined FLAC__CPU_X86_64) && FLAC__HAS_X86INTRIN
+#include "private/pcm.h"
+#ifdef FLAC__SSE2_SUPPORTED
+
+#include "FLAC/assert.h"
+
+#include <emmintrin.h> /* SSE2 */
+
+/* Only mono and stereo, which is nearly everything, get vector loops;
+ * other channel counts and the tail of each block go to the C versions.
+ */
+
+FLAC__SSE_TARGET("sse2")
+void FLAC__pcm_interleave_int16_intrin_sse2(const FLAC__int32 * const input[], uint32_t channels, uint32_t samples, uint32_t bps, void *output)
+{
+	FLAC__int16 *out = output;
+	const __m128i lcnt = _mm_cvtsi32_si128(bps < 16? 16 - bps : 0);
+	const __m128i rcnt = _mm_cvtsi32_si128(bps > 16? bps - 16 : 0);
+	const FLAC__int32 *tail[2];
+	uint32_t i = 0;
+
+	FLAC__ASSERT(bps > 0 && bps <= 32);
+
+	if(channels == 2) {
+		const FLAC__int32 *left = input[0], *right = input[1];
+		for( ; i + 4 <= samples; i += 4) {
+			__m128i l = _mm_loadu_si128((const __m128i*)(left + i));
+			__m128i r = _mm_loadu_si128((const __m128i*)(right + i));
+			l = _mm_sra_epi32(_mm_sll_epi32(l, lcnt), rcnt);
+			r = _mm_sra_epi32(_mm_sll_epi32(r, lcnt), rcnt);
+			/* the values already fit so the saturation in packs is a no-op */
+			_mm_storeu_si128((__m128i*)(out + 2*i), _mm_packs_epi32(_mm_unpacklo_epi32(l, r), _mm_unpackhi_epi32(l, r)));
+		}
+		tail[1] = right + i;
+	}
+	else if(channels == 1) {
+		const FLAC__int32 *mono = input[0];
+		for( ; i + 8 <= samples; i += 8) {
+			__m128i a = _mm_loadu_si128((const __m128i*)(mono + i));
+			__m128i b = _mm_loadu_si128((const __m128i*)(mono + i + 4));
+			a = _mm_sra_epi32(_mm_sll_epi32(a, lcnt), rcnt);
+			b = _mm_sra_epi32(_mm_sll_epi32(b, lcnt), rcnt);
+			_mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(a, b));
+		}
+	}
+	else {
+		FLAC__pcm_interleave_int16(input, channels, samples, bps, output);
+		return;
+	}
+
+	tail[0] = input[0] + i;
+	FLAC__pcm_interleave_int16(tail, channels, samples - i, bps, out + channels*i);
+}
+
+FLAC__SSE_TARGET("sse2")
+void FLAC__pcm_interleave_int32_intrin_sse2(const FLAC__int32 * const input[], uint32_t channels, uint32_t samples, uint32_t bps, void *output)
+{
+	FLAC__int32 *out = output;
+	const __m128i lcnt = _mm_cvtsi32_si128(32 - bps);
+	const FLAC__int32 *tail[2];
+	uint32_t i = 0;
+
+	FLAC__ASSERT(bps > 0 && bps <= 32);
+
+	if(channels == 2) {
+		const FLAC__int32 *left = input[0], *right = input[1];
+		for( ; i + 4 <= samples; i += 4) {
+			const __m128i l = _mm_sll_epi32(_mm_loadu_si128((const __m128i*)(left + i)), lcnt);
+			const __m128i r = _mm_sll_epi32(_mm_loadu_si128((const __m128i*)(right + i)), lcnt);
+			_mm_storeu_si128((__m128i*)(out + 2*i), _mm_unpacklo_epi32(l, r));
+			_mm_storeu_si128((__m128i*)(out + 2*i + 4), _mm_unpackhi_epi32(l, r));
+		}
+		tail[1] = right + i;
+	}
+	else if(channels == 1) {
+		const FLAC__int32 *mono = input[0];
+		for( ; i + 4 <= samples; i += 4)
+			_mm_storeu_si128((__m128i*)(out + i), _mm_sll_epi32(_mm_loadu_si128((const __m128i*)(mono + i)), lcnt));
+	}
+	else {
+		FLAC__pcm_interleave_int32(input, channels, samples, bps, output);
+		return;
+	}
+
+	tail[0] = input[0] + i;
+	FLAC__pcm_interleave_int32(tail, channels, samples - i, bps, out + channels*i);
+}
+
+#ifndef FLAC__INTEGER_ONLY_LIBRARY
+FLAC__SSE_TARGET("sse2")
+void FLAC__pcm_interleave_float32_intrin_sse2(const FLAC__int32 * const input[], uint32_t channels, uint32_t samples, uint32_t bps, void *output)
+{
+	float *out = output;
+	const __m128 scale = _mm_set1_ps(1.0f / (float)((FLAC__uint32)1 << (bps - 1)));
+	const FLAC__int32 *tail[2];
+	uint32_t i = 0;
+
+	FLAC__ASSERT(bps > 0 && bps <= 32);
+
+	if(channels == 2) {
+		const FLAC__int32 *left = input[0], *right = input[1];
+		for( ; i + 4 <= samples; i += 4) {
+			const __m128 l = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(left + i))), scale);
+			const __m128 r = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(right + i))), scale);
+			_mm_storeu_ps(out + 2*i, _mm_unpacklo_ps(l, r));
+			_mm_storeu_ps(out + 2*i + 4, _mm_unpackhi_ps(l, r));
+		}
+		tail[1] = right + i;
+	}
+	else if(channels == 1) {
+		const FLAC__int32 *mono = input[0];
+		for( ; i + 4 <= samples; i += 4)
+			_mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(mono + i))), scale));
+	}
+	else {
+		FLAC__pcm_interleave_float32(input, channels, samples, bps, output);
+		return;
+	}
+
+	tail[0] = input[0] + i;
+	FLAC__pcm_interleave_float32(tail, channels, samples - i, bps, out + channels*i);
+}
+#endif
+
+FLAC__SSE_TARGET("sse2")
+FLAC__bool FLAC__pcm_deinterleave_int16_intrin_sse2(const void *input, uint32_t channels, uint32_t samples, uint32_t bps, FLAC__int32 * const output[])
+{
+	const FLAC__int16 *in = input;
+	const __m128i cnt = _mm_cvtsi32_si128(32 - bps);
+	__m128i overflow = _mm_setzero_si128();
+	FLAC__int32 *tail[2];
+	uint32_t i = 0;
+
+	FLAC__ASSERT(bps > 0 && bps <= 32);
+
+	if(channels == 2) {
+		FLAC__int32 *left = output[0], *right = output[1];
+		for( ; i + 4 <= samples; i += 4) {
+			const __m128i v = _mm_loadu_si128((const __m128i*)(in + 2*i));
+			/* sign-extend the even (left) and odd (right) 16-bit lanes */
+			const __m128i l = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+			const __m128i r = _mm_srai_epi32(v, 16);
+			overflow = _mm_or_si128(overflow, _mm_xor_si128(l, _mm_sra_epi32(_mm_sll_epi32(l, cnt), cnt)));
+			overflow = _mm_or_si128(overflow, _mm_xor_si128(r, _mm_sra_epi32(_mm_sll_epi32(r, cnt), cnt)));
+			_mm_storeu_si128((__m128i*)(left + i), l);
+			_mm_storeu_si128((__m128i*)(right + i), r);
+		}
+		tail[1] = right + i;
+	}
+	else if(channels == 1) {
+		FLAC__int32 *mono = output[0];
+		for( ; i + 8 <= samples; i += 8) {
+			const __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+			const __m128i a = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+			const __m128i b = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+			overflow = _mm_or_si128(overflow, _mm_xor_si128(a, _mm_sra_epi32(_mm_sll_epi32(a, cnt), cnt)));
+			overflow = _mm_or_si128(overflow, _mm_xor_si128(b, _mm_sra_epi32(_mm_sll_epi32(b, cnt), cnt)));
+			_mm_storeu_si128((__m128i*)(mono + i), a);
+			_mm_storeu_si128((__m128i*)(mono + i + 4), b);
+		}
+	}
+	else
+		return FLAC__pcm_deinterleave_int16(input, channels, samples, bps, output);
+
+	tail[0] = output[0] + i;
+	if(_mm_movemask_epi8(_mm_cmpeq_epi32(overflow, _mm_setzero_si128())) != 0xFFFF)
+		return false;
+	return FLAC__pcm_deinterleave_int16(in + channels*i, channels, samples - i, bps, tail);
+}
+
+#ifndef FLAC__INTEGER_ONLY_LIBRARY
+FLAC__SSE_TARGET("sse2")
+FLAC__bool FLAC__pcm_deinterleave_float32_intrin_sse2(const void *input, uint32_t channels, uint32_t samples, uint32_t bps, FLAC__int32 * const output[])
+{
+	const float *in = input;
+	const __m128 scale = _mm_set1_ps((float)((FLAC__uint32)1 << (bps - 1)));
+	const __m128 minus_scale = _mm_sub_ps(_mm_setzero_ps(), scale);
+	__m128 ok = _mm_castsi128_ps(_mm_set1_epi32(-1));
+	FLAC__int32 *tail[2];
+	uint32_t i = 0;
+
+	FLAC__ASSERT(bps > 0 && bps <= 32);
+
+	/* a lane stays all-ones only while every value it saw was in range
+	 * (false for NaN) and survived the round trip through int32 exactly */
+#define CONVERT_(f, x) \
+	f = _mm_mul_ps(f, scale); \
+	x = _mm_cvttps_epi32(f); \
+	ok = _mm_and_ps(ok, _mm_and_ps(_mm_cmpge_ps(f, minus_scale), _mm_cmplt_ps(f, scale))); \
+	ok = _mm_and_ps(ok, _mm_cmpeq_ps(_mm_cvtepi32_ps(x), f))
+
+	if(channels == 2) {
+		FLAC__int32 *left = output[0], *right = output[1];
+		for( ; i + 4 <= samples; i += 4) {
+			const __m128 a = _mm_loadu_ps(in + 2*i), b = _mm_loadu_ps(in + 2*i + 4);
+			__m128 l = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0));
+			__m128 r = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1));
+			__m128i x;
+			CONVERT_(l, x);
+			_mm_storeu_si128((__m128i*)(left + i), x);
+			CONVERT_(r, x);
+			_mm_storeu_si128((__m128i*)(right + i), x);
+		}
+		tail[1] = right + i;
+	}
+	else if(channels == 1) {
+		FLAC__int32 *mono = output[0];
+		for( ; i + 4 <= samples; i += 4) {
+			__m128 f = _mm_loadu_ps(in + i);
+			__m128i x;
+			CONVERT_(f, x);
+			_mm_storeu_si128((__m128i*)(mono + i), x);
+		}
+	}
+	else
+		return FLAC__pcm_deinterleave_float32(input, channels, samples, bps, output);
+#undef CONVERT_
+
+	tail[0] = output[0] + i;
+	if(_mm_movemask_ps(ok) != 0xF)
+		return false;
+	return FLAC__pcm_deinterleave_float32(in + channels*i, channels, samples - i, bps, tail);
+}
+#endif
+
+#endif /* FLAC__SSE2_SUPPORTED */
+#endif /* (FLAC__CPU_IA32 || FLAC__CPU_X86_64) && FLAC__HAS_X86INTRIN */
+#endif /* FLAC__NO_ASM */
@@ -0,0 +1,160 @@
+/* libFLAC - Free Lossless Audio Codec library
+ * Copyright (C) 2000-2009  Josh Coalson
+ * Copyright (C) 2011-2018  Xiph.Org Foundation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of the Xiph.org Foundation nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "private/cpu.h"
+
+#ifndef FLAC__NO_ASM
+#if (defined FLAC__CPU_IA32 || defined FLAC__CPU_X86_64) && FLAC__HAS_X86INTRIN
+#include "private/pcm.h"
+#ifdef FLAC__SSSE3_SUPPORTED
+
+#include "FLAC/assert.h"
+
+#include <tmmintrin.h> /* SSSE3 */
+
+/* Eight samples are rescaled in two vectors, the low three bytes of each
+ * lane are packed to the bottom of the vector with PSHUFB, and the two
+ * 12-byte halves are written as one 16-byte and one 8-byte store so
+ * nothing is written past the 24 bytes of output.
+ */
+#define PACK24_STORE_(out, a, b) { \
+	const __m128i pa = _mm_shuffle_epi8(a, pack); \
+	const __m128i pb = _mm_shuffle_epi8(b, pack); \
+	_mm_storeu_si128((__m128i*)(out), _mm_or_si128(pa, _mm_slli_si128(pb, 12))); \
+	_mm_storel_epi64((__m128i*)((out) + 16), _mm_srli_si128(pb, 4)); \
+}
+
+FLAC__SSE_TARGET("ssse3")
+void FLAC__pcm_interleave_int24_intrin_ssse3(const FLAC__int32 * const input[], uint32_t channels, uint32_t samples, uint32_t bps, void *output)
+{
+	FLAC__byte *out = output;
+	const __m128i lcnt = _mm_cvtsi32_si128(bps < 24? 24 - bps : 0);
+	const __m128i rcnt = _mm_cvtsi32_si128(bps > 24? bps - 24 : 0);
+	const __m128i pack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+	const FLAC__int32 *tail[2];
+	uint32_t i = 0;
+
+	FLAC__ASSERT(bps > 0 && bps <= 32);
+
+	if(channels == 2) {
+		const FLAC__int32 *left = input[0], *right = input[1];
+		for( ; i + 4 <= samples; i += 4) {
+			__m128i l = _mm_loadu_si128((const __m128i*)(left + i));
+			__m128i r = _mm_loadu_si128((const __m128i*)(right + i));
+			l = _mm_sra_epi32(_mm_sll_epi32(l, lcnt), rcnt);
+			r = _mm_sra_epi32(_mm_sll_epi32(r, lcnt), rcnt);
+			PACK24_STORE_(out + 6*i, _mm_unpacklo_epi32(l, r), _mm_unpackhi_epi32(l, r));
+		}
+		tail[1] = right + i;
+	}
+	else if(channels == 1) {
+		const FLAC__int32 *mono = input[0];
+		for( ; i + 8 <= samples; i += 8) {
+			__m128i a = _mm_loadu_si128((const __m128i*)(mono + i));
+			__m128i b = _mm_loadu_si128((const __m128i*)(mono + i + 4));
+			a = _mm_sra_epi32(_mm_sll_epi32(a, lcnt), rcnt);
+			b = _mm_sra_epi32(_mm_sll_epi32(b, lcnt), rcnt);
+			PACK24_STORE_(out + 3*i, a, b);
+		}
+	}
+	else {
+		FLAC__pcm_interleave_int24(input, channels, samples, bps, output);
+		return;
+	}
+
+	tail[0] = input[0] + i;
+	FLAC__pcm_interleave_int24(tail, channels, samples - i, bps, out + 3*channels*i);
+}
+
+/* The reverse: 24 bytes of input are read as two overlapping 16-byte
+ * loads at offsets 0 and 8, so nothing past the input is read either.
+ * PSHUFB puts each sample in the top three bytes of a lane and an
+ * arithmetic shift sign-extends it.
+ */
+FLAC__SSE_TARGET("ssse3")
+FLAC__bool FLAC__pcm_deinterleave_int24_intrin_ssse3(const void *input, uint32_t channels, uint32_t samples, uint32_t bps, FLAC__int32 * const output[])
+{
+	const FLAC__byte *in = input;
+	const __m128i cnt = _mm_cvtsi32_si128(32 - bps);
+	const __m128i unpack_lo = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+	const __m128i unpack_hi = _mm_setr_epi8(-1, 4, 5, 6, -1, 7, 8, 9, -1, 10, 11, 12, -1, 13, 14, 15);
+	__m128i overflow = _mm_setzero_si128();
+	FLAC__int32 *tail[2];
+	uint32_t i = 0;
+
+	FLAC__ASSERT(bps > 0 && bps <= 32);
+
+	if(channels == 2) {
+		FLAC__int32 *left = output[0], *right = output[1];
+		for( ; i + 4 <= samples; i += 4) {
+			/* a = L0 R0 L1 R1, b = L2 R2 L3 R3 */
+			__m128i a = _mm_srai_epi32(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(in + 6*i)), unpack_lo), 8);
+			__m128i b = _mm_srai_epi32(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(in + 6*i + 8)), unpack_hi), 8);
+			__m128i l, r;
+			a = _mm_shuffle_epi32(a, _MM_SHUFFLE(3,1,2,0));
+			b = _mm_shuffle_epi32(b, _MM_SHUFFLE(3,1,2,0));
+			l = _mm_unpacklo_epi64(a, b);
+			r = _mm_unpackhi_epi64(a, b);
+			overflow = _mm_or_si128(overflow, _mm_xor_si128(l, _mm_sra_epi32(_mm_sll_epi32(l, cnt), cnt)));
+			overflow = _mm_or_si128(overflow, _mm_xor_si128(r, _mm_sra_epi32(_mm_sll_epi32(r, cnt), cnt)));
+			_mm_storeu_si128((__m128i*)(left + i), l);
+			_mm_storeu_si128((__m128i*)(right + i), r);
+		}
+		tail[1] = right + i;
+	}
+	else if(channels == 1) {
+		FLAC__int32 *mono = output[0];
+		for( ; i + 8 <= samples; i += 8) {
+			const __m128i a = _mm_srai_epi32(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(in + 3*i)), unpack_lo), 8);
+			const __m128i b = _mm_srai_epi32(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(in + 3*i + 8)), unpack_hi), 8);
+			overflow = _mm_or_si128(overflow, _mm_xor_si128(a, _mm_sra_epi32(_mm_sll_epi32(a, cnt), cnt)));
+			overflow = _mm_or_si128(overflow, _mm_xor_si128(b, _mm_sra_epi32(_mm_sll_epi32(b, cnt), cnt)));
+			_mm_storeu_si128((__m128i*)(mono + i), a);
+			_mm_storeu_si128((__m128i*)(mono + i + 4), b);
+		}
+	}
+	else
+		return FLAC__pcm_deinterleave_int24(input, channels, samples, bps, output);
+
+	tail[0] = output[0] + i;
+	if(_mm_movemask_epi8(_mm_cmpeq_epi32(overflow, _mm_setzero_si128())) != 0xFFFF)
+		return false;
+	return FLAC__pcm_deinterleave_int24(in + 3*channels*i, channels, samples - i, bps, tail);
+}
+
+#endif /* FLAC__SSSE3_SUPPORTED */
+#endif /* (FLAC__CPU_IA32 || FLAC__CPU_X86_64) && FLAC__HAS_X86INTRIN */
+#endif /* FLAC__NO_ASM */
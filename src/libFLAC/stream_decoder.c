@@ -39,8 +39,15 @@
 #include <string.h> /* for memset/memcpy() */
 #include <sys/stat.h> /* for stat() */
 #include <sys/types.h> /* for off_t */
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h> /* for mmap() */
+#endif
 #include "share/compat.h"
 #include "FLAC/assert.h"
+#include "FLAC/metadata.h"
 #include "share/alloc.h"
 #include "protected/stream_decoder.h"
 #include "private/bitreader.h"
@@ -51,6 +58,8 @@
 #include "private/format.h"
 #include "private/lpc.h"
 #include "private/md5.h"
+#include "private/pcm.h"
+#include "private/statistics.h"
 #include "private/memory.h"
 #include "private/macros.h"
 
@@ -67,6 +76,20 @@ FLAC_API int FLAC_API_SUPPORTS_OGG_FLAC = FLAC__HAS_OGG;
 
 static const FLAC__byte ID3V2_TAG_[3] = { 'I', 'D', '3' };
 
+#ifdef HAVE_PTHREAD
+/* nominal number of bytes of input handed to each thread by FLAC__stream_decoder_process_parallel() */
+static const size_t PARALLEL_CHUNK_SIZE_ = 1u << 20;
+#endif
+
+/* how many frame boundaries found by earlier seeks are kept to narrow down later ones */
+#define LEARNED_SEEK_POINTS_ 64
+
+/* points one of the CPU-dependent function pointers at a routine and
+ * remembers which one for FLAC__stream_decoder_get_kernel()
+ */
+#define SET_KERNEL_(decoder, kernel, member, routine) \
+	((decoder)->private_->member = (routine), (decoder)->private_->kernel_name[FLAC__STREAM_DECODER_KERNEL_##kernel] = #routine)
+
 /***********************************************************************
  *
  * Private class method prototypes
@@ -76,6 +99,7 @@ static const FLAC__byte ID3V2_TAG_[3] = { 'I', 'D', '3' };
 static void set_defaults_(FLAC__StreamDecoder *decoder);
 static FILE *get_binary_stdin_(void);
 static FLAC__bool allocate_output_(FLAC__StreamDecoder *decoder, uint32_t size, uint32_t channels);
+static FLAC__EntropyCodingMethod_PartitionedRiceContents *rice_contents_(FLAC__StreamDecoder *decoder, uint32_t channel);
 static FLAC__bool has_id_filtered_(FLAC__StreamDecoder *decoder, FLAC__byte *id);
 static FLAC__bool find_metadata_(FLAC__StreamDecoder *decoder);
 static FLAC__bool read_metadata_(FLAC__StreamDecoder *decoder);
@@ -86,6 +110,7 @@ static FLAC__bool read_metadata_cuesheet_(FLAC__StreamDecoder *decoder, FLAC__St
 static FLAC__bool read_metadata_picture_(FLAC__StreamDecoder *decoder, FLAC__StreamMetadata_Picture *obj);
 static FLAC__bool skip_id3v2_tag_(FLAC__StreamDecoder *decoder);
 static FLAC__bool frame_sync_(FLAC__StreamDecoder *decoder);
+static uint32_t frame_header_crc_mismatch_(const FLAC__StreamDecoder *decoder);
 static FLAC__bool read_frame_(FLAC__StreamDecoder *decoder, FLAC__bool *got_a_frame, FLAC__bool do_full_decode);
 static FLAC__bool read_frame_header_(FLAC__StreamDecoder *decoder);
 static FLAC__bool read_subframe_(FLAC__StreamDecoder *decoder, uint32_t channel, uint32_t bps, FLAC__bool do_full_decode);
@@ -96,12 +121,19 @@ static FLAC__bool read_subframe_verbatim_(FLAC__StreamDecoder *decoder, uint32_t
 static FLAC__bool read_residual_partitioned_rice_(FLAC__StreamDecoder *decoder, uint32_t predictor_order, uint32_t partition_order, FLAC__EntropyCodingMethod_PartitionedRiceContents *partitioned_rice_contents, FLAC__int32 *residual, FLAC__bool is_extended);
 static FLAC__bool read_zero_padding_(FLAC__StreamDecoder *decoder);
 static FLAC__bool read_callback_(FLAC__byte buffer[], size_t *bytes, void *client_data);
+static FLAC__bool borrow_callback_(const FLAC__byte **buffer, size_t *bytes, void *client_data);
 #if FLAC__HAS_OGG
 static FLAC__StreamDecoderReadStatus read_callback_ogg_aspect_(const FLAC__StreamDecoder *decoder, FLAC__byte buffer[], size_t *bytes);
 static FLAC__OggDecoderAspectReadStatus read_callback_proxy_(const void *void_decoder, FLAC__byte buffer[], size_t *bytes, void *client_data);
 #endif
+static FLAC__StreamDecoderWriteStatus write_to_client_(FLAC__StreamDecoder *decoder, const FLAC__Frame *frame, const FLAC__int32 * const buffer[]);
 static FLAC__StreamDecoderWriteStatus write_audio_frame_to_client_(FLAC__StreamDecoder *decoder, const FLAC__Frame *frame, const FLAC__int32 * const buffer[]);
+static FLAC__bool accumulate_md5_(FLAC__StreamDecoder *decoder, const FLAC__Frame *frame, const FLAC__int32 * const buffer[]);
 static void send_error_to_client_(const FLAC__StreamDecoder *decoder, FLAC__StreamDecoderErrorStatus status);
+static FLAC__bool seek_to_first_frame_(FLAC__StreamDecoder *decoder);
+static void learn_seek_point_(FLAC__StreamDecoder *decoder, FLAC__uint64 sample, FLAC__uint64 offset);
+static FLAC__bool seekpoint_holds_(const FLAC__StreamMetadata_SeekPoint *point, FLAC__uint64 sample);
+static FLAC__bool seek_to_indexed_frame_(FLAC__StreamDecoder *decoder, const FLAC__StreamMetadata_SeekTable *index, FLAC__uint64 target_sample);
 static FLAC__bool seek_to_absolute_sample_(FLAC__StreamDecoder *decoder, FLAC__uint64 stream_length, FLAC__uint64 target_sample);
 #if FLAC__HAS_OGG
 static FLAC__bool seek_to_absolute_sample_ogg_(FLAC__StreamDecoder *decoder, FLAC__uint64 stream_length, FLAC__uint64 target_sample);
@@ -111,6 +143,28 @@ static FLAC__StreamDecoderSeekStatus file_seek_callback_(const FLAC__StreamDecod
 static FLAC__StreamDecoderTellStatus file_tell_callback_(const FLAC__StreamDecoder *decoder, FLAC__uint64 *absolute_byte_offset, void *client_data);
 static FLAC__StreamDecoderLengthStatus file_length_callback_(const FLAC__StreamDecoder *decoder, FLAC__uint64 *stream_length, void *client_data);
 static FLAC__bool file_eof_callback_(const FLAC__StreamDecoder *decoder, void *client_data);
+static FLAC__StreamDecoderReadStatus memory_read_callback_(const FLAC__StreamDecoder *decoder, FLAC__byte buffer[], size_t *bytes, void *client_data);
+static FLAC__StreamDecoderSeekStatus memory_seek_callback_(const FLAC__StreamDecoder *decoder, FLAC__uint64 absolute_byte_offset, void *client_data);
+static FLAC__StreamDecoderTellStatus memory_tell_callback_(const FLAC__StreamDecoder *decoder, FLAC__uint64 *absolute_byte_offset, void *client_data);
+static FLAC__StreamDecoderLengthStatus memory_length_callback_(const FLAC__StreamDecoder *decoder, FLAC__uint64 *stream_length, void *client_data);
+static FLAC__bool memory_eof_callback_(const FLAC__StreamDecoder *decoder, void *client_data);
+#ifdef HAVE_PTHREAD
+struct FLAC__StreamDecoderParallelWorker;
+struct FLAC__StreamDecoderParallelMD5;
+static FLAC__bool process_parallel_(FLAC__StreamDecoder *decoder, uint32_t num_threads);
+static FLAC__bool init_parallel_worker_(FLAC__StreamDecoder *decoder, struct FLAC__StreamDecoderParallelWorker *worker);
+static void free_parallel_worker_(struct FLAC__StreamDecoderParallelWorker *worker);
+static void *process_parallel_thread_(void *arg);
+static void *process_parallel_md5_thread_(void *arg);
+static FLAC__StreamDecoderReadStatus parallel_read_callback_(const FLAC__StreamDecoder *decoder, FLAC__byte buffer[], size_t *bytes, void *client_data);
+static FLAC__StreamDecoderTellStatus parallel_tell_callback_(const FLAC__StreamDecoder *decoder, FLAC__uint64 *absolute_byte_offset, void *client_data);
+static FLAC__bool parallel_eof_callback_(const FLAC__StreamDecoder *decoder, void *client_data);
+static FLAC__StreamDecoderWriteStatus parallel_write_callback_(const FLAC__StreamDecoder *decoder, const FLAC__Frame *frame, const FLAC__int32 * const buffer[], void *client_data);
+static void parallel_error_callback_(const FLAC__StreamDecoder *decoder, FLAC__StreamDecoderErrorStatus status, void *client_data);
+#ifdef FLAC__ENABLE_STATISTICS
+static void add_statistics_(FLAC__StreamDecoderStatistics *total, const FLAC__StreamDecoderStatistics *part);
+#endif
+#endif
 
 /***********************************************************************
  *
@@ -134,12 +188,20 @@ typedef struct FLAC__StreamDecoderPrivate {
 	void (*local_lpc_restore_signal_64bit)(const FLAC__int32 residual[], uint32_t data_len, const FLAC__int32 qlp_coeff[], uint32_t order, int lp_quantization, FLAC__int32 data[]);
 	/* for use when the signal is <= 16 bits-per-sample, or <= 15 bits-per-sample on a side channel (which requires 1 extra bit): */
 	void (*local_lpc_restore_signal_16bit)(const FLAC__int32 residual[], uint32_t data_len, const FLAC__int32 qlp_coeff[], uint32_t order, int lp_quantization, FLAC__int32 data[]);
+	FLAC__bool (*local_bitreader_read_rice_signed_block)(FLAC__BitReader *br, int vals[], uint32_t nvals, uint32_t parameter);
+	FLAC__PCMInterleaveFunction local_pcm_interleave; /* NULL unless protected_->interleaved_format is set */
+	const char *kernel_name[FLAC__STREAM_DECODER_KERNEL_COUNT]; /* see FLAC__stream_decoder_get_kernel() */
 	void *client_data;
 	FILE *file; /* only used if FLAC__stream_decoder_init_file()/FLAC__stream_decoder_init_file() called, else NULL */
+	FLAC__bool is_memory; /* true if FLAC__stream_decoder_init_memory()/FLAC__stream_decoder_init_mmap() called; the bitreader then borrows from memory_data */
+	const FLAC__byte *memory_data;
+	size_t memory_length, memory_position;
+	void *mapping; /* only used if FLAC__stream_decoder_init_mmap() mapped the file, else NULL */
+	size_t mapping_length;
 	FLAC__BitReader *input;
 	FLAC__int32 *output[FLAC__MAX_CHANNELS];
-	FLAC__int32 *residual[FLAC__MAX_CHANNELS]; /* WATCHOUT: these are the aligned pointers; the real pointers that should be free()'d are residual_unaligned[] below */
-	FLAC__EntropyCodingMethod_PartitionedRiceContents partitioned_rice_contents[FLAC__MAX_CHANNELS];
+	FLAC__int32 *residual[FLAC__MAX_CHANNELS]; /* WATCHOUT: these are the aligned pointers; the real pointers that should be free()'d are residual_unaligned[] below; with protected_->low_footprint they all point to residual[0] */
+	FLAC__EntropyCodingMethod_PartitionedRiceContents partitioned_rice_contents[FLAC__MAX_CHANNELS]; /* with protected_->low_footprint only [0] is used, see rice_contents_() */
 	uint32_t output_capacity, output_channels;
 	FLAC__uint32 fixed_block_size, next_fixed_block_size;
 	FLAC__uint64 samples_decoded;
@@ -156,10 +218,31 @@ typedef struct FLAC__StreamDecoderPrivate {
 	FLAC__byte lookahead; /* temp storage when we need to look ahead one byte in the stream */
 	/* unaligned (original) pointers to allocated data */
 	FLAC__int32 *residual_unaligned[FLAC__MAX_CHANNELS];
+	void *interleaved; /* see FLAC__stream_decoder_get_interleaved_buffer() */
+	size_t interleaved_capacity; /* in bytes */
+	/* FLAC__stream_decoder_read_samples() state; only used when there is no write callback */
+	const FLAC__int32 *pull_pending[FLAC__MAX_CHANNELS]; /* decoded samples not yet handed out, pointing into output[] */
+	uint32_t pull_pending_samples;
+	uint32_t pull_pending_channels;
+	FLAC__int32 * const *pull_buffer; /* the caller's buffer while a read_samples() call is decoding a frame, else NULL */
+	uint32_t pull_offset, pull_room; /* where in pull_buffer the frame would go and how many samples fit there */
+	FLAC__bool pull_direct; /* true while output[] points into pull_buffer */
+	FLAC__int32 *pull_saved_output[FLAC__MAX_CHANNELS]; /* output[] while pull_direct is set */
+	const FLAC__StreamMetadata *frame_index; /* see FLAC__stream_decoder_set_frame_index(); either the client's or built_frame_index */
+	FLAC__StreamMetadata built_frame_index; /* made by FLAC__stream_decoder_build_frame_index(), the points come from the decoder's allocator */
 	FLAC__bool do_md5_checking; /* initially gets protected_->md5_checking but is turned off after a seek or if the metadata has a zero MD5 */
 	FLAC__bool internal_reset_hack; /* used only during init() so we can call reset to set up the decoder without rewinding the input */
 	FLAC__bool is_seeking;
+	FLAC__StreamDecoderSeekStats seek_stats; /* see FLAC__stream_decoder_get_seek_stats() */
+#ifdef FLAC__ENABLE_STATISTICS
+	FLAC__StreamDecoderStatistics statistics; /* see FLAC__stream_decoder_get_statistics() */
+#endif
+	FLAC__StreamMetadata_SeekPoint learned_seek_points[LEARNED_SEEK_POINTS_]; /* a ring of frame boundaries; stream_offset is absolute, frame_samples unused */
+	uint32_t num_learned_seek_points, next_learned_seek_point;
 	FLAC__MD5Context md5context;
+#ifdef HAVE_PTHREAD
+	FLAC__MD5Worker *md5_worker; /* hashes into md5context when threaded_md5 is set */
+#endif
 	FLAC__byte computed_md5sum[16]; /* this is the sum we computed from the decoded data */
 	/* (the rest of these are only used for seeking) */
 	FLAC__Frame last_frame; /* holds the info of the last frame we seeked to */
@@ -167,8 +250,48 @@ typedef struct FLAC__StreamDecoderPrivate {
 	FLAC__uint64 target_sample;
 	uint32_t unparseable_frame_count; /* used to tell whether we're decoding a future version of FLAC or just got a bad sync */
 	FLAC__bool got_a_frame; /* hack needed in Ogg FLAC seek routine to check when process_single() actually writes a frame */
+	FLAC__Allocator allocator; /* for everything the decoder allocates, including itself */
 } FLAC__StreamDecoderPrivate;
 
+#ifdef HAVE_PTHREAD
+/* one decoded frame as buffered by a FLAC__stream_decoder_process_parallel() worker */
+typedef struct {
+	FLAC__Frame frame; /* the subframe data/residual pointers are cleared since they do not outlive the worker's write callback */
+	size_t pcm_offset; /* offset of the frame's samples in each of the worker's pcm[] buffers */
+	size_t end_offset; /* offset in the input chunk just past the end of the frame */
+	FLAC__bool bad; /* the frame failed its CRC check and was written as silence */
+	FLAC__bool error_before; /* an error was reported between the previous frame and this one */
+} FLAC__StreamDecoderParallelFrame;
+
+typedef struct FLAC__StreamDecoderParallelWorker {
+	FLAC__StreamDecoder *decoder; /* private decoder reading from data[] through the parallel_*_callback_()s */
+	pthread_t thread;
+	const FLAC__byte *data;
+	size_t data_len, position;
+	size_t start; /* where to start searching for the first frame */
+	size_t stop; /* stop after the first frame ending at or past this offset */
+	FLAC__bool running, reached_stop, error_pending, ok;
+	FLAC__StreamDecoderErrorStatus last_error;
+	FLAC__StreamDecoderParallelFrame *frames;
+	uint32_t num_frames, frames_capacity;
+	uint32_t first_accepted, last_accepted; /* range of frames[] passed on to the client, set while merging */
+	FLAC__int32 *pcm[FLAC__MAX_CHANNELS];
+	uint32_t pcm_channels;
+	size_t pcm_len, pcm_capacity; /* in samples per channel */
+	const FLAC__Allocator *allocator; /* the parent decoder's, for frames[] and pcm[] */
+} FLAC__StreamDecoderParallelWorker;
+
+typedef struct FLAC__StreamDecoderParallelMD5 {
+	FLAC__StreamDecoder *decoder;
+	const FLAC__StreamDecoderParallelWorker *workers;
+	uint32_t num_workers;
+	FLAC__bool ok;
+#ifdef FLAC__ENABLE_STATISTICS
+	FLAC__StreamDecoderStatistics statistics; /* kept apart from decoder's while the main thread writes to it */
+#endif
+} FLAC__StreamDecoderParallelMD5;
+#endif
+
 /***********************************************************************
  *
  * Public static class data
@@ -233,50 +356,88 @@ FLAC_API const char * const FLAC__StreamDecoderErrorStatusString[] = {
 	"FLAC__STREAM_DECODER_ERROR_STATUS_UNPARSEABLE_STREAM"
 };
 
+FLAC_API const char * const FLAC__StreamDecoderInterleavedFormatString[] = {
+	"FLAC__STREAM_DECODER_INTERLEAVED_NONE",
+	"FLAC__STREAM_DECODER_INTERLEAVED_INT16",
+	"FLAC__STREAM_DECODER_INTERLEAVED_INT24",
+	"FLAC__STREAM_DECODER_INTERLEAVED_INT32",
+	"FLAC__STREAM_DECODER_INTERLEAVED_FLOAT32"
+};
+
+FLAC_API const char * const FLAC__StreamDecoderStageString[] = {
+	"FLAC__STREAM_DECODER_STAGE_FRAME_SYNC",
+	"FLAC__STREAM_DECODER_STAGE_FRAME_HEADER",
+	"FLAC__STREAM_DECODER_STAGE_RESIDUAL",
+	"FLAC__STREAM_DECODER_STAGE_RESTORE",
+	"FLAC__STREAM_DECODER_STAGE_DECORRELATION",
+	"FLAC__STREAM_DECODER_STAGE_MD5",
+	"FLAC__STREAM_DECODER_STAGE_WRITE_CALLBACK"
+};
+
+FLAC_API const char * const FLAC__StreamDecoderKernelString[] = {
+	"FLAC__STREAM_DECODER_KERNEL_LPC_RESTORE",
+	"FLAC__STREAM_DECODER_KERNEL_LPC_RESTORE_64BIT",
+	"FLAC__STREAM_DECODER_KERNEL_LPC_RESTORE_16BIT",
+	"FLAC__STREAM_DECODER_KERNEL_READ_RICE_SIGNED_BLOCK",
+	"FLAC__STREAM_DECODER_KERNEL_PCM_INTERLEAVE"
+};
+
+/* bytes per sample of each FLAC__StreamDecoderInterleavedFormat */
+static const uint32_t interleaved_sample_bytes_[] = { 0, 2, 3, 4, 4 };
+
 /***********************************************************************
  *
  * Class constructor/destructor
  *
  ***********************************************************************/
 FLAC_API FLAC__StreamDecoder *FLAC__stream_decoder_new(void)
+{
+	return FLAC__stream_decoder_new_with_allocator(0);
+}
+
+FLAC_API FLAC__StreamDecoder *FLAC__stream_decoder_new_with_allocator(const FLAC__Allocator *allocator)
 {
 	FLAC__StreamDecoder *decoder;
+	FLAC__Allocator alloc;
 	uint32_t i;
 
 	FLAC__ASSERT(sizeof(int) >= 4); /* we want to die right away if this is not true */
 
-	decoder = calloc(1, sizeof(FLAC__StreamDecoder));
+	FLAC__memory_get_allocator(&alloc, allocator);
+
+	decoder = FLAC__memory_calloc(&alloc, 1, sizeof(FLAC__StreamDecoder));
 	if(decoder == 0) {
 		return 0;
 	}
 
-	decoder->protected_ = calloc(1, sizeof(FLAC__StreamDecoderProtected));
+	decoder->protected_ = FLAC__memory_calloc(&alloc, 1, sizeof(FLAC__StreamDecoderProtected));
 	if(decoder->protected_ == 0) {
-		free(decoder);
+		FLAC__memory_free(&alloc, decoder);
 		return 0;
 	}
 
-	decoder->private_ = calloc(1, sizeof(FLAC__StreamDecoderPrivate));
+	decoder->private_ = FLAC__memory_calloc(&alloc, 1, sizeof(FLAC__StreamDecoderPrivate));
 	if(decoder->private_ == 0) {
-		free(decoder->protected_);
-		free(decoder);
+		FLAC__memory_free(&alloc, decoder->protected_);
+		FLAC__memory_free(&alloc, decoder);
 		return 0;
 	}
+	decoder->private_->allocator = alloc;
 
-	decoder->private_->input = FLAC__bitreader_new();
+	decoder->private_->input = FLAC__bitreader_new(&decoder->private_->allocator);
 	if(decoder->private_->input == 0) {
-		free(decoder->private_);
-		free(decoder->protected_);
-		free(decoder);
+		FLAC__memory_free(&alloc, decoder->private_);
+		FLAC__memory_free(&alloc, decoder->protected_);
+		FLAC__memory_free(&alloc, decoder);
 		return 0;
 	}
 
 	decoder->private_->metadata_filter_ids_capacity = 16;
-	if(0 == (decoder->private_->metadata_filter_ids = malloc((FLAC__STREAM_METADATA_APPLICATION_ID_LEN/8) * decoder->private_->metadata_filter_ids_capacity))) {
+	if(0 == (decoder->private_->metadata_filter_ids = FLAC__memory_malloc(&decoder->private_->allocator, (FLAC__STREAM_METADATA_APPLICATION_ID_LEN/8) * decoder->private_->metadata_filter_ids_capacity))) {
 		FLAC__bitreader_delete(decoder->private_->input);
-		free(decoder->private_);
-		free(decoder->protected_);
-		free(decoder);
+		FLAC__memory_free(&alloc, decoder->private_);
+		FLAC__memory_free(&alloc, decoder->protected_);
+		FLAC__memory_free(&alloc, decoder);
 		return 0;
 	}
 
@@ -288,11 +449,23 @@ FLAC_API FLAC__StreamDecoder *FLAC__stream_decoder_new(void)
 	decoder->private_->output_capacity = 0;
 	decoder->private_->output_channels = 0;
 	decoder->private_->has_seek_table = false;
+	decoder->private_->interleaved = 0;
+	decoder->private_->interleaved_capacity = 0;
+	decoder->private_->pull_pending_samples = 0;
+	decoder->private_->pull_buffer = 0;
+	decoder->private_->pull_direct = false;
+	memset(&decoder->private_->seek_stats, 0, sizeof(decoder->private_->seek_stats));
+	decoder->private_->num_learned_seek_points = decoder->private_->next_learned_seek_point = 0;
 
 	for(i = 0; i < FLAC__MAX_CHANNELS; i++)
 		FLAC__format_entropy_coding_method_partitioned_rice_contents_init(&decoder->private_->partitioned_rice_contents[i]);
 
 	decoder->private_->file = 0;
+	decoder->private_->is_memory = false;
+	decoder->private_->memory_data = 0;
+	decoder->private_->memory_length = decoder->private_->memory_position = 0;
+	decoder->private_->mapping = 0;
+	decoder->private_->mapping_length = 0;
 
 	set_defaults_(decoder);
 
@@ -303,6 +476,7 @@ FLAC_API FLAC__StreamDecoder *FLAC__stream_decoder_new(void)
 
 FLAC_API void FLAC__stream_decoder_delete(FLAC__StreamDecoder *decoder)
 {
+	FLAC__Allocator alloc;
 	uint32_t i;
 
 	if (decoder == NULL)
@@ -315,16 +489,17 @@ FLAC_API void FLAC__stream_decoder_delete(FLAC__StreamDecoder *decoder)
 	(void)FLAC__stream_decoder_finish(decoder);
 
 	if(0 != decoder->private_->metadata_filter_ids)
-		free(decoder->private_->metadata_filter_ids);
+		FLAC__memory_free(&decoder->private_->allocator, decoder->private_->metadata_filter_ids);
 
 	FLAC__bitreader_delete(decoder->private_->input);
 
 	for(i = 0; i < FLAC__MAX_CHANNELS; i++)
-		FLAC__format_entropy_coding_method_partitioned_rice_contents_clear(&decoder->private_->partitioned_rice_contents[i]);
+		FLAC__format_entropy_coding_method_partitioned_rice_contents_clear(&decoder->private_->partitioned_rice_contents[i], &decoder->private_->allocator);
 
-	free(decoder->private_);
-	free(decoder->protected_);
-	free(decoder);
+	alloc = decoder->private_->allocator;
+	FLAC__memory_free(&alloc, decoder->private_);
+	FLAC__memory_free(&alloc, decoder->protected_);
+	FLAC__memory_free(&alloc, decoder);
 }
 
 /***********************************************************************
@@ -347,6 +522,8 @@ static FLAC__StreamDecoderInitStatus init_stream_internal_(
 	FLAC__bool is_ogg
 )
 {
+	uint32_t i;
+
 	FLAC__ASSERT(0 != decoder);
 
 	if(decoder->protected_->state != FLAC__STREAM_DECODER_UNINITIALIZED)
@@ -357,7 +534,6 @@ static FLAC__StreamDecoderInitStatus init_stream_internal_(
 
 	if(
 		0 == read_callback ||
-		0 == write_callback ||
 		0 == error_callback ||
 		(seek_callback && (0 == tell_callback || 0 == length_callback || 0 == eof_callback))
 	)
@@ -373,50 +549,121 @@ static FLAC__StreamDecoderInitStatus init_stream_internal_(
 	 * get the CPU info and set the function pointers
 	 */
 	FLAC__cpu_info(&decoder->private_->cpuinfo);
+	memset(decoder->private_->kernel_name, 0, sizeof(decoder->private_->kernel_name));
 	/* first default to the non-asm routines */
-	decoder->private_->local_lpc_restore_signal = FLAC__lpc_restore_signal;
-	decoder->private_->local_lpc_restore_signal_64bit = FLAC__lpc_restore_signal_wide;
-	decoder->private_->local_lpc_restore_signal_16bit = FLAC__lpc_restore_signal;
+	SET_KERNEL_(decoder, LPC_RESTORE, local_lpc_restore_signal, FLAC__lpc_restore_signal);
+	SET_KERNEL_(decoder, LPC_RESTORE_64BIT, local_lpc_restore_signal_64bit, FLAC__lpc_restore_signal_wide);
+	SET_KERNEL_(decoder, LPC_RESTORE_16BIT, local_lpc_restore_signal_16bit, FLAC__lpc_restore_signal);
+	SET_KERNEL_(decoder, READ_RICE_SIGNED_BLOCK, local_bitreader_read_rice_signed_block, FLAC__bitreader_read_rice_signed_block);
 	/* now override with asm where appropriate */
 #ifndef FLAC__NO_ASM
 	if(decoder->private_->cpuinfo.use_asm) {
 #ifdef FLAC__CPU_IA32
 		FLAC__ASSERT(decoder->private_->cpuinfo.type == FLAC__CPUINFO_TYPE_IA32);
 #ifdef FLAC__HAS_NASM
-		decoder->private_->local_lpc_restore_signal_64bit = FLAC__lpc_restore_signal_wide_asm_ia32; /* OPT_IA32: was really necessary for GCC < 4.9 */
+		SET_KERNEL_(decoder, LPC_RESTORE_64BIT, local_lpc_restore_signal_64bit, FLAC__lpc_restore_signal_wide_asm_ia32); /* OPT_IA32: was really necessary for GCC < 4.9 */
 		if (decoder->private_->cpuinfo.x86.mmx) {
-			decoder->private_->local_lpc_restore_signal = FLAC__lpc_restore_signal_asm_ia32;
-			decoder->private_->local_lpc_restore_signal_16bit = FLAC__lpc_restore_signal_asm_ia32_mmx;
+			SET_KERNEL_(decoder, LPC_RESTORE, local_lpc_restore_signal, FLAC__lpc_restore_signal_asm_ia32);
+			SET_KERNEL_(decoder, LPC_RESTORE_16BIT, local_lpc_restore_signal_16bit, FLAC__lpc_restore_signal_asm_ia32_mmx);
 		}
 		else {
-			decoder->private_->local_lpc_restore_signal = FLAC__lpc_restore_signal_asm_ia32;
-			decoder->private_->local_lpc_restore_signal_16bit = FLAC__lpc_restore_signal_asm_ia32;
+			SET_KERNEL_(decoder, LPC_RESTORE, local_lpc_restore_signal, FLAC__lpc_restore_signal_asm_ia32);
+			SET_KERNEL_(decoder, LPC_RESTORE_16BIT, local_lpc_restore_signal_16bit, FLAC__lpc_restore_signal_asm_ia32);
 		}
 #endif
 #if FLAC__HAS_X86INTRIN && ! defined FLAC__INTEGER_ONLY_LIBRARY
 # if defined FLAC__SSE4_1_SUPPORTED
 		if (decoder->private_->cpuinfo.x86.sse41) {
 #  if !defined FLAC__HAS_NASM  /* these are not undoubtedly faster than their MMX ASM counterparts */
-			decoder->private_->local_lpc_restore_signal = FLAC__lpc_restore_signal_intrin_sse41;
-			decoder->private_->local_lpc_restore_signal_16bit = FLAC__lpc_restore_signal_16_intrin_sse41;
+			SET_KERNEL_(decoder, LPC_RESTORE, local_lpc_restore_signal, FLAC__lpc_restore_signal_intrin_sse41);
+			SET_KERNEL_(decoder, LPC_RESTORE_16BIT, local_lpc_restore_signal_16bit, FLAC__lpc_restore_signal_16_intrin_sse41);
 #  endif
-			decoder->private_->local_lpc_restore_signal_64bit = FLAC__lpc_restore_signal_wide_intrin_sse41;
+			SET_KERNEL_(decoder, LPC_RESTORE_64BIT, local_lpc_restore_signal_64bit, FLAC__lpc_restore_signal_wide_intrin_sse41);
+		}
+# endif
+# if defined FLAC__AVX2_SUPPORTED
+		if (decoder->private_->cpuinfo.x86.avx2) {
+			SET_KERNEL_(decoder, LPC_RESTORE, local_lpc_restore_signal, FLAC__lpc_restore_signal_intrin_avx2);
+			SET_KERNEL_(decoder, LPC_RESTORE_16BIT, local_lpc_restore_signal_16bit, FLAC__lpc_restore_signal_16_intrin_avx2);
+			SET_KERNEL_(decoder, LPC_RESTORE_64BIT, local_lpc_restore_signal_64bit, FLAC__lpc_restore_signal_wide_intrin_avx2);
 		}
 # endif
 #endif
 #elif defined FLAC__CPU_X86_64
 		FLAC__ASSERT(decoder->private_->cpuinfo.type == FLAC__CPUINFO_TYPE_X86_64);
-		/* No useful SSE optimizations yet */
+#if FLAC__HAS_X86INTRIN && ! defined FLAC__INTEGER_ONLY_LIBRARY
+# if defined FLAC__AVX2_SUPPORTED
+		if (decoder->private_->cpuinfo.x86.avx2) {
+			SET_KERNEL_(decoder, LPC_RESTORE, local_lpc_restore_signal, FLAC__lpc_restore_signal_intrin_avx2);
+			SET_KERNEL_(decoder, LPC_RESTORE_16BIT, local_lpc_restore_signal_16bit, FLAC__lpc_restore_signal_16_intrin_avx2);
+			SET_KERNEL_(decoder, LPC_RESTORE_64BIT, local_lpc_restore_signal_64bit, FLAC__lpc_restore_signal_wide_intrin_avx2);
+		}
+# endif
+#endif
+#if FLAC__HAS_X86INTRIN && defined FLAC__BMI2_SUPPORTED && (ENABLE_64_BIT_WORDS == 0)
+		if (decoder->private_->cpuinfo.x86.bmi2 && decoder->private_->cpuinfo.x86.lzcnt)
+			SET_KERNEL_(decoder, READ_RICE_SIGNED_BLOCK, local_bitreader_read_rice_signed_block, FLAC__bitreader_read_rice_signed_block_bmi2);
+#endif
+#endif
+	}
+#endif
+
+	/* pick the interleaving routine, if the client asked for one */
+	switch(decoder->protected_->interleaved_format) {
+		case FLAC__STREAM_DECODER_INTERLEAVED_INT16:
+			SET_KERNEL_(decoder, PCM_INTERLEAVE, local_pcm_interleave, FLAC__pcm_interleave_int16);
+			break;
+		case FLAC__STREAM_DECODER_INTERLEAVED_INT24:
+			SET_KERNEL_(decoder, PCM_INTERLEAVE, local_pcm_interleave, FLAC__pcm_interleave_int24);
+			break;
+		case FLAC__STREAM_DECODER_INTERLEAVED_INT32:
+			SET_KERNEL_(decoder, PCM_INTERLEAVE, local_pcm_interleave, FLAC__pcm_interleave_int32);
+			break;
+#ifndef FLAC__INTEGER_ONLY_LIBRARY
+		case FLAC__STREAM_DECODER_INTERLEAVED_FLOAT32:
+			SET_KERNEL_(decoder, PCM_INTERLEAVE, local_pcm_interleave, FLAC__pcm_interleave_float32);
+			break;
 #endif
+		default:
+			decoder->private_->local_pcm_interleave = 0;
+			break;
+	}
+#if !defined FLAC__NO_ASM && (defined FLAC__CPU_IA32 || defined FLAC__CPU_X86_64) && FLAC__HAS_X86INTRIN
+	if(decoder->private_->cpuinfo.use_asm) {
+# ifdef FLAC__SSE2_SUPPORTED
+		if(decoder->private_->cpuinfo.x86.sse2) {
+			if(decoder->private_->local_pcm_interleave == FLAC__pcm_interleave_int16)
+				SET_KERNEL_(decoder, PCM_INTERLEAVE, local_pcm_interleave, FLAC__pcm_interleave_int16_intrin_sse2);
+			else if(decoder->private_->local_pcm_interleave == FLAC__pcm_interleave_int32)
+				SET_KERNEL_(decoder, PCM_INTERLEAVE, local_pcm_interleave, FLAC__pcm_interleave_int32_intrin_sse2);
+#  ifndef FLAC__INTEGER_ONLY_LIBRARY
+			else if(decoder->private_->local_pcm_interleave == FLAC__pcm_interleave_float32)
+				SET_KERNEL_(decoder, PCM_INTERLEAVE, local_pcm_interleave, FLAC__pcm_interleave_float32_intrin_sse2);
+#  endif
+		}
+# endif
+# ifdef FLAC__SSSE3_SUPPORTED
+		if(decoder->private_->cpuinfo.x86.ssse3 && decoder->private_->local_pcm_interleave == FLAC__pcm_interleave_int24)
+			SET_KERNEL_(decoder, PCM_INTERLEAVE, local_pcm_interleave, FLAC__pcm_interleave_int24_intrin_ssse3);
+# endif
 	}
 #endif
 
 	/* from here on, errors are fatal */
 
+	FLAC__bitreader_set_low_footprint(decoder->private_->input, decoder->protected_->low_footprint);
 	if(!FLAC__bitreader_init(decoder->private_->input, read_callback_, decoder)) {
 		decoder->protected_->state = FLAC__STREAM_DECODER_MEMORY_ALLOCATION_ERROR;
 		return FLAC__STREAM_DECODER_INIT_STATUS_MEMORY_ALLOCATION_ERROR;
 	}
+	FLAC__bitreader_set_cpu_info(decoder->private_->input, &decoder->private_->cpuinfo);
+	if(decoder->private_->is_memory)
+		FLAC__bitreader_set_borrow_callback(decoder->private_->input, borrow_callback_);
+	if(decoder->protected_->low_footprint) {
+		/* rice_contents_() only hands out the first one; drop what an earlier run may have left in the others */
+		for(i = 1; i < FLAC__MAX_CHANNELS; i++)
+			FLAC__format_entropy_coding_method_partitioned_rice_contents_clear(&decoder->private_->partitioned_rice_contents[i], &decoder->private_->allocator);
+	}
 
 	decoder->private_->read_callback = read_callback;
 	decoder->private_->seek_callback = seek_callback;
@@ -434,6 +681,9 @@ static FLAC__StreamDecoderInitStatus init_stream_internal_(
 
 	decoder->private_->do_md5_checking = decoder->protected_->md5_checking;
 	decoder->private_->is_seeking = false;
+#ifdef FLAC__ENABLE_STATISTICS
+	memset(&decoder->private_->statistics, 0, sizeof(decoder->private_->statistics));
+#endif
 
 	decoder->private_->internal_reset_hack = true; /* so the following reset does not try to rewind the input */
 	if(!FLAC__stream_decoder_reset(decoder)) {
@@ -516,7 +766,7 @@ static FLAC__StreamDecoderInitStatus init_FILE_internal_(
 	if(decoder->protected_->state != FLAC__STREAM_DECODER_UNINITIALIZED)
 		return decoder->protected_->initstate = FLAC__STREAM_DECODER_INIT_STATUS_ALREADY_INITIALIZED;
 
-	if(0 == write_callback || 0 == error_callback)
+	if(0 == error_callback)
 		return decoder->protected_->initstate = FLAC__STREAM_DECODER_INIT_STATUS_INVALID_CALLBACKS;
 
 	/*
@@ -590,7 +840,7 @@ static FLAC__StreamDecoderInitStatus init_file_internal_(
 	if(decoder->protected_->state != FLAC__STREAM_DECODER_UNINITIALIZED)
 		return decoder->protected_->initstate = FLAC__STREAM_DECODER_INIT_STATUS_ALREADY_INITIALIZED;
 
-	if(0 == write_callback || 0 == error_callback)
+	if(0 == error_callback)
 		return decoder->protected_->initstate = FLAC__STREAM_DECODER_INIT_STATUS_INVALID_CALLBACKS;
 
 	file = filename? flac_fopen(filename, "rb") : stdin;
@@ -625,6 +875,134 @@ FLAC_API FLAC__StreamDecoderInitStatus FLAC__stream_decoder_init_ogg_file(
 	return init_file_internal_(decoder, filename, write_callback, metadata_callback, error_callback, client_data, /*is_ogg=*/true);
 }
 
+/* forgets the input set up by init_memory_internal_(), unmapping it if FLAC__stream_decoder_init_mmap() mapped it */
+static void release_memory_input_(FLAC__StreamDecoder *decoder)
+{
+#ifdef HAVE_SYS_MMAN_H
+	if(0 != decoder->private_->mapping)
+		munmap(decoder->private_->mapping, decoder->private_->mapping_length);
+#endif
+	decoder->private_->mapping = 0;
+	decoder->private_->mapping_length = 0;
+	decoder->private_->is_memory = false;
+	decoder->private_->memory_data = 0;
+	decoder->private_->memory_length = decoder->private_->memory_position = 0;
+}
+
+static FLAC__StreamDecoderInitStatus init_memory_internal_(
+	FLAC__StreamDecoder *decoder,
+	const FLAC__byte *data,
+	size_t length,
+	FLAC__StreamDecoderWriteCallback write_callback,
+	FLAC__StreamDecoderMetadataCallback metadata_callback,
+	FLAC__StreamDecoderErrorCallback error_callback,
+	void *client_data
+)
+{
+	FLAC__StreamDecoderInitStatus init_status;
+
+	FLAC__ASSERT(0 != decoder);
+	FLAC__ASSERT(0 != data || length == 0);
+
+	decoder->private_->is_memory = true;
+	decoder->private_->memory_data = data;
+	decoder->private_->memory_length = length;
+	decoder->private_->memory_position = 0;
+
+	init_status = init_stream_internal_(
+		decoder,
+		memory_read_callback_,
+		memory_seek_callback_,
+		memory_tell_callback_,
+		memory_length_callback_,
+		memory_eof_callback_,
+		write_callback,
+		metadata_callback,
+		error_callback,
+		client_data,
+		/*is_ogg=*/false
+	);
+	if(init_status != FLAC__STREAM_DECODER_INIT_STATUS_OK)
+		release_memory_input_(decoder);
+
+	return init_status;
+}
+
+FLAC_API FLAC__StreamDecoderInitStatus FLAC__stream_decoder_init_memory(
+	FLAC__StreamDecoder *decoder,
+	const FLAC__byte *data,
+	size_t length,
+	FLAC__StreamDecoderWriteCallback write_callback,
+	FLAC__StreamDecoderMetadataCallback metadata_callback,
+	FLAC__StreamDecoderErrorCallback error_callback,
+	void *client_data
+)
+{
+	FLAC__ASSERT(0 != decoder);
+
+	/* the same entrance checks as in init_FILE_internal_(), so that a
+	 * failed init does not leave the decoder pointing at the memory
+	 */
+	if(decoder->protected_->state != FLAC__STREAM_DECODER_UNINITIALIZED)
+		return decoder->protected_->initstate = FLAC__STREAM_DECODER_INIT_STATUS_ALREADY_INITIALIZED;
+
+	if(0 == error_callback)
+		return decoder->protected_->initstate = FLAC__STREAM_DECODER_INIT_STATUS_INVALID_CALLBACKS;
+
+	if(0 == data && length > 0)
+		return decoder->protected_->initstate = FLAC__STREAM_DECODER_INIT_STATUS_ERROR_OPENING_FILE;
+
+	return init_memory_internal_(decoder, data, length, write_callback, metadata_callback, error_callback, client_data);
+}
+
+FLAC_API FLAC__StreamDecoderInitStatus FLAC__stream_decoder_init_mmap(
+	FLAC__StreamDecoder *decoder,
+	const char *filename,
+	FLAC__StreamDecoderWriteCallback write_callback,
+	FLAC__StreamDecoderMetadataCallback metadata_callback,
+	FLAC__StreamDecoderErrorCallback error_callback,
+	void *client_data
+)
+{
+#ifdef HAVE_SYS_MMAN_H
+	FILE *file;
+	struct flac_stat_s filestats;
+	void *mapping = MAP_FAILED;
+#endif
+
+	FLAC__ASSERT(0 != decoder);
+
+	/* see init_file_internal_() for why these are checked up front */
+	if(decoder->protected_->state != FLAC__STREAM_DECODER_UNINITIALIZED)
+		return decoder->protected_->initstate = FLAC__STREAM_DECODER_INIT_STATUS_ALREADY_INITIALIZED;
+
+	if(0 == error_callback)
+		return decoder->protected_->initstate = FLAC__STREAM_DECODER_INIT_STATUS_INVALID_CALLBACKS;
+
+#ifdef HAVE_SYS_MMAN_H
+	if(0 != filename) {
+		if(0 == (file = flac_fopen(filename, "rb")))
+			return FLAC__STREAM_DECODER_INIT_STATUS_ERROR_OPENING_FILE;
+		/* the mapping stays valid after the descriptor is closed */
+		if(
+			flac_fstat(fileno(file), &filestats) == 0 &&
+			filestats.st_size > 0 &&
+			(FLAC__uint64)filestats.st_size <= (FLAC__uint64)((size_t)(-1))
+		)
+			mapping = mmap(0, (size_t)filestats.st_size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+		fclose(file);
+		if(mapping != MAP_FAILED) {
+			decoder->private_->mapping = mapping;
+			decoder->private_->mapping_length = (size_t)filestats.st_size;
+			return init_memory_internal_(decoder, (const FLAC__byte*)mapping, (size_t)filestats.st_size, write_callback, metadata_callback, error_callback, client_data);
+		}
+	}
+#endif
+
+	/* stdin, special files and platforms without mmap() just read the file */
+	return init_file_internal_(decoder, filename, write_callback, metadata_callback, error_callback, client_data, /*is_ogg=*/false);
+}
+
 FLAC_API FLAC__bool FLAC__stream_decoder_finish(FLAC__StreamDecoder *decoder)
 {
 	FLAC__bool md5_failed = false;
@@ -640,9 +1018,15 @@ FLAC_API FLAC__bool FLAC__stream_decoder_finish(FLAC__StreamDecoder *decoder)
 	/* see the comment in FLAC__stream_decoder_reset() as to why we
 	 * always call FLAC__MD5Final()
 	 */
+#ifdef HAVE_PTHREAD
+	if(0 != decoder->private_->md5_worker) {
+		FLAC__MD5WorkerFinish(decoder->private_->md5_worker);
+		decoder->private_->md5_worker = 0;
+	}
+#endif
 	FLAC__MD5Final(decoder->private_->computed_md5sum, &decoder->private_->md5context);
 
-	free(decoder->private_->seek_table.data.seek_table.points);
+	FLAC__memory_free(&decoder->private_->allocator, decoder->private_->seek_table.data.seek_table.points);
 	decoder->private_->seek_table.data.seek_table.points = 0;
 	decoder->private_->has_seek_table = false;
 
@@ -655,16 +1039,25 @@ FLAC_API FLAC__bool FLAC__stream_decoder_finish(FLAC__StreamDecoder *decoder)
 		 * we use 4 to keep the data well-aligned.
 		 */
 		if(0 != decoder->private_->output[i]) {
-			free(decoder->private_->output[i]-4);
+			FLAC__memory_free(&decoder->private_->allocator, decoder->private_->output[i]-4);
 			decoder->private_->output[i] = 0;
 		}
 		if(0 != decoder->private_->residual_unaligned[i]) {
-			free(decoder->private_->residual_unaligned[i]);
-			decoder->private_->residual_unaligned[i] = decoder->private_->residual[i] = 0;
+			FLAC__memory_free(&decoder->private_->allocator, decoder->private_->residual_unaligned[i]);
+			decoder->private_->residual_unaligned[i] = 0;
 		}
+		decoder->private_->residual[i] = 0;
 	}
 	decoder->private_->output_capacity = 0;
 	decoder->private_->output_channels = 0;
+	FLAC__memory_free(&decoder->private_->allocator, decoder->private_->interleaved);
+	decoder->private_->interleaved = 0;
+	decoder->private_->interleaved_capacity = 0;
+	decoder->private_->pull_pending_samples = 0;
+	decoder->private_->pull_buffer = 0;
+	decoder->private_->pull_direct = false;
+	FLAC__memory_free(&decoder->private_->allocator, decoder->private_->built_frame_index.data.seek_table.points);
+	decoder->private_->built_frame_index.data.seek_table.points = 0;
 
 #if FLAC__HAS_OGG
 	if(decoder->private_->is_ogg)
@@ -677,6 +1070,8 @@ FLAC_API FLAC__bool FLAC__stream_decoder_finish(FLAC__StreamDecoder *decoder)
 		decoder->private_->file = 0;
 	}
 
+	release_memory_input_(decoder);
+
 	if(decoder->private_->do_md5_checking) {
 		if(memcmp(decoder->private_->stream_info.data.stream_info.md5sum, decoder->private_->computed_md5sum, 16))
 			md5_failed = true;
@@ -717,6 +1112,59 @@ FLAC_API FLAC__bool FLAC__stream_decoder_set_md5_checking(FLAC__StreamDecoder *d
 	return true;
 }
 
+FLAC_API FLAC__bool FLAC__stream_decoder_set_threaded_md5(FLAC__StreamDecoder *decoder, FLAC__bool value)
+{
+	FLAC__ASSERT(0 != decoder);
+	FLAC__ASSERT(0 != decoder->protected_);
+	if(decoder->protected_->state != FLAC__STREAM_DECODER_UNINITIALIZED)
+		return false;
+#ifndef HAVE_PTHREAD
+	if(value)
+		return false;
+#endif
+	decoder->protected_->threaded_md5 = value;
+	return true;
+}
+
+FLAC_API FLAC__bool FLAC__stream_decoder_set_interleaved_format(FLAC__StreamDecoder *decoder, FLAC__StreamDecoderInterleavedFormat format)
+{
+	FLAC__ASSERT(0 != decoder);
+	FLAC__ASSERT(0 != decoder->protected_);
+	if(decoder->protected_->state != FLAC__STREAM_DECODER_UNINITIALIZED)
+		return false;
+	if((uint32_t)format > FLAC__STREAM_DECODER_INTERLEAVED_FLOAT32)
+		return false;
+#ifdef FLAC__INTEGER_ONLY_LIBRARY
+	if(format == FLAC__STREAM_DECODER_INTERLEAVED_FLOAT32)
+		return false;
+#endif
+	decoder->protected_->interleaved_format = format;
+	return true;
+}
+
+FLAC_API FLAC__bool FLAC__stream_decoder_set_low_footprint(FLAC__StreamDecoder *decoder, FLAC__bool value)
+{
+	FLAC__ASSERT(0 != decoder);
+	FLAC__ASSERT(0 != decoder->protected_);
+	if(decoder->protected_->state != FLAC__STREAM_DECODER_UNINITIALIZED)
+		return false;
+	decoder->protected_->low_footprint = value;
+	return true;
+}
+
+FLAC_API FLAC__bool FLAC__stream_decoder_set_frame_index(FLAC__StreamDecoder *decoder, const FLAC__StreamMetadata *index)
+{
+	FLAC__ASSERT(0 != decoder);
+	FLAC__ASSERT(0 != decoder->private_);
+	FLAC__ASSERT(0 != decoder->protected_);
+	if(decoder->protected_->state != FLAC__STREAM_DECODER_UNINITIALIZED)
+		return false;
+	if(0 != index && index->type != FLAC__METADATA_TYPE_SEEKTABLE)
+		return false;
+	decoder->private_->frame_index = index;
+	return true;
+}
+
 FLAC_API FLAC__bool FLAC__stream_decoder_set_metadata_respond(FLAC__StreamDecoder *decoder, FLAC__MetadataType type)
 {
 	FLAC__ASSERT(0 != decoder);
@@ -749,7 +1197,7 @@ FLAC_API FLAC__bool FLAC__stream_decoder_set_metadata_respond_application(FLAC__
 	FLAC__ASSERT(0 != decoder->private_->metadata_filter_ids);
 
 	if(decoder->private_->metadata_filter_ids_count == decoder->private_->metadata_filter_ids_capacity) {
-		if(0 == (decoder->private_->metadata_filter_ids = safe_realloc_mul_2op_(decoder->private_->metadata_filter_ids, decoder->private_->metadata_filter_ids_capacity, /*times*/2))) {
+		if(0 == (decoder->private_->metadata_filter_ids = FLAC__memory_realloc_mul_2op(&decoder->private_->allocator, decoder->private_->metadata_filter_ids, decoder->private_->metadata_filter_ids_capacity, /*times*/2))) {
 			decoder->protected_->state = FLAC__STREAM_DECODER_MEMORY_ALLOCATION_ERROR;
 			return false;
 		}
@@ -808,7 +1256,7 @@ FLAC_API FLAC__bool FLAC__stream_decoder_set_metadata_ignore_application(FLAC__S
 	FLAC__ASSERT(0 != decoder->private_->metadata_filter_ids);
 
 	if(decoder->private_->metadata_filter_ids_count == decoder->private_->metadata_filter_ids_capacity) {
-		if(0 == (decoder->private_->metadata_filter_ids = safe_realloc_mul_2op_(decoder->private_->metadata_filter_ids, decoder->private_->metadata_filter_ids_capacity, /*times*/2))) {
+		if(0 == (decoder->private_->metadata_filter_ids = FLAC__memory_realloc_mul_2op(&decoder->private_->allocator, decoder->private_->metadata_filter_ids, decoder->private_->metadata_filter_ids_capacity, /*times*/2))) {
 			decoder->protected_->state = FLAC__STREAM_DECODER_MEMORY_ALLOCATION_ERROR;
 			return false;
 		}
@@ -852,6 +1300,41 @@ FLAC_API FLAC__bool FLAC__stream_decoder_get_md5_checking(const FLAC__StreamDeco
 	return decoder->protected_->md5_checking;
 }
 
+FLAC_API FLAC__bool FLAC__stream_decoder_get_threaded_md5(const FLAC__StreamDecoder *decoder)
+{
+	FLAC__ASSERT(0 != decoder);
+	FLAC__ASSERT(0 != decoder->protected_);
+	return decoder->protected_->threaded_md5;
+}
+
+FLAC_API FLAC__StreamDecoderInterleavedFormat FLAC__stream_decoder_get_interleaved_format(const FLAC__StreamDecoder *decoder)
+{
+	FLAC__ASSERT(0 != decoder);
+	FLAC__ASSERT(0 != decoder->protected_);
+	return decoder->protected_->interleaved_format;
+}
+
+FLAC_API FLAC__bool FLAC__stream_decoder_get_low_footprint(const FLAC__StreamDecoder *decoder)
+{
+	FLAC__ASSERT(0 != decoder);
+	FLAC__ASSERT(0 != decoder->protected_);
+	return decoder->protected_->low_footprint;
+}
+
+FLAC_API const void *FLAC__stream_decoder_get_interleaved_buffer(const FLAC__StreamDecoder *decoder)
+{
+	FLAC__ASSERT(0 != decoder);
+	FLAC__ASSERT(0 != decoder->private_);
+	return decoder->private_->interleaved;
+}
+
+FLAC_API const FLAC__StreamMetadata *FLAC__stream_decoder_get_frame_index(const FLAC__StreamDecoder *decoder)
+{
+	FLAC__ASSERT(0 != decoder);
+	FLAC__ASSERT(0 != decoder->private_);
+	return decoder->private_->frame_index;
+}
+
 FLAC_API FLAC__uint64 FLAC__stream_decoder_get_total_samples(const FLAC__StreamDecoder *decoder)
 {
 	FLAC__ASSERT(0 != decoder);
@@ -926,6 +1409,7 @@ FLAC_API FLAC__bool FLAC__stream_decoder_flush(FLAC__StreamDecoder *decoder)
 
 	decoder->private_->samples_decoded = 0;
 	decoder->private_->do_md5_checking = false;
+	decoder->private_->pull_pending_samples = 0;
 
 #if FLAC__HAS_OGG
 	if(decoder->private_->is_ogg)
@@ -976,9 +1460,10 @@ FLAC_API FLAC__bool FLAC__stream_decoder_reset(FLAC__StreamDecoder *decoder)
 
 	decoder->private_->has_stream_info = false;
 
-	free(decoder->private_->seek_table.data.seek_table.points);
+	FLAC__memory_free(&decoder->private_->allocator, decoder->private_->seek_table.data.seek_table.points);
 	decoder->private_->seek_table.data.seek_table.points = 0;
 	decoder->private_->has_seek_table = false;
+	decoder->private_->num_learned_seek_points = decoder->private_->next_learned_seek_point = 0;
 
 	decoder->private_->do_md5_checking = decoder->protected_->md5_checking;
 	/*
@@ -991,9 +1476,25 @@ FLAC_API FLAC__bool FLAC__stream_decoder_reset(FLAC__StreamDecoder *decoder)
 	 * is because md5 checking may be turned on to start and then turned off if
 	 * a seek occurs.  So we init the context here and finalize it in
 	 * FLAC__stream_decoder_finish() to make sure things are always cleaned up
-	 * properly.
+	 * properly.  A context left over from before the reset is finalized
+	 * first, since that is what releases its sample buffer.
 	 */
-	FLAC__MD5Init(&decoder->private_->md5context);
+#ifdef HAVE_PTHREAD
+	if(0 != decoder->private_->md5_worker) {
+		FLAC__MD5WorkerFinish(decoder->private_->md5_worker);
+		decoder->private_->md5_worker = 0;
+	}
+#endif
+	{
+		FLAC__byte digest[16];
+		FLAC__MD5Final(digest, &decoder->private_->md5context);
+	}
+	FLAC__MD5Init(&decoder->private_->md5context, &decoder->private_->allocator);
+#ifdef HAVE_PTHREAD
+	/* if the thread cannot be started, the sum is just computed inline */
+	if(decoder->protected_->threaded_md5 && decoder->private_->do_md5_checking)
+		decoder->private_->md5_worker = FLAC__MD5WorkerStart(&decoder->private_->md5context);
+#endif
 
 	decoder->private_->first_frame_offset = 0;
 	decoder->private_->unparseable_frame_count = 0;
@@ -1003,7 +1504,7 @@ FLAC_API FLAC__bool FLAC__stream_decoder_reset(FLAC__StreamDecoder *decoder)
 
 FLAC_API FLAC__bool FLAC__stream_decoder_process_single(FLAC__StreamDecoder *decoder)
 {
-	FLAC__bool got_a_frame;
+	FLAC__bool got_a_frame, ok;
 	FLAC__ASSERT(0 != decoder);
 	FLAC__ASSERT(0 != decoder->protected_);
 
@@ -1019,7 +1520,9 @@ FLAC_API FLAC__bool FLAC__stream_decoder_process_single(FLAC__StreamDecoder *dec
 				else
 					return true;
 			case FLAC__STREAM_DECODER_SEARCH_FOR_FRAME_SYNC:
-				if(!frame_sync_(decoder))
+				FLAC__STATISTICS_TIME(&decoder->private_->statistics, FLAC__STREAM_DECODER_STAGE_FRAME_SYNC,
+					ok = frame_sync_(decoder));
+				if(!ok)
 					return true; /* above function sets the status for us */
 				break;
 			case FLAC__STREAM_DECODER_READ_FRAME:
@@ -1067,7 +1570,7 @@ FLAC_API FLAC__bool FLAC__stream_decoder_process_until_end_of_metadata(FLAC__Str
 
 FLAC_API FLAC__bool FLAC__stream_decoder_process_until_end_of_stream(FLAC__StreamDecoder *decoder)
 {
-	FLAC__bool dummy;
+	FLAC__bool dummy, ok;
 	FLAC__ASSERT(0 != decoder);
 	FLAC__ASSERT(0 != decoder->protected_);
 
@@ -1082,7 +1585,9 @@ FLAC_API FLAC__bool FLAC__stream_decoder_process_until_end_of_stream(FLAC__Strea
 					return false; /* above function sets the status for us */
 				break;
 			case FLAC__STREAM_DECODER_SEARCH_FOR_FRAME_SYNC:
-				if(!frame_sync_(decoder))
+				FLAC__STATISTICS_TIME(&decoder->private_->statistics, FLAC__STREAM_DECODER_STAGE_FRAME_SYNC,
+					ok = frame_sync_(decoder));
+				if(!ok)
 					return true; /* above function sets the status for us */
 				break;
 			case FLAC__STREAM_DECODER_READ_FRAME:
@@ -1099,9 +1604,78 @@ FLAC_API FLAC__bool FLAC__stream_decoder_process_until_end_of_stream(FLAC__Strea
 	}
 }
 
+FLAC_API uint32_t FLAC__stream_decoder_read_samples(FLAC__StreamDecoder *decoder, FLAC__int32 * const buffer[], uint32_t samples)
+{
+	uint32_t done = 0, channel;
+	FLAC__bool got_a_frame, ok;
+
+	FLAC__ASSERT(0 != decoder);
+	FLAC__ASSERT(0 != decoder->private_);
+	FLAC__ASSERT(0 != decoder->protected_);
+	FLAC__ASSERT(0 != buffer);
+
+	if(0 != decoder->private_->write_callback)
+		return 0;
+
+	while(done < samples) {
+		/* hand out what is left of the last frame first */
+		if(decoder->private_->pull_pending_samples > 0) {
+			const uint32_t n = flac_min(decoder->private_->pull_pending_samples, samples - done);
+			for(channel = 0; channel < decoder->private_->pull_pending_channels; channel++) {
+				memcpy(buffer[channel] + done, decoder->private_->pull_pending[channel], sizeof(FLAC__int32) * n);
+				decoder->private_->pull_pending[channel] += n;
+			}
+			decoder->private_->pull_pending_samples -= n;
+			done += n;
+			continue;
+		}
+
+		switch(decoder->protected_->state) {
+			case FLAC__STREAM_DECODER_SEARCH_FOR_METADATA:
+				if(!find_metadata_(decoder))
+					return done; /* above function sets the status for us */
+				break;
+			case FLAC__STREAM_DECODER_READ_METADATA:
+				if(!read_metadata_(decoder))
+					return done; /* above function sets the status for us */
+				break;
+			case FLAC__STREAM_DECODER_SEARCH_FOR_FRAME_SYNC:
+				FLAC__STATISTICS_TIME(&decoder->private_->statistics, FLAC__STREAM_DECODER_STAGE_FRAME_SYNC,
+					ok = frame_sync_(decoder));
+				if(!ok)
+					return done; /* above function sets the status for us */
+				break;
+			case FLAC__STREAM_DECODER_READ_FRAME:
+				decoder->private_->pull_buffer = buffer;
+				decoder->private_->pull_offset = done;
+				decoder->private_->pull_room = samples - done;
+				ok = read_frame_(decoder, &got_a_frame, /*do_full_decode=*/true);
+				decoder->private_->pull_buffer = 0;
+				if(decoder->private_->pull_direct) {
+					for(channel = 0; channel < decoder->private_->frame.header.channels; channel++)
+						decoder->private_->output[channel] = decoder->private_->pull_saved_output[channel];
+					decoder->private_->pull_direct = false;
+					if(ok && got_a_frame)
+						done += decoder->private_->frame.header.blocksize;
+				}
+				if(!ok)
+					return done; /* above function sets the status for us */
+				break;
+			case FLAC__STREAM_DECODER_END_OF_STREAM:
+			case FLAC__STREAM_DECODER_ABORTED:
+				return done;
+			default:
+				FLAC__ASSERT(0);
+				return done;
+		}
+	}
+
+	return done;
+}
+
 FLAC_API FLAC__bool FLAC__stream_decoder_skip_single_frame(FLAC__StreamDecoder *decoder)
 {
-	FLAC__bool got_a_frame;
+	FLAC__bool got_a_frame, ok;
 	FLAC__ASSERT(0 != decoder);
 	FLAC__ASSERT(0 != decoder->protected_);
 
@@ -1111,7 +1685,9 @@ FLAC_API FLAC__bool FLAC__stream_decoder_skip_single_frame(FLAC__StreamDecoder *
 			case FLAC__STREAM_DECODER_READ_METADATA:
 				return false; /* above function sets the status for us */
 			case FLAC__STREAM_DECODER_SEARCH_FOR_FRAME_SYNC:
-				if(!frame_sync_(decoder))
+				FLAC__STATISTICS_TIME(&decoder->private_->statistics, FLAC__STREAM_DECODER_STAGE_FRAME_SYNC,
+					ok = frame_sync_(decoder));
+				if(!ok)
 					return true; /* above function sets the status for us */
 				break;
 			case FLAC__STREAM_DECODER_READ_FRAME:
@@ -1157,6 +1733,8 @@ FLAC_API FLAC__bool FLAC__stream_decoder_seek_absolute(FLAC__StreamDecoder *deco
 		return false;
 
 	decoder->private_->is_seeking = true;
+	decoder->private_->pull_pending_samples = 0;
+	memset(&decoder->private_->seek_stats, 0, sizeof(decoder->private_->seek_stats));
 
 	/* turn off md5 checking if a seek is attempted */
 	decoder->private_->do_md5_checking = false;
@@ -1197,30 +1775,209 @@ FLAC_API FLAC__bool FLAC__stream_decoder_seek_absolute(FLAC__StreamDecoder *deco
 	}
 }
 
-/***********************************************************************
- *
- * Protected class methods
- *
- ***********************************************************************/
-
-uint32_t FLAC__stream_decoder_get_input_bytes_unconsumed(const FLAC__StreamDecoder *decoder)
+FLAC_API void FLAC__stream_decoder_get_seek_stats(const FLAC__StreamDecoder *decoder, FLAC__StreamDecoderSeekStats *stats)
 {
 	FLAC__ASSERT(0 != decoder);
-	FLAC__ASSERT(FLAC__bitreader_is_consumed_byte_aligned(decoder->private_->input));
-	FLAC__ASSERT(!(FLAC__bitreader_get_input_bits_unconsumed(decoder->private_->input) & 7));
-	return FLAC__bitreader_get_input_bits_unconsumed(decoder->private_->input) / 8;
+	FLAC__ASSERT(0 != decoder->private_);
+	FLAC__ASSERT(0 != stats);
+	*stats = decoder->private_->seek_stats;
 }
 
-/***********************************************************************
- *
- * Private class methods
- *
- ***********************************************************************/
+FLAC_API FLAC__bool FLAC__stream_decoder_get_statistics(const FLAC__StreamDecoder *decoder, FLAC__StreamDecoderStatistics *statistics)
+{
+	FLAC__ASSERT(0 != decoder);
+	FLAC__ASSERT(0 != decoder->private_);
+	FLAC__ASSERT(0 != statistics);
+#ifdef FLAC__ENABLE_STATISTICS
+	*statistics = decoder->private_->statistics;
+	return true;
+#else
+	(void)decoder;
+	memset(statistics, 0, sizeof(*statistics));
+	return false;
+#endif
+}
 
-void set_defaults_(FLAC__StreamDecoder *decoder)
+FLAC_API const char *FLAC__stream_decoder_get_kernel(const FLAC__StreamDecoder *decoder, FLAC__StreamDecoderKernel kernel)
 {
-	decoder->private_->is_ogg = false;
-	decoder->private_->read_callback = 0;
+	FLAC__ASSERT(0 != decoder);
+	FLAC__ASSERT(0 != decoder->private_);
+	FLAC__ASSERT(kernel < FLAC__STREAM_DECODER_KERNEL_COUNT);
+	return decoder->private_->kernel_name[kernel];
+}
+
+FLAC_API size_t FLAC__stream_decoder_get_footprint(const FLAC__StreamDecoder *decoder)
+{
+	const FLAC__EntropyCodingMethod_PartitionedRiceContents *contents;
+	size_t bytes;
+	uint32_t i;
+
+	FLAC__ASSERT(0 != decoder);
+	FLAC__ASSERT(0 != decoder->protected_);
+	FLAC__ASSERT(0 != decoder->private_);
+
+	bytes = sizeof(FLAC__StreamDecoder) + sizeof(FLAC__StreamDecoderProtected) + sizeof(FLAC__StreamDecoderPrivate);
+	bytes += FLAC__bitreader_get_footprint(decoder->private_->input);
+	bytes += (FLAC__STREAM_METADATA_APPLICATION_ID_LEN/8) * decoder->private_->metadata_filter_ids_capacity;
+
+	/* allocate_output_() makes one output[] per channel but in low footprint mode only one residual[] */
+	bytes += sizeof(FLAC__int32) * (decoder->private_->output_capacity + 4) * decoder->private_->output_channels;
+	for(i = 0; i < FLAC__MAX_CHANNELS; i++) {
+		if(0 != decoder->private_->residual_unaligned[i])
+			bytes += sizeof(FLAC__int32) * decoder->private_->output_capacity;
+		contents = &decoder->private_->partitioned_rice_contents[i];
+		if(0 != contents->parameters)
+			bytes += 2 * sizeof(uint32_t) * ((size_t)1 << contents->capacity_by_order);
+	}
+	bytes += decoder->private_->interleaved_capacity;
+
+	if(0 != decoder->private_->seek_table.data.seek_table.points)
+		bytes += sizeof(FLAC__StreamMetadata_SeekPoint) * decoder->private_->seek_table.data.seek_table.num_points;
+	if(0 != decoder->private_->built_frame_index.data.seek_table.points)
+		bytes += sizeof(FLAC__StreamMetadata_SeekPoint) * decoder->private_->built_frame_index.data.seek_table.num_points;
+
+	bytes += decoder->private_->md5context.capacity;
+#ifdef HAVE_PTHREAD
+	if(0 != decoder->private_->md5_worker)
+		bytes += FLAC__MD5WorkerGetFootprint(decoder->private_->md5_worker);
+#endif
+
+	return bytes;
+}
+
+FLAC_API FLAC__bool FLAC__stream_decoder_build_frame_index(FLAC__StreamDecoder *decoder)
+{
+	FLAC__StreamMetadata *index;
+	FLAC__StreamMetadata_SeekPoint *points = 0, *point;
+	FLAC__uint64 position;
+	uint32_t num_points = 0, capacity = 0;
+
+	FLAC__ASSERT(0 != decoder);
+
+	if(
+		decoder->protected_->state != FLAC__STREAM_DECODER_SEARCH_FOR_METADATA &&
+		decoder->protected_->state != FLAC__STREAM_DECODER_READ_METADATA &&
+		decoder->protected_->state != FLAC__STREAM_DECODER_SEARCH_FOR_FRAME_SYNC &&
+		decoder->protected_->state != FLAC__STREAM_DECODER_READ_FRAME &&
+		decoder->protected_->state != FLAC__STREAM_DECODER_END_OF_STREAM
+	)
+		return false;
+
+	if(0 == decoder->private_->seek_callback || decoder->private_->is_ogg)
+		return false;
+
+	if(
+		decoder->protected_->state == FLAC__STREAM_DECODER_SEARCH_FOR_METADATA ||
+		decoder->protected_->state == FLAC__STREAM_DECODER_READ_METADATA
+	) {
+		if(!FLAC__stream_decoder_process_until_end_of_metadata(decoder))
+			return false; /* above call sets the state for us */
+	}
+
+	/* skip through the stream from the first frame, noting where each one starts */
+	if(!seek_to_first_frame_(decoder))
+		return false;
+	while(1) {
+		if(!FLAC__stream_decoder_get_decode_position(decoder, &position)) {
+			decoder->protected_->state = FLAC__STREAM_DECODER_SEEK_ERROR;
+			FLAC__memory_free(&decoder->private_->allocator, points);
+			return false;
+		}
+		if(!FLAC__stream_decoder_skip_single_frame(decoder) || decoder->protected_->state == FLAC__STREAM_DECODER_ABORTED) {
+			/* above call sets the state for us */
+			FLAC__memory_free(&decoder->private_->allocator, points);
+			return false;
+		}
+		if(decoder->protected_->state == FLAC__STREAM_DECODER_END_OF_STREAM)
+			break;
+		if(num_points == capacity) {
+			capacity = capacity? capacity * 2 : 1024;
+			/* FLAC__memory_realloc_mul_2op() frees the old points if it fails */
+			if(0 == (points = FLAC__memory_realloc_mul_2op(&decoder->private_->allocator, points, capacity, /*times*/sizeof(FLAC__StreamMetadata_SeekPoint)))) {
+				decoder->protected_->state = FLAC__STREAM_DECODER_MEMORY_ALLOCATION_ERROR;
+				return false;
+			}
+		}
+		FLAC__ASSERT(decoder->private_->frame.header.number_type == FLAC__FRAME_NUMBER_TYPE_SAMPLE_NUMBER);
+		point = &points[num_points++];
+		point->sample_number = decoder->private_->frame.header.number.sample_number;
+		point->stream_offset = position - decoder->private_->first_frame_offset;
+		point->frame_samples = decoder->private_->frame.header.blocksize;
+	}
+	if(num_points == 0) {
+		FLAC__memory_free(&decoder->private_->allocator, points);
+		points = 0;
+	}
+	else if(num_points < capacity && 0 == (points = FLAC__memory_realloc_mul_2op(&decoder->private_->allocator, points, num_points, /*times*/sizeof(FLAC__StreamMetadata_SeekPoint)))) {
+		decoder->protected_->state = FLAC__STREAM_DECODER_MEMORY_ALLOCATION_ERROR;
+		return false;
+	}
+
+	index = &decoder->private_->built_frame_index;
+	FLAC__memory_free(&decoder->private_->allocator, index->data.seek_table.points);
+	index->type = FLAC__METADATA_TYPE_SEEKTABLE;
+	index->is_last = false;
+	index->length = num_points * FLAC__STREAM_METADATA_SEEKPOINT_LENGTH;
+	index->data.seek_table.num_points = num_points;
+	index->data.seek_table.points = points;
+	decoder->private_->frame_index = index;
+
+	return seek_to_first_frame_(decoder);
+}
+
+FLAC_API FLAC__bool FLAC__stream_decoder_process_parallel(FLAC__StreamDecoder *decoder, uint32_t num_threads)
+{
+	FLAC__ASSERT(0 != decoder);
+	FLAC__ASSERT(0 != decoder->private_);
+	FLAC__ASSERT(0 != decoder->protected_);
+
+#ifdef HAVE_PTHREAD
+	if(num_threads > FLAC__STREAM_DECODER_MAX_THREADS)
+		num_threads = FLAC__STREAM_DECODER_MAX_THREADS;
+
+	/* parallel decoding needs to reposition the input and to know the stream parameters up front */
+	if(
+		num_threads > 1 &&
+		!decoder->private_->is_ogg &&
+		0 != decoder->private_->write_callback &&
+		0 != decoder->private_->seek_callback &&
+		0 != decoder->private_->tell_callback
+	) {
+		if(!FLAC__stream_decoder_process_until_end_of_metadata(decoder))
+			return false; /* above function sets the status for us */
+		if(decoder->protected_->state == FLAC__STREAM_DECODER_SEARCH_FOR_FRAME_SYNC && decoder->private_->has_stream_info)
+			return process_parallel_(decoder, num_threads);
+	}
+#else
+	(void)num_threads;
+#endif
+	return FLAC__stream_decoder_process_until_end_of_stream(decoder);
+}
+
+/***********************************************************************
+ *
+ * Protected class methods
+ *
+ ***********************************************************************/
+
+uint32_t FLAC__stream_decoder_get_input_bytes_unconsumed(const FLAC__StreamDecoder *decoder)
+{
+	FLAC__ASSERT(0 != decoder);
+	FLAC__ASSERT(FLAC__bitreader_is_consumed_byte_aligned(decoder->private_->input));
+	FLAC__ASSERT(!(FLAC__bitreader_get_input_bits_unconsumed(decoder->private_->input) & 7));
+	return FLAC__bitreader_get_input_bits_unconsumed(decoder->private_->input) / 8;
+}
+
+/***********************************************************************
+ *
+ * Private class methods
+ *
+ ***********************************************************************/
+
+void set_defaults_(FLAC__StreamDecoder *decoder)
+{
+	decoder->private_->is_ogg = false;
+	decoder->private_->read_callback = 0;
 	decoder->private_->seek_callback = 0;
 	decoder->private_->tell_callback = 0;
 	decoder->private_->length_callback = 0;
@@ -1235,6 +1992,10 @@ void set_defaults_(FLAC__StreamDecoder *decoder)
 	decoder->private_->metadata_filter_ids_count = 0;
 
 	decoder->protected_->md5_checking = false;
+	decoder->protected_->threaded_md5 = false;
+	decoder->protected_->interleaved_format = FLAC__STREAM_DECODER_INTERLEAVED_NONE;
+	decoder->protected_->low_footprint = false;
+	decoder->private_->frame_index = 0;
 
 #if FLAC__HAS_OGG
 	FLAC__ogg_decoder_aspect_set_defaults(&decoder->protected_->ogg_decoder_aspect);
@@ -1271,13 +2032,14 @@ FLAC__bool allocate_output_(FLAC__StreamDecoder *decoder, uint32_t size, uint32_
 
 	for(i = 0; i < FLAC__MAX_CHANNELS; i++) {
 		if(0 != decoder->private_->output[i]) {
-			free(decoder->private_->output[i]-4);
+			FLAC__memory_free(&decoder->private_->allocator, decoder->private_->output[i]-4);
 			decoder->private_->output[i] = 0;
 		}
 		if(0 != decoder->private_->residual_unaligned[i]) {
-			free(decoder->private_->residual_unaligned[i]);
-			decoder->private_->residual_unaligned[i] = decoder->private_->residual[i] = 0;
+			FLAC__memory_free(&decoder->private_->allocator, decoder->private_->residual_unaligned[i]);
+			decoder->private_->residual_unaligned[i] = 0;
 		}
+		decoder->private_->residual[i] = 0;
 	}
 
 	for(i = 0; i < channels; i++) {
@@ -1287,7 +2049,7 @@ FLAC__bool allocate_output_(FLAC__StreamDecoder *decoder, uint32_t size, uint32_
 		 * in front (at negative indices) for alignment purposes;
 		 * we use 4 to keep the data well-aligned.
 		 */
-		tmp = safe_malloc_muladd2_(sizeof(FLAC__int32), /*times (*/size, /*+*/4/*)*/);
+		tmp = FLAC__memory_malloc_muladd2(&decoder->private_->allocator, sizeof(FLAC__int32), /*times (*/size, /*+*/4/*)*/);
 		if(tmp == 0) {
 			decoder->protected_->state = FLAC__STREAM_DECODER_MEMORY_ALLOCATION_ERROR;
 			return false;
@@ -1295,7 +2057,12 @@ FLAC__bool allocate_output_(FLAC__StreamDecoder *decoder, uint32_t size, uint32_
 		memset(tmp, 0, sizeof(FLAC__int32)*4);
 		decoder->private_->output[i] = tmp + 4;
 
-		if(!FLAC__memory_alloc_aligned_int32_array(size, &decoder->private_->residual_unaligned[i], &decoder->private_->residual[i])) {
+		if(i > 0 && decoder->protected_->low_footprint) {
+			/* the channels are decoded one at a time, so they can take turns with one residual buffer */
+			decoder->private_->residual[i] = decoder->private_->residual[0];
+			continue;
+		}
+		if(!FLAC__memory_alloc_aligned_int32_array(&decoder->private_->allocator, size, &decoder->private_->residual_unaligned[i], &decoder->private_->residual[i])) {
 			decoder->protected_->state = FLAC__STREAM_DECODER_MEMORY_ALLOCATION_ERROR;
 			return false;
 		}
@@ -1307,6 +2074,12 @@ FLAC__bool allocate_output_(FLAC__StreamDecoder *decoder, uint32_t size, uint32_
 	return true;
 }
 
+FLAC__EntropyCodingMethod_PartitionedRiceContents *rice_contents_(FLAC__StreamDecoder *decoder, uint32_t channel)
+{
+	/* like residual[], shared by all channels in low footprint mode */
+	return &decoder->private_->partitioned_rice_contents[decoder->protected_->low_footprint? 0 : channel];
+}
+
 FLAC__bool has_id_filtered_(FLAC__StreamDecoder *decoder, FLAC__byte *id)
 {
 	size_t i;
@@ -1423,6 +2196,12 @@ FLAC__bool read_metadata_(FLAC__StreamDecoder *decoder)
 		decoder->private_->has_seek_table = true;
 		if(!decoder->private_->is_seeking && decoder->private_->metadata_filter[FLAC__METADATA_TYPE_SEEKTABLE] && decoder->private_->metadata_callback)
 			decoder->private_->metadata_callback(decoder, &decoder->private_->seek_table, decoder->private_->client_data);
+		if(decoder->protected_->low_footprint && 0 == decoder->private_->seek_callback) {
+			/* without a seek callback nothing needs it any more */
+			FLAC__memory_free(&decoder->private_->allocator, decoder->private_->seek_table.data.seek_table.points);
+			decoder->private_->seek_table.data.seek_table.points = 0;
+			decoder->private_->has_seek_table = false;
+		}
 	}
 	else {
 		FLAC__bool skip_it = !decoder->private_->metadata_filter[type];
@@ -1464,7 +2243,7 @@ FLAC__bool read_metadata_(FLAC__StreamDecoder *decoder)
 				case FLAC__METADATA_TYPE_APPLICATION:
 					/* remember, we read the ID already */
 					if(real_length > 0) {
-						if(0 == (block.data.application.data = malloc(real_length))) {
+						if(0 == (block.data.application.data = FLAC__memory_malloc(&decoder->private_->allocator, real_length))) {
 							decoder->protected_->state = FLAC__STREAM_DECODER_MEMORY_ALLOCATION_ERROR;
 							ok = false;
 						}
@@ -1492,7 +2271,7 @@ FLAC__bool read_metadata_(FLAC__StreamDecoder *decoder)
 					break;
 				default:
 					if(real_length > 0) {
-						if(0 == (block.data.unknown.data = malloc(real_length))) {
+						if(0 == (block.data.unknown.data = FLAC__memory_malloc(&decoder->private_->allocator, real_length))) {
 							decoder->protected_->state = FLAC__STREAM_DECODER_MEMORY_ALLOCATION_ERROR;
 							ok = false;
 						}
@@ -1512,40 +2291,40 @@ FLAC__bool read_metadata_(FLAC__StreamDecoder *decoder)
 					break;
 				case FLAC__METADATA_TYPE_APPLICATION:
 					if(0 != block.data.application.data)
-						free(block.data.application.data);
+						FLAC__memory_free(&decoder->private_->allocator, block.data.application.data);
 					break;
 				case FLAC__METADATA_TYPE_VORBIS_COMMENT:
 					if(0 != block.data.vorbis_comment.vendor_string.entry)
-						free(block.data.vorbis_comment.vendor_string.entry);
+						FLAC__memory_free(&decoder->private_->allocator, block.data.vorbis_comment.vendor_string.entry);
 					if(block.data.vorbis_comment.num_comments > 0)
 						for(i = 0; i < block.data.vorbis_comment.num_comments; i++)
 							if(0 != block.data.vorbis_comment.comments[i].entry)
-								free(block.data.vorbis_comment.comments[i].entry);
+								FLAC__memory_free(&decoder->private_->allocator, block.data.vorbis_comment.comments[i].entry);
 					if(0 != block.data.vorbis_comment.comments)
-						free(block.data.vorbis_comment.comments);
+						FLAC__memory_free(&decoder->private_->allocator, block.data.vorbis_comment.comments);
 					break;
 				case FLAC__METADATA_TYPE_CUESHEET:
 					if(block.data.cue_sheet.num_tracks > 0)
 						for(i = 0; i < block.data.cue_sheet.num_tracks; i++)
 							if(0 != block.data.cue_sheet.tracks[i].indices)
-								free(block.data.cue_sheet.tracks[i].indices);
+								FLAC__memory_free(&decoder->private_->allocator, block.data.cue_sheet.tracks[i].indices);
 					if(0 != block.data.cue_sheet.tracks)
-						free(block.data.cue_sheet.tracks);
+						FLAC__memory_free(&decoder->private_->allocator, block.data.cue_sheet.tracks);
 					break;
 				case FLAC__METADATA_TYPE_PICTURE:
 					if(0 != block.data.picture.mime_type)
-						free(block.data.picture.mime_type);
+						FLAC__memory_free(&decoder->private_->allocator, block.data.picture.mime_type);
 					if(0 != block.data.picture.description)
-						free(block.data.picture.description);
+						FLAC__memory_free(&decoder->private_->allocator, block.data.picture.description);
 					if(0 != block.data.picture.data)
-						free(block.data.picture.data);
+						FLAC__memory_free(&decoder->private_->allocator, block.data.picture.data);
 					break;
 				case FLAC__METADATA_TYPE_STREAMINFO:
 				case FLAC__METADATA_TYPE_SEEKTABLE:
 					FLAC__ASSERT(0);
 				default:
 					if(0 != block.data.unknown.data)
-						free(block.data.unknown.data);
+						FLAC__memory_free(&decoder->private_->allocator, block.data.unknown.data);
 					break;
 			}
 
@@ -1651,7 +2430,7 @@ FLAC__bool read_metadata_seektable_(FLAC__StreamDecoder *decoder, FLAC__bool is_
 	decoder->private_->seek_table.data.seek_table.num_points = length / FLAC__STREAM_METADATA_SEEKPOINT_LENGTH;
 
 	/* use realloc since we may pass through here several times (e.g. after seeking) */
-	if(0 == (decoder->private_->seek_table.data.seek_table.points = safe_realloc_mul_2op_(decoder->private_->seek_table.data.seek_table.points, decoder->private_->seek_table.data.seek_table.num_points, /*times*/sizeof(FLAC__StreamMetadata_SeekPoint)))) {
+	if(0 == (decoder->private_->seek_table.data.seek_table.points = FLAC__memory_realloc_mul_2op(&decoder->private_->allocator, decoder->private_->seek_table.data.seek_table.points, decoder->private_->seek_table.data.seek_table.num_points, /*times*/sizeof(FLAC__StreamMetadata_SeekPoint)))) {
 		decoder->protected_->state = FLAC__STREAM_DECODER_MEMORY_ALLOCATION_ERROR;
 		return false;
 	}
@@ -1699,7 +2478,7 @@ FLAC__bool read_metadata_vorbiscomment_(FLAC__StreamDecoder *decoder, FLAC__Stre
 			}
 			else
 				length -= obj->vendor_string.length;
-			if (0 == (obj->vendor_string.entry = safe_malloc_add_2op_(obj->vendor_string.length, /*+*/1))) {
+			if (0 == (obj->vendor_string.entry = FLAC__memory_malloc_add_2op(&decoder->private_->allocator, obj->vendor_string.length, /*+*/1))) {
 				decoder->protected_->state = FLAC__STREAM_DECODER_MEMORY_ALLOCATION_ERROR;
 				return false;
 			}
@@ -1722,7 +2501,7 @@ FLAC__bool read_metadata_vorbiscomment_(FLAC__StreamDecoder *decoder, FLAC__Stre
 			return false;
 		}
 		if (obj->num_comments > 0) {
-			if (0 == (obj->comments = safe_malloc_mul_2op_p(obj->num_comments, /*times*/sizeof(FLAC__StreamMetadata_VorbisComment_Entry)))) {
+			if (0 == (obj->comments = FLAC__memory_malloc_mul_2op(&decoder->private_->allocator, obj->num_comments, /*times*/sizeof(FLAC__StreamMetadata_VorbisComment_Entry)))) {
 				obj->num_comments = 0;
 				decoder->protected_->state = FLAC__STREAM_DECODER_MEMORY_ALLOCATION_ERROR;
 				return false;
@@ -1750,7 +2529,7 @@ FLAC__bool read_metadata_vorbiscomment_(FLAC__StreamDecoder *decoder, FLAC__Stre
 					}
 					else
 						length -= obj->comments[i].length;
-					if (0 == (obj->comments[i].entry = safe_malloc_add_2op_(obj->comments[i].length, /*+*/1))) {
+					if (0 == (obj->comments[i].entry = FLAC__memory_malloc_add_2op(&decoder->private_->allocator, obj->comments[i].length, /*+*/1))) {
 						decoder->protected_->state = FLAC__STREAM_DECODER_MEMORY_ALLOCATION_ERROR;
 						obj->num_comments = i;
 						return false;
@@ -1758,7 +2537,7 @@ FLAC__bool read_metadata_vorbiscomment_(FLAC__StreamDecoder *decoder, FLAC__Stre
 					memset (obj->comments[i].entry, 0, obj->comments[i].length) ;
 					if (!FLAC__bitreader_read_byte_block_aligned_no_crc(decoder->private_->input, obj->comments[i].entry, obj->comments[i].length)) {
 						/* Current i-th entry is bad, so we delete it. */
-						free (obj->comments[i].entry) ;
+						FLAC__memory_free(&decoder->private_->allocator, obj->comments[i].entry) ;
 						obj->comments[i].entry = NULL ;
 						obj->num_comments = i;
 						goto skip;
@@ -1775,7 +2554,7 @@ FLAC__bool read_metadata_vorbiscomment_(FLAC__StreamDecoder *decoder, FLAC__Stre
 	if (length > 0) {
 		/* length > 0 can only happen on files with invalid data in comments */
 		if(obj->num_comments < 1) {
-			free(obj->comments);
+			FLAC__memory_free(&decoder->private_->allocator, obj->comments);
 			obj->comments = NULL;
 		}
 		if(!FLAC__bitreader_skip_byte_block_aligned_no_crc(decoder->private_->input, length))
@@ -1812,7 +2591,7 @@ FLAC__bool read_metadata_cuesheet_(FLAC__StreamDecoder *decoder, FLAC__StreamMet
 	obj->num_tracks = x;
 
 	if(obj->num_tracks > 0) {
-		if(0 == (obj->tracks = safe_calloc_(obj->num_tracks, sizeof(FLAC__StreamMetadata_CueSheet_Track)))) {
+		if(0 == (obj->tracks = FLAC__memory_calloc(&decoder->private_->allocator, obj->num_tracks, sizeof(FLAC__StreamMetadata_CueSheet_Track)))) {
 			decoder->protected_->state = FLAC__STREAM_DECODER_MEMORY_ALLOCATION_ERROR;
 			return false;
 		}
@@ -1845,7 +2624,7 @@ FLAC__bool read_metadata_cuesheet_(FLAC__StreamDecoder *decoder, FLAC__StreamMet
 			track->num_indices = (FLAC__byte)x;
 
 			if(track->num_indices > 0) {
-				if(0 == (track->indices = safe_calloc_(track->num_indices, sizeof(FLAC__StreamMetadata_CueSheet_Index)))) {
+				if(0 == (track->indices = FLAC__memory_calloc(&decoder->private_->allocator, track->num_indices, sizeof(FLAC__StreamMetadata_CueSheet_Index)))) {
 					decoder->protected_->state = FLAC__STREAM_DECODER_MEMORY_ALLOCATION_ERROR;
 					return false;
 				}
@@ -1882,7 +2661,7 @@ FLAC__bool read_metadata_picture_(FLAC__StreamDecoder *decoder, FLAC__StreamMeta
 	/* read MIME type */
 	if(!FLAC__bitreader_read_raw_uint32(decoder->private_->input, &x, FLAC__STREAM_METADATA_PICTURE_MIME_TYPE_LENGTH_LEN))
 		return false; /* read_callback_ sets the state for us */
-	if(0 == (obj->mime_type = safe_malloc_add_2op_(x, /*+*/1))) {
+	if(0 == (obj->mime_type = FLAC__memory_malloc_add_2op(&decoder->private_->allocator, x, /*+*/1))) {
 		decoder->protected_->state = FLAC__STREAM_DECODER_MEMORY_ALLOCATION_ERROR;
 		return false;
 	}
@@ -1895,7 +2674,7 @@ FLAC__bool read_metadata_picture_(FLAC__StreamDecoder *decoder, FLAC__StreamMeta
 	/* read description */
 	if(!FLAC__bitreader_read_raw_uint32(decoder->private_->input, &x, FLAC__STREAM_METADATA_PICTURE_DESCRIPTION_LENGTH_LEN))
 		return false; /* read_callback_ sets the state for us */
-	if(0 == (obj->description = safe_malloc_add_2op_(x, /*+*/1))) {
+	if(0 == (obj->description = FLAC__memory_malloc_add_2op(&decoder->private_->allocator, x, /*+*/1))) {
 		decoder->protected_->state = FLAC__STREAM_DECODER_MEMORY_ALLOCATION_ERROR;
 		return false;
 	}
@@ -1924,7 +2703,7 @@ FLAC__bool read_metadata_picture_(FLAC__StreamDecoder *decoder, FLAC__StreamMeta
 	/* read data */
 	if(!FLAC__bitreader_read_raw_uint32(decoder->private_->input, &(obj->data_length), FLAC__STREAM_METADATA_PICTURE_DATA_LENGTH_LEN))
 		return false; /* read_callback_ sets the state for us */
-	if(0 == (obj->data = safe_malloc_(obj->data_length))) {
+	if(0 == (obj->data = FLAC__memory_malloc(&decoder->private_->allocator, obj->data_length))) {
 		decoder->protected_->state = FLAC__STREAM_DECODER_MEMORY_ALLOCATION_ERROR;
 		return false;
 	}
@@ -1962,6 +2741,8 @@ FLAC__bool frame_sync_(FLAC__StreamDecoder *decoder)
 {
 	FLAC__uint32 x;
 	FLAC__bool first = true;
+	FLAC__bool ok;
+	uint32_t skipped, header_len;
 
 	/* If we know the total number of samples in the stream, stop if we've read that many. */
 	/* This will stop us, for example, from wasting time trying to sync on an ID3V1 tag. */
@@ -1984,6 +2765,19 @@ FLAC__bool frame_sync_(FLAC__StreamDecoder *decoder)
 			decoder->private_->cached = false;
 		}
 		else {
+			/*
+			 * Let the reader skip ahead to the next sync code a block at a
+			 * time.  The skipped bytes are reported just as if they had
+			 * been read one at a time below, even when the input ends
+			 * before another sync code turns up.
+			 */
+			ok = FLAC__bitreader_skip_to_frame_sync_no_crc(decoder->private_->input, &skipped);
+			if(skipped && first) {
+				send_error_to_client_(decoder, FLAC__STREAM_DECODER_ERROR_STATUS_LOST_SYNC);
+				first = false;
+			}
+			if(!ok)
+				return false; /* read_callback_ sets the state for us */
 			if(!FLAC__bitreader_read_raw_uint32(decoder->private_->input, &x, 8))
 				return false; /* read_callback_ sets the state for us */
 		}
@@ -2000,6 +2794,19 @@ FLAC__bool frame_sync_(FLAC__StreamDecoder *decoder)
 			}
 			else if(x >> 1 == 0x7c) { /* MAGIC NUMBER for the last 6 sync bits and reserved 7th bit */
 				decoder->private_->header_warmup[1] = (FLAC__byte)x;
+				/*
+				 * Most false sync codes in audio data are followed by a
+				 * header with a bad CRC-8.  Drop those here, with the
+				 * same callback read_frame_header_() would have made,
+				 * and carry on as if frame_sync_() had been called anew.
+				 */
+				if(0 != (header_len = frame_header_crc_mismatch_(decoder))) {
+					send_error_to_client_(decoder, FLAC__STREAM_DECODER_ERROR_STATUS_BAD_HEADER);
+					if(!FLAC__bitreader_skip_byte_block_aligned_no_crc(decoder->private_->input, header_len))
+						return false; /* read_callback_ sets the state for us */
+					first = true;
+					continue;
+				}
 				decoder->protected_->state = FLAC__STREAM_DECODER_READ_FRAME;
 				return true;
 			}
@@ -2013,6 +2820,72 @@ FLAC__bool frame_sync_(FLAC__StreamDecoder *decoder)
 	return true;
 }
 
+/*
+ * Returns the number of bytes following the sync code up to and including
+ * the CRC-8 if all of them are already in the input buffer and
+ * read_frame_header_() would read that far only to find the CRC-8 wrong.
+ * Returns 0 in every other case, leaving the header to read_frame_header_().
+ */
+uint32_t frame_header_crc_mismatch_(const FLAC__StreamDecoder *decoder)
+{
+	FLAC__byte header[16]; /* MAGIC NUMBER based on the maximum frame header size, including CRC */
+	uint32_t header_len, avail, n, i;
+	FLAC__bool variable_blocksize;
+
+	header[0] = decoder->private_->header_warmup[0];
+	header[1] = decoder->private_->header_warmup[1];
+	avail = 2 + FLAC__bitreader_peek_byte_block_aligned(decoder->private_->input, header + 2, sizeof(header) - 2);
+	if(avail < 5)
+		return 0;
+
+	/* read_frame_header_() reports these before it gets to the CRC-8 */
+	if(header[2] == 0xff || header[3] == 0xff || (header[2] & 0x0f) == 15)
+		return 0;
+
+	variable_blocksize =
+		header[1] & 0x01 ||
+		(decoder->private_->has_stream_info && decoder->private_->stream_info.data.stream_info.min_blocksize != decoder->private_->stream_info.data.stream_info.max_blocksize);
+
+	/* the number of continuation bytes, as FLAC__bitreader_read_utf8_uint32/64() work it out */
+	if(!(header[4] & 0x80))
+		n = 0;
+	else if(header[4] < 0xe0)
+		n = 1;
+	else if(header[4] < 0xf0)
+		n = 2;
+	else if(header[4] < 0xf8)
+		n = 3;
+	else if(header[4] < 0xfc)
+		n = 4;
+	else if(header[4] < 0xfe)
+		n = 5;
+	else if(header[4] == 0xfe && variable_blocksize)
+		n = 6;
+	else
+		return 0;
+	header_len = 5 + n;
+
+	if(header[2] >> 4 == 6)
+		header_len += 1;
+	else if(header[2] >> 4 == 7)
+		header_len += 2;
+	if((header[2] & 0x0f) == 12)
+		header_len += 1;
+	else if((header[2] & 0x0f) == 13 || (header[2] & 0x0f) == 14)
+		header_len += 2;
+
+	if(avail < header_len + 1)
+		return 0;
+	for(i = 5; i < 5 + n; i++) {
+		if((header[i] & 0xc0) != 0x80)
+			return 0;
+	}
+	if(FLAC__crc8(header, header_len) == header[header_len])
+		return 0;
+
+	return header_len + 1 - 2;
+}
+
 FLAC__bool read_frame_(FLAC__StreamDecoder *decoder, FLAC__bool *got_a_frame, FLAC__bool do_full_decode)
 {
 	uint32_t channel;
@@ -2020,6 +2893,7 @@ FLAC__bool read_frame_(FLAC__StreamDecoder *decoder, FLAC__bool *got_a_frame, FL
 	FLAC__int32 mid, side;
 	uint32_t frame_crc; /* the one we calculate from the input stream */
 	FLAC__uint32 x;
+	FLAC__bool ok;
 
 	*got_a_frame = false;
 
@@ -2029,12 +2903,36 @@ FLAC__bool read_frame_(FLAC__StreamDecoder *decoder, FLAC__bool *got_a_frame, FL
 	frame_crc = FLAC__CRC16_UPDATE(decoder->private_->header_warmup[1], frame_crc);
 	FLAC__bitreader_reset_read_crc16(decoder->private_->input, (FLAC__uint16)frame_crc);
 
-	if(!read_frame_header_(decoder))
+	FLAC__STATISTICS_TIME(&decoder->private_->statistics, FLAC__STREAM_DECODER_STAGE_FRAME_HEADER,
+		ok = read_frame_header_(decoder));
+	if(!ok)
 		return false;
 	if(decoder->protected_->state == FLAC__STREAM_DECODER_SEARCH_FOR_FRAME_SYNC) /* means we didn't sync on a valid header */
 		return true;
+#ifdef FLAC__ENABLE_STATISTICS
+	decoder->private_->statistics.blocksizes[FLAC__bitmath_ilog2(decoder->private_->frame.header.blocksize)]++;
+#endif
 	if(!allocate_output_(decoder, decoder->private_->frame.header.blocksize, decoder->private_->frame.header.channels))
 		return false;
+	/*
+	 * If FLAC__stream_decoder_read_samples() has room for the whole frame,
+	 * decode straight into the caller's buffer.  Some of the LPC restore
+	 * routines read up to 3 samples in front of output[] (see
+	 * allocate_output_()), so only do it past the first 4 samples, where
+	 * those reads stay inside the buffer.
+	 */
+	if(
+		0 != decoder->private_->pull_buffer &&
+		decoder->private_->pull_offset >= 4 &&
+		decoder->private_->frame.header.blocksize <= decoder->private_->pull_room &&
+		do_full_decode
+	) {
+		for(channel = 0; channel < decoder->private_->frame.header.channels; channel++) {
+			decoder->private_->pull_saved_output[channel] = decoder->private_->output[channel];
+			decoder->private_->output[channel] = decoder->private_->pull_buffer[channel] + decoder->private_->pull_offset;
+		}
+		decoder->private_->pull_direct = true;
+	}
 	for(channel = 0; channel < decoder->private_->frame.header.channels; channel++) {
 		/*
 		 * first figure the correct bits-per-sample of the subframe
@@ -2083,6 +2981,10 @@ FLAC__bool read_frame_(FLAC__StreamDecoder *decoder, FLAC__bool *got_a_frame, FL
 		return false; /* read_callback_ sets the state for us */
 	if(frame_crc == x) {
 		if(do_full_decode) {
+#ifdef FLAC__ENABLE_STATISTICS
+			/* not FLAC__STATISTICS_TIME(): there is an #if in the switch */
+			const FLAC__uint64 decorrelation_start = FLAC__statistics_clock();
+#endif
 			/* Undo any special channel coding */
 			switch(decoder->private_->frame.header.channel_assignment) {
 				case FLAC__CHANNEL_ASSIGNMENT_INDEPENDENT:
@@ -2120,6 +3022,10 @@ FLAC__bool read_frame_(FLAC__StreamDecoder *decoder, FLAC__bool *got_a_frame, FL
 					FLAC__ASSERT(0);
 					break;
 			}
+#ifdef FLAC__ENABLE_STATISTICS
+			decoder->private_->statistics.nanoseconds[FLAC__STREAM_DECODER_STAGE_DECORRELATION] += FLAC__statistics_clock() - decorrelation_start;
+			decoder->private_->statistics.calls[FLAC__STREAM_DECODER_STAGE_DECORRELATION]++;
+#endif
 		}
 	}
 	else {
@@ -2532,6 +3438,17 @@ FLAC__bool read_subframe_(FLAC__StreamDecoder *decoder, uint32_t channel, uint32
 			return true;
 	}
 
+#ifdef FLAC__ENABLE_STATISTICS
+	{
+		const FLAC__Subframe *subframe = &decoder->private_->frame.subframes[channel];
+		decoder->private_->statistics.subframe_types[subframe->type]++;
+		if(subframe->type == FLAC__SUBFRAME_TYPE_FIXED)
+			decoder->private_->statistics.fixed_orders[subframe->data.fixed.order]++;
+		else if(subframe->type == FLAC__SUBFRAME_TYPE_LPC)
+			decoder->private_->statistics.lpc_orders[subframe->data.lpc.order]++;
+	}
+#endif
+
 	if(wasted_bits && do_full_decode) {
 		x = decoder->private_->frame.subframes[channel].wasted_bits;
 		for(i = 0; i < decoder->private_->frame.header.blocksize; i++) {
@@ -2572,6 +3489,7 @@ FLAC__bool read_subframe_fixed_(FLAC__StreamDecoder *decoder, uint32_t channel,
 	FLAC__int32 i32;
 	FLAC__uint32 u32;
 	uint32_t u;
+	FLAC__bool ok;
 
 	decoder->private_->frame.subframes[channel].type = FLAC__SUBFRAME_TYPE_FIXED;
 
@@ -2600,7 +3518,7 @@ FLAC__bool read_subframe_fixed_(FLAC__StreamDecoder *decoder, uint32_t channel,
 				return true;
 			}
 			subframe->entropy_coding_method.data.partitioned_rice.order = u32;
-			subframe->entropy_coding_method.data.partitioned_rice.contents = &decoder->private_->partitioned_rice_contents[channel];
+			subframe->entropy_coding_method.data.partitioned_rice.contents = rice_contents_(decoder, channel);
 			break;
 		default:
 			send_error_to_client_(decoder, FLAC__STREAM_DECODER_ERROR_STATUS_UNPARSEABLE_STREAM);
@@ -2612,7 +3530,9 @@ FLAC__bool read_subframe_fixed_(FLAC__StreamDecoder *decoder, uint32_t channel,
 	switch(subframe->entropy_coding_method.type) {
 		case FLAC__ENTROPY_CODING_METHOD_PARTITIONED_RICE:
 		case FLAC__ENTROPY_CODING_METHOD_PARTITIONED_RICE2:
-			if(!read_residual_partitioned_rice_(decoder, order, subframe->entropy_coding_method.data.partitioned_rice.order, &decoder->private_->partitioned_rice_contents[channel], decoder->private_->residual[channel], /*is_extended=*/subframe->entropy_coding_method.type == FLAC__ENTROPY_CODING_METHOD_PARTITIONED_RICE2))
+			FLAC__STATISTICS_TIME(&decoder->private_->statistics, FLAC__STREAM_DECODER_STAGE_RESIDUAL,
+				ok = read_residual_partitioned_rice_(decoder, order, subframe->entropy_coding_method.data.partitioned_rice.order, rice_contents_(decoder, channel), decoder->private_->residual[channel], /*is_extended=*/subframe->entropy_coding_method.type == FLAC__ENTROPY_CODING_METHOD_PARTITIONED_RICE2));
+			if(!ok)
 				return false;
 			break;
 		default:
@@ -2622,7 +3542,8 @@ FLAC__bool read_subframe_fixed_(FLAC__StreamDecoder *decoder, uint32_t channel,
 	/* decode the subframe */
 	if(do_full_decode) {
 		memcpy(decoder->private_->output[channel], subframe->warmup, sizeof(FLAC__int32) * order);
-		FLAC__fixed_restore_signal(decoder->private_->residual[channel], decoder->private_->frame.header.blocksize-order, order, decoder->private_->output[channel]+order);
+		FLAC__STATISTICS_TIME(&decoder->private_->statistics, FLAC__STREAM_DECODER_STAGE_RESTORE,
+			FLAC__fixed_restore_signal(decoder->private_->residual[channel], decoder->private_->frame.header.blocksize-order, order, decoder->private_->output[channel]+order));
 	}
 
 	return true;
@@ -2634,6 +3555,7 @@ FLAC__bool read_subframe_lpc_(FLAC__StreamDecoder *decoder, uint32_t channel, ui
 	FLAC__int32 i32;
 	FLAC__uint32 u32;
 	uint32_t u;
+	FLAC__bool ok;
 
 	decoder->private_->frame.subframes[channel].type = FLAC__SUBFRAME_TYPE_LPC;
 
@@ -2689,7 +3611,7 @@ FLAC__bool read_subframe_lpc_(FLAC__StreamDecoder *decoder, uint32_t channel, ui
 				return true;
 			}
 			subframe->entropy_coding_method.data.partitioned_rice.order = u32;
-			subframe->entropy_coding_method.data.partitioned_rice.contents = &decoder->private_->partitioned_rice_contents[channel];
+			subframe->entropy_coding_method.data.partitioned_rice.contents = rice_contents_(decoder, channel);
 			break;
 		default:
 			send_error_to_client_(decoder, FLAC__STREAM_DECODER_ERROR_STATUS_UNPARSEABLE_STREAM);
@@ -2701,7 +3623,9 @@ FLAC__bool read_subframe_lpc_(FLAC__StreamDecoder *decoder, uint32_t channel, ui
 	switch(subframe->entropy_coding_method.type) {
 		case FLAC__ENTROPY_CODING_METHOD_PARTITIONED_RICE:
 		case FLAC__ENTROPY_CODING_METHOD_PARTITIONED_RICE2:
-			if(!read_residual_partitioned_rice_(decoder, order, subframe->entropy_coding_method.data.partitioned_rice.order, &decoder->private_->partitioned_rice_contents[channel], decoder->private_->residual[channel], /*is_extended=*/subframe->entropy_coding_method.type == FLAC__ENTROPY_CODING_METHOD_PARTITIONED_RICE2))
+			FLAC__STATISTICS_TIME(&decoder->private_->statistics, FLAC__STREAM_DECODER_STAGE_RESIDUAL,
+				ok = read_residual_partitioned_rice_(decoder, order, subframe->entropy_coding_method.data.partitioned_rice.order, rice_contents_(decoder, channel), decoder->private_->residual[channel], /*is_extended=*/subframe->entropy_coding_method.type == FLAC__ENTROPY_CODING_METHOD_PARTITIONED_RICE2));
+			if(!ok)
 				return false;
 			break;
 		default:
@@ -2711,13 +3635,15 @@ FLAC__bool read_subframe_lpc_(FLAC__StreamDecoder *decoder, uint32_t channel, ui
 	/* decode the subframe */
 	if(do_full_decode) {
 		memcpy(decoder->private_->output[channel], subframe->warmup, sizeof(FLAC__int32) * order);
-		if(bps + subframe->qlp_coeff_precision + FLAC__bitmath_ilog2(order) <= 32)
-			if(bps <= 16 && subframe->qlp_coeff_precision <= 16)
-				decoder->private_->local_lpc_restore_signal_16bit(decoder->private_->residual[channel], decoder->private_->frame.header.blocksize-order, subframe->qlp_coeff, order, subframe->quantization_level, decoder->private_->output[channel]+order);
+		FLAC__STATISTICS_TIME(&decoder->private_->statistics, FLAC__STREAM_DECODER_STAGE_RESTORE,
+			if(bps + subframe->qlp_coeff_precision + FLAC__bitmath_ilog2(order) <= 32)
+				if(bps <= 16 && subframe->qlp_coeff_precision <= 16)
+					decoder->private_->local_lpc_restore_signal_16bit(decoder->private_->residual[channel], decoder->private_->frame.header.blocksize-order, subframe->qlp_coeff, order, subframe->quantization_level, decoder->private_->output[channel]+order);
+				else
+					decoder->private_->local_lpc_restore_signal(decoder->private_->residual[channel], decoder->private_->frame.header.blocksize-order, subframe->qlp_coeff, order, subframe->quantization_level, decoder->private_->output[channel]+order);
 			else
-				decoder->private_->local_lpc_restore_signal(decoder->private_->residual[channel], decoder->private_->frame.header.blocksize-order, subframe->qlp_coeff, order, subframe->quantization_level, decoder->private_->output[channel]+order);
-		else
-			decoder->private_->local_lpc_restore_signal_64bit(decoder->private_->residual[channel], decoder->private_->frame.header.blocksize-order, subframe->qlp_coeff, order, subframe->quantization_level, decoder->private_->output[channel]+order);
+				decoder->private_->local_lpc_restore_signal_64bit(decoder->private_->residual[channel], decoder->private_->frame.header.blocksize-order, subframe->qlp_coeff, order, subframe->quantization_level, decoder->private_->output[channel]+order)
+		);
 	}
 
 	return true;
@@ -2759,7 +3685,7 @@ FLAC__bool read_residual_partitioned_rice_(FLAC__StreamDecoder *decoder, uint32_
 	/* invalid predictor and partition orders mush be handled in the callers */
 	FLAC__ASSERT(partition_order > 0? partition_samples >= predictor_order : decoder->private_->frame.header.blocksize >= predictor_order);
 
-	if(!FLAC__format_entropy_coding_method_partitioned_rice_contents_ensure_size(partitioned_rice_contents, flac_max(6u, partition_order))) {
+	if(!FLAC__format_entropy_coding_method_partitioned_rice_contents_ensure_size(partitioned_rice_contents, flac_max(6u, partition_order), &decoder->private_->allocator)) {
 		decoder->protected_->state = FLAC__STREAM_DECODER_MEMORY_ALLOCATION_ERROR;
 		return false;
 	}
@@ -2770,13 +3696,19 @@ FLAC__bool read_residual_partitioned_rice_(FLAC__StreamDecoder *decoder, uint32_
 			return false; /* read_callback_ sets the state for us */
 		partitioned_rice_contents->parameters[partition] = rice_parameter;
 		if(rice_parameter < pesc) {
+#ifdef FLAC__ENABLE_STATISTICS
+			decoder->private_->statistics.rice_parameters[rice_parameter]++;
+#endif
 			partitioned_rice_contents->raw_bits[partition] = 0;
 			u = (partition == 0) ? partition_samples - predictor_order : partition_samples;
-			if(!FLAC__bitreader_read_rice_signed_block(decoder->private_->input, residual + sample, u, rice_parameter))
+			if(!decoder->private_->local_bitreader_read_rice_signed_block(decoder->private_->input, residual + sample, u, rice_parameter))
 				return false; /* read_callback_ sets the state for us */
 			sample += u;
 		}
 		else {
+#ifdef FLAC__ENABLE_STATISTICS
+			decoder->private_->statistics.escaped_partitions++;
+#endif
 			if(!FLAC__bitreader_read_raw_uint32(decoder->private_->input, &rice_parameter, FLAC__ENTROPY_CODING_METHOD_PARTITIONED_RICE_RAW_LEN))
 				return false; /* read_callback_ sets the state for us */
 			partitioned_rice_contents->raw_bits[partition] = rice_parameter;
@@ -2805,6 +3737,35 @@ FLAC__bool read_zero_padding_(FLAC__StreamDecoder *decoder)
 	return true;
 }
 
+/* the FLAC__stream_decoder_init_memory() counterpart of read_callback_(),
+ * handing the bitreader a pointer into the memory instead of a copy
+ */
+FLAC__bool borrow_callback_(const FLAC__byte **buffer, size_t *bytes, void *client_data)
+{
+	FLAC__StreamDecoder *decoder = (FLAC__StreamDecoder *)client_data;
+	const size_t remaining = decoder->private_->memory_length - decoder->private_->memory_position;
+
+	if(remaining == 0) {
+		*bytes = 0;
+		decoder->protected_->state = FLAC__STREAM_DECODER_END_OF_STREAM;
+		return false;
+	}
+	/* see read_callback_() */
+	if(decoder->private_->is_seeking && decoder->private_->unparseable_frame_count > 20) {
+		decoder->protected_->state = FLAC__STREAM_DECODER_ABORTED;
+		return false;
+	}
+	if(*bytes > remaining)
+		*bytes = remaining;
+	*buffer = decoder->private_->memory_data + decoder->private_->memory_position;
+	decoder->private_->memory_position += *bytes;
+	if(decoder->private_->is_seeking) {
+		decoder->private_->seek_stats.read_callbacks++;
+		decoder->private_->seek_stats.bytes_read += *bytes;
+	}
+	return true;
+}
+
 FLAC__bool read_callback_(FLAC__byte buffer[], size_t *bytes, void *client_data)
 {
 	FLAC__StreamDecoder *decoder = (FLAC__StreamDecoder *)client_data;
@@ -2843,6 +3804,11 @@ FLAC__bool read_callback_(FLAC__byte buffer[], size_t *bytes, void *client_data)
 #endif
 				decoder->private_->read_callback(decoder, buffer, bytes, decoder->private_->client_data)
 			;
+			/* Ogg FLAC reads are counted in read_callback_proxy_() */
+			if(decoder->private_->is_seeking && !decoder->private_->is_ogg) {
+				decoder->private_->seek_stats.read_callbacks++;
+				decoder->private_->seek_stats.bytes_read += *bytes;
+			}
 			if(status == FLAC__STREAM_DECODER_READ_STATUS_ABORT) {
 				decoder->protected_->state = FLAC__STREAM_DECODER_ABORTED;
 				return false;
@@ -2915,8 +3881,13 @@ FLAC__StreamDecoderReadStatus read_callback_ogg_aspect_(const FLAC__StreamDecode
 FLAC__OggDecoderAspectReadStatus read_callback_proxy_(const void *void_decoder, FLAC__byte buffer[], size_t *bytes, void *client_data)
 {
 	FLAC__StreamDecoder *decoder = (FLAC__StreamDecoder*)void_decoder;
+	const FLAC__StreamDecoderReadStatus status = decoder->private_->read_callback(decoder, buffer, bytes, client_data);
 
-	switch(decoder->private_->read_callback(decoder, buffer, bytes, client_data)) {
+	if(decoder->private_->is_seeking) {
+		decoder->private_->seek_stats.read_callbacks++;
+		decoder->private_->seek_stats.bytes_read += *bytes;
+	}
+	switch(status) {
 		case FLAC__STREAM_DECODER_READ_STATUS_CONTINUE:
 			return FLAC__OGG_DECODER_ASPECT_READ_STATUS_OK;
 		case FLAC__STREAM_DECODER_READ_STATUS_END_OF_STREAM:
@@ -2931,6 +3902,39 @@ FLAC__OggDecoderAspectReadStatus read_callback_proxy_(const void *void_decoder,
 }
 #endif
 
+FLAC__StreamDecoderWriteStatus write_to_client_(FLAC__StreamDecoder *decoder, const FLAC__Frame *frame, const FLAC__int32 * const buffer[])
+{
+	FLAC__StreamDecoderWriteStatus status;
+
+	if(0 == decoder->private_->write_callback) {
+		/* no write callback: keep the samples for FLAC__stream_decoder_read_samples(), unless they were decoded into its buffer already */
+		if(!decoder->private_->pull_direct) {
+			uint32_t channel;
+			for(channel = 0; channel < frame->header.channels; channel++)
+				decoder->private_->pull_pending[channel] = buffer[channel];
+			decoder->private_->pull_pending_samples = frame->header.blocksize;
+			decoder->private_->pull_pending_channels = frame->header.channels;
+		}
+		return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+	}
+	if(0 != decoder->private_->local_pcm_interleave) {
+		const size_t bytes = (size_t)frame->header.blocksize * frame->header.channels * interleaved_sample_bytes_[decoder->protected_->interleaved_format];
+		if(bytes > decoder->private_->interleaved_capacity) {
+			void *tmp = FLAC__memory_realloc(&decoder->private_->allocator, decoder->private_->interleaved, bytes);
+			if(0 == tmp) {
+				decoder->protected_->state = FLAC__STREAM_DECODER_MEMORY_ALLOCATION_ERROR;
+				return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+			}
+			decoder->private_->interleaved = tmp;
+			decoder->private_->interleaved_capacity = bytes;
+		}
+		decoder->private_->local_pcm_interleave(buffer, frame->header.channels, frame->header.blocksize, frame->header.bits_per_sample, decoder->private_->interleaved);
+	}
+	FLAC__STATISTICS_TIME(&decoder->private_->statistics, FLAC__STREAM_DECODER_STAGE_WRITE_CALLBACK,
+		status = decoder->private_->write_callback(decoder, frame, buffer, decoder->private_->client_data));
+	return status;
+}
+
 FLAC__StreamDecoderWriteStatus write_audio_frame_to_client_(FLAC__StreamDecoder *decoder, const FLAC__Frame *frame, const FLAC__int32 * const buffer[])
 {
 	if(decoder->private_->is_seeking) {
@@ -2940,6 +3944,7 @@ FLAC__StreamDecoderWriteStatus write_audio_frame_to_client_(FLAC__StreamDecoder
 
 		FLAC__ASSERT(frame->header.number_type == FLAC__FRAME_NUMBER_TYPE_SAMPLE_NUMBER);
 
+		decoder->private_->seek_stats.frames_decoded++;
 #if FLAC__HAS_OGG
 		decoder->private_->got_a_frame = true;
 #endif
@@ -2957,11 +3962,11 @@ FLAC__StreamDecoderWriteStatus write_audio_frame_to_client_(FLAC__StreamDecoder
 				decoder->private_->last_frame.header.blocksize -= delta;
 				decoder->private_->last_frame.header.number.sample_number += (FLAC__uint64)delta;
 				/* write the relevant samples */
-				return decoder->private_->write_callback(decoder, &decoder->private_->last_frame, newbuffer, decoder->private_->client_data);
+				return write_to_client_(decoder, &decoder->private_->last_frame, newbuffer);
 			}
 			else {
 				/* write the relevant samples */
-				return decoder->private_->write_callback(decoder, frame, buffer, decoder->private_->client_data);
+				return write_to_client_(decoder, frame, buffer);
 			}
 		}
 		else {
@@ -2976,13 +3981,26 @@ FLAC__StreamDecoderWriteStatus write_audio_frame_to_client_(FLAC__StreamDecoder
 		if(!decoder->private_->has_stream_info)
 			decoder->private_->do_md5_checking = false;
 		if(decoder->private_->do_md5_checking) {
-			if(!FLAC__MD5Accumulate(&decoder->private_->md5context, buffer, frame->header.channels, frame->header.blocksize, (frame->header.bits_per_sample+7) / 8))
+			FLAC__bool ok;
+			FLAC__STATISTICS_TIME(&decoder->private_->statistics, FLAC__STREAM_DECODER_STAGE_MD5,
+				ok = accumulate_md5_(decoder, frame, buffer));
+			if(!ok)
 				return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
 		}
-		return decoder->private_->write_callback(decoder, frame, buffer, decoder->private_->client_data);
+		return write_to_client_(decoder, frame, buffer);
 	}
 }
 
+FLAC__bool accumulate_md5_(FLAC__StreamDecoder *decoder, const FLAC__Frame *frame, const FLAC__int32 * const buffer[])
+{
+	const uint32_t bytes_per_sample = (frame->header.bits_per_sample+7) / 8;
+#ifdef HAVE_PTHREAD
+	if(0 != decoder->private_->md5_worker)
+		return FLAC__MD5WorkerAccumulate(decoder->private_->md5_worker, buffer, frame->header.channels, frame->header.blocksize, bytes_per_sample);
+#endif
+	return FLAC__MD5Accumulate(&decoder->private_->md5context, buffer, frame->header.channels, frame->header.blocksize, bytes_per_sample);
+}
+
 void send_error_to_client_(const FLAC__StreamDecoder *decoder, FLAC__StreamDecoderErrorStatus status)
 {
 	if(!decoder->private_->is_seeking)
@@ -2991,6 +4009,85 @@ void send_error_to_client_(const FLAC__StreamDecoder *decoder, FLAC__StreamDecod
 		decoder->private_->unparseable_frame_count++;
 }
 
+FLAC__bool seek_to_first_frame_(FLAC__StreamDecoder *decoder)
+{
+	if(decoder->private_->seek_callback(decoder, decoder->private_->first_frame_offset, decoder->private_->client_data) != FLAC__STREAM_DECODER_SEEK_STATUS_OK) {
+		decoder->protected_->state = FLAC__STREAM_DECODER_SEEK_ERROR;
+		return false;
+	}
+	return FLAC__stream_decoder_flush(decoder); /* this sets the state for us on failure */
+}
+
+void learn_seek_point_(FLAC__StreamDecoder *decoder, FLAC__uint64 sample, FLAC__uint64 offset)
+{
+	FLAC__StreamMetadata_SeekPoint *point;
+	uint32_t i;
+
+	for(i = 0; i < decoder->private_->num_learned_seek_points; i++) {
+		if(decoder->private_->learned_seek_points[i].sample_number == sample)
+			return;
+	}
+	/* once the ring is full the oldest boundary makes way */
+	point = &decoder->private_->learned_seek_points[decoder->private_->next_learned_seek_point];
+	point->sample_number = sample;
+	point->stream_offset = offset;
+	point->frame_samples = 0;
+	decoder->private_->next_learned_seek_point = (decoder->private_->next_learned_seek_point + 1) % LEARNED_SEEK_POINTS_;
+	if(decoder->private_->num_learned_seek_points < LEARNED_SEEK_POINTS_)
+		decoder->private_->num_learned_seek_points++;
+}
+
+FLAC__bool seekpoint_holds_(const FLAC__StreamMetadata_SeekPoint *point, FLAC__uint64 sample)
+{
+	return
+		point->sample_number != FLAC__STREAM_METADATA_SEEKPOINT_PLACEHOLDER &&
+		point->sample_number <= sample &&
+		sample - point->sample_number < point->frame_samples;
+}
+
+FLAC__bool seek_to_indexed_frame_(FLAC__StreamDecoder *decoder, const FLAC__StreamMetadata_SeekTable *index, FLAC__uint64 target_sample)
+{
+	const FLAC__StreamMetadata_SeekPoint *point = 0;
+
+	if(0 == index || 0 == index->num_points)
+		return false;
+
+	/* with a point for every frame of a fixed-blocksize stream, the point number follows from the sample number */
+	if(index->points[0].sample_number == 0 && index->points[0].frame_samples > 0) {
+		const FLAC__uint64 guess = target_sample / index->points[0].frame_samples;
+		if(guess < index->num_points)
+			point = &index->points[guess];
+	}
+	if(0 == point || !seekpoint_holds_(point, target_sample)) {
+		/* the points are in ascending order with placeholders last, so find the last one at or before the target */
+		uint32_t lo = 0, hi = index->num_points;
+		while(hi - lo > 1) {
+			const uint32_t mid = lo + (hi - lo) / 2;
+			if(index->points[mid].sample_number <= target_sample)
+				lo = mid;
+			else
+				hi = mid;
+		}
+		point = &index->points[lo];
+		if(!seekpoint_holds_(point, target_sample))
+			return false;
+	}
+
+	decoder->private_->seek_stats.iterations++;
+	decoder->private_->seek_stats.seek_callbacks++;
+	if(decoder->private_->seek_callback(decoder, decoder->private_->first_frame_offset + point->stream_offset, decoder->private_->client_data) != FLAC__STREAM_DECODER_SEEK_STATUS_OK)
+		return false;
+	if(!FLAC__stream_decoder_flush(decoder))
+		return false;
+	decoder->private_->unparseable_frame_count = 0;
+	if(!FLAC__stream_decoder_process_single(decoder) || decoder->protected_->state == FLAC__STREAM_DECODER_ABORTED) {
+		decoder->protected_->state = FLAC__STREAM_DECODER_SEEK_ERROR;
+		return false;
+	}
+	/* our write callback clears is_seeking when it gets to the target frame */
+	return !decoder->private_->is_seeking;
+}
+
 FLAC__bool seek_to_absolute_sample_(FLAC__StreamDecoder *decoder, FLAC__uint64 stream_length, FLAC__uint64 target_sample)
 {
 	FLAC__uint64 first_frame_offset = decoder->private_->first_frame_offset, lower_bound, upper_bound, lower_bound_sample, upper_bound_sample, this_frame_sample;
@@ -3008,6 +4105,22 @@ FLAC__bool seek_to_absolute_sample_(FLAC__StreamDecoder *decoder, FLAC__uint64 s
 	uint32_t bps = FLAC__stream_decoder_get_bits_per_sample(decoder);
 	const FLAC__StreamMetadata_SeekTable *seek_table = decoder->private_->has_seek_table? &decoder->private_->seek_table.data.seek_table : 0;
 
+	/*
+	 * If the frame index or the SEEKTABLE has a point for the very frame
+	 * holding the target, go straight there.  If that does not land on
+	 * the target we fall back to the search below, which does its own
+	 * seeking.
+	 */
+	decoder->private_->target_sample = target_sample;
+	if(0 != decoder->private_->frame_index && seek_to_indexed_frame_(decoder, &decoder->private_->frame_index->data.seek_table, target_sample))
+		return true;
+	if(decoder->protected_->state == FLAC__STREAM_DECODER_SEEK_ERROR)
+		return false;
+	if(seek_to_indexed_frame_(decoder, seek_table, target_sample))
+		return true;
+	if(decoder->protected_->state == FLAC__STREAM_DECODER_SEEK_ERROR)
+		return false;
+
 	/* use values from stream info if we didn't decode a frame */
 	if(channels == 0)
 		channels = decoder->private_->stream_info.data.stream_info.channels;
@@ -3093,6 +4206,28 @@ FLAC__bool seek_to_absolute_sample_(FLAC__StreamDecoder *decoder, FLAC__uint64 s
 		}
 	}
 
+	/*
+	 * Narrow the bounds further with the frame boundaries found by
+	 * earlier seeks.  They work like seek points, and when the client
+	 * keeps seeking around the same spot they are usually much closer
+	 * to the target than anything in the seek table.
+	 */
+	for(i = 0; i < (int)decoder->private_->num_learned_seek_points; i++) {
+		const FLAC__StreamMetadata_SeekPoint *point = &decoder->private_->learned_seek_points[i];
+		if(point->stream_offset < lower_bound || point->stream_offset > upper_bound)
+			continue;
+		if(point->sample_number <= target_sample) {
+			if(point->sample_number >= lower_bound_sample) {
+				lower_bound = point->stream_offset;
+				lower_bound_sample = point->sample_number;
+			}
+		}
+		else if(point->sample_number < upper_bound_sample) {
+			upper_bound = point->stream_offset;
+			upper_bound_sample = point->sample_number;
+		}
+	}
+
 	FLAC__ASSERT(upper_bound_sample >= lower_bound_sample);
 	/* there are 2 insidious ways that the following equality occurs, which
 	 * we need to fix:
@@ -3126,6 +4261,8 @@ FLAC__bool seek_to_absolute_sample_(FLAC__StreamDecoder *decoder, FLAC__uint64 s
 			pos = (FLAC__int64)upper_bound - 1;
 		if(pos < (FLAC__int64)lower_bound)
 			pos = (FLAC__int64)lower_bound;
+		decoder->private_->seek_stats.iterations++;
+		decoder->private_->seek_stats.seek_callbacks++;
 		if(decoder->private_->seek_callback(decoder, (FLAC__uint64)pos, decoder->private_->client_data) != FLAC__STREAM_DECODER_SEEK_STATUS_OK) {
 			decoder->protected_->state = FLAC__STREAM_DECODER_SEEK_ERROR;
 			return false;
@@ -3153,8 +4290,13 @@ FLAC__bool seek_to_absolute_sample_(FLAC__StreamDecoder *decoder, FLAC__uint64 s
 		if(decoder->protected_->state != FLAC__SEEKABLE_STREAM_DECODER_SEEKING && decoder->protected_->state != FLAC__STREAM_DECODER_END_OF_STREAM)
 			break;
 #endif
-		if(!decoder->private_->is_seeking)
+		if(!decoder->private_->is_seeking) {
+			FLAC__uint64 position;
+			/* the frame after the target is a good place to start the next seek from */
+			if(FLAC__stream_decoder_get_decode_position(decoder, &position))
+				learn_seek_point_(decoder, decoder->private_->last_frame.header.number.sample_number + decoder->private_->last_frame.header.blocksize, position);
 			break;
+		}
 
 		FLAC__ASSERT(decoder->private_->last_frame.header.number_type == FLAC__FRAME_NUMBER_TYPE_SAMPLE_NUMBER);
 		this_frame_sample = decoder->private_->last_frame.header.number.sample_number;
@@ -3186,6 +4328,7 @@ FLAC__bool seek_to_absolute_sample_(FLAC__StreamDecoder *decoder, FLAC__uint64 s
 				decoder->protected_->state = FLAC__STREAM_DECODER_SEEK_ERROR;
 				return false;
 			}
+			learn_seek_point_(decoder, upper_bound_sample, upper_bound);
 			approx_bytes_per_frame = (uint32_t)(2 * (upper_bound - pos) / 3 + 16);
 		}
 		else { /* target_sample >= this_frame_sample + this frame's blocksize */
@@ -3194,6 +4337,7 @@ FLAC__bool seek_to_absolute_sample_(FLAC__StreamDecoder *decoder, FLAC__uint64 s
 				decoder->protected_->state = FLAC__STREAM_DECODER_SEEK_ERROR;
 				return false;
 			}
+			learn_seek_point_(decoder, lower_bound_sample, lower_bound);
 			approx_bytes_per_frame = (uint32_t)(2 * (lower_bound - pos) / 3 + 16);
 		}
 	}
@@ -3233,6 +4377,7 @@ FLAC__bool seek_to_absolute_sample_ogg_(FLAC__StreamDecoder *decoder, FLAC__uint
 
 	decoder->private_->target_sample = target_sample;
 	for( ; ; iteration++) {
+		decoder->private_->seek_stats.iterations++;
 		if (iteration == 0 || this_frame_sample > target_sample || target_sample - this_frame_sample > LINEAR_SEARCH_WITHIN_SAMPLES) {
 			if (iteration >= BINARY_SEARCH_AFTER_ITERATION) {
 				pos = (right_pos + left_pos) / 2;
@@ -3255,6 +4400,7 @@ FLAC__bool seek_to_absolute_sample_ogg_(FLAC__StreamDecoder *decoder, FLAC__uint
 			}
 
 			/* physical seek */
+			decoder->private_->seek_stats.seek_callbacks++;
 			if(decoder->private_->seek_callback((FLAC__StreamDecoder*)decoder, (FLAC__uint64)pos, decoder->private_->client_data) != FLAC__STREAM_DECODER_SEEK_STATUS_OK) {
 				decoder->protected_->state = FLAC__STREAM_DECODER_SEEK_ERROR;
 				return false;
@@ -3400,7 +4546,522 @@ FLAC__bool file_eof_callback_(const FLAC__StreamDecoder *decoder, void *client_d
 	return feof(decoder->private_->file)? true : false;
 }
 
+/* only used by FLAC__stream_decoder_process_parallel(); regular decoding goes through borrow_callback_() */
+FLAC__StreamDecoderReadStatus memory_read_callback_(const FLAC__StreamDecoder *decoder, FLAC__byte buffer[], size_t *bytes, void *client_data)
+{
+	const size_t remaining = decoder->private_->memory_length - decoder->private_->memory_position;
+	(void)client_data;
+
+	if(*bytes > 0) {
+		if(*bytes > remaining)
+			*bytes = remaining;
+		if(*bytes == 0)
+			return FLAC__STREAM_DECODER_READ_STATUS_END_OF_STREAM;
+		memcpy(buffer, decoder->private_->memory_data + decoder->private_->memory_position, *bytes);
+		decoder->private_->memory_position += *bytes;
+		return FLAC__STREAM_DECODER_READ_STATUS_CONTINUE;
+	}
+	else
+		return FLAC__STREAM_DECODER_READ_STATUS_ABORT; /* abort to avoid a deadlock */
+}
+
+FLAC__StreamDecoderSeekStatus memory_seek_callback_(const FLAC__StreamDecoder *decoder, FLAC__uint64 absolute_byte_offset, void *client_data)
+{
+	(void)client_data;
+
+	if(absolute_byte_offset > decoder->private_->memory_length)
+		return FLAC__STREAM_DECODER_SEEK_STATUS_ERROR;
+	decoder->private_->memory_position = (size_t)absolute_byte_offset;
+	return FLAC__STREAM_DECODER_SEEK_STATUS_OK;
+}
+
+FLAC__StreamDecoderTellStatus memory_tell_callback_(const FLAC__StreamDecoder *decoder, FLAC__uint64 *absolute_byte_offset, void *client_data)
+{
+	(void)client_data;
+
+	*absolute_byte_offset = decoder->private_->memory_position;
+	return FLAC__STREAM_DECODER_TELL_STATUS_OK;
+}
+
+FLAC__StreamDecoderLengthStatus memory_length_callback_(const FLAC__StreamDecoder *decoder, FLAC__uint64 *stream_length, void *client_data)
+{
+	(void)client_data;
+
+	*stream_length = decoder->private_->memory_length;
+	return FLAC__STREAM_DECODER_LENGTH_STATUS_OK;
+}
+
+FLAC__bool memory_eof_callback_(const FLAC__StreamDecoder *decoder, void *client_data)
+{
+	(void)client_data;
+
+	return decoder->private_->memory_position >= decoder->private_->memory_length;
+}
+
 FLAC_API const void *FLAC__get_decoder_client_data(FLAC__StreamDecoder *decoder)
 {
 	return decoder->private_->client_data;
 }
+
+#ifdef HAVE_PTHREAD
+/*
+ * Parallel decoding works in batches: up to num_threads chunks of the
+ * input are read into one buffer and each chunk is decoded by its own
+ * worker decoder.  The first chunk of a batch always starts on a frame
+ * boundary; the others start at a seek point when the SEEKTABLE has one
+ * nearby, or else rely on the usual frame sync search.  Each worker
+ * decodes until it has passed the start of the next chunk, so the
+ * frames of neighboring chunks overlap and are stitched together by
+ * sample number.  Whatever cannot be stitched (a chunk that failed to
+ * sync or a frame with errors) is left for the next batch, which
+ * starts right after the last frame handed to the client; if even the
+ * first frame of a batch is not clean, the rest of the stream is
+ * decoded serially so that errors are reported exactly as by
+ * FLAC__stream_decoder_process_until_end_of_stream().
+ */
+FLAC__bool process_parallel_(FLAC__StreamDecoder *decoder, uint32_t num_threads)
+{
+	const FLAC__StreamMetadata_StreamInfo *stream_info = &decoder->private_->stream_info.data.stream_info;
+	FLAC__StreamDecoderParallelWorker *workers;
+	FLAC__StreamDecoderSeekStatus seek_status;
+	FLAC__byte *data;
+	FLAC__uint64 base, next_sample = 0;
+	size_t chunk_size, overlap, capacity, data_len = 0, accepted_end;
+	uint32_t k, num_chunks = 0, num_accepted, seek_point;
+	FLAC__bool have_next_sample = false, eof = false, ok = true, fall_back = false;
+
+	if(!FLAC__stream_decoder_get_decode_position(decoder, &base))
+		return FLAC__stream_decoder_process_until_end_of_stream(decoder);
+
+	/* enough overlap for the last frame of a chunk to be decoded whole */
+	if(stream_info->max_framesize > 0)
+		overlap = stream_info->max_framesize;
+	else
+		overlap = (size_t)stream_info->max_blocksize * stream_info->channels * (stream_info->bits_per_sample + 1) / 8 + 64;
+	chunk_size = flac_max(PARALLEL_CHUNK_SIZE_, 2 * overlap);
+	capacity = num_threads * chunk_size + overlap;
+
+	/* drop what the bitreader has buffered so the input can be read in bulk */
+	seek_status = decoder->private_->seek_callback(decoder, base, decoder->private_->client_data);
+	if(seek_status == FLAC__STREAM_DECODER_SEEK_STATUS_UNSUPPORTED)
+		return FLAC__stream_decoder_process_until_end_of_stream(decoder);
+	if(seek_status != FLAC__STREAM_DECODER_SEEK_STATUS_OK) {
+		decoder->protected_->state = FLAC__STREAM_DECODER_SEEK_ERROR;
+		return false;
+	}
+	if(!FLAC__bitreader_clear(decoder->private_->input)) {
+		decoder->protected_->state = FLAC__STREAM_DECODER_MEMORY_ALLOCATION_ERROR;
+		return false;
+	}
+
+	if(0 == (data = FLAC__memory_malloc(&decoder->private_->allocator, capacity))) {
+		decoder->protected_->state = FLAC__STREAM_DECODER_MEMORY_ALLOCATION_ERROR;
+		return false;
+	}
+	if(0 == (workers = FLAC__memory_calloc(&decoder->private_->allocator, num_threads, sizeof(FLAC__StreamDecoderParallelWorker)))) {
+		FLAC__memory_free(&decoder->private_->allocator, data);
+		decoder->protected_->state = FLAC__STREAM_DECODER_MEMORY_ALLOCATION_ERROR;
+		return false;
+	}
+	for(k = 0; k < num_threads; k++) {
+		if(!init_parallel_worker_(decoder, &workers[k])) {
+			decoder->protected_->state = FLAC__STREAM_DECODER_MEMORY_ALLOCATION_ERROR;
+			ok = false;
+			num_threads = k + 1;
+			break;
+		}
+	}
+
+	while(ok) {
+		/* top up the buffer */
+		while(data_len < capacity && !eof) {
+			size_t bytes = capacity - data_len;
+			const FLAC__StreamDecoderReadStatus status = decoder->private_->read_callback(decoder, data + data_len, &bytes, decoder->private_->client_data);
+			if(status == FLAC__STREAM_DECODER_READ_STATUS_ABORT) {
+				decoder->protected_->state = FLAC__STREAM_DECODER_ABORTED;
+				ok = false;
+				break;
+			}
+			data_len += bytes;
+			if(
+				status == FLAC__STREAM_DECODER_READ_STATUS_END_OF_STREAM ||
+				(bytes == 0 && (0 == decoder->private_->eof_callback || decoder->private_->eof_callback(decoder, decoder->private_->client_data)))
+			)
+				eof = true;
+		}
+		if(!ok)
+			break;
+		if(data_len == 0) {
+			decoder->protected_->state = FLAC__STREAM_DECODER_END_OF_STREAM;
+			break;
+		}
+
+		/* split it into chunks, moving the boundaries up to a seek point where there is one nearby */
+		{
+			const size_t end = eof? data_len : num_threads * chunk_size;
+			size_t start = 0;
+			seek_point = 0;
+			for(num_chunks = 0; num_chunks < num_threads && start < end; num_chunks++) {
+				size_t stop = (num_chunks + 1) * chunk_size;
+				if(stop >= end)
+					stop = end;
+				else if(decoder->private_->has_seek_table) {
+					const FLAC__StreamMetadata_SeekTable *seek_table = &decoder->private_->seek_table.data.seek_table;
+					for( ; seek_point < seek_table->num_points; seek_point++) {
+						const FLAC__uint64 offset = decoder->private_->first_frame_offset + seek_table->points[seek_point].stream_offset;
+						if(seek_table->points[seek_point].sample_number == FLAC__STREAM_METADATA_SEEKPOINT_PLACEHOLDER)
+							break;
+						if(offset >= base + stop) {
+							if(offset < base + stop + chunk_size / 2 && offset < base + end)
+								stop = (size_t)(offset - base);
+							break;
+						}
+					}
+				}
+				workers[num_chunks].data = data;
+				workers[num_chunks].data_len = data_len;
+				workers[num_chunks].start = start;
+				workers[num_chunks].stop = stop;
+				start = stop;
+			}
+		}
+
+		/* decode them */
+		for(k = 0; k < num_chunks; k++) {
+			workers[k].decoder->private_->fixed_block_size = decoder->private_->fixed_block_size;
+			workers[k].running = k > 0 && pthread_create(&workers[k].thread, 0, process_parallel_thread_, &workers[k]) == 0;
+			if(k > 0 && !workers[k].running)
+				process_parallel_thread_(&workers[k]);
+		}
+		process_parallel_thread_(&workers[0]);
+		for(k = 1; k < num_chunks; k++) {
+			if(workers[k].running)
+				pthread_join(workers[k].thread, 0);
+			workers[k].running = false;
+		}
+		for(k = 0; k < num_chunks; k++)
+			ok = ok && workers[k].ok;
+		if(!ok) {
+			decoder->protected_->state = FLAC__STREAM_DECODER_MEMORY_ALLOCATION_ERROR;
+			break;
+		}
+
+		/* stitch the frames together */
+		accepted_end = 0;
+		for(num_accepted = 0; num_accepted < num_chunks; num_accepted++) {
+			FLAC__StreamDecoderParallelWorker *worker = &workers[num_accepted];
+			uint32_t i = 0;
+			if(num_accepted > 0) {
+				/* skip whatever was found while syncing up to the frame following the previous chunk */
+				while(i < worker->num_frames && (worker->frames[i].bad || worker->frames[i].end_offset <= accepted_end || worker->frames[i].frame.header.number.sample_number != next_sample))
+					i++;
+				if(i < worker->num_frames)
+					worker->frames[i].error_before = false;
+			}
+			worker->first_accepted = i;
+			for( ; i < worker->num_frames; i++) {
+				const FLAC__StreamDecoderParallelFrame *frame = &worker->frames[i];
+				if(frame->bad || frame->error_before || (have_next_sample && frame->frame.header.number.sample_number != next_sample))
+					break;
+				next_sample = frame->frame.header.number.sample_number + frame->frame.header.blocksize;
+				have_next_sample = true;
+				accepted_end = frame->end_offset;
+			}
+			worker->last_accepted = i;
+			if(i == worker->first_accepted || i < worker->num_frames) {
+				if(i > worker->first_accepted)
+					num_accepted++;
+				break;
+			}
+		}
+		if(decoder->private_->fixed_block_size == 0)
+			decoder->private_->fixed_block_size = workers[0].decoder->private_->fixed_block_size;
+
+		/* hand them to the client, computing the MD5 sum on another thread in the meantime */
+		{
+			FLAC__StreamDecoderParallelMD5 md5;
+			pthread_t md5_thread;
+			FLAC__bool md5_running = false;
+
+			md5.decoder = decoder;
+			md5.workers = workers;
+			md5.num_workers = num_accepted;
+			md5.ok = true;
+#ifdef FLAC__ENABLE_STATISTICS
+			memset(&md5.statistics, 0, sizeof(md5.statistics));
+#endif
+			if(decoder->private_->do_md5_checking)
+				md5_running = pthread_create(&md5_thread, 0, process_parallel_md5_thread_, &md5) == 0;
+
+			for(k = 0; k < num_accepted && ok; k++) {
+				const FLAC__StreamDecoderParallelWorker *worker = &workers[k];
+				uint32_t i, channel;
+				for(i = worker->first_accepted; i < worker->last_accepted; i++) {
+					const FLAC__StreamDecoderParallelFrame *frame = &worker->frames[i];
+					const FLAC__int32 *buffer[FLAC__MAX_CHANNELS];
+					for(channel = 0; channel < frame->frame.header.channels; channel++)
+						buffer[channel] = worker->pcm[channel] + frame->pcm_offset;
+					decoder->protected_->channels = frame->frame.header.channels;
+					decoder->protected_->channel_assignment = frame->frame.header.channel_assignment;
+					decoder->protected_->bits_per_sample = frame->frame.header.bits_per_sample;
+					decoder->protected_->sample_rate = frame->frame.header.sample_rate;
+					decoder->protected_->blocksize = frame->frame.header.blocksize;
+					decoder->private_->samples_decoded = frame->frame.header.number.sample_number + frame->frame.header.blocksize;
+					if(write_to_client_(decoder, &frame->frame, buffer) != FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE) {
+						decoder->protected_->state = FLAC__STREAM_DECODER_ABORTED;
+						ok = false;
+						break;
+					}
+				}
+			}
+
+			if(md5_running)
+				pthread_join(md5_thread, 0);
+			else if(decoder->private_->do_md5_checking && ok)
+				process_parallel_md5_thread_(&md5);
+#ifdef FLAC__ENABLE_STATISTICS
+			add_statistics_(&decoder->private_->statistics, &md5.statistics);
+#endif
+			if(!md5.ok) {
+				decoder->protected_->state = FLAC__STREAM_DECODER_MEMORY_ALLOCATION_ERROR;
+				ok = false;
+			}
+		}
+		if(!ok)
+			break;
+
+		if(accepted_end == 0) {
+			fall_back = true;
+			break;
+		}
+		if(eof && accepted_end == data_len) {
+			decoder->protected_->state = FLAC__STREAM_DECODER_END_OF_STREAM;
+			break;
+		}
+		/* the next batch starts right after the last frame handed out */
+		memmove(data, data + accepted_end, data_len - accepted_end);
+		data_len -= accepted_end;
+		base += accepted_end;
+	}
+
+#ifdef FLAC__ENABLE_STATISTICS
+	/* what the workers' write callback does is buffering for us, not the client's work */
+	for(k = 0; k < num_threads; k++) {
+		if(0 != workers[k].decoder) {
+			FLAC__StreamDecoderStatistics *statistics = &workers[k].decoder->private_->statistics;
+			statistics->nanoseconds[FLAC__STREAM_DECODER_STAGE_WRITE_CALLBACK] = statistics->calls[FLAC__STREAM_DECODER_STAGE_WRITE_CALLBACK] = 0;
+			add_statistics_(&decoder->private_->statistics, statistics);
+		}
+	}
+#endif
+	for(k = 0; k < num_threads; k++)
+		free_parallel_worker_(&workers[k]);
+	FLAC__memory_free(&decoder->private_->allocator, workers);
+	FLAC__memory_free(&decoder->private_->allocator, data);
+
+	if(fall_back) {
+		if(decoder->private_->seek_callback(decoder, base, decoder->private_->client_data) != FLAC__STREAM_DECODER_SEEK_STATUS_OK) {
+			decoder->protected_->state = FLAC__STREAM_DECODER_SEEK_ERROR;
+			return false;
+		}
+		decoder->private_->samples_decoded = next_sample;
+		decoder->protected_->state = FLAC__STREAM_DECODER_SEARCH_FOR_FRAME_SYNC;
+		return FLAC__stream_decoder_process_until_end_of_stream(decoder);
+	}
+	return ok;
+}
+
+FLAC__bool init_parallel_worker_(FLAC__StreamDecoder *decoder, FLAC__StreamDecoderParallelWorker *worker)
+{
+	worker->ok = true;
+	worker->allocator = &decoder->private_->allocator;
+	if(0 == (worker->decoder = FLAC__stream_decoder_new_with_allocator(&decoder->private_->allocator)))
+		return false;
+	if(FLAC__stream_decoder_init_stream(worker->decoder, parallel_read_callback_, /*seek_callback=*/0, parallel_tell_callback_, /*length_callback=*/0, parallel_eof_callback_, parallel_write_callback_, /*metadata_callback=*/0, parallel_error_callback_, worker) != FLAC__STREAM_DECODER_INIT_STATUS_OK)
+		return false;
+	/* the worker starts in the middle of the stream, so give it the STREAMINFO up front */
+	worker->decoder->private_->stream_info = decoder->private_->stream_info;
+	worker->decoder->private_->has_stream_info = true;
+	return true;
+}
+
+void free_parallel_worker_(FLAC__StreamDecoderParallelWorker *worker)
+{
+	uint32_t channel;
+
+	if(0 != worker->decoder)
+		FLAC__stream_decoder_delete(worker->decoder);
+	FLAC__memory_free(worker->allocator, worker->frames);
+	for(channel = 0; channel < FLAC__MAX_CHANNELS; channel++)
+		FLAC__memory_free(worker->allocator, worker->pcm[channel]);
+}
+
+void *process_parallel_thread_(void *arg)
+{
+	FLAC__StreamDecoderParallelWorker *worker = (FLAC__StreamDecoderParallelWorker *)arg;
+	FLAC__StreamDecoder *decoder = worker->decoder;
+
+	worker->position = worker->start;
+	worker->num_frames = 0;
+	worker->pcm_len = 0;
+	worker->reached_stop = false;
+	worker->error_pending = false;
+
+	if(!FLAC__stream_decoder_flush(decoder)) {
+		worker->ok = false;
+		return 0;
+	}
+	while(
+		worker->ok &&
+		!worker->reached_stop &&
+		decoder->protected_->state != FLAC__STREAM_DECODER_END_OF_STREAM &&
+		decoder->protected_->state != FLAC__STREAM_DECODER_ABORTED
+	) {
+		if(!FLAC__stream_decoder_process_single(decoder))
+			break;
+	}
+	return 0;
+}
+
+void *process_parallel_md5_thread_(void *arg)
+{
+	FLAC__StreamDecoderParallelMD5 *md5 = (FLAC__StreamDecoderParallelMD5 *)arg;
+	uint32_t k, i, channel;
+
+	for(k = 0; k < md5->num_workers; k++) {
+		const FLAC__StreamDecoderParallelWorker *worker = &md5->workers[k];
+		for(i = worker->first_accepted; i < worker->last_accepted; i++) {
+			const FLAC__StreamDecoderParallelFrame *frame = &worker->frames[i];
+			const FLAC__int32 *buffer[FLAC__MAX_CHANNELS];
+			for(channel = 0; channel < frame->frame.header.channels; channel++)
+				buffer[channel] = worker->pcm[channel] + frame->pcm_offset;
+			FLAC__STATISTICS_TIME(&md5->statistics, FLAC__STREAM_DECODER_STAGE_MD5,
+				md5->ok = accumulate_md5_(md5->decoder, &frame->frame, buffer));
+			if(!md5->ok)
+				return 0;
+		}
+	}
+	return 0;
+}
+
+FLAC__StreamDecoderReadStatus parallel_read_callback_(const FLAC__StreamDecoder *decoder, FLAC__byte buffer[], size_t *bytes, void *client_data)
+{
+	FLAC__StreamDecoderParallelWorker *worker = (FLAC__StreamDecoderParallelWorker *)client_data;
+	(void)decoder;
+
+	if(worker->position >= worker->data_len) {
+		*bytes = 0;
+		return FLAC__STREAM_DECODER_READ_STATUS_END_OF_STREAM;
+	}
+	if(*bytes > worker->data_len - worker->position)
+		*bytes = worker->data_len - worker->position;
+	memcpy(buffer, worker->data + worker->position, *bytes);
+	worker->position += *bytes;
+	return FLAC__STREAM_DECODER_READ_STATUS_CONTINUE;
+}
+
+FLAC__StreamDecoderTellStatus parallel_tell_callback_(const FLAC__StreamDecoder *decoder, FLAC__uint64 *absolute_byte_offset, void *client_data)
+{
+	(void)decoder;
+	*absolute_byte_offset = ((FLAC__StreamDecoderParallelWorker *)client_data)->position;
+	return FLAC__STREAM_DECODER_TELL_STATUS_OK;
+}
+
+FLAC__bool parallel_eof_callback_(const FLAC__StreamDecoder *decoder, void *client_data)
+{
+	const FLAC__StreamDecoderParallelWorker *worker = (const FLAC__StreamDecoderParallelWorker *)client_data;
+	(void)decoder;
+	return worker->position >= worker->data_len;
+}
+
+FLAC__StreamDecoderWriteStatus parallel_write_callback_(const FLAC__StreamDecoder *decoder, const FLAC__Frame *frame, const FLAC__int32 * const buffer[], void *client_data)
+{
+	FLAC__StreamDecoderParallelWorker *worker = (FLAC__StreamDecoderParallelWorker *)client_data;
+	FLAC__StreamDecoderParallelFrame *f;
+	FLAC__uint64 end_offset;
+	uint32_t channel;
+
+	if(worker->num_frames == worker->frames_capacity) {
+		const uint32_t new_capacity = worker->frames_capacity? worker->frames_capacity * 2 : 64;
+		if(0 == (worker->frames = FLAC__memory_realloc_mul_2op(worker->allocator, worker->frames, new_capacity, sizeof(FLAC__StreamDecoderParallelFrame)))) {
+			worker->ok = false;
+			return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+		}
+		worker->frames_capacity = new_capacity;
+	}
+	if(worker->pcm_len + frame->header.blocksize > worker->pcm_capacity || frame->header.channels > worker->pcm_channels) {
+		const size_t new_capacity = flac_max(worker->pcm_len + frame->header.blocksize, worker->pcm_capacity * 2);
+		const uint32_t new_channels = flac_max(frame->header.channels, worker->pcm_channels);
+		for(channel = 0; channel < new_channels; channel++) {
+			if(0 == (worker->pcm[channel] = FLAC__memory_realloc_mul_2op(worker->allocator, worker->pcm[channel], new_capacity, sizeof(FLAC__int32)))) {
+				worker->ok = false;
+				return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+			}
+		}
+		worker->pcm_capacity = new_capacity;
+		worker->pcm_channels = new_channels;
+	}
+
+	if(!FLAC__stream_decoder_get_decode_position(decoder, &end_offset)) {
+		worker->ok = false;
+		return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+	}
+
+	f = &worker->frames[worker->num_frames++];
+	f->frame = *frame;
+	for(channel = 0; channel < frame->header.channels; channel++) {
+		FLAC__Subframe *subframe = &f->frame.subframes[channel];
+		if(subframe->type == FLAC__SUBFRAME_TYPE_FIXED) {
+			subframe->data.fixed.residual = 0;
+			subframe->data.fixed.entropy_coding_method.data.partitioned_rice.contents = 0;
+		}
+		else if(subframe->type == FLAC__SUBFRAME_TYPE_LPC) {
+			subframe->data.lpc.residual = 0;
+			subframe->data.lpc.entropy_coding_method.data.partitioned_rice.contents = 0;
+		}
+		else if(subframe->type == FLAC__SUBFRAME_TYPE_VERBATIM)
+			subframe->data.verbatim.data = 0;
+		memcpy(worker->pcm[channel] + worker->pcm_len, buffer[channel], sizeof(FLAC__int32) * frame->header.blocksize);
+	}
+	f->pcm_offset = worker->pcm_len;
+	f->end_offset = (size_t)end_offset;
+	f->bad = worker->error_pending && worker->last_error == FLAC__STREAM_DECODER_ERROR_STATUS_FRAME_CRC_MISMATCH;
+	f->error_before = worker->error_pending;
+	worker->pcm_len += frame->header.blocksize;
+	worker->error_pending = false;
+	if(f->end_offset >= worker->stop)
+		worker->reached_stop = true;
+
+	return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+}
+
+#ifdef FLAC__ENABLE_STATISTICS
+void add_statistics_(FLAC__StreamDecoderStatistics *total, const FLAC__StreamDecoderStatistics *part)
+{
+	uint32_t i;
+	for(i = 0; i < FLAC__STREAM_DECODER_STAGE_COUNT; i++) {
+		total->nanoseconds[i] += part->nanoseconds[i];
+		total->calls[i] += part->calls[i];
+	}
+	for(i = 0; i < sizeof(total->subframe_types) / sizeof(total->subframe_types[0]); i++)
+		total->subframe_types[i] += part->subframe_types[i];
+	for(i = 0; i <= FLAC__MAX_FIXED_ORDER; i++)
+		total->fixed_orders[i] += part->fixed_orders[i];
+	for(i = 0; i <= FLAC__MAX_LPC_ORDER; i++)
+		total->lpc_orders[i] += part->lpc_orders[i];
+	for(i = 0; i < sizeof(total->rice_parameters) / sizeof(total->rice_parameters[0]); i++)
+		total->rice_parameters[i] += part->rice_parameters[i];
+	total->escaped_partitions += part->escaped_partitions;
+	for(i = 0; i < sizeof(total->blocksizes) / sizeof(total->blocksizes[0]); i++)
+		total->blocksizes[i] += part->blocksizes[i];
+}
+#endif
+
+void parallel_error_callback_(const FLAC__StreamDecoder *decoder, FLAC__StreamDecoderErrorStatus status, void *client_data)
+{
+	FLAC__StreamDecoderParallelWorker *worker = (FLAC__StreamDecoderParallelWorker *)client_data;
+	(void)decoder;
+	worker->error_pending = true;
+	worker->last_error = status;
+}
+#endif
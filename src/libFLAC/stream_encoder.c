@@ -39,12 +39,16 @@
 #include <stdlib.h> /* for malloc() */
 #include <string.h> /* for memcpy() */
 #include <sys/types.h> /* for off_t */
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 #ifdef _WIN32
 #include <windows.h> /* for GetFileType() */
 #include <io.h> /* for _get_osfhandle() */
 #endif
 #include "share/compat.h"
 #include "FLAC/assert.h"
+#include "FLAC/metadata.h"
 #include "FLAC/stream_decoder.h"
 #include "protected/stream_encoder.h"
 #include "private/bitwriter.h"
@@ -57,6 +61,8 @@
 #include "private/md5.h"
 #include "private/memory.h"
 #include "private/macros.h"
+#include "private/pcm.h"
+#include "private/statistics.h"
 #if FLAC__HAS_OGG
 #include "private/ogg_helper.h"
 #include "private/ogg_mapping.h"
@@ -131,20 +137,55 @@ static const  struct CompressionLevels {
  *
  ***********************************************************************/
 
+struct FLAC__StreamEncoderThreadTask;
+struct FLAC__StreamEncoderSubframeScratch;
+
 static void set_defaults_(FLAC__StreamEncoder *encoder);
 static void free_(FLAC__StreamEncoder *encoder);
+static struct FLAC__StreamEncoderThreadTask *new_threadtask_(const FLAC__Allocator *allocator);
+static void free_threadtask_(struct FLAC__StreamEncoderThreadTask *threadtask);
+static void delete_threadtask_(struct FLAC__StreamEncoderThreadTask *threadtask);
+static void init_subframe_scratch_(struct FLAC__StreamEncoderSubframeScratch *scratch, const FLAC__Allocator *allocator);
+static void free_subframe_scratch_(struct FLAC__StreamEncoderSubframeScratch *scratch);
+static void clear_subframe_scratch_(struct FLAC__StreamEncoderSubframeScratch *scratch);
+static FLAC__bool resize_subframe_scratch_(FLAC__StreamEncoder *encoder, struct FLAC__StreamEncoderSubframeScratch *scratch, uint32_t new_blocksize);
 static FLAC__bool resize_buffers_(FLAC__StreamEncoder *encoder, uint32_t new_blocksize);
-static FLAC__bool write_bitbuffer_(FLAC__StreamEncoder *encoder, uint32_t samples, FLAC__bool is_last_block);
+static FLAC__bool write_bitbuffer_(FLAC__StreamEncoder *encoder, struct FLAC__StreamEncoderThreadTask *threadtask, uint32_t samples, FLAC__bool is_last_block);
+#ifdef FLAC__ENABLE_STATISTICS
+static void collect_statistics_(FLAC__StreamEncoderStatistics *total, FLAC__StreamEncoderStatistics *part);
+#endif
 static FLAC__StreamEncoderWriteStatus write_frame_(FLAC__StreamEncoder *encoder, const FLAC__byte buffer[], size_t bytes, uint32_t samples, FLAC__bool is_last_block);
 static void update_metadata_(const FLAC__StreamEncoder *encoder);
 #if FLAC__HAS_OGG
 static void update_ogg_metadata_(FLAC__StreamEncoder *encoder);
 #endif
+static FLAC__bool process_interleaved_pcm_(FLAC__StreamEncoder *encoder, FLAC__PCMDeinterleaveFunction deinterleave, const FLAC__byte *buffer, uint32_t sample_bytes, uint32_t samples);
 static FLAC__bool process_frame_(FLAC__StreamEncoder *encoder, FLAC__bool is_fractional_block, FLAC__bool is_last_block);
-static FLAC__bool process_subframes_(FLAC__StreamEncoder *encoder, FLAC__bool is_fractional_block);
+static FLAC__bool encode_frame_(FLAC__StreamEncoder *encoder, struct FLAC__StreamEncoderThreadTask *threadtask, FLAC__bool is_fractional_block);
+#ifdef HAVE_PTHREAD
+static FLAC__bool start_threads_(FLAC__StreamEncoder *encoder);
+static void stop_threads_(FLAC__StreamEncoder *encoder);
+static void *process_frame_thread_(void *arg);
+static void *process_subframes_thread_(void *arg);
+static void run_subframe_jobs_(FLAC__StreamEncoder *encoder, struct FLAC__StreamEncoderSubframeScratch *scratch);
+static FLAC__bool queue_frame_(FLAC__StreamEncoder *encoder);
+static FLAC__bool write_finished_frames_(FLAC__StreamEncoder *encoder, FLAC__bool wait_for_all);
+#endif
+static FLAC__bool process_subframes_(FLAC__StreamEncoder *encoder, struct FLAC__StreamEncoderThreadTask *threadtask, FLAC__bool is_fractional_block);
+static FLAC__bool process_subframe_job_(
+	FLAC__StreamEncoder *encoder,
+	struct FLAC__StreamEncoderThreadTask *threadtask,
+	struct FLAC__StreamEncoderSubframeScratch *scratch,
+	uint32_t min_partition_order,
+	uint32_t max_partition_order,
+	const FLAC__FrameHeader *frame_header,
+	uint32_t channel,
+	FLAC__bool is_mid_side
+);
 
 static FLAC__bool process_subframe_(
 	FLAC__StreamEncoder *encoder,
+	struct FLAC__StreamEncoderSubframeScratch *scratch,
 	uint32_t min_partition_order,
 	uint32_t max_partition_order,
 	const FLAC__FrameHeader *frame_header,
@@ -158,7 +199,6 @@ static FLAC__bool process_subframe_(
 );
 
 static FLAC__bool add_subframe_(
-	FLAC__StreamEncoder *encoder,
 	uint32_t blocksize,
 	uint32_t subframe_bps,
 	const FLAC__Subframe *subframe,
@@ -175,6 +215,7 @@ static uint32_t evaluate_constant_subframe_(
 
 static uint32_t evaluate_fixed_subframe_(
 	FLAC__StreamEncoder *encoder,
+	struct FLAC__StreamEncoderSubframeScratch *scratch,
 	const FLAC__int32 signal[],
 	FLAC__int32 residual[],
 	FLAC__uint64 abs_residual_partition_sums[],
@@ -195,6 +236,7 @@ static uint32_t evaluate_fixed_subframe_(
 #ifndef FLAC__INTEGER_ONLY_LIBRARY
 static uint32_t evaluate_lpc_subframe_(
 	FLAC__StreamEncoder *encoder,
+	struct FLAC__StreamEncoderSubframeScratch *scratch,
 	const FLAC__int32 signal[],
 	FLAC__int32 residual[],
 	FLAC__uint64 abs_residual_partition_sums[],
@@ -225,6 +267,7 @@ static uint32_t evaluate_verbatim_subframe_(
 
 static uint32_t find_best_partition_order_(
 	struct FLAC__StreamEncoderPrivate *private_,
+	struct FLAC__StreamEncoderSubframeScratch *scratch,
 	const FLAC__int32 residual[],
 	FLAC__uint64 abs_residual_partition_sums[],
 	uint32_t raw_bits_per_partition[],
@@ -273,6 +316,7 @@ static FLAC__bool set_partitioned_rice_(
 	const uint32_t partition_order,
 	const FLAC__bool search_for_escapes,
 	FLAC__EntropyCodingMethod_PartitionedRiceContents *partitioned_rice_contents,
+	const FLAC__Allocator *allocator,
 	uint32_t *bits
 );
 
@@ -304,6 +348,9 @@ static FLAC__StreamEncoderReadStatus file_read_callback_(const FLAC__StreamEncod
 static FLAC__StreamEncoderSeekStatus file_seek_callback_(const FLAC__StreamEncoder *encoder, FLAC__uint64 absolute_byte_offset, void *client_data);
 static FLAC__StreamEncoderTellStatus file_tell_callback_(const FLAC__StreamEncoder *encoder, FLAC__uint64 *absolute_byte_offset, void *client_data);
 static FLAC__StreamEncoderWriteStatus file_write_callback_(const FLAC__StreamEncoder *encoder, const FLAC__byte buffer[], size_t bytes, uint32_t samples, uint32_t current_frame, void *client_data);
+static FLAC__StreamEncoderSeekStatus memory_seek_callback_(const FLAC__StreamEncoder *encoder, FLAC__uint64 absolute_byte_offset, void *client_data);
+static FLAC__StreamEncoderTellStatus memory_tell_callback_(const FLAC__StreamEncoder *encoder, FLAC__uint64 *absolute_byte_offset, void *client_data);
+static FLAC__StreamEncoderWriteStatus memory_write_callback_(const FLAC__StreamEncoder *encoder, const FLAC__byte buffer[], size_t bytes, uint32_t samples, uint32_t current_frame, void *client_data);
 static FILE *get_binary_stdout_(void);
 
 
@@ -313,16 +360,44 @@ static FILE *get_binary_stdout_(void);
  *
  ***********************************************************************/
 
-typedef struct FLAC__StreamEncoderPrivate {
-	uint32_t input_capacity;                          /* current size (in samples) of the signal and residual buffers */
-	FLAC__int32 *integer_signal[FLAC__MAX_CHANNELS];  /* the integer version of the input signal */
-	FLAC__int32 *integer_signal_mid_side[2];          /* the integer version of the mid-side input signal (stereo only) */
+/* Scratch space for process_subframe_() and the functions it calls.  Each
+ * thread task has one; with parallel subframes every subframe searched at
+ * the same time needs one of its own.
+ */
+typedef struct FLAC__StreamEncoderSubframeScratch {
 #ifndef FLAC__INTEGER_ONLY_LIBRARY
-	FLAC__real *real_signal[FLAC__MAX_CHANNELS];      /* (@@@ currently unused) the floating-point version of the input signal */
-	FLAC__real *real_signal_mid_side[2];              /* (@@@ currently unused) the floating-point version of the mid-side input signal (stereo only) */
-	FLAC__real *window[FLAC__MAX_APODIZATION_FUNCTIONS]; /* the pre-computed floating-point window for each apodization function */
 	FLAC__real *windowed_signal;                      /* the integer_signal[] * current window[] */
 #endif
+	FLAC__uint64 *abs_residual_partition_sums;        /* workspace where the sum of abs(candidate residual) for each partition is stored */
+	uint32_t *raw_bits_per_partition;                 /* workspace where the sum of silog2(candidate residual) for each partition is stored */
+	/* unaligned (original) pointers to allocated data */
+#ifndef FLAC__INTEGER_ONLY_LIBRARY
+	FLAC__real *windowed_signal_unaligned;
+#endif
+	FLAC__uint64 *abs_residual_partition_sums_unaligned;
+	uint32_t *raw_bits_per_partition_unaligned;
+	/*
+	 * These fields have been moved here from private function local
+	 * declarations merely to save stack space during encoding.
+	 */
+#ifndef FLAC__INTEGER_ONLY_LIBRARY
+	FLAC__real lp_coeff[FLAC__MAX_LPC_ORDER][FLAC__MAX_LPC_ORDER]; /* from process_subframe_() */
+#endif
+	FLAC__EntropyCodingMethod_PartitionedRiceContents partitioned_rice_contents_extra[2]; /* from find_best_partition_order_() */
+#ifdef FLAC__ENABLE_STATISTICS
+	FLAC__StreamEncoderStatistics statistics;         /* stages timed while using this scratch space; moved into private_->statistics by write_bitbuffer_() */
+#endif
+	const FLAC__Allocator *allocator;                 /* the encoder's */
+} FLAC__StreamEncoderSubframeScratch;
+
+/* Everything needed to encode one frame.  threadtask[0] holds the input
+ * signal that the FLAC__stream_encoder_process*() calls fill in and is
+ * used for all encoding when running single-threaded; the other tasks
+ * get a copy of one block each and are handed to the worker threads.
+ */
+typedef struct FLAC__StreamEncoderThreadTask {
+	FLAC__int32 *integer_signal[FLAC__MAX_CHANNELS];  /* the integer version of the input signal */
+	FLAC__int32 *integer_signal_mid_side[2];          /* the integer version of the mid-side input signal (stereo only) */
 	uint32_t subframe_bps[FLAC__MAX_CHANNELS];        /* the effective bits per sample of the input signal (stream bps - wasted bits) */
 	uint32_t subframe_bps_mid_side[2];                /* the effective bits per sample of the mid-side input signal (stream bps - wasted bits + 0/1) */
 	FLAC__int32 *residual_workspace[FLAC__MAX_CHANNELS][2]; /* each channel has a candidate and best workspace where the subframe residual signals will be stored */
@@ -339,18 +414,57 @@ typedef struct FLAC__StreamEncoderPrivate {
 	uint32_t best_subframe_mid_side[2];
 	uint32_t best_subframe_bits[FLAC__MAX_CHANNELS];  /* size in bits of the best subframe for each channel */
 	uint32_t best_subframe_bits_mid_side[2];
-	FLAC__uint64 *abs_residual_partition_sums;        /* workspace where the sum of abs(candidate residual) for each partition is stored */
-	uint32_t *raw_bits_per_partition;                 /* workspace where the sum of silog2(candidate residual) for each partition is stored */
+	FLAC__StreamEncoderSubframeScratch scratch;
 	FLAC__BitWriter *frame;                           /* the current frame being worked on */
+	uint32_t frame_number;                            /* number of the frame in frame, written into its header */
+	FLAC__bool done;                                  /* set by the worker thread once frame is complete */
+	FLAC__bool returnvalue;                           /* false if the worker thread failed to encode the frame */
+	FLAC__StreamEncoderState error;                   /* why encoding the frame failed; the encoder state is only ever set by the main thread */
+	/* unaligned (original) pointers to allocated data */
+	FLAC__int32 *integer_signal_unaligned[FLAC__MAX_CHANNELS];
+	FLAC__int32 *integer_signal_mid_side_unaligned[2];
+	FLAC__int32 *residual_workspace_unaligned[FLAC__MAX_CHANNELS][2];
+	FLAC__int32 *residual_workspace_mid_side_unaligned[2][2];
+	const FLAC__Allocator *allocator;                 /* the encoder's */
+} FLAC__StreamEncoderThreadTask;
+
+/* threadtask[0] plus two blocks in flight per worker thread, so that
+ * the workers can keep going while the oldest frames are being written.
+ */
+#define FLAC__STREAM_ENCODER_MAX_THREADTASKS (2 * FLAC__STREAM_ENCODER_MAX_THREADS + 1)
+
+/* points one of the CPU-dependent function pointers at a routine and
+ * remembers which one for FLAC__stream_encoder_get_kernel()
+ */
+#define SET_KERNEL_(encoder, kernel, member, routine) \
+	((encoder)->private_->member = (routine), (encoder)->private_->kernel_name[FLAC__STREAM_ENCODER_KERNEL_##kernel] = #routine)
+
+typedef struct FLAC__StreamEncoderPrivate {
+	uint32_t input_capacity;                          /* current size (in samples) of the signal and residual buffers; every one of them that is allocated has this size */
+	FLAC__StreamEncoderThreadTask *threadtask[FLAC__STREAM_ENCODER_MAX_THREADTASKS];
+	uint32_t num_threadtasks;                         /* number of entries of threadtask[] in use */
+#ifndef FLAC__INTEGER_ONLY_LIBRARY
+	FLAC__real *real_signal[FLAC__MAX_CHANNELS];      /* (@@@ currently unused) the floating-point version of the input signal */
+	FLAC__real *real_signal_mid_side[2];              /* (@@@ currently unused) the floating-point version of the mid-side input signal (stereo only) */
+	const FLAC__real *window[FLAC__MAX_APODIZATION_FUNCTIONS]; /* the pre-computed floating-point window for each apodization function */
+#endif
 	uint32_t loose_mid_side_stereo_frames;            /* rounded number of frames the encoder will use before trying both independent and mid/side frames again */
 	uint32_t loose_mid_side_stereo_frame_count;       /* number of frames using the current channel assignment */
 	FLAC__ChannelAssignment last_channel_assignment;
 	FLAC__StreamMetadata streaminfo;                  /* scratchpad for STREAMINFO as it is built */
 	FLAC__StreamMetadata_SeekTable *seek_table;       /* pointer into encoder->protected_->metadata_ where the seek table is */
+	FLAC__StreamMetadata *frame_index;                 /* see FLAC__stream_encoder_set_frame_index(); owned by the client */
+	uint32_t frame_index_points;                       /* number of points of frame_index filled in; the rest is room to grow */
 	uint32_t current_sample_number;
 	uint32_t current_frame_number;
 	FLAC__MD5Context md5context;
+#ifdef HAVE_PTHREAD
+	FLAC__MD5Worker *md5_worker;                      /* hashes into md5context when threaded_md5 is set */
+#endif
 	FLAC__CPUInfo cpuinfo;
+#ifdef FLAC__ENABLE_STATISTICS
+	FLAC__StreamEncoderStatistics statistics;         /* see FLAC__stream_encoder_get_statistics() */
+#endif
 	void (*local_precompute_partition_info_sums)(const FLAC__int32 residual[], FLAC__uint64 abs_residual_partition_sums[], uint32_t residual_samples, uint32_t predictor_order, uint32_t min_partition_order, uint32_t max_partition_order, uint32_t bps);
 #ifndef FLAC__INTEGER_ONLY_LIBRARY
 	uint32_t (*local_fixed_compute_best_predictor)(const FLAC__int32 data[], uint32_t data_len, float residual_bits_per_sample[FLAC__MAX_FIXED_ORDER+1]);
@@ -365,6 +479,12 @@ typedef struct FLAC__StreamEncoderPrivate {
 	void (*local_lpc_compute_residual_from_qlp_coefficients_64bit)(const FLAC__int32 *data, uint32_t data_len, const FLAC__int32 qlp_coeff[], uint32_t order, int lp_quantization, FLAC__int32 residual[]);
 	void (*local_lpc_compute_residual_from_qlp_coefficients_16bit)(const FLAC__int32 *data, uint32_t data_len, const FLAC__int32 qlp_coeff[], uint32_t order, int lp_quantization, FLAC__int32 residual[]);
 #endif
+	FLAC__PCMDeinterleaveFunction local_pcm_deinterleave_int16;
+	FLAC__PCMDeinterleaveFunction local_pcm_deinterleave_int24;
+#ifndef FLAC__INTEGER_ONLY_LIBRARY
+	FLAC__PCMDeinterleaveFunction local_pcm_deinterleave_float32;
+#endif
+	const char *kernel_name[FLAC__STREAM_ENCODER_KERNEL_COUNT]; /* see FLAC__stream_encoder_get_kernel() */
 	FLAC__bool disable_constant_subframes;
 	FLAC__bool disable_fixed_subframes;
 	FLAC__bool disable_verbatim_subframes;
@@ -378,31 +498,58 @@ typedef struct FLAC__StreamEncoderPrivate {
 	void *client_data;
 	uint32_t first_seekpoint_to_check;
 	FILE *file;                            /* only used when encoding to a file */
+	FLAC__bool is_memory;                  /* true when encoding with FLAC__stream_encoder_init_memory() */
+	FLAC__byte *memory;                    /* the encoded stream so far, owned by us until FLAC__stream_encoder_finish_memory() */
+	size_t memory_length, memory_capacity, memory_position;
 	FLAC__uint64 bytes_written;
 	FLAC__uint64 samples_written;
 	uint32_t frames_written;
 	uint32_t total_frames_estimate;
 	/* unaligned (original) pointers to allocated data */
-	FLAC__int32 *integer_signal_unaligned[FLAC__MAX_CHANNELS];
-	FLAC__int32 *integer_signal_mid_side_unaligned[2];
 #ifndef FLAC__INTEGER_ONLY_LIBRARY
 	FLAC__real *real_signal_unaligned[FLAC__MAX_CHANNELS]; /* (@@@ currently unused) */
 	FLAC__real *real_signal_mid_side_unaligned[2]; /* (@@@ currently unused) */
-	FLAC__real *window_unaligned[FLAC__MAX_APODIZATION_FUNCTIONS];
-	FLAC__real *windowed_signal_unaligned;
+	FLAC__WindowCacheEntry *window_entry[FLAC__MAX_APODIZATION_FUNCTIONS]; /* where window[] comes from, shared with other encoders */
 #endif
-	FLAC__int32 *residual_workspace_unaligned[FLAC__MAX_CHANNELS][2];
-	FLAC__int32 *residual_workspace_mid_side_unaligned[2][2];
-	FLAC__uint64 *abs_residual_partition_sums_unaligned;
-	uint32_t *raw_bits_per_partition_unaligned;
+#ifdef HAVE_PTHREAD
 	/*
-	 * These fields have been moved here from private function local
-	 * declarations merely to save stack space during encoding.
+	 * The data for the worker threads.  Tasks 1..num_threadtasks-1 form
+	 * a ring that the main thread fills, the workers encode and the main
+	 * thread writes out again, always in the same order.
 	 */
-#ifndef FLAC__INTEGER_ONLY_LIBRARY
-	FLAC__real lp_coeff[FLAC__MAX_LPC_ORDER][FLAC__MAX_LPC_ORDER]; /* from process_subframe_() */
+	pthread_t thread[FLAC__STREAM_ENCODER_MAX_THREADS];
+	uint32_t num_started_threads;
+	pthread_mutex_t mutex_work_queue;                 /* protects the fields below and threadtask[]->done */
+	pthread_cond_t cond_work_available;
+	pthread_cond_t cond_task_done;
+	uint32_t next_task_to_work;                       /* next task to be picked up by a worker */
+	uint32_t num_tasks_queued;                        /* number of tasks filled but not yet picked up */
+	FLAC__bool finish_work_threads;
+	/* only used by the main thread: */
+	uint32_t next_task_to_fill;
+	uint32_t next_task_to_write;
+	uint32_t num_tasks_in_flight;                     /* number of tasks filled but not yet written */
+	/*
+	 * With parallel subframes there is no ring; instead the workers and
+	 * the main thread share the subframe searches of threadtask[0], each
+	 * with a scratch space of its own.  Jobs below num_independent are
+	 * the independent channels, the others the mid and side channels.
+	 */
+	FLAC__StreamEncoderSubframeScratch *subframe_scratch[FLAC__MAX_CHANNELS];
+	uint32_t num_subframe_scratch;
+	struct {
+		FLAC__StreamEncoderThreadTask *threadtask;
+		const FLAC__FrameHeader *frame_header;
+		uint32_t min_partition_order;
+		uint32_t max_partition_order;
+		uint32_t num_independent;
+		uint32_t num_jobs;
+		uint32_t next_job;                            /* protected by mutex_work_queue */
+		uint32_t num_jobs_done;                       /* protected by mutex_work_queue */
+		FLAC__bool ok;                                /* protected by mutex_work_queue */
+		uint32_t num_scratch_taken;                   /* protected by mutex_work_queue */
+	} subframe_jobs;
 #endif
-	FLAC__EntropyCodingMethod_PartitionedRiceContents partitioned_rice_contents_extra[2]; /* from find_best_partition_order_() */
 	/*
 	 * The data for the verify section
 	 */
@@ -422,6 +569,7 @@ typedef struct FLAC__StreamEncoderPrivate {
 		} error_stats;
 	} verify;
 	FLAC__bool is_being_deleted; /* if true, call to ..._finish() from ..._delete() will not call the callbacks */
+	FLAC__Allocator allocator; /* for everything the encoder allocates, including itself */
 } FLAC__StreamEncoderPrivate;
 
 /***********************************************************************
@@ -483,6 +631,33 @@ FLAC_API const char * const FLAC__StreamEncoderTellStatusString[] = {
 	"FLAC__STREAM_ENCODER_TELL_STATUS_UNSUPPORTED"
 };
 
+FLAC_API const char * const FLAC__StreamEncoderStageString[] = {
+	"FLAC__STREAM_ENCODER_STAGE_WINDOW",
+	"FLAC__STREAM_ENCODER_STAGE_AUTOCORRELATION",
+	"FLAC__STREAM_ENCODER_STAGE_LP_COEFFICIENTS",
+	"FLAC__STREAM_ENCODER_STAGE_QUANTIZATION",
+	"FLAC__STREAM_ENCODER_STAGE_RESIDUAL",
+	"FLAC__STREAM_ENCODER_STAGE_PARTITION_SUMS",
+	"FLAC__STREAM_ENCODER_STAGE_RICE_SEARCH",
+	"FLAC__STREAM_ENCODER_STAGE_PACKING",
+	"FLAC__STREAM_ENCODER_STAGE_MD5",
+	"FLAC__STREAM_ENCODER_STAGE_VERIFY",
+	"FLAC__STREAM_ENCODER_STAGE_WRITE_CALLBACK"
+};
+
+FLAC_API const char * const FLAC__StreamEncoderKernelString[] = {
+	"FLAC__STREAM_ENCODER_KERNEL_LPC_AUTOCORRELATION",
+	"FLAC__STREAM_ENCODER_KERNEL_FIXED_BEST_PREDICTOR",
+	"FLAC__STREAM_ENCODER_KERNEL_FIXED_BEST_PREDICTOR_WIDE",
+	"FLAC__STREAM_ENCODER_KERNEL_LPC_RESIDUAL",
+	"FLAC__STREAM_ENCODER_KERNEL_LPC_RESIDUAL_64BIT",
+	"FLAC__STREAM_ENCODER_KERNEL_LPC_RESIDUAL_16BIT",
+	"FLAC__STREAM_ENCODER_KERNEL_PARTITION_SUMS",
+	"FLAC__STREAM_ENCODER_KERNEL_PCM_DEINTERLEAVE_INT16",
+	"FLAC__STREAM_ENCODER_KERNEL_PCM_DEINTERLEAVE_INT24",
+	"FLAC__STREAM_ENCODER_KERNEL_PCM_DEINTERLEAVE_FLOAT32"
+};
+
 /* Number of samples that will be overread to watch for end of stream.  By
  * 'overread', we mean that the FLAC__stream_encoder_process*() calls will
  * always try to read blocksize+1 samples before encoding a block, so that
@@ -502,72 +677,55 @@ static const uint32_t OVERREAD_ = 1;
  *
  */
 FLAC_API FLAC__StreamEncoder *FLAC__stream_encoder_new(void)
+{
+	return FLAC__stream_encoder_new_with_allocator(0);
+}
+
+FLAC_API FLAC__StreamEncoder *FLAC__stream_encoder_new_with_allocator(const FLAC__Allocator *allocator)
 {
 	FLAC__StreamEncoder *encoder;
-	uint32_t i;
+	FLAC__Allocator alloc;
 
 	FLAC__ASSERT(sizeof(int) >= 4); /* we want to die right away if this is not true */
 
-	encoder = calloc(1, sizeof(FLAC__StreamEncoder));
+	FLAC__memory_get_allocator(&alloc, allocator);
+
+	encoder = FLAC__memory_calloc(&alloc, 1, sizeof(FLAC__StreamEncoder));
 	if(encoder == 0) {
 		return 0;
 	}
 
-	encoder->protected_ = calloc(1, sizeof(FLAC__StreamEncoderProtected));
+	encoder->protected_ = FLAC__memory_calloc(&alloc, 1, sizeof(FLAC__StreamEncoderProtected));
 	if(encoder->protected_ == 0) {
-		free(encoder);
+		FLAC__memory_free(&alloc, encoder);
 		return 0;
 	}
 
-	encoder->private_ = calloc(1, sizeof(FLAC__StreamEncoderPrivate));
+	encoder->private_ = FLAC__memory_calloc(&alloc, 1, sizeof(FLAC__StreamEncoderPrivate));
 	if(encoder->private_ == 0) {
-		free(encoder->protected_);
-		free(encoder);
+		FLAC__memory_free(&alloc, encoder->protected_);
+		FLAC__memory_free(&alloc, encoder);
 		return 0;
 	}
+	encoder->private_->allocator = alloc;
 
-	encoder->private_->frame = FLAC__bitwriter_new();
-	if(encoder->private_->frame == 0) {
-		free(encoder->private_);
-		free(encoder->protected_);
-		free(encoder);
+	encoder->private_->threadtask[0] = new_threadtask_(&encoder->private_->allocator);
+	if(encoder->private_->threadtask[0] == 0) {
+		FLAC__memory_free(&alloc, encoder->private_);
+		FLAC__memory_free(&alloc, encoder->protected_);
+		FLAC__memory_free(&alloc, encoder);
 		return 0;
 	}
 
 	encoder->private_->file = 0;
+	encoder->private_->is_memory = false;
+	encoder->private_->memory = 0;
+	encoder->private_->memory_length = encoder->private_->memory_capacity = encoder->private_->memory_position = 0;
 
 	set_defaults_(encoder);
 
 	encoder->private_->is_being_deleted = false;
 
-	for(i = 0; i < FLAC__MAX_CHANNELS; i++) {
-		encoder->private_->subframe_workspace_ptr[i][0] = &encoder->private_->subframe_workspace[i][0];
-		encoder->private_->subframe_workspace_ptr[i][1] = &encoder->private_->subframe_workspace[i][1];
-	}
-	for(i = 0; i < 2; i++) {
-		encoder->private_->subframe_workspace_ptr_mid_side[i][0] = &encoder->private_->subframe_workspace_mid_side[i][0];
-		encoder->private_->subframe_workspace_ptr_mid_side[i][1] = &encoder->private_->subframe_workspace_mid_side[i][1];
-	}
-	for(i = 0; i < FLAC__MAX_CHANNELS; i++) {
-		encoder->private_->partitioned_rice_contents_workspace_ptr[i][0] = &encoder->private_->partitioned_rice_contents_workspace[i][0];
-		encoder->private_->partitioned_rice_contents_workspace_ptr[i][1] = &encoder->private_->partitioned_rice_contents_workspace[i][1];
-	}
-	for(i = 0; i < 2; i++) {
-		encoder->private_->partitioned_rice_contents_workspace_ptr_mid_side[i][0] = &encoder->private_->partitioned_rice_contents_workspace_mid_side[i][0];
-		encoder->private_->partitioned_rice_contents_workspace_ptr_mid_side[i][1] = &encoder->private_->partitioned_rice_contents_workspace_mid_side[i][1];
-	}
-
-	for(i = 0; i < FLAC__MAX_CHANNELS; i++) {
-		FLAC__format_entropy_coding_method_partitioned_rice_contents_init(&encoder->private_->partitioned_rice_contents_workspace[i][0]);
-		FLAC__format_entropy_coding_method_partitioned_rice_contents_init(&encoder->private_->partitioned_rice_contents_workspace[i][1]);
-	}
-	for(i = 0; i < 2; i++) {
-		FLAC__format_entropy_coding_method_partitioned_rice_contents_init(&encoder->private_->partitioned_rice_contents_workspace_mid_side[i][0]);
-		FLAC__format_entropy_coding_method_partitioned_rice_contents_init(&encoder->private_->partitioned_rice_contents_workspace_mid_side[i][1]);
-	}
-	for(i = 0; i < 2; i++)
-		FLAC__format_entropy_coding_method_partitioned_rice_contents_init(&encoder->private_->partitioned_rice_contents_extra[i]);
-
 	encoder->protected_->state = FLAC__STREAM_ENCODER_UNINITIALIZED;
 
 	return encoder;
@@ -575,14 +733,14 @@ FLAC_API FLAC__StreamEncoder *FLAC__stream_encoder_new(void)
 
 FLAC_API void FLAC__stream_encoder_delete(FLAC__StreamEncoder *encoder)
 {
-	uint32_t i;
+	FLAC__Allocator alloc;
 
 	if (encoder == NULL)
 		return ;
 
 	FLAC__ASSERT(0 != encoder->protected_);
 	FLAC__ASSERT(0 != encoder->private_);
-	FLAC__ASSERT(0 != encoder->private_->frame);
+	FLAC__ASSERT(0 != encoder->private_->threadtask[0]);
 
 	encoder->private_->is_being_deleted = true;
 
@@ -591,21 +749,11 @@ FLAC_API void FLAC__stream_encoder_delete(FLAC__StreamEncoder *encoder)
 	if(0 != encoder->private_->verify.decoder)
 		FLAC__stream_decoder_delete(encoder->private_->verify.decoder);
 
-	for(i = 0; i < FLAC__MAX_CHANNELS; i++) {
-		FLAC__format_entropy_coding_method_partitioned_rice_contents_clear(&encoder->private_->partitioned_rice_contents_workspace[i][0]);
-		FLAC__format_entropy_coding_method_partitioned_rice_contents_clear(&encoder->private_->partitioned_rice_contents_workspace[i][1]);
-	}
-	for(i = 0; i < 2; i++) {
-		FLAC__format_entropy_coding_method_partitioned_rice_contents_clear(&encoder->private_->partitioned_rice_contents_workspace_mid_side[i][0]);
-		FLAC__format_entropy_coding_method_partitioned_rice_contents_clear(&encoder->private_->partitioned_rice_contents_workspace_mid_side[i][1]);
-	}
-	for(i = 0; i < 2; i++)
-		FLAC__format_entropy_coding_method_partitioned_rice_contents_clear(&encoder->private_->partitioned_rice_contents_extra[i]);
-
-	FLAC__bitwriter_delete(encoder->private_->frame);
-	free(encoder->private_);
-	free(encoder->protected_);
-	free(encoder);
+	delete_threadtask_(encoder->private_->threadtask[0]);
+	alloc = encoder->private_->allocator;
+	FLAC__memory_free(&alloc, encoder->private_);
+	FLAC__memory_free(&alloc, encoder->protected_);
+	FLAC__memory_free(&alloc, encoder);
 }
 
 /***********************************************************************
@@ -649,6 +797,10 @@ static FLAC__StreamEncoderInitStatus init_stream_internal_(
 	else if(!encoder->protected_->do_mid_side_stereo)
 		encoder->protected_->loose_mid_side_stereo = false;
 
+	/* loose mid-side stereo chains every frame to the one before it, which defeats encoding frames in parallel */
+	if(encoder->protected_->num_threads > 1 && !encoder->protected_->parallel_subframes)
+		encoder->protected_->loose_mid_side_stereo = false;
+
 	if(encoder->protected_->bits_per_sample >= 32)
 		encoder->protected_->do_mid_side_stereo = false; /* since we currently do 32-bit math, the side channel would have 33 bps and overflow */
 
@@ -819,36 +971,48 @@ static FLAC__StreamEncoderInitStatus init_stream_internal_(
 		}
 	}
 
-	encoder->private_->input_capacity = 0;
-	for(i = 0; i < encoder->protected_->channels; i++) {
-		encoder->private_->integer_signal_unaligned[i] = encoder->private_->integer_signal[i] = 0;
 #ifndef FLAC__INTEGER_ONLY_LIBRARY
+	for(i = 0; i < encoder->protected_->channels; i++)
 		encoder->private_->real_signal_unaligned[i] = encoder->private_->real_signal[i] = 0;
-#endif
-	}
-	for(i = 0; i < 2; i++) {
-		encoder->private_->integer_signal_mid_side_unaligned[i] = encoder->private_->integer_signal_mid_side[i] = 0;
-#ifndef FLAC__INTEGER_ONLY_LIBRARY
+	for(i = 0; i < 2; i++)
 		encoder->private_->real_signal_mid_side_unaligned[i] = encoder->private_->real_signal_mid_side[i] = 0;
-#endif
+	for(i = 0; i < encoder->protected_->num_apodizations; i++) {
+		encoder->private_->window_entry[i] = 0;
+		encoder->private_->window[i] = 0;
 	}
-#ifndef FLAC__INTEGER_ONLY_LIBRARY
-	for(i = 0; i < encoder->protected_->num_apodizations; i++)
-		encoder->private_->window_unaligned[i] = encoder->private_->window[i] = 0;
-	encoder->private_->windowed_signal_unaligned = encoder->private_->windowed_signal = 0;
 #endif
-	for(i = 0; i < encoder->protected_->channels; i++) {
-		encoder->private_->residual_workspace_unaligned[i][0] = encoder->private_->residual_workspace[i][0] = 0;
-		encoder->private_->residual_workspace_unaligned[i][1] = encoder->private_->residual_workspace[i][1] = 0;
-		encoder->private_->best_subframe[i] = 0;
+
+	/*
+	 * Set up the extra tasks (or for parallel subframes, the extra
+	 * scratch spaces) for the worker threads; their buffers get
+	 * allocated along with those of threadtask[0] in resize_buffers_()
+	 */
+	encoder->private_->num_threadtasks = 1;
+#ifdef HAVE_PTHREAD
+	encoder->private_->num_subframe_scratch = 0;
+	if(encoder->protected_->num_threads > 1 && encoder->protected_->parallel_subframes) {
+		/* the main thread uses threadtask[0]->scratch for the first job */
+		const uint32_t max_jobs = encoder->protected_->channels + (encoder->protected_->do_mid_side_stereo? 2 : 0);
+		FLAC__ASSERT(max_jobs <= FLAC__MAX_CHANNELS);
+		for(i = 1; i < flac_min(encoder->protected_->num_threads, max_jobs); i++) {
+			if(0 == (encoder->private_->subframe_scratch[i-1] = FLAC__memory_calloc(&encoder->private_->allocator, 1, sizeof(FLAC__StreamEncoderSubframeScratch)))) {
+				encoder->protected_->state = FLAC__STREAM_ENCODER_MEMORY_ALLOCATION_ERROR;
+				return FLAC__STREAM_ENCODER_INIT_STATUS_ENCODER_ERROR;
+			}
+			init_subframe_scratch_(encoder->private_->subframe_scratch[i-1], &encoder->private_->allocator);
+			encoder->private_->num_subframe_scratch++;
+		}
 	}
-	for(i = 0; i < 2; i++) {
-		encoder->private_->residual_workspace_mid_side_unaligned[i][0] = encoder->private_->residual_workspace_mid_side[i][0] = 0;
-		encoder->private_->residual_workspace_mid_side_unaligned[i][1] = encoder->private_->residual_workspace_mid_side[i][1] = 0;
-		encoder->private_->best_subframe_mid_side[i] = 0;
+	else if(encoder->protected_->num_threads > 1) {
+		for(i = 1; i < 2 * encoder->protected_->num_threads + 1; i++) {
+			if(0 == (encoder->private_->threadtask[i] = new_threadtask_(&encoder->private_->allocator))) {
+				encoder->protected_->state = FLAC__STREAM_ENCODER_MEMORY_ALLOCATION_ERROR;
+				return FLAC__STREAM_ENCODER_INIT_STATUS_ENCODER_ERROR;
+			}
+			encoder->private_->num_threadtasks++;
+		}
 	}
-	encoder->private_->abs_residual_partition_sums_unaligned = encoder->private_->abs_residual_partition_sums = 0;
-	encoder->private_->raw_bits_per_partition_unaligned = encoder->private_->raw_bits_per_partition = 0;
+#endif
 #ifndef FLAC__INTEGER_ONLY_LIBRARY
 	encoder->private_->loose_mid_side_stereo_frames = (uint32_t)((double)encoder->protected_->sample_rate * 0.4 / (double)encoder->protected_->blocksize + 0.5);
 #else
@@ -865,22 +1029,32 @@ static FLAC__StreamEncoderInitStatus init_stream_internal_(
 	encoder->private_->loose_mid_side_stereo_frame_count = 0;
 	encoder->private_->current_sample_number = 0;
 	encoder->private_->current_frame_number = 0;
+#ifdef FLAC__ENABLE_STATISTICS
+	memset(&encoder->private_->statistics, 0, sizeof(encoder->private_->statistics));
+	memset(&encoder->private_->threadtask[0]->scratch.statistics, 0, sizeof(encoder->private_->threadtask[0]->scratch.statistics));
+#endif
 
 	/*
 	 * get the CPU info and set the function pointers
 	 */
 	FLAC__cpu_info(&encoder->private_->cpuinfo);
+	memset(encoder->private_->kernel_name, 0, sizeof(encoder->private_->kernel_name));
 	/* first default to the non-asm routines */
 #ifndef FLAC__INTEGER_ONLY_LIBRARY
-	encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation;
+	SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation);
+#endif
+	SET_KERNEL_(encoder, PARTITION_SUMS, local_precompute_partition_info_sums, precompute_partition_info_sums_);
+	SET_KERNEL_(encoder, FIXED_BEST_PREDICTOR, local_fixed_compute_best_predictor, FLAC__fixed_compute_best_predictor);
+	SET_KERNEL_(encoder, FIXED_BEST_PREDICTOR_WIDE, local_fixed_compute_best_predictor_wide, FLAC__fixed_compute_best_predictor_wide);
+#ifndef FLAC__INTEGER_ONLY_LIBRARY
+	SET_KERNEL_(encoder, LPC_RESIDUAL, local_lpc_compute_residual_from_qlp_coefficients, FLAC__lpc_compute_residual_from_qlp_coefficients);
+	SET_KERNEL_(encoder, LPC_RESIDUAL_64BIT, local_lpc_compute_residual_from_qlp_coefficients_64bit, FLAC__lpc_compute_residual_from_qlp_coefficients_wide);
+	SET_KERNEL_(encoder, LPC_RESIDUAL_16BIT, local_lpc_compute_residual_from_qlp_coefficients_16bit, FLAC__lpc_compute_residual_from_qlp_coefficients);
 #endif
-	encoder->private_->local_precompute_partition_info_sums = precompute_partition_info_sums_;
-	encoder->private_->local_fixed_compute_best_predictor = FLAC__fixed_compute_best_predictor;
-	encoder->private_->local_fixed_compute_best_predictor_wide = FLAC__fixed_compute_best_predictor_wide;
+	SET_KERNEL_(encoder, PCM_DEINTERLEAVE_INT16, local_pcm_deinterleave_int16, FLAC__pcm_deinterleave_int16);
+	SET_KERNEL_(encoder, PCM_DEINTERLEAVE_INT24, local_pcm_deinterleave_int24, FLAC__pcm_deinterleave_int24);
 #ifndef FLAC__INTEGER_ONLY_LIBRARY
-	encoder->private_->local_lpc_compute_residual_from_qlp_coefficients = FLAC__lpc_compute_residual_from_qlp_coefficients;
-	encoder->private_->local_lpc_compute_residual_from_qlp_coefficients_64bit = FLAC__lpc_compute_residual_from_qlp_coefficients_wide;
-	encoder->private_->local_lpc_compute_residual_from_qlp_coefficients_16bit = FLAC__lpc_compute_residual_from_qlp_coefficients;
+	SET_KERNEL_(encoder, PCM_DEINTERLEAVE_FLOAT32, local_pcm_deinterleave_float32, FLAC__pcm_deinterleave_float32);
 #endif
 	/* now override with asm where appropriate */
 #ifndef FLAC__INTEGER_ONLY_LIBRARY
@@ -890,28 +1064,28 @@ static FLAC__StreamEncoderInitStatus init_stream_internal_(
 #ifdef FLAC__HAS_TARGET_POWER9
 	if (encoder->private_->cpuinfo.ppc.arch_3_00) {
 		if(encoder->protected_->max_lpc_order < 4)
-			encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_intrin_power9_vsx_lag_4;
+			SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_intrin_power9_vsx_lag_4);
 		else if(encoder->protected_->max_lpc_order < 8)
-			encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_intrin_power9_vsx_lag_8;
+			SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_intrin_power9_vsx_lag_8);
 		else if(encoder->protected_->max_lpc_order < 12)
-			encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_intrin_power9_vsx_lag_12;
+			SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_intrin_power9_vsx_lag_12);
 		else if(encoder->protected_->max_lpc_order < 16)
-			encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_intrin_power9_vsx_lag_16;
+			SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_intrin_power9_vsx_lag_16);
 		else
-			encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation;
+			SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation);
 	} else
 #endif
 	if (encoder->private_->cpuinfo.ppc.arch_2_07) {
 		if(encoder->protected_->max_lpc_order < 4)
-			encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_intrin_power8_vsx_lag_4;
+			SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_intrin_power8_vsx_lag_4);
 		else if(encoder->protected_->max_lpc_order < 8)
-			encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_intrin_power8_vsx_lag_8;
+			SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_intrin_power8_vsx_lag_8);
 		else if(encoder->protected_->max_lpc_order < 12)
-			encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_intrin_power8_vsx_lag_12;
+			SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_intrin_power8_vsx_lag_12);
 		else if(encoder->protected_->max_lpc_order < 16)
-			encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_intrin_power8_vsx_lag_16;
+			SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_intrin_power8_vsx_lag_16);
 		else
-			encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation;
+			SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation);
 	}
 #endif
 #endif
@@ -921,92 +1095,96 @@ static FLAC__StreamEncoderInitStatus init_stream_internal_(
 #   ifdef FLAC__HAS_NASM
 		if (encoder->private_->cpuinfo.x86.sse) {
 			if(encoder->protected_->max_lpc_order < 4)
-				encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_asm_ia32_sse_lag_4_old;
+				SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_asm_ia32_sse_lag_4_old);
 			else if(encoder->protected_->max_lpc_order < 8)
-				encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_asm_ia32_sse_lag_8_old;
+				SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_asm_ia32_sse_lag_8_old);
 			else if(encoder->protected_->max_lpc_order < 12)
-				encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_asm_ia32_sse_lag_12_old;
+				SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_asm_ia32_sse_lag_12_old);
 			else if(encoder->protected_->max_lpc_order < 16)
-				encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_asm_ia32_sse_lag_16_old;
+				SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_asm_ia32_sse_lag_16_old);
 			else
-				encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_asm_ia32;
+				SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_asm_ia32);
 		}
 		else
-			encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_asm_ia32;
+			SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_asm_ia32);
 
-		encoder->private_->local_lpc_compute_residual_from_qlp_coefficients_64bit = FLAC__lpc_compute_residual_from_qlp_coefficients_wide_asm_ia32; /* OPT_IA32: was really necessary for GCC < 4.9 */
+		SET_KERNEL_(encoder, LPC_RESIDUAL_64BIT, local_lpc_compute_residual_from_qlp_coefficients_64bit, FLAC__lpc_compute_residual_from_qlp_coefficients_wide_asm_ia32); /* OPT_IA32: was really necessary for GCC < 4.9 */
 		if (encoder->private_->cpuinfo.x86.mmx) {
-			encoder->private_->local_lpc_compute_residual_from_qlp_coefficients = FLAC__lpc_compute_residual_from_qlp_coefficients_asm_ia32;
-			encoder->private_->local_lpc_compute_residual_from_qlp_coefficients_16bit = FLAC__lpc_compute_residual_from_qlp_coefficients_asm_ia32_mmx;
+			SET_KERNEL_(encoder, LPC_RESIDUAL, local_lpc_compute_residual_from_qlp_coefficients, FLAC__lpc_compute_residual_from_qlp_coefficients_asm_ia32);
+			SET_KERNEL_(encoder, LPC_RESIDUAL_16BIT, local_lpc_compute_residual_from_qlp_coefficients_16bit, FLAC__lpc_compute_residual_from_qlp_coefficients_asm_ia32_mmx);
 		}
 		else {
-			encoder->private_->local_lpc_compute_residual_from_qlp_coefficients = FLAC__lpc_compute_residual_from_qlp_coefficients_asm_ia32;
-			encoder->private_->local_lpc_compute_residual_from_qlp_coefficients_16bit = FLAC__lpc_compute_residual_from_qlp_coefficients_asm_ia32;
+			SET_KERNEL_(encoder, LPC_RESIDUAL, local_lpc_compute_residual_from_qlp_coefficients, FLAC__lpc_compute_residual_from_qlp_coefficients_asm_ia32);
+			SET_KERNEL_(encoder, LPC_RESIDUAL_16BIT, local_lpc_compute_residual_from_qlp_coefficients_16bit, FLAC__lpc_compute_residual_from_qlp_coefficients_asm_ia32);
 		}
 
 		if (encoder->private_->cpuinfo.x86.mmx && encoder->private_->cpuinfo.x86.cmov)
-			encoder->private_->local_fixed_compute_best_predictor = FLAC__fixed_compute_best_predictor_asm_ia32_mmx_cmov;
+			SET_KERNEL_(encoder, FIXED_BEST_PREDICTOR, local_fixed_compute_best_predictor, FLAC__fixed_compute_best_predictor_asm_ia32_mmx_cmov);
 #   endif /* FLAC__HAS_NASM */
 #   if FLAC__HAS_X86INTRIN
 #    if defined FLAC__SSE_SUPPORTED
 		if (encoder->private_->cpuinfo.x86.sse) {
 			if (encoder->private_->cpuinfo.x86.sse42 || !encoder->private_->cpuinfo.x86.intel) { /* use new autocorrelation functions */
 				if(encoder->protected_->max_lpc_order < 4)
-					encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_intrin_sse_lag_4_new;
+					SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_intrin_sse_lag_4_new);
 				else if(encoder->protected_->max_lpc_order < 8)
-					encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_intrin_sse_lag_8_new;
+					SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_intrin_sse_lag_8_new);
 				else if(encoder->protected_->max_lpc_order < 12)
-					encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_intrin_sse_lag_12_new;
+					SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_intrin_sse_lag_12_new);
 				else if(encoder->protected_->max_lpc_order < 16)
-					encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_intrin_sse_lag_16_new;
+					SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_intrin_sse_lag_16_new);
 				else
-					encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation;
+					SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation);
 			}
 			else { /* use old autocorrelation functions */
 				if(encoder->protected_->max_lpc_order < 4)
-					encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_intrin_sse_lag_4_old;
+					SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_intrin_sse_lag_4_old);
 				else if(encoder->protected_->max_lpc_order < 8)
-					encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_intrin_sse_lag_8_old;
+					SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_intrin_sse_lag_8_old);
 				else if(encoder->protected_->max_lpc_order < 12)
-					encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_intrin_sse_lag_12_old;
+					SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_intrin_sse_lag_12_old);
 				else if(encoder->protected_->max_lpc_order < 16)
-					encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_intrin_sse_lag_16_old;
+					SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_intrin_sse_lag_16_old);
 				else
-					encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation;
+					SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation);
 			}
 		}
 #    endif
+#    if defined FLAC__AVX2_SUPPORTED && defined FLAC__FMA_SUPPORTED
+		if(encoder->private_->cpuinfo.x86.avx2 && encoder->private_->cpuinfo.x86.fma)
+			SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_intrin_avx2_fma); /* covers all orders, so also replaces the generic routine above order 15 */
+#    endif
 
 #    ifdef FLAC__SSE2_SUPPORTED
 		if (encoder->private_->cpuinfo.x86.sse2) {
-			encoder->private_->local_lpc_compute_residual_from_qlp_coefficients       = FLAC__lpc_compute_residual_from_qlp_coefficients_intrin_sse2;
-			encoder->private_->local_lpc_compute_residual_from_qlp_coefficients_16bit = FLAC__lpc_compute_residual_from_qlp_coefficients_16_intrin_sse2;
+			SET_KERNEL_(encoder, LPC_RESIDUAL, local_lpc_compute_residual_from_qlp_coefficients, FLAC__lpc_compute_residual_from_qlp_coefficients_intrin_sse2);
+			SET_KERNEL_(encoder, LPC_RESIDUAL_16BIT, local_lpc_compute_residual_from_qlp_coefficients_16bit, FLAC__lpc_compute_residual_from_qlp_coefficients_16_intrin_sse2);
 		}
 #    endif
 #    ifdef FLAC__SSE4_1_SUPPORTED
 		if (encoder->private_->cpuinfo.x86.sse41) {
-			encoder->private_->local_lpc_compute_residual_from_qlp_coefficients       = FLAC__lpc_compute_residual_from_qlp_coefficients_intrin_sse41;
-			encoder->private_->local_lpc_compute_residual_from_qlp_coefficients_64bit = FLAC__lpc_compute_residual_from_qlp_coefficients_wide_intrin_sse41;
+			SET_KERNEL_(encoder, LPC_RESIDUAL, local_lpc_compute_residual_from_qlp_coefficients, FLAC__lpc_compute_residual_from_qlp_coefficients_intrin_sse41);
+			SET_KERNEL_(encoder, LPC_RESIDUAL_64BIT, local_lpc_compute_residual_from_qlp_coefficients_64bit, FLAC__lpc_compute_residual_from_qlp_coefficients_wide_intrin_sse41);
 		}
 #    endif
 #    ifdef FLAC__AVX2_SUPPORTED
 		if (encoder->private_->cpuinfo.x86.avx2) {
-			encoder->private_->local_lpc_compute_residual_from_qlp_coefficients_16bit = FLAC__lpc_compute_residual_from_qlp_coefficients_16_intrin_avx2;
-			encoder->private_->local_lpc_compute_residual_from_qlp_coefficients       = FLAC__lpc_compute_residual_from_qlp_coefficients_intrin_avx2;
-			encoder->private_->local_lpc_compute_residual_from_qlp_coefficients_64bit = FLAC__lpc_compute_residual_from_qlp_coefficients_wide_intrin_avx2;
+			SET_KERNEL_(encoder, LPC_RESIDUAL_16BIT, local_lpc_compute_residual_from_qlp_coefficients_16bit, FLAC__lpc_compute_residual_from_qlp_coefficients_16_intrin_avx2);
+			SET_KERNEL_(encoder, LPC_RESIDUAL, local_lpc_compute_residual_from_qlp_coefficients, FLAC__lpc_compute_residual_from_qlp_coefficients_intrin_avx2);
+			SET_KERNEL_(encoder, LPC_RESIDUAL_64BIT, local_lpc_compute_residual_from_qlp_coefficients_64bit, FLAC__lpc_compute_residual_from_qlp_coefficients_wide_intrin_avx2);
 		}
 #    endif
 
 #    ifdef FLAC__SSE2_SUPPORTED
 		if (encoder->private_->cpuinfo.x86.sse2) {
-			encoder->private_->local_fixed_compute_best_predictor      = FLAC__fixed_compute_best_predictor_intrin_sse2;
-			encoder->private_->local_fixed_compute_best_predictor_wide = FLAC__fixed_compute_best_predictor_wide_intrin_sse2;
+			SET_KERNEL_(encoder, FIXED_BEST_PREDICTOR, local_fixed_compute_best_predictor, FLAC__fixed_compute_best_predictor_intrin_sse2);
+			SET_KERNEL_(encoder, FIXED_BEST_PREDICTOR_WIDE, local_fixed_compute_best_predictor_wide, FLAC__fixed_compute_best_predictor_wide_intrin_sse2);
 		}
 #    endif
 #    ifdef FLAC__SSSE3_SUPPORTED
 		if (encoder->private_->cpuinfo.x86.ssse3) {
-			encoder->private_->local_fixed_compute_best_predictor      = FLAC__fixed_compute_best_predictor_intrin_ssse3;
-			encoder->private_->local_fixed_compute_best_predictor_wide = FLAC__fixed_compute_best_predictor_wide_intrin_ssse3;
+			SET_KERNEL_(encoder, FIXED_BEST_PREDICTOR, local_fixed_compute_best_predictor, FLAC__fixed_compute_best_predictor_intrin_ssse3);
+			SET_KERNEL_(encoder, FIXED_BEST_PREDICTOR_WIDE, local_fixed_compute_best_predictor_wide, FLAC__fixed_compute_best_predictor_wide_intrin_ssse3);
 		}
 #    endif
 #   endif /* FLAC__HAS_X86INTRIN */
@@ -1014,52 +1192,62 @@ static FLAC__StreamEncoderInitStatus init_stream_internal_(
 		FLAC__ASSERT(encoder->private_->cpuinfo.type == FLAC__CPUINFO_TYPE_X86_64);
 #   if FLAC__HAS_X86INTRIN
 #    ifdef FLAC__SSE_SUPPORTED
-		if(encoder->private_->cpuinfo.x86.sse42 || !encoder->private_->cpuinfo.x86.intel) { /* use new autocorrelation functions */
-			if(encoder->protected_->max_lpc_order < 4)
-				encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_intrin_sse_lag_4_new;
-			else if(encoder->protected_->max_lpc_order < 8)
-				encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_intrin_sse_lag_8_new;
-			else if(encoder->protected_->max_lpc_order < 12)
-				encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_intrin_sse_lag_12_new;
-			else if(encoder->protected_->max_lpc_order < 16)
-				encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_intrin_sse_lag_16_new;
-		}
-		else {
-			if(encoder->protected_->max_lpc_order < 4)
-				encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_intrin_sse_lag_4_old;
-			else if(encoder->protected_->max_lpc_order < 8)
-				encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_intrin_sse_lag_8_old;
-			else if(encoder->protected_->max_lpc_order < 12)
-				encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_intrin_sse_lag_12_old;
-			else if(encoder->protected_->max_lpc_order < 16)
-				encoder->private_->local_lpc_compute_autocorrelation = FLAC__lpc_compute_autocorrelation_intrin_sse_lag_16_old;
+		/* SSE and SSE2 are part of x86-64, but FLAC__set_cpu_feature_mask() may have cleared them */
+		if(encoder->private_->cpuinfo.x86.sse) {
+			if(encoder->private_->cpuinfo.x86.sse42 || !encoder->private_->cpuinfo.x86.intel) { /* use new autocorrelation functions */
+				if(encoder->protected_->max_lpc_order < 4)
+					SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_intrin_sse_lag_4_new);
+				else if(encoder->protected_->max_lpc_order < 8)
+					SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_intrin_sse_lag_8_new);
+				else if(encoder->protected_->max_lpc_order < 12)
+					SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_intrin_sse_lag_12_new);
+				else if(encoder->protected_->max_lpc_order < 16)
+					SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_intrin_sse_lag_16_new);
+			}
+			else {
+				if(encoder->protected_->max_lpc_order < 4)
+					SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_intrin_sse_lag_4_old);
+				else if(encoder->protected_->max_lpc_order < 8)
+					SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_intrin_sse_lag_8_old);
+				else if(encoder->protected_->max_lpc_order < 12)
+					SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_intrin_sse_lag_12_old);
+				else if(encoder->protected_->max_lpc_order < 16)
+					SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_intrin_sse_lag_16_old);
+			}
 		}
 #    endif
+#    if defined FLAC__AVX2_SUPPORTED && defined FLAC__FMA_SUPPORTED
+		if(encoder->private_->cpuinfo.x86.avx2 && encoder->private_->cpuinfo.x86.fma)
+			SET_KERNEL_(encoder, LPC_AUTOCORRELATION, local_lpc_compute_autocorrelation, FLAC__lpc_compute_autocorrelation_intrin_avx2_fma); /* covers all orders, so also replaces the generic routine above order 15 */
+#    endif
 
 #    ifdef FLAC__SSE2_SUPPORTED
-		encoder->private_->local_lpc_compute_residual_from_qlp_coefficients_16bit = FLAC__lpc_compute_residual_from_qlp_coefficients_16_intrin_sse2;
+		if(encoder->private_->cpuinfo.x86.sse2)
+			SET_KERNEL_(encoder, LPC_RESIDUAL_16BIT, local_lpc_compute_residual_from_qlp_coefficients_16bit, FLAC__lpc_compute_residual_from_qlp_coefficients_16_intrin_sse2);
 #    endif
 #    ifdef FLAC__SSE4_1_SUPPORTED
 		if(encoder->private_->cpuinfo.x86.sse41) {
-			encoder->private_->local_lpc_compute_residual_from_qlp_coefficients = FLAC__lpc_compute_residual_from_qlp_coefficients_intrin_sse41;
+			SET_KERNEL_(encoder, LPC_RESIDUAL, local_lpc_compute_residual_from_qlp_coefficients, FLAC__lpc_compute_residual_from_qlp_coefficients_intrin_sse41);
 		}
 #    endif
 #    ifdef FLAC__AVX2_SUPPORTED
 		if(encoder->private_->cpuinfo.x86.avx2) {
-			encoder->private_->local_lpc_compute_residual_from_qlp_coefficients_16bit = FLAC__lpc_compute_residual_from_qlp_coefficients_16_intrin_avx2;
-			encoder->private_->local_lpc_compute_residual_from_qlp_coefficients       = FLAC__lpc_compute_residual_from_qlp_coefficients_intrin_avx2;
-			encoder->private_->local_lpc_compute_residual_from_qlp_coefficients_64bit = FLAC__lpc_compute_residual_from_qlp_coefficients_wide_intrin_avx2;
+			SET_KERNEL_(encoder, LPC_RESIDUAL_16BIT, local_lpc_compute_residual_from_qlp_coefficients_16bit, FLAC__lpc_compute_residual_from_qlp_coefficients_16_intrin_avx2);
+			SET_KERNEL_(encoder, LPC_RESIDUAL, local_lpc_compute_residual_from_qlp_coefficients, FLAC__lpc_compute_residual_from_qlp_coefficients_intrin_avx2);
+			SET_KERNEL_(encoder, LPC_RESIDUAL_64BIT, local_lpc_compute_residual_from_qlp_coefficients_64bit, FLAC__lpc_compute_residual_from_qlp_coefficients_wide_intrin_avx2);
 		}
 #    endif
 
 #    ifdef FLAC__SSE2_SUPPORTED
-		encoder->private_->local_fixed_compute_best_predictor      = FLAC__fixed_compute_best_predictor_intrin_sse2;
-		encoder->private_->local_fixed_compute_best_predictor_wide = FLAC__fixed_compute_best_predictor_wide_intrin_sse2;
+		if(encoder->private_->cpuinfo.x86.sse2) {
+			SET_KERNEL_(encoder, FIXED_BEST_PREDICTOR, local_fixed_compute_best_predictor, FLAC__fixed_compute_best_predictor_intrin_sse2);
+			SET_KERNEL_(encoder, FIXED_BEST_PREDICTOR_WIDE, local_fixed_compute_best_predictor_wide, FLAC__fixed_compute_best_predictor_wide_intrin_sse2);
+		}
 #    endif
 #    ifdef FLAC__SSSE3_SUPPORTED
 		if (encoder->private_->cpuinfo.x86.ssse3) {
-			encoder->private_->local_fixed_compute_best_predictor      = FLAC__fixed_compute_best_predictor_intrin_ssse3;
-			encoder->private_->local_fixed_compute_best_predictor_wide = FLAC__fixed_compute_best_predictor_wide_intrin_ssse3;
+			SET_KERNEL_(encoder, FIXED_BEST_PREDICTOR, local_fixed_compute_best_predictor, FLAC__fixed_compute_best_predictor_intrin_ssse3);
+			SET_KERNEL_(encoder, FIXED_BEST_PREDICTOR_WIDE, local_fixed_compute_best_predictor_wide, FLAC__fixed_compute_best_predictor_wide_intrin_ssse3);
 		}
 #    endif
 #   endif /* FLAC__HAS_X86INTRIN */
@@ -1072,31 +1260,48 @@ static FLAC__StreamEncoderInitStatus init_stream_internal_(
 # if defined FLAC__CPU_IA32
 #  ifdef FLAC__SSE2_SUPPORTED
 		if (encoder->private_->cpuinfo.x86.sse2)
-			encoder->private_->local_precompute_partition_info_sums = FLAC__precompute_partition_info_sums_intrin_sse2;
+			SET_KERNEL_(encoder, PARTITION_SUMS, local_precompute_partition_info_sums, FLAC__precompute_partition_info_sums_intrin_sse2);
 #  endif
 #  ifdef FLAC__SSSE3_SUPPORTED
 		if (encoder->private_->cpuinfo.x86.ssse3)
-			encoder->private_->local_precompute_partition_info_sums = FLAC__precompute_partition_info_sums_intrin_ssse3;
+			SET_KERNEL_(encoder, PARTITION_SUMS, local_precompute_partition_info_sums, FLAC__precompute_partition_info_sums_intrin_ssse3);
 #  endif
 #  ifdef FLAC__AVX2_SUPPORTED
 		if (encoder->private_->cpuinfo.x86.avx2)
-			encoder->private_->local_precompute_partition_info_sums = FLAC__precompute_partition_info_sums_intrin_avx2;
+			SET_KERNEL_(encoder, PARTITION_SUMS, local_precompute_partition_info_sums, FLAC__precompute_partition_info_sums_intrin_avx2);
 #  endif
 # elif defined FLAC__CPU_X86_64
 #  ifdef FLAC__SSE2_SUPPORTED
-		encoder->private_->local_precompute_partition_info_sums = FLAC__precompute_partition_info_sums_intrin_sse2;
+		if(encoder->private_->cpuinfo.x86.sse2)
+			SET_KERNEL_(encoder, PARTITION_SUMS, local_precompute_partition_info_sums, FLAC__precompute_partition_info_sums_intrin_sse2);
 #  endif
 #  ifdef FLAC__SSSE3_SUPPORTED
 		if(encoder->private_->cpuinfo.x86.ssse3)
-			encoder->private_->local_precompute_partition_info_sums = FLAC__precompute_partition_info_sums_intrin_ssse3;
+			SET_KERNEL_(encoder, PARTITION_SUMS, local_precompute_partition_info_sums, FLAC__precompute_partition_info_sums_intrin_ssse3);
 #  endif
 #  ifdef FLAC__AVX2_SUPPORTED
 		if(encoder->private_->cpuinfo.x86.avx2)
-			encoder->private_->local_precompute_partition_info_sums = FLAC__precompute_partition_info_sums_intrin_avx2;
+			SET_KERNEL_(encoder, PARTITION_SUMS, local_precompute_partition_info_sums, FLAC__precompute_partition_info_sums_intrin_avx2);
 #  endif
 # endif /* FLAC__CPU_... */
 	}
 #endif /* !FLAC__NO_ASM && FLAC__HAS_X86INTRIN */
+#if !defined FLAC__NO_ASM && (defined FLAC__CPU_IA32 || defined FLAC__CPU_X86_64) && FLAC__HAS_X86INTRIN
+	if(encoder->private_->cpuinfo.use_asm) {
+# ifdef FLAC__SSE2_SUPPORTED
+		if(encoder->private_->cpuinfo.x86.sse2) {
+			SET_KERNEL_(encoder, PCM_DEINTERLEAVE_INT16, local_pcm_deinterleave_int16, FLAC__pcm_deinterleave_int16_intrin_sse2);
+#  ifndef FLAC__INTEGER_ONLY_LIBRARY
+			SET_KERNEL_(encoder, PCM_DEINTERLEAVE_FLOAT32, local_pcm_deinterleave_float32, FLAC__pcm_deinterleave_float32_intrin_sse2);
+#  endif
+		}
+# endif
+# ifdef FLAC__SSSE3_SUPPORTED
+		if(encoder->private_->cpuinfo.x86.ssse3)
+			SET_KERNEL_(encoder, PCM_DEINTERLEAVE_INT24, local_pcm_deinterleave_int24, FLAC__pcm_deinterleave_int24_intrin_ssse3);
+# endif
+	}
+#endif
 
 	/* set state to OK; from here on, errors are fatal and we'll override the state then */
 	encoder->protected_->state = FLAC__STREAM_ENCODER_OK;
@@ -1121,10 +1326,20 @@ static FLAC__StreamEncoderInitStatus init_stream_internal_(
 		return FLAC__STREAM_ENCODER_INIT_STATUS_ENCODER_ERROR;
 	}
 
-	if(!FLAC__bitwriter_init(encoder->private_->frame)) {
-		encoder->protected_->state = FLAC__STREAM_ENCODER_MEMORY_ALLOCATION_ERROR;
+	for(i = 0; i < encoder->private_->num_threadtasks; i++) {
+		if(!FLAC__bitwriter_init(encoder->private_->threadtask[i]->frame)) {
+			encoder->protected_->state = FLAC__STREAM_ENCODER_MEMORY_ALLOCATION_ERROR;
+			return FLAC__STREAM_ENCODER_INIT_STATUS_ENCODER_ERROR;
+		}
+		FLAC__bitwriter_set_cpu_info(encoder->private_->threadtask[i]->frame, &encoder->private_->cpuinfo);
+	}
+
+#ifdef HAVE_PTHREAD
+	if((encoder->private_->num_threadtasks > 1 || encoder->private_->num_subframe_scratch > 0) && !start_threads_(encoder)) {
+		/* the above function sets the state for us in case of an error */
 		return FLAC__STREAM_ENCODER_INIT_STATUS_ENCODER_ERROR;
 	}
+#endif
 
 	/*
 	 * Set up the verify stuff if necessary
@@ -1134,9 +1349,9 @@ static FLAC__StreamEncoderInitStatus init_stream_internal_(
 		 * First, set up the fifo which will hold the
 		 * original signal to compare against
 		 */
-		encoder->private_->verify.input_fifo.size = encoder->protected_->blocksize+OVERREAD_;
+		encoder->private_->verify.input_fifo.size = encoder->protected_->blocksize*encoder->private_->num_threadtasks+OVERREAD_;
 		for(i = 0; i < encoder->protected_->channels; i++) {
-			if(0 == (encoder->private_->verify.input_fifo.data[i] = safe_malloc_mul_2op_p(sizeof(FLAC__int32), /*times*/encoder->private_->verify.input_fifo.size))) {
+			if(0 == (encoder->private_->verify.input_fifo.data[i] = FLAC__memory_malloc_mul_2op(&encoder->private_->allocator, sizeof(FLAC__int32), /*times*/encoder->private_->verify.input_fifo.size))) {
 				encoder->protected_->state = FLAC__STREAM_ENCODER_MEMORY_ALLOCATION_ERROR;
 				return FLAC__STREAM_ENCODER_INIT_STATUS_ENCODER_ERROR;
 			}
@@ -1147,7 +1362,7 @@ static FLAC__StreamEncoderInitStatus init_stream_internal_(
 		 * Now set up a stream decoder for verification
 		 */
 		if(0 == encoder->private_->verify.decoder) {
-			encoder->private_->verify.decoder = FLAC__stream_decoder_new();
+			encoder->private_->verify.decoder = FLAC__stream_decoder_new_with_allocator(&encoder->private_->allocator);
 			if(0 == encoder->private_->verify.decoder) {
 				encoder->protected_->state = FLAC__STREAM_ENCODER_VERIFY_DECODER_ERROR;
 				return FLAC__STREAM_ENCODER_INIT_STATUS_ENCODER_ERROR;
@@ -1171,6 +1386,11 @@ static FLAC__StreamEncoderInitStatus init_stream_internal_(
 	 * calls the write_callback, which uses these values.
 	 */
 	encoder->private_->first_seekpoint_to_check = 0;
+	encoder->private_->frame_index_points = 0;
+	if(0 != encoder->private_->frame_index && !FLAC__metadata_object_seektable_resize_points(encoder->private_->frame_index, 0)) {
+		encoder->protected_->state = FLAC__STREAM_ENCODER_MEMORY_ALLOCATION_ERROR;
+		return FLAC__STREAM_ENCODER_INIT_STATUS_ENCODER_ERROR;
+	}
 	encoder->private_->samples_written = 0;
 	encoder->protected_->streaminfo_offset = 0;
 	encoder->protected_->seektable_offset = 0;
@@ -1181,11 +1401,11 @@ static FLAC__StreamEncoderInitStatus init_stream_internal_(
 	 */
 	if(encoder->protected_->verify)
 		encoder->private_->verify.state_hint = ENCODER_IN_MAGIC;
-	if(!FLAC__bitwriter_write_raw_uint32(encoder->private_->frame, FLAC__STREAM_SYNC, FLAC__STREAM_SYNC_LEN)) {
+	if(!FLAC__bitwriter_write_raw_uint32(encoder->private_->threadtask[0]->frame, FLAC__STREAM_SYNC, FLAC__STREAM_SYNC_LEN)) {
 		encoder->protected_->state = FLAC__STREAM_ENCODER_FRAMING_ERROR;
 		return FLAC__STREAM_ENCODER_INIT_STATUS_ENCODER_ERROR;
 	}
-	if(!write_bitbuffer_(encoder, 0, /*is_last_block=*/false)) {
+	if(!write_bitbuffer_(encoder, encoder->private_->threadtask[0], 0, /*is_last_block=*/false)) {
 		/* the above function sets the state for us in case of an error */
 		return FLAC__STREAM_ENCODER_INIT_STATUS_ENCODER_ERROR;
 	}
@@ -1207,13 +1427,19 @@ static FLAC__StreamEncoderInitStatus init_stream_internal_(
 	encoder->private_->streaminfo.data.stream_info.bits_per_sample = encoder->protected_->bits_per_sample;
 	encoder->private_->streaminfo.data.stream_info.total_samples = encoder->protected_->total_samples_estimate; /* we will replace this later with the real total */
 	memset(encoder->private_->streaminfo.data.stream_info.md5sum, 0, 16); /* we don't know this yet; have to fill it in later */
-	if(encoder->protected_->do_md5)
-		FLAC__MD5Init(&encoder->private_->md5context);
-	if(!FLAC__add_metadata_block(&encoder->private_->streaminfo, encoder->private_->frame)) {
+	if(encoder->protected_->do_md5) {
+		FLAC__MD5Init(&encoder->private_->md5context, &encoder->private_->allocator);
+#ifdef HAVE_PTHREAD
+		/* if the thread cannot be started, the sum is just computed inline */
+		if(encoder->protected_->threaded_md5)
+			encoder->private_->md5_worker = FLAC__MD5WorkerStart(&encoder->private_->md5context);
+#endif
+	}
+	if(!FLAC__add_metadata_block(&encoder->private_->streaminfo, encoder->private_->threadtask[0]->frame)) {
 		encoder->protected_->state = FLAC__STREAM_ENCODER_FRAMING_ERROR;
 		return FLAC__STREAM_ENCODER_INIT_STATUS_ENCODER_ERROR;
 	}
-	if(!write_bitbuffer_(encoder, 0, /*is_last_block=*/false)) {
+	if(!write_bitbuffer_(encoder, encoder->private_->threadtask[0], 0, /*is_last_block=*/false)) {
 		/* the above function sets the state for us in case of an error */
 		return FLAC__STREAM_ENCODER_INIT_STATUS_ENCODER_ERROR;
 	}
@@ -1245,11 +1471,11 @@ static FLAC__StreamEncoderInitStatus init_stream_internal_(
 		vorbis_comment.data.vorbis_comment.vendor_string.entry = 0;
 		vorbis_comment.data.vorbis_comment.num_comments = 0;
 		vorbis_comment.data.vorbis_comment.comments = 0;
-		if(!FLAC__add_metadata_block(&vorbis_comment, encoder->private_->frame)) {
+		if(!FLAC__add_metadata_block(&vorbis_comment, encoder->private_->threadtask[0]->frame)) {
 			encoder->protected_->state = FLAC__STREAM_ENCODER_FRAMING_ERROR;
 			return FLAC__STREAM_ENCODER_INIT_STATUS_ENCODER_ERROR;
 		}
-		if(!write_bitbuffer_(encoder, 0, /*is_last_block=*/false)) {
+		if(!write_bitbuffer_(encoder, encoder->private_->threadtask[0], 0, /*is_last_block=*/false)) {
 			/* the above function sets the state for us in case of an error */
 			return FLAC__STREAM_ENCODER_INIT_STATUS_ENCODER_ERROR;
 		}
@@ -1260,11 +1486,11 @@ static FLAC__StreamEncoderInitStatus init_stream_internal_(
 	 */
 	for(i = 0; i < encoder->protected_->num_metadata_blocks; i++) {
 		encoder->protected_->metadata[i]->is_last = (i == encoder->protected_->num_metadata_blocks - 1);
-		if(!FLAC__add_metadata_block(encoder->protected_->metadata[i], encoder->private_->frame)) {
+		if(!FLAC__add_metadata_block(encoder->protected_->metadata[i], encoder->private_->threadtask[0]->frame)) {
 			encoder->protected_->state = FLAC__STREAM_ENCODER_FRAMING_ERROR;
 			return FLAC__STREAM_ENCODER_INIT_STATUS_ENCODER_ERROR;
 		}
-		if(!write_bitbuffer_(encoder, 0, /*is_last_block=*/false)) {
+		if(!write_bitbuffer_(encoder, encoder->private_->threadtask[0], 0, /*is_last_block=*/false)) {
 			/* the above function sets the state for us in case of an error */
 			return FLAC__STREAM_ENCODER_INIT_STATUS_ENCODER_ERROR;
 		}
@@ -1465,7 +1691,71 @@ FLAC_API FLAC__StreamEncoderInitStatus FLAC__stream_encoder_init_ogg_file(
 	return init_file_internal_(encoder, filename, progress_callback, client_data, /*is_ogg=*/true);
 }
 
-FLAC_API FLAC__bool FLAC__stream_encoder_finish(FLAC__StreamEncoder *encoder)
+FLAC_API FLAC__StreamEncoderInitStatus FLAC__stream_encoder_init_memory(
+	FLAC__StreamEncoder *encoder,
+	FLAC__StreamEncoderProgressCallback progress_callback,
+	void *client_data
+)
+{
+	FLAC__StreamEncoderInitStatus init_status;
+
+	FLAC__ASSERT(0 != encoder);
+
+	if(encoder->protected_->state != FLAC__STREAM_ENCODER_UNINITIALIZED)
+		return FLAC__STREAM_ENCODER_INIT_STATUS_ALREADY_INITIALIZED;
+
+	encoder->private_->is_memory = true;
+	encoder->private_->memory_length = encoder->private_->memory_position = 0;
+
+	encoder->private_->progress_callback = progress_callback;
+	encoder->private_->bytes_written = 0;
+	encoder->private_->samples_written = 0;
+	encoder->private_->frames_written = 0;
+
+	init_status = init_stream_internal_(
+		encoder,
+		/*read_callback=*/0,
+		memory_write_callback_,
+		memory_seek_callback_,
+		memory_tell_callback_,
+		/*metadata_callback=*/0,
+		client_data,
+		/*is_ogg=*/false
+	);
+	if(init_status != FLAC__STREAM_ENCODER_INIT_STATUS_OK) {
+		/* the above function sets the state for us in case of an error */
+		encoder->private_->is_memory = false;
+		return init_status;
+	}
+
+	{
+		uint32_t blocksize = FLAC__stream_encoder_get_blocksize(encoder);
+
+		FLAC__ASSERT(blocksize != 0);
+		encoder->private_->total_frames_estimate = (uint32_t)((FLAC__stream_encoder_get_total_samples_estimate(encoder) + blocksize - 1) / blocksize);
+	}
+
+	return init_status;
+}
+
+/* takes the place of the FILE handling in FLAC__stream_encoder_finish()
+ * for FLAC__stream_encoder_init_memory(); the stream goes to data/length
+ * if they are given and there was no error, else it is thrown away
+ */
+static void finish_memory_(FLAC__StreamEncoder *encoder, FLAC__bool error, FLAC__byte **data, size_t *length)
+{
+	if(0 != data && !error) {
+		*data = encoder->private_->memory;
+		*length = encoder->private_->memory_length;
+	}
+	else
+		FLAC__memory_free(&encoder->private_->allocator, encoder->private_->memory);
+	encoder->private_->is_memory = false;
+	encoder->private_->memory = 0;
+	encoder->private_->memory_length = encoder->private_->memory_capacity = encoder->private_->memory_position = 0;
+}
+
+static FLAC__bool finish_internal_(FLAC__StreamEncoder *encoder, FLAC__byte **data, size_t *length)
 {
 	FLAC__bool error = false;
 
@@ -1478,6 +1768,14 @@ FLAC_API FLAC__bool FLAC__stream_encoder_finish(FLAC__StreamEncoder *encoder)
 	if(encoder->protected_->state == FLAC__STREAM_ENCODER_UNINITIALIZED)
 		return true;
 
+#ifdef HAVE_PTHREAD
+	/* the frames still being worked on have to go out before the last one */
+	if(encoder->protected_->state == FLAC__STREAM_ENCODER_OK && !encoder->private_->is_being_deleted && encoder->private_->num_threadtasks > 1) {
+		if(!write_finished_frames_(encoder, /*wait_for_all=*/true))
+			error = true;
+	}
+#endif
+
 	if(encoder->protected_->state == FLAC__STREAM_ENCODER_OK && !encoder->private_->is_being_deleted) {
 		if(encoder->private_->current_sample_number != 0) {
 			const FLAC__bool is_fractional_block = encoder->protected_->blocksize != encoder->private_->current_sample_number;
@@ -1487,8 +1785,15 @@ FLAC_API FLAC__bool FLAC__stream_encoder_finish(FLAC__StreamEncoder *encoder)
 		}
 	}
 
-	if(encoder->protected_->do_md5)
+	if(encoder->protected_->do_md5) {
+#ifdef HAVE_PTHREAD
+		if(0 != encoder->private_->md5_worker) {
+			FLAC__MD5WorkerFinish(encoder->private_->md5_worker);
+			encoder->private_->md5_worker = 0;
+		}
+#endif
 		FLAC__MD5Final(encoder->private_->streaminfo.data.stream_info.md5sum, &encoder->private_->md5context);
+	}
 
 	if(!encoder->private_->is_being_deleted) {
 		if(encoder->protected_->state == FLAC__STREAM_ENCODER_OK) {
@@ -1515,12 +1820,22 @@ FLAC_API FLAC__bool FLAC__stream_encoder_finish(FLAC__StreamEncoder *encoder)
 		}
 	}
 
+	/* drop the room left for more points */
+	if(0 != encoder->private_->frame_index && !FLAC__metadata_object_seektable_resize_points(encoder->private_->frame_index, encoder->private_->frame_index_points)) {
+		if(!error)
+			encoder->protected_->state = FLAC__STREAM_ENCODER_MEMORY_ALLOCATION_ERROR;
+		error = true;
+	}
+
 	if(0 != encoder->private_->file) {
 		if(encoder->private_->file != stdout)
 			fclose(encoder->private_->file);
 		encoder->private_->file = 0;
 	}
 
+	if(encoder->private_->is_memory)
+		finish_memory_(encoder, error, data, length);
+
 #if FLAC__HAS_OGG
 	if(encoder->private_->is_ogg)
 		FLAC__ogg_encoder_aspect_finish(&encoder->protected_->ogg_encoder_aspect);
@@ -1535,6 +1850,22 @@ FLAC_API FLAC__bool FLAC__stream_encoder_finish(FLAC__StreamEncoder *encoder)
 	return !error;
 }
 
+FLAC_API FLAC__bool FLAC__stream_encoder_finish(FLAC__StreamEncoder *encoder)
+{
+	return finish_internal_(encoder, /*data=*/0, /*length=*/0);
+}
+
+FLAC_API FLAC__bool FLAC__stream_encoder_finish_memory(FLAC__StreamEncoder *encoder, FLAC__byte **data, size_t *length)
+{
+	FLAC__ASSERT(0 != data);
+	FLAC__ASSERT(0 != length);
+
+	*data = 0;
+	*length = 0;
+
+	return finish_internal_(encoder, data, length);
+}
+
 FLAC_API FLAC__bool FLAC__stream_encoder_set_ogg_serial_number(FLAC__StreamEncoder *encoder, long value)
 {
 	FLAC__ASSERT(0 != encoder);
@@ -1898,38 +2229,105 @@ FLAC_API FLAC__bool FLAC__stream_encoder_set_rice_parameter_search_dist(FLAC__St
 	return true;
 }
 
-FLAC_API FLAC__bool FLAC__stream_encoder_set_total_samples_estimate(FLAC__StreamEncoder *encoder, FLAC__uint64 value)
+FLAC_API FLAC__bool FLAC__stream_encoder_set_num_threads(FLAC__StreamEncoder *encoder, uint32_t value)
 {
 	FLAC__ASSERT(0 != encoder);
 	FLAC__ASSERT(0 != encoder->private_);
 	FLAC__ASSERT(0 != encoder->protected_);
 	if(encoder->protected_->state != FLAC__STREAM_ENCODER_UNINITIALIZED)
 		return false;
-	value = flac_min(value, (FLAC__U64L(1) << FLAC__STREAM_METADATA_STREAMINFO_TOTAL_SAMPLES_LEN) - 1);
-	encoder->protected_->total_samples_estimate = value;
+	if(value == 0 || value > FLAC__STREAM_ENCODER_MAX_THREADS)
+		return false;
+#ifndef HAVE_PTHREAD
+	if(value > 1)
+		return false;
+#endif
+	encoder->protected_->num_threads = value;
 	return true;
 }
 
-FLAC_API FLAC__bool FLAC__stream_encoder_set_metadata(FLAC__StreamEncoder *encoder, FLAC__StreamMetadata **metadata, uint32_t num_blocks)
+FLAC_API FLAC__bool FLAC__stream_encoder_set_parallel_subframes(FLAC__StreamEncoder *encoder, FLAC__bool value)
 {
 	FLAC__ASSERT(0 != encoder);
 	FLAC__ASSERT(0 != encoder->private_);
 	FLAC__ASSERT(0 != encoder->protected_);
 	if(encoder->protected_->state != FLAC__STREAM_ENCODER_UNINITIALIZED)
 		return false;
-	if(0 == metadata)
-		num_blocks = 0;
-	if(0 == num_blocks)
-		metadata = 0;
-	/* realloc() does not do exactly what we want so... */
-	if(encoder->protected_->metadata) {
-		free(encoder->protected_->metadata);
-		encoder->protected_->metadata = 0;
-		encoder->protected_->num_metadata_blocks = 0;
-	}
+	encoder->protected_->parallel_subframes = value;
+	return true;
+}
+
+FLAC_API FLAC__bool FLAC__stream_encoder_set_threaded_md5(FLAC__StreamEncoder *encoder, FLAC__bool value)
+{
+	FLAC__ASSERT(0 != encoder);
+	FLAC__ASSERT(0 != encoder->private_);
+	FLAC__ASSERT(0 != encoder->protected_);
+	if(encoder->protected_->state != FLAC__STREAM_ENCODER_UNINITIALIZED)
+		return false;
+#ifndef HAVE_PTHREAD
+	if(value)
+		return false;
+#endif
+	encoder->protected_->threaded_md5 = value;
+	return true;
+}
+
+FLAC_API FLAC__bool FLAC__stream_encoder_set_keep_buffers(FLAC__StreamEncoder *encoder, FLAC__bool value)
+{
+	FLAC__ASSERT(0 != encoder);
+	FLAC__ASSERT(0 != encoder->private_);
+	FLAC__ASSERT(0 != encoder->protected_);
+	if(encoder->protected_->state != FLAC__STREAM_ENCODER_UNINITIALIZED)
+		return false;
+	encoder->protected_->keep_buffers = value;
+	return true;
+}
+
+FLAC_API FLAC__bool FLAC__stream_encoder_set_total_samples_estimate(FLAC__StreamEncoder *encoder, FLAC__uint64 value)
+{
+	FLAC__ASSERT(0 != encoder);
+	FLAC__ASSERT(0 != encoder->private_);
+	FLAC__ASSERT(0 != encoder->protected_);
+	if(encoder->protected_->state != FLAC__STREAM_ENCODER_UNINITIALIZED)
+		return false;
+	value = flac_min(value, (FLAC__U64L(1) << FLAC__STREAM_METADATA_STREAMINFO_TOTAL_SAMPLES_LEN) - 1);
+	encoder->protected_->total_samples_estimate = value;
+	return true;
+}
+
+FLAC_API FLAC__bool FLAC__stream_encoder_set_frame_index(FLAC__StreamEncoder *encoder, FLAC__StreamMetadata *index)
+{
+	FLAC__ASSERT(0 != encoder);
+	FLAC__ASSERT(0 != encoder->private_);
+	FLAC__ASSERT(0 != encoder->protected_);
+	if(encoder->protected_->state != FLAC__STREAM_ENCODER_UNINITIALIZED)
+		return false;
+	if(0 != index && index->type != FLAC__METADATA_TYPE_SEEKTABLE)
+		return false;
+	encoder->private_->frame_index = index;
+	return true;
+}
+
+FLAC_API FLAC__bool FLAC__stream_encoder_set_metadata(FLAC__StreamEncoder *encoder, FLAC__StreamMetadata **metadata, uint32_t num_blocks)
+{
+	FLAC__ASSERT(0 != encoder);
+	FLAC__ASSERT(0 != encoder->private_);
+	FLAC__ASSERT(0 != encoder->protected_);
+	if(encoder->protected_->state != FLAC__STREAM_ENCODER_UNINITIALIZED)
+		return false;
+	if(0 == metadata)
+		num_blocks = 0;
+	if(0 == num_blocks)
+		metadata = 0;
+	/* realloc() does not do exactly what we want so... */
+	if(encoder->protected_->metadata) {
+		FLAC__memory_free(&encoder->private_->allocator, encoder->protected_->metadata);
+		encoder->protected_->metadata = 0;
+		encoder->protected_->num_metadata_blocks = 0;
+	}
 	if(num_blocks) {
 		FLAC__StreamMetadata **m;
-		if(0 == (m = safe_malloc_mul_2op_p(sizeof(m[0]), /*times*/num_blocks)))
+		if(0 == (m = FLAC__memory_malloc_mul_2op(&encoder->private_->allocator, sizeof(m[0]), /*times*/num_blocks)))
 			return false;
 		memcpy(m, metadata, sizeof(m[0]) * num_blocks);
 		encoder->protected_->metadata = m;
@@ -2164,6 +2562,38 @@ FLAC_API uint32_t FLAC__stream_encoder_get_rice_parameter_search_dist(const FLAC
 	return encoder->protected_->rice_parameter_search_dist;
 }
 
+FLAC_API uint32_t FLAC__stream_encoder_get_num_threads(const FLAC__StreamEncoder *encoder)
+{
+	FLAC__ASSERT(0 != encoder);
+	FLAC__ASSERT(0 != encoder->private_);
+	FLAC__ASSERT(0 != encoder->protected_);
+	return encoder->protected_->num_threads;
+}
+
+FLAC_API FLAC__bool FLAC__stream_encoder_get_parallel_subframes(const FLAC__StreamEncoder *encoder)
+{
+	FLAC__ASSERT(0 != encoder);
+	FLAC__ASSERT(0 != encoder->private_);
+	FLAC__ASSERT(0 != encoder->protected_);
+	return encoder->protected_->parallel_subframes;
+}
+
+FLAC_API FLAC__bool FLAC__stream_encoder_get_threaded_md5(const FLAC__StreamEncoder *encoder)
+{
+	FLAC__ASSERT(0 != encoder);
+	FLAC__ASSERT(0 != encoder->private_);
+	FLAC__ASSERT(0 != encoder->protected_);
+	return encoder->protected_->threaded_md5;
+}
+
+FLAC_API FLAC__bool FLAC__stream_encoder_get_keep_buffers(const FLAC__StreamEncoder *encoder)
+{
+	FLAC__ASSERT(0 != encoder);
+	FLAC__ASSERT(0 != encoder->private_);
+	FLAC__ASSERT(0 != encoder->protected_);
+	return encoder->protected_->keep_buffers;
+}
+
 FLAC_API FLAC__uint64 FLAC__stream_encoder_get_total_samples_estimate(const FLAC__StreamEncoder *encoder)
 {
 	FLAC__ASSERT(0 != encoder);
@@ -2172,6 +2602,29 @@ FLAC_API FLAC__uint64 FLAC__stream_encoder_get_total_samples_estimate(const FLAC
 	return encoder->protected_->total_samples_estimate;
 }
 
+FLAC_API FLAC__bool FLAC__stream_encoder_get_statistics(const FLAC__StreamEncoder *encoder, FLAC__StreamEncoderStatistics *statistics)
+{
+	FLAC__ASSERT(0 != encoder);
+	FLAC__ASSERT(0 != encoder->private_);
+	FLAC__ASSERT(0 != statistics);
+#ifdef FLAC__ENABLE_STATISTICS
+	*statistics = encoder->private_->statistics;
+	return true;
+#else
+	(void)encoder;
+	memset(statistics, 0, sizeof(*statistics));
+	return false;
+#endif
+}
+
+FLAC_API const char *FLAC__stream_encoder_get_kernel(const FLAC__StreamEncoder *encoder, FLAC__StreamEncoderKernel kernel)
+{
+	FLAC__ASSERT(0 != encoder);
+	FLAC__ASSERT(0 != encoder->private_);
+	FLAC__ASSERT(kernel < FLAC__STREAM_ENCODER_KERNEL_COUNT);
+	return encoder->private_->kernel_name[kernel];
+}
+
 FLAC_API FLAC__bool FLAC__stream_encoder_process(FLAC__StreamEncoder *encoder, const FLAC__int32 * const buffer[], uint32_t samples)
 {
 	uint32_t i, j = 0, channel;
@@ -2192,15 +2645,15 @@ FLAC_API FLAC__bool FLAC__stream_encoder_process(FLAC__StreamEncoder *encoder, c
 			if (buffer[channel] == NULL) {
 				return false;
 			}
-			memcpy(&encoder->private_->integer_signal[channel][encoder->private_->current_sample_number], &buffer[channel][j], sizeof(buffer[channel][0]) * n);
+			memcpy(&encoder->private_->threadtask[0]->integer_signal[channel][encoder->private_->current_sample_number], &buffer[channel][j], sizeof(buffer[channel][0]) * n);
 		}
 
 		if(encoder->protected_->do_mid_side_stereo) {
 			FLAC__ASSERT(channels == 2);
 			/* "i <= blocksize" to overread 1 sample; see comment in OVERREAD_ decl */
 			for(i = encoder->private_->current_sample_number; i <= blocksize && j < samples; i++, j++) {
-				encoder->private_->integer_signal_mid_side[1][i] = buffer[0][j] - buffer[1][j];
-				encoder->private_->integer_signal_mid_side[0][i] = (buffer[0][j] + buffer[1][j]) >> 1; /* NOTE: not the same as 'mid = (buffer[0][j] + buffer[1][j]) / 2' ! */
+				encoder->private_->threadtask[0]->integer_signal_mid_side[1][i] = buffer[0][j] - buffer[1][j];
+				encoder->private_->threadtask[0]->integer_signal_mid_side[0][i] = (buffer[0][j] + buffer[1][j]) >> 1; /* NOTE: not the same as 'mid = (buffer[0][j] + buffer[1][j]) / 2' ! */
 			}
 		}
 		else
@@ -2216,10 +2669,10 @@ FLAC_API FLAC__bool FLAC__stream_encoder_process(FLAC__StreamEncoder *encoder, c
 				return false;
 			/* move unprocessed overread samples to beginnings of arrays */
 			for(channel = 0; channel < channels; channel++)
-				encoder->private_->integer_signal[channel][0] = encoder->private_->integer_signal[channel][blocksize];
+				encoder->private_->threadtask[0]->integer_signal[channel][0] = encoder->private_->threadtask[0]->integer_signal[channel][blocksize];
 			if(encoder->protected_->do_mid_side_stereo) {
-				encoder->private_->integer_signal_mid_side[0][0] = encoder->private_->integer_signal_mid_side[0][blocksize];
-				encoder->private_->integer_signal_mid_side[1][0] = encoder->private_->integer_signal_mid_side[1][blocksize];
+				encoder->private_->threadtask[0]->integer_signal_mid_side[0][0] = encoder->private_->threadtask[0]->integer_signal_mid_side[0][blocksize];
+				encoder->private_->threadtask[0]->integer_signal_mid_side[1][0] = encoder->private_->threadtask[0]->integer_signal_mid_side[1][blocksize];
 			}
 			encoder->private_->current_sample_number = 1;
 		}
@@ -2254,14 +2707,14 @@ FLAC_API FLAC__bool FLAC__stream_encoder_process_interleaved(FLAC__StreamEncoder
 
 			/* "i <= blocksize" to overread 1 sample; see comment in OVERREAD_ decl */
 			for(i = encoder->private_->current_sample_number; i <= blocksize && j < samples; i++, j++) {
-				encoder->private_->integer_signal[0][i] = mid = side = buffer[k++];
+				encoder->private_->threadtask[0]->integer_signal[0][i] = mid = side = buffer[k++];
 				x = buffer[k++];
-				encoder->private_->integer_signal[1][i] = x;
+				encoder->private_->threadtask[0]->integer_signal[1][i] = x;
 				mid += x;
 				side -= x;
 				mid >>= 1; /* NOTE: not the same as 'mid = (left + right) / 2' ! */
-				encoder->private_->integer_signal_mid_side[1][i] = side;
-				encoder->private_->integer_signal_mid_side[0][i] = mid;
+				encoder->private_->threadtask[0]->integer_signal_mid_side[1][i] = side;
+				encoder->private_->threadtask[0]->integer_signal_mid_side[0][i] = mid;
 			}
 			encoder->private_->current_sample_number = i;
 			/* we only process if we have a full block + 1 extra sample; final block is always handled by FLAC__stream_encoder_finish() */
@@ -2271,10 +2724,10 @@ FLAC_API FLAC__bool FLAC__stream_encoder_process_interleaved(FLAC__StreamEncoder
 				/* move unprocessed overread samples to beginnings of arrays */
 				FLAC__ASSERT(i == blocksize+OVERREAD_);
 				FLAC__ASSERT(OVERREAD_ == 1); /* assert we only overread 1 sample which simplifies the rest of the code below */
-				encoder->private_->integer_signal[0][0] = encoder->private_->integer_signal[0][blocksize];
-				encoder->private_->integer_signal[1][0] = encoder->private_->integer_signal[1][blocksize];
-				encoder->private_->integer_signal_mid_side[0][0] = encoder->private_->integer_signal_mid_side[0][blocksize];
-				encoder->private_->integer_signal_mid_side[1][0] = encoder->private_->integer_signal_mid_side[1][blocksize];
+				encoder->private_->threadtask[0]->integer_signal[0][0] = encoder->private_->threadtask[0]->integer_signal[0][blocksize];
+				encoder->private_->threadtask[0]->integer_signal[1][0] = encoder->private_->threadtask[0]->integer_signal[1][blocksize];
+				encoder->private_->threadtask[0]->integer_signal_mid_side[0][0] = encoder->private_->threadtask[0]->integer_signal_mid_side[0][blocksize];
+				encoder->private_->threadtask[0]->integer_signal_mid_side[1][0] = encoder->private_->threadtask[0]->integer_signal_mid_side[1][blocksize];
 				encoder->private_->current_sample_number = 1;
 			}
 		} while(j < samples);
@@ -2290,7 +2743,7 @@ FLAC_API FLAC__bool FLAC__stream_encoder_process_interleaved(FLAC__StreamEncoder
 			/* "i <= blocksize" to overread 1 sample; see comment in OVERREAD_ decl */
 			for(i = encoder->private_->current_sample_number; i <= blocksize && j < samples; i++, j++) {
 				for(channel = 0; channel < channels; channel++)
-					encoder->private_->integer_signal[channel][i] = buffer[k++];
+					encoder->private_->threadtask[0]->integer_signal[channel][i] = buffer[k++];
 			}
 			encoder->private_->current_sample_number = i;
 			/* we only process if we have a full block + 1 extra sample; final block is always handled by FLAC__stream_encoder_finish() */
@@ -2301,7 +2754,7 @@ FLAC_API FLAC__bool FLAC__stream_encoder_process_interleaved(FLAC__StreamEncoder
 				FLAC__ASSERT(i == blocksize+OVERREAD_);
 				FLAC__ASSERT(OVERREAD_ == 1); /* assert we only overread 1 sample which simplifies the rest of the code below */
 				for(channel = 0; channel < channels; channel++)
-					encoder->private_->integer_signal[channel][0] = encoder->private_->integer_signal[channel][blocksize];
+					encoder->private_->threadtask[0]->integer_signal[channel][0] = encoder->private_->threadtask[0]->integer_signal[channel][blocksize];
 				encoder->private_->current_sample_number = 1;
 			}
 		} while(j < samples);
@@ -2310,12 +2763,101 @@ FLAC_API FLAC__bool FLAC__stream_encoder_process_interleaved(FLAC__StreamEncoder
 	return true;
 }
 
+FLAC_API FLAC__bool FLAC__stream_encoder_process_interleaved_int16(FLAC__StreamEncoder *encoder, const FLAC__int16 buffer[], uint32_t samples)
+{
+	FLAC__ASSERT(0 != encoder);
+	FLAC__ASSERT(0 != encoder->private_);
+	return process_interleaved_pcm_(encoder, encoder->private_->local_pcm_deinterleave_int16, (const FLAC__byte*)buffer, sizeof(FLAC__int16), samples);
+}
+
+FLAC_API FLAC__bool FLAC__stream_encoder_process_interleaved_int24(FLAC__StreamEncoder *encoder, const FLAC__byte buffer[], uint32_t samples)
+{
+	FLAC__ASSERT(0 != encoder);
+	FLAC__ASSERT(0 != encoder->private_);
+	return process_interleaved_pcm_(encoder, encoder->private_->local_pcm_deinterleave_int24, buffer, 3, samples);
+}
+
+FLAC_API FLAC__bool FLAC__stream_encoder_process_interleaved_float32(FLAC__StreamEncoder *encoder, const float buffer[], uint32_t samples)
+{
+	FLAC__ASSERT(0 != encoder);
+	FLAC__ASSERT(0 != encoder->private_);
+#ifdef FLAC__INTEGER_ONLY_LIBRARY
+	(void)buffer, (void)samples;
+	encoder->protected_->state = FLAC__STREAM_ENCODER_CLIENT_ERROR;
+	return false;
+#else
+	return process_interleaved_pcm_(encoder, encoder->private_->local_pcm_deinterleave_float32, (const FLAC__byte*)buffer, sizeof(float), samples);
+#endif
+}
+
 /***********************************************************************
  *
  * Private class methods
  *
  ***********************************************************************/
 
+/*
+ * Common part of the process_interleaved_*() flavors that take samples
+ * narrower than FLAC__int32: each stretch is split straight into
+ * integer_signal[] instead of going through an intermediate int32 buffer.
+ */
+FLAC__bool process_interleaved_pcm_(FLAC__StreamEncoder *encoder, FLAC__PCMDeinterleaveFunction deinterleave, const FLAC__byte *buffer, uint32_t sample_bytes, uint32_t samples)
+{
+	FLAC__int32 *signal[FLAC__MAX_CHANNELS];
+	uint32_t i, j = 0, channel;
+	const uint32_t channels = encoder->protected_->channels, blocksize = encoder->protected_->blocksize;
+	FLAC__StreamEncoderThreadTask *threadtask = encoder->private_->threadtask[0];
+
+	FLAC__ASSERT(0 != encoder);
+	FLAC__ASSERT(0 != encoder->private_);
+	FLAC__ASSERT(0 != encoder->protected_);
+	FLAC__ASSERT(encoder->protected_->state == FLAC__STREAM_ENCODER_OK);
+
+	do {
+		const uint32_t start = encoder->private_->current_sample_number;
+		const uint32_t n = flac_min(blocksize+OVERREAD_-start, samples-j);
+
+		for(channel = 0; channel < channels; channel++)
+			signal[channel] = threadtask->integer_signal[channel] + start;
+		if(!deinterleave(buffer + (size_t)j * channels * sample_bytes, channels, n, encoder->protected_->bits_per_sample, signal)) {
+			encoder->protected_->state = FLAC__STREAM_ENCODER_CLIENT_ERROR;
+			return false;
+		}
+
+		if(encoder->protected_->verify)
+			append_to_verify_fifo_(&encoder->private_->verify.input_fifo, (const FLAC__int32 * const *)signal, 0, channels, n);
+
+		if(encoder->protected_->do_mid_side_stereo && channels == 2) {
+			const FLAC__int32 *left = threadtask->integer_signal[0], *right = threadtask->integer_signal[1];
+			for(i = start; i < start + n; i++) {
+				threadtask->integer_signal_mid_side[1][i] = left[i] - right[i];
+				threadtask->integer_signal_mid_side[0][i] = (left[i] + right[i]) >> 1; /* NOTE: not the same as 'mid = (left[i] + right[i]) / 2' ! */
+			}
+		}
+
+		j += n;
+		encoder->private_->current_sample_number += n;
+
+		/* we only process if we have a full block + 1 extra sample; final block is always handled by FLAC__stream_encoder_finish() */
+		if(encoder->private_->current_sample_number > blocksize) {
+			FLAC__ASSERT(encoder->private_->current_sample_number == blocksize+OVERREAD_);
+			FLAC__ASSERT(OVERREAD_ == 1); /* assert we only overread 1 sample which simplifies the rest of the code below */
+			if(!process_frame_(encoder, /*is_fractional_block=*/false, /*is_last_block=*/false))
+				return false;
+			/* move unprocessed overread samples to beginnings of arrays */
+			for(channel = 0; channel < channels; channel++)
+				threadtask->integer_signal[channel][0] = threadtask->integer_signal[channel][blocksize];
+			if(encoder->protected_->do_mid_side_stereo && channels == 2) {
+				threadtask->integer_signal_mid_side[0][0] = threadtask->integer_signal_mid_side[0][blocksize];
+				threadtask->integer_signal_mid_side[1][0] = threadtask->integer_signal_mid_side[1][blocksize];
+			}
+			encoder->private_->current_sample_number = 1;
+		}
+	} while(j < samples);
+
+	return true;
+}
+
 void set_defaults_(FLAC__StreamEncoder *encoder)
 {
 	FLAC__ASSERT(0 != encoder);
@@ -2346,11 +2888,16 @@ void set_defaults_(FLAC__StreamEncoder *encoder)
 	encoder->protected_->min_residual_partition_order = 0;
 	encoder->protected_->max_residual_partition_order = 0;
 	encoder->protected_->rice_parameter_search_dist = 0;
+	encoder->protected_->num_threads = 1;
+	encoder->protected_->parallel_subframes = false;
+	encoder->protected_->threaded_md5 = false;
+	encoder->protected_->keep_buffers = false;
 	encoder->protected_->total_samples_estimate = 0;
 	encoder->protected_->metadata = 0;
 	encoder->protected_->num_metadata_blocks = 0;
 
 	encoder->private_->seek_table = 0;
+	encoder->private_->frame_index = 0;
 	encoder->private_->disable_constant_subframes = false;
 	encoder->private_->disable_fixed_subframes = false;
 	encoder->private_->disable_verbatim_subframes = false;
@@ -2372,97 +2919,266 @@ void set_defaults_(FLAC__StreamEncoder *encoder)
 
 void free_(FLAC__StreamEncoder *encoder)
 {
-	uint32_t i, channel;
+	uint32_t i;
 
 	FLAC__ASSERT(0 != encoder);
+#ifdef HAVE_PTHREAD
+	if(encoder->private_->num_started_threads > 0)
+		stop_threads_(encoder);
+#endif
 	if(encoder->protected_->metadata) {
-		free(encoder->protected_->metadata);
+		FLAC__memory_free(&encoder->private_->allocator, encoder->protected_->metadata);
 		encoder->protected_->metadata = 0;
 		encoder->protected_->num_metadata_blocks = 0;
 	}
-	for(i = 0; i < encoder->protected_->channels; i++) {
-		if(0 != encoder->private_->integer_signal_unaligned[i]) {
-			free(encoder->private_->integer_signal_unaligned[i]);
-			encoder->private_->integer_signal_unaligned[i] = 0;
-		}
 #ifndef FLAC__INTEGER_ONLY_LIBRARY
+	for(i = 0; i < encoder->protected_->channels; i++) {
 		if(0 != encoder->private_->real_signal_unaligned[i]) {
-			free(encoder->private_->real_signal_unaligned[i]);
+			FLAC__memory_free(&encoder->private_->allocator, encoder->private_->real_signal_unaligned[i]);
 			encoder->private_->real_signal_unaligned[i] = 0;
 		}
-#endif
 	}
 	for(i = 0; i < 2; i++) {
-		if(0 != encoder->private_->integer_signal_mid_side_unaligned[i]) {
-			free(encoder->private_->integer_signal_mid_side_unaligned[i]);
-			encoder->private_->integer_signal_mid_side_unaligned[i] = 0;
-		}
-#ifndef FLAC__INTEGER_ONLY_LIBRARY
 		if(0 != encoder->private_->real_signal_mid_side_unaligned[i]) {
-			free(encoder->private_->real_signal_mid_side_unaligned[i]);
+			FLAC__memory_free(&encoder->private_->allocator, encoder->private_->real_signal_mid_side_unaligned[i]);
 			encoder->private_->real_signal_mid_side_unaligned[i] = 0;
 		}
-#endif
 	}
-#ifndef FLAC__INTEGER_ONLY_LIBRARY
 	for(i = 0; i < encoder->protected_->num_apodizations; i++) {
-		if(0 != encoder->private_->window_unaligned[i]) {
-			free(encoder->private_->window_unaligned[i]);
-			encoder->private_->window_unaligned[i] = 0;
+		if(0 != encoder->private_->window_entry[i]) {
+			FLAC__window_cache_release(encoder->private_->window_entry[i]);
+			encoder->private_->window_entry[i] = 0;
+			encoder->private_->window[i] = 0;
 		}
 	}
-	if(0 != encoder->private_->windowed_signal_unaligned) {
-		free(encoder->private_->windowed_signal_unaligned);
-		encoder->private_->windowed_signal_unaligned = 0;
+#endif
+	/* the other tasks are made anew by every init, so only threadtask[0] can keep its buffers; see resize_buffers_() */
+	if(!encoder->protected_->keep_buffers) {
+		free_threadtask_(encoder->private_->threadtask[0]);
+		encoder->private_->input_capacity = 0;
+	}
+	for(i = 1; i < encoder->private_->num_threadtasks; i++) {
+		delete_threadtask_(encoder->private_->threadtask[i]);
+		encoder->private_->threadtask[i] = 0;
 	}
+	encoder->private_->num_threadtasks = 1;
+#ifdef HAVE_PTHREAD
+	for(i = 0; i < encoder->private_->num_subframe_scratch; i++) {
+		clear_subframe_scratch_(encoder->private_->subframe_scratch[i]);
+		FLAC__memory_free(&encoder->private_->allocator, encoder->private_->subframe_scratch[i]);
+		encoder->private_->subframe_scratch[i] = 0;
+	}
+	encoder->private_->num_subframe_scratch = 0;
 #endif
-	for(channel = 0; channel < encoder->protected_->channels; channel++) {
+	if(encoder->protected_->verify) {
+		for(i = 0; i < encoder->protected_->channels; i++) {
+			if(0 != encoder->private_->verify.input_fifo.data[i]) {
+				FLAC__memory_free(&encoder->private_->allocator, encoder->private_->verify.input_fifo.data[i]);
+				encoder->private_->verify.input_fifo.data[i] = 0;
+			}
+		}
+	}
+}
+
+FLAC__StreamEncoderThreadTask *new_threadtask_(const FLAC__Allocator *allocator)
+{
+	FLAC__StreamEncoderThreadTask *threadtask;
+	uint32_t i;
+
+	threadtask = FLAC__memory_calloc(allocator, 1, sizeof(FLAC__StreamEncoderThreadTask));
+	if(threadtask == 0)
+		return 0;
+	threadtask->allocator = allocator;
+
+	threadtask->frame = FLAC__bitwriter_new(allocator);
+	if(threadtask->frame == 0) {
+		FLAC__memory_free(allocator, threadtask);
+		return 0;
+	}
+
+	for(i = 0; i < FLAC__MAX_CHANNELS; i++) {
+		threadtask->subframe_workspace_ptr[i][0] = &threadtask->subframe_workspace[i][0];
+		threadtask->subframe_workspace_ptr[i][1] = &threadtask->subframe_workspace[i][1];
+	}
+	for(i = 0; i < 2; i++) {
+		threadtask->subframe_workspace_ptr_mid_side[i][0] = &threadtask->subframe_workspace_mid_side[i][0];
+		threadtask->subframe_workspace_ptr_mid_side[i][1] = &threadtask->subframe_workspace_mid_side[i][1];
+	}
+	for(i = 0; i < FLAC__MAX_CHANNELS; i++) {
+		threadtask->partitioned_rice_contents_workspace_ptr[i][0] = &threadtask->partitioned_rice_contents_workspace[i][0];
+		threadtask->partitioned_rice_contents_workspace_ptr[i][1] = &threadtask->partitioned_rice_contents_workspace[i][1];
+	}
+	for(i = 0; i < 2; i++) {
+		threadtask->partitioned_rice_contents_workspace_ptr_mid_side[i][0] = &threadtask->partitioned_rice_contents_workspace_mid_side[i][0];
+		threadtask->partitioned_rice_contents_workspace_ptr_mid_side[i][1] = &threadtask->partitioned_rice_contents_workspace_mid_side[i][1];
+	}
+
+	for(i = 0; i < FLAC__MAX_CHANNELS; i++) {
+		FLAC__format_entropy_coding_method_partitioned_rice_contents_init(&threadtask->partitioned_rice_contents_workspace[i][0]);
+		FLAC__format_entropy_coding_method_partitioned_rice_contents_init(&threadtask->partitioned_rice_contents_workspace[i][1]);
+	}
+	for(i = 0; i < 2; i++) {
+		FLAC__format_entropy_coding_method_partitioned_rice_contents_init(&threadtask->partitioned_rice_contents_workspace_mid_side[i][0]);
+		FLAC__format_entropy_coding_method_partitioned_rice_contents_init(&threadtask->partitioned_rice_contents_workspace_mid_side[i][1]);
+	}
+	init_subframe_scratch_(&threadtask->scratch, allocator);
+
+	return threadtask;
+}
+
+/* Frees the per-frame buffers of a task but keeps the task itself. */
+void free_threadtask_(FLAC__StreamEncoderThreadTask *threadtask)
+{
+	uint32_t i, channel;
+
+	FLAC__ASSERT(0 != threadtask);
+	for(i = 0; i < FLAC__MAX_CHANNELS; i++) {
+		if(0 != threadtask->integer_signal_unaligned[i]) {
+			FLAC__memory_free(threadtask->allocator, threadtask->integer_signal_unaligned[i]);
+			threadtask->integer_signal_unaligned[i] = 0;
+		}
+		threadtask->integer_signal[i] = 0;
+	}
+	for(i = 0; i < 2; i++) {
+		if(0 != threadtask->integer_signal_mid_side_unaligned[i]) {
+			FLAC__memory_free(threadtask->allocator, threadtask->integer_signal_mid_side_unaligned[i]);
+			threadtask->integer_signal_mid_side_unaligned[i] = 0;
+		}
+		threadtask->integer_signal_mid_side[i] = 0;
+	}
+	for(channel = 0; channel < FLAC__MAX_CHANNELS; channel++) {
 		for(i = 0; i < 2; i++) {
-			if(0 != encoder->private_->residual_workspace_unaligned[channel][i]) {
-				free(encoder->private_->residual_workspace_unaligned[channel][i]);
-				encoder->private_->residual_workspace_unaligned[channel][i] = 0;
+			if(0 != threadtask->residual_workspace_unaligned[channel][i]) {
+				FLAC__memory_free(threadtask->allocator, threadtask->residual_workspace_unaligned[channel][i]);
+				threadtask->residual_workspace_unaligned[channel][i] = 0;
 			}
+			threadtask->residual_workspace[channel][i] = 0;
 		}
 	}
 	for(channel = 0; channel < 2; channel++) {
 		for(i = 0; i < 2; i++) {
-			if(0 != encoder->private_->residual_workspace_mid_side_unaligned[channel][i]) {
-				free(encoder->private_->residual_workspace_mid_side_unaligned[channel][i]);
-				encoder->private_->residual_workspace_mid_side_unaligned[channel][i] = 0;
+			if(0 != threadtask->residual_workspace_mid_side_unaligned[channel][i]) {
+				FLAC__memory_free(threadtask->allocator, threadtask->residual_workspace_mid_side_unaligned[channel][i]);
+				threadtask->residual_workspace_mid_side_unaligned[channel][i] = 0;
 			}
+			threadtask->residual_workspace_mid_side[channel][i] = 0;
 		}
 	}
-	if(0 != encoder->private_->abs_residual_partition_sums_unaligned) {
-		free(encoder->private_->abs_residual_partition_sums_unaligned);
-		encoder->private_->abs_residual_partition_sums_unaligned = 0;
+	free_subframe_scratch_(&threadtask->scratch);
+	for(channel = 0; channel < FLAC__MAX_CHANNELS; channel++)
+		threadtask->best_subframe[channel] = 0;
+	for(channel = 0; channel < 2; channel++)
+		threadtask->best_subframe_mid_side[channel] = 0;
+	FLAC__bitwriter_free(threadtask->frame);
+}
+
+void delete_threadtask_(FLAC__StreamEncoderThreadTask *threadtask)
+{
+	uint32_t i;
+
+	FLAC__ASSERT(0 != threadtask);
+
+	free_threadtask_(threadtask);
+	clear_subframe_scratch_(&threadtask->scratch);
+
+	for(i = 0; i < FLAC__MAX_CHANNELS; i++) {
+		FLAC__format_entropy_coding_method_partitioned_rice_contents_clear(&threadtask->partitioned_rice_contents_workspace[i][0], threadtask->allocator);
+		FLAC__format_entropy_coding_method_partitioned_rice_contents_clear(&threadtask->partitioned_rice_contents_workspace[i][1], threadtask->allocator);
 	}
-	if(0 != encoder->private_->raw_bits_per_partition_unaligned) {
-		free(encoder->private_->raw_bits_per_partition_unaligned);
-		encoder->private_->raw_bits_per_partition_unaligned = 0;
+	for(i = 0; i < 2; i++) {
+		FLAC__format_entropy_coding_method_partitioned_rice_contents_clear(&threadtask->partitioned_rice_contents_workspace_mid_side[i][0], threadtask->allocator);
+		FLAC__format_entropy_coding_method_partitioned_rice_contents_clear(&threadtask->partitioned_rice_contents_workspace_mid_side[i][1], threadtask->allocator);
 	}
-	if(encoder->protected_->verify) {
-		for(i = 0; i < encoder->protected_->channels; i++) {
-			if(0 != encoder->private_->verify.input_fifo.data[i]) {
-				free(encoder->private_->verify.input_fifo.data[i]);
-				encoder->private_->verify.input_fifo.data[i] = 0;
-			}
-		}
+
+	FLAC__bitwriter_delete(threadtask->frame);
+	FLAC__memory_free(threadtask->allocator, threadtask);
+}
+
+void init_subframe_scratch_(FLAC__StreamEncoderSubframeScratch *scratch, const FLAC__Allocator *allocator)
+{
+	scratch->allocator = allocator;
+#ifdef FLAC__ENABLE_STATISTICS
+	memset(&scratch->statistics, 0, sizeof(scratch->statistics));
+#endif
+	FLAC__format_entropy_coding_method_partitioned_rice_contents_init(&scratch->partitioned_rice_contents_extra[0]);
+	FLAC__format_entropy_coding_method_partitioned_rice_contents_init(&scratch->partitioned_rice_contents_extra[1]);
+}
+
+/* Frees the buffers of the scratch space but keeps the rest for reuse. */
+void free_subframe_scratch_(FLAC__StreamEncoderSubframeScratch *scratch)
+{
+	FLAC__ASSERT(0 != scratch);
+#ifndef FLAC__INTEGER_ONLY_LIBRARY
+	if(0 != scratch->windowed_signal_unaligned) {
+		FLAC__memory_free(scratch->allocator, scratch->windowed_signal_unaligned);
+		scratch->windowed_signal_unaligned = 0;
+	}
+	scratch->windowed_signal = 0;
+#endif
+	if(0 != scratch->abs_residual_partition_sums_unaligned) {
+		FLAC__memory_free(scratch->allocator, scratch->abs_residual_partition_sums_unaligned);
+		scratch->abs_residual_partition_sums_unaligned = 0;
 	}
-	FLAC__bitwriter_free(encoder->private_->frame);
+	scratch->abs_residual_partition_sums = 0;
+	if(0 != scratch->raw_bits_per_partition_unaligned) {
+		FLAC__memory_free(scratch->allocator, scratch->raw_bits_per_partition_unaligned);
+		scratch->raw_bits_per_partition_unaligned = 0;
+	}
+	scratch->raw_bits_per_partition = 0;
+}
+
+void clear_subframe_scratch_(FLAC__StreamEncoderSubframeScratch *scratch)
+{
+	free_subframe_scratch_(scratch);
+	FLAC__format_entropy_coding_method_partitioned_rice_contents_clear(&scratch->partitioned_rice_contents_extra[0], scratch->allocator);
+	FLAC__format_entropy_coding_method_partitioned_rice_contents_clear(&scratch->partitioned_rice_contents_extra[1], scratch->allocator);
+}
+
+FLAC__bool resize_subframe_scratch_(FLAC__StreamEncoder *encoder, FLAC__StreamEncoderSubframeScratch *scratch, uint32_t new_blocksize)
+{
+	FLAC__bool ok = true;
+
+	/* like the buffers in resize_buffers_(), only fill in what is missing */
+#ifndef FLAC__INTEGER_ONLY_LIBRARY
+	if(encoder->protected_->max_lpc_order > 0 && 0 == scratch->windowed_signal_unaligned)
+		ok = ok && FLAC__memory_alloc_aligned_real_array(&encoder->private_->allocator, new_blocksize, &scratch->windowed_signal_unaligned, &scratch->windowed_signal);
+#endif
+	/* the *2 is an approximation to the series 1 + 1/2 + 1/4 + ... that sums tree occupies in a flat array */
+	/*@@@ new_blocksize*2 is too pessimistic, but to fix, we need smarter logic because a smaller new_blocksize can actually increase the # of partitions; would require moving this out into a separate function, then checking its capacity against the need of the current blocksize&min/max_partition_order (and maybe predictor order) */
+	if(0 == scratch->abs_residual_partition_sums_unaligned)
+		ok = ok && FLAC__memory_alloc_aligned_uint64_array(&encoder->private_->allocator, new_blocksize * 2, &scratch->abs_residual_partition_sums_unaligned, &scratch->abs_residual_partition_sums);
+	if(encoder->protected_->do_escape_coding && 0 == scratch->raw_bits_per_partition_unaligned)
+		ok = ok && FLAC__memory_alloc_aligned_unsigned_array(&encoder->private_->allocator, new_blocksize * 2, &scratch->raw_bits_per_partition_unaligned, &scratch->raw_bits_per_partition);
+
+	return ok;
 }
 
 FLAC__bool resize_buffers_(FLAC__StreamEncoder *encoder, uint32_t new_blocksize)
 {
+	/* process_subframe_() always tries a residual-coded subframe in the
+	 * workspace the best one so far is not in; the best one can only be
+	 * in workspace 1 by then if there is more than one such candidate
+	 */
+	const uint32_t first_workspace = (encoder->protected_->max_lpc_order > 0 || encoder->protected_->do_exhaustive_model_search)? 0 : 1;
 	FLAC__bool ok;
-	uint32_t i, channel;
+	uint32_t i, channel, t, capacity;
 
 	FLAC__ASSERT(new_blocksize > 0);
 	FLAC__ASSERT(encoder->protected_->state == FLAC__STREAM_ENCODER_OK);
 	FLAC__ASSERT(encoder->private_->current_sample_number == 0);
 
-	/* To avoid excessive malloc'ing, we only grow the buffer; no shrinking. */
-	if(new_blocksize <= encoder->private_->input_capacity)
-		return true;
+	/* To avoid excessive malloc'ing, we only grow the buffers; no shrinking.
+	 * Buffers left by FLAC__stream_encoder_set_keep_buffers() are reused
+	 * as they are if they are big enough, so only those that the current
+	 * settings need and were not needed before get allocated.  Otherwise
+	 * they all go, so that none is left behind with the old size.
+	 */
+	if(new_blocksize > encoder->private_->input_capacity) {
+		for(t = 0; t < encoder->private_->num_threadtasks; t++)
+			free_threadtask_(encoder->private_->threadtask[t]);
+		encoder->private_->input_capacity = new_blocksize;
+	}
+	capacity = encoder->private_->input_capacity;
 
 	ok = true;
 
@@ -2472,133 +3188,90 @@ FLAC__bool resize_buffers_(FLAC__StreamEncoder *encoder, uint32_t new_blocksize)
 	 * alignment purposes; we use 4 in front to keep the data well-aligned.
 	 */
 
-	for(i = 0; ok && i < encoder->protected_->channels; i++) {
-		ok = ok && FLAC__memory_alloc_aligned_int32_array(new_blocksize+4+OVERREAD_, &encoder->private_->integer_signal_unaligned[i], &encoder->private_->integer_signal[i]);
-		memset(encoder->private_->integer_signal[i], 0, sizeof(FLAC__int32)*4);
-		encoder->private_->integer_signal[i] += 4;
-#ifndef FLAC__INTEGER_ONLY_LIBRARY
-#if 0 /* @@@ currently unused */
-		if(encoder->protected_->max_lpc_order > 0)
-			ok = ok && FLAC__memory_alloc_aligned_real_array(new_blocksize+OVERREAD_, &encoder->private_->real_signal_unaligned[i], &encoder->private_->real_signal[i]);
-#endif
-#endif
-	}
-	for(i = 0; ok && i < 2; i++) {
-		ok = ok && FLAC__memory_alloc_aligned_int32_array(new_blocksize+4+OVERREAD_, &encoder->private_->integer_signal_mid_side_unaligned[i], &encoder->private_->integer_signal_mid_side[i]);
-		memset(encoder->private_->integer_signal_mid_side[i], 0, sizeof(FLAC__int32)*4);
-		encoder->private_->integer_signal_mid_side[i] += 4;
-#ifndef FLAC__INTEGER_ONLY_LIBRARY
-#if 0 /* @@@ currently unused */
-		if(encoder->protected_->max_lpc_order > 0)
-			ok = ok && FLAC__memory_alloc_aligned_real_array(new_blocksize+OVERREAD_, &encoder->private_->real_signal_mid_side_unaligned[i], &encoder->private_->real_signal_mid_side[i]);
-#endif
-#endif
-	}
-#ifndef FLAC__INTEGER_ONLY_LIBRARY
-	if(ok && encoder->protected_->max_lpc_order > 0) {
-		for(i = 0; ok && i < encoder->protected_->num_apodizations; i++)
-			ok = ok && FLAC__memory_alloc_aligned_real_array(new_blocksize, &encoder->private_->window_unaligned[i], &encoder->private_->window[i]);
-		ok = ok && FLAC__memory_alloc_aligned_real_array(new_blocksize, &encoder->private_->windowed_signal_unaligned, &encoder->private_->windowed_signal);
-	}
-#endif
-	for(channel = 0; ok && channel < encoder->protected_->channels; channel++) {
-		for(i = 0; ok && i < 2; i++) {
-			ok = ok && FLAC__memory_alloc_aligned_int32_array(new_blocksize, &encoder->private_->residual_workspace_unaligned[channel][i], &encoder->private_->residual_workspace[channel][i]);
+	for(t = 0; ok && t < encoder->private_->num_threadtasks; t++) {
+		FLAC__StreamEncoderThreadTask *threadtask = encoder->private_->threadtask[t];
+		for(i = 0; ok && i < encoder->protected_->channels; i++) {
+			if(0 != threadtask->integer_signal_unaligned[i])
+				continue;
+			ok = ok && FLAC__memory_alloc_aligned_int32_array(&encoder->private_->allocator, capacity+4+OVERREAD_, &threadtask->integer_signal_unaligned[i], &threadtask->integer_signal[i]);
+			if(ok) {
+				memset(threadtask->integer_signal[i], 0, sizeof(FLAC__int32)*4);
+				threadtask->integer_signal[i] += 4;
+			}
 		}
-	}
-	for(channel = 0; ok && channel < 2; channel++) {
-		for(i = 0; ok && i < 2; i++) {
-			ok = ok && FLAC__memory_alloc_aligned_int32_array(new_blocksize, &encoder->private_->residual_workspace_mid_side_unaligned[channel][i], &encoder->private_->residual_workspace_mid_side[channel][i]);
+		/* the mid-side signal only exists for stereo, where init leaves do_mid_side_stereo set */
+		for(i = 0; ok && encoder->protected_->do_mid_side_stereo && i < 2; i++) {
+			if(0 != threadtask->integer_signal_mid_side_unaligned[i])
+				continue;
+			ok = ok && FLAC__memory_alloc_aligned_int32_array(&encoder->private_->allocator, capacity+4+OVERREAD_, &threadtask->integer_signal_mid_side_unaligned[i], &threadtask->integer_signal_mid_side[i]);
+			if(ok) {
+				memset(threadtask->integer_signal_mid_side[i], 0, sizeof(FLAC__int32)*4);
+				threadtask->integer_signal_mid_side[i] += 4;
+			}
 		}
-	}
-	/* the *2 is an approximation to the series 1 + 1/2 + 1/4 + ... that sums tree occupies in a flat array */
-	/*@@@ new_blocksize*2 is too pessimistic, but to fix, we need smarter logic because a smaller new_blocksize can actually increase the # of partitions; would require moving this out into a separate function, then checking its capacity against the need of the current blocksize&min/max_partition_order (and maybe predictor order) */
-	ok = ok && FLAC__memory_alloc_aligned_uint64_array(new_blocksize * 2, &encoder->private_->abs_residual_partition_sums_unaligned, &encoder->private_->abs_residual_partition_sums);
-	if(encoder->protected_->do_escape_coding)
-		ok = ok && FLAC__memory_alloc_aligned_unsigned_array(new_blocksize * 2, &encoder->private_->raw_bits_per_partition_unaligned, &encoder->private_->raw_bits_per_partition);
-
-	/* now adjust the windows if the blocksize has changed */
-#ifndef FLAC__INTEGER_ONLY_LIBRARY
-	if(ok && new_blocksize != encoder->private_->input_capacity && encoder->protected_->max_lpc_order > 0) {
-		for(i = 0; ok && i < encoder->protected_->num_apodizations; i++) {
-			switch(encoder->protected_->apodizations[i].type) {
-				case FLAC__APODIZATION_BARTLETT:
-					FLAC__window_bartlett(encoder->private_->window[i], new_blocksize);
-					break;
-				case FLAC__APODIZATION_BARTLETT_HANN:
-					FLAC__window_bartlett_hann(encoder->private_->window[i], new_blocksize);
-					break;
-				case FLAC__APODIZATION_BLACKMAN:
-					FLAC__window_blackman(encoder->private_->window[i], new_blocksize);
-					break;
-				case FLAC__APODIZATION_BLACKMAN_HARRIS_4TERM_92DB_SIDELOBE:
-					FLAC__window_blackman_harris_4term_92db_sidelobe(encoder->private_->window[i], new_blocksize);
-					break;
-				case FLAC__APODIZATION_CONNES:
-					FLAC__window_connes(encoder->private_->window[i], new_blocksize);
-					break;
-				case FLAC__APODIZATION_FLATTOP:
-					FLAC__window_flattop(encoder->private_->window[i], new_blocksize);
-					break;
-				case FLAC__APODIZATION_GAUSS:
-					FLAC__window_gauss(encoder->private_->window[i], new_blocksize, encoder->protected_->apodizations[i].parameters.gauss.stddev);
-					break;
-				case FLAC__APODIZATION_HAMMING:
-					FLAC__window_hamming(encoder->private_->window[i], new_blocksize);
-					break;
-				case FLAC__APODIZATION_HANN:
-					FLAC__window_hann(encoder->private_->window[i], new_blocksize);
-					break;
-				case FLAC__APODIZATION_KAISER_BESSEL:
-					FLAC__window_kaiser_bessel(encoder->private_->window[i], new_blocksize);
-					break;
-				case FLAC__APODIZATION_NUTTALL:
-					FLAC__window_nuttall(encoder->private_->window[i], new_blocksize);
-					break;
-				case FLAC__APODIZATION_RECTANGLE:
-					FLAC__window_rectangle(encoder->private_->window[i], new_blocksize);
-					break;
-				case FLAC__APODIZATION_TRIANGLE:
-					FLAC__window_triangle(encoder->private_->window[i], new_blocksize);
-					break;
-				case FLAC__APODIZATION_TUKEY:
-					FLAC__window_tukey(encoder->private_->window[i], new_blocksize, encoder->protected_->apodizations[i].parameters.tukey.p);
-					break;
-				case FLAC__APODIZATION_PARTIAL_TUKEY:
-					FLAC__window_partial_tukey(encoder->private_->window[i], new_blocksize, encoder->protected_->apodizations[i].parameters.multiple_tukey.p, encoder->protected_->apodizations[i].parameters.multiple_tukey.start, encoder->protected_->apodizations[i].parameters.multiple_tukey.end);
-					break;
-				case FLAC__APODIZATION_PUNCHOUT_TUKEY:
-					FLAC__window_punchout_tukey(encoder->private_->window[i], new_blocksize, encoder->protected_->apodizations[i].parameters.multiple_tukey.p, encoder->protected_->apodizations[i].parameters.multiple_tukey.start, encoder->protected_->apodizations[i].parameters.multiple_tukey.end);
-					break;
-				case FLAC__APODIZATION_WELCH:
-					FLAC__window_welch(encoder->private_->window[i], new_blocksize);
-					break;
-				default:
-					FLAC__ASSERT(0);
-					/* double protection */
-					FLAC__window_hann(encoder->private_->window[i], new_blocksize);
-					break;
+		for(channel = 0; ok && channel < encoder->protected_->channels; channel++) {
+			for(i = first_workspace; ok && i < 2; i++) {
+				if(0 == threadtask->residual_workspace_unaligned[channel][i])
+					ok = ok && FLAC__memory_alloc_aligned_int32_array(&encoder->private_->allocator, capacity, &threadtask->residual_workspace_unaligned[channel][i], &threadtask->residual_workspace[channel][i]);
 			}
 		}
+		for(channel = 0; ok && encoder->protected_->do_mid_side_stereo && channel < 2; channel++) {
+			for(i = first_workspace; ok && i < 2; i++) {
+				if(0 == threadtask->residual_workspace_mid_side_unaligned[channel][i])
+					ok = ok && FLAC__memory_alloc_aligned_int32_array(&encoder->private_->allocator, capacity, &threadtask->residual_workspace_mid_side_unaligned[channel][i], &threadtask->residual_workspace_mid_side[channel][i]);
+			}
+		}
+		ok = ok && resize_subframe_scratch_(encoder, &threadtask->scratch, capacity);
 	}
+#ifdef HAVE_PTHREAD
+	for(i = 0; ok && i < encoder->private_->num_subframe_scratch; i++)
+		ok = ok && resize_subframe_scratch_(encoder, encoder->private_->subframe_scratch[i], capacity);
 #endif
 
-	if(ok)
-		encoder->private_->input_capacity = new_blocksize;
-	else
+	/* now get the windows for the new blocksize; they are computed once and shared by every encoder using them */
+#ifndef FLAC__INTEGER_ONLY_LIBRARY
+	if(ok && encoder->protected_->max_lpc_order > 0) {
+		for(i = 0; ok && i < encoder->protected_->num_apodizations; i++) {
+			if(0 != encoder->private_->window_entry[i])
+				FLAC__window_cache_release(encoder->private_->window_entry[i]);
+			encoder->private_->window_entry[i] = FLAC__window_cache_acquire(&encoder->protected_->apodizations[i], new_blocksize);
+			if(0 == encoder->private_->window_entry[i])
+				ok = false;
+			else
+				encoder->private_->window[i] = FLAC__window_cache_get_window(encoder->private_->window_entry[i]);
+		}
+	}
+#endif
+
+	if(!ok)
 		encoder->protected_->state = FLAC__STREAM_ENCODER_MEMORY_ALLOCATION_ERROR;
 
 	return ok;
 }
 
-FLAC__bool write_bitbuffer_(FLAC__StreamEncoder *encoder, uint32_t samples, FLAC__bool is_last_block)
+FLAC__bool write_bitbuffer_(FLAC__StreamEncoder *encoder, FLAC__StreamEncoderThreadTask *threadtask, uint32_t samples, FLAC__bool is_last_block)
 {
 	const FLAC__byte *buffer;
 	size_t bytes;
+	FLAC__bool ok;
+
+	FLAC__ASSERT(FLAC__bitwriter_is_byte_aligned(threadtask->frame));
 
-	FLAC__ASSERT(FLAC__bitwriter_is_byte_aligned(encoder->private_->frame));
+#ifdef FLAC__ENABLE_STATISTICS
+	/* the frame is finished, so nothing else is touching its scratch
+	 * spaces; with parallel subframes the workers are idle by now too
+	 */
+	collect_statistics_(&encoder->private_->statistics, &threadtask->scratch.statistics);
+#ifdef HAVE_PTHREAD
+	if(threadtask == encoder->private_->threadtask[0]) {
+		uint32_t i;
+		for(i = 0; i < encoder->private_->num_subframe_scratch; i++)
+			collect_statistics_(&encoder->private_->statistics, &encoder->private_->subframe_scratch[i]->statistics);
+	}
+#endif
+#endif
 
-	if(!FLAC__bitwriter_get_buffer(encoder->private_->frame, &buffer, &bytes)) {
+	if(!FLAC__bitwriter_get_buffer(threadtask->frame, &buffer, &bytes)) {
 		encoder->protected_->state = FLAC__STREAM_ENCODER_MEMORY_ALLOCATION_ERROR;
 		return false;
 	}
@@ -2610,9 +3283,11 @@ FLAC__bool write_bitbuffer_(FLAC__StreamEncoder *encoder, uint32_t samples, FLAC
 			encoder->private_->verify.needs_magic_hack = true;
 		}
 		else {
-			if(!FLAC__stream_decoder_process_single(encoder->private_->verify.decoder)) {
-				FLAC__bitwriter_release_buffer(encoder->private_->frame);
-				FLAC__bitwriter_clear(encoder->private_->frame);
+			FLAC__STATISTICS_TIME(&encoder->private_->statistics, FLAC__STREAM_ENCODER_STAGE_VERIFY,
+				ok = FLAC__stream_decoder_process_single(encoder->private_->verify.decoder));
+			if(!ok) {
+				FLAC__bitwriter_release_buffer(threadtask->frame);
+				FLAC__bitwriter_clear(threadtask->frame);
 				if(encoder->protected_->state != FLAC__STREAM_ENCODER_VERIFY_MISMATCH_IN_AUDIO_DATA)
 					encoder->protected_->state = FLAC__STREAM_ENCODER_VERIFY_DECODER_ERROR;
 				return false;
@@ -2621,14 +3296,14 @@ FLAC__bool write_bitbuffer_(FLAC__StreamEncoder *encoder, uint32_t samples, FLAC
 	}
 
 	if(write_frame_(encoder, buffer, bytes, samples, is_last_block) != FLAC__STREAM_ENCODER_WRITE_STATUS_OK) {
-		FLAC__bitwriter_release_buffer(encoder->private_->frame);
-		FLAC__bitwriter_clear(encoder->private_->frame);
+		FLAC__bitwriter_release_buffer(threadtask->frame);
+		FLAC__bitwriter_clear(threadtask->frame);
 		encoder->protected_->state = FLAC__STREAM_ENCODER_CLIENT_ERROR;
 		return false;
 	}
 
-	FLAC__bitwriter_release_buffer(encoder->private_->frame);
-	FLAC__bitwriter_clear(encoder->private_->frame);
+	FLAC__bitwriter_release_buffer(threadtask->frame);
+	FLAC__bitwriter_clear(threadtask->frame);
 
 	if(samples > 0) {
 		encoder->private_->streaminfo.data.stream_info.min_framesize = flac_min(bytes, encoder->private_->streaminfo.data.stream_info.min_framesize);
@@ -2638,6 +3313,19 @@ FLAC__bool write_bitbuffer_(FLAC__StreamEncoder *encoder, uint32_t samples, FLAC
 	return true;
 }
 
+#ifdef FLAC__ENABLE_STATISTICS
+/* Adds the counters of part to total and clears part. */
+void collect_statistics_(FLAC__StreamEncoderStatistics *total, FLAC__StreamEncoderStatistics *part)
+{
+	uint32_t i;
+	for(i = 0; i < FLAC__STREAM_ENCODER_STAGE_COUNT; i++) {
+		total->nanoseconds[i] += part->nanoseconds[i];
+		total->calls[i] += part->calls[i];
+	}
+	memset(part, 0, sizeof(*part));
+}
+#endif
+
 FLAC__StreamEncoderWriteStatus write_frame_(FLAC__StreamEncoder *encoder, const FLAC__byte buffer[], size_t bytes, uint32_t samples, FLAC__bool is_last_block)
 {
 	FLAC__StreamEncoderWriteStatus status;
@@ -2698,23 +3386,43 @@ FLAC__StreamEncoderWriteStatus write_frame_(FLAC__StreamEncoder *encoder, const
 		}
 	}
 
+	/*
+	 * Add the frame to the frame index, doubling the room for points
+	 * as needed; finish_internal_() trims it to size.
+	 */
+	if(0 != encoder->private_->frame_index && encoder->protected_->audio_offset > 0 && samples > 0 && !encoder->private_->is_ogg) {
+		FLAC__StreamMetadata *index = encoder->private_->frame_index;
+		FLAC__StreamMetadata_SeekPoint *point;
+		if(encoder->private_->frame_index_points == index->data.seek_table.num_points && !FLAC__metadata_object_seektable_resize_points(index, encoder->private_->frame_index_points? encoder->private_->frame_index_points * 2 : 1024)) {
+			encoder->protected_->state = FLAC__STREAM_ENCODER_MEMORY_ALLOCATION_ERROR;
+			return FLAC__STREAM_ENCODER_WRITE_STATUS_FATAL_ERROR;
+		}
+		point = &index->data.seek_table.points[encoder->private_->frame_index_points++];
+		point->sample_number = encoder->private_->samples_written;
+		point->stream_offset = output_position - encoder->protected_->audio_offset;
+		point->frame_samples = samples;
+	}
+
 #if FLAC__HAS_OGG
 	if(encoder->private_->is_ogg) {
-		status = FLAC__ogg_encoder_aspect_write_callback_wrapper(
-			&encoder->protected_->ogg_encoder_aspect,
-			buffer,
-			bytes,
-			samples,
-			encoder->private_->current_frame_number,
-			is_last_block,
-			(FLAC__OggEncoderAspectWriteCallbackProxy)encoder->private_->write_callback,
-			encoder,
-			encoder->private_->client_data
+		FLAC__STATISTICS_TIME(&encoder->private_->statistics, FLAC__STREAM_ENCODER_STAGE_WRITE_CALLBACK,
+			status = FLAC__ogg_encoder_aspect_write_callback_wrapper(
+				&encoder->protected_->ogg_encoder_aspect,
+				buffer,
+				bytes,
+				samples,
+				encoder->private_->current_frame_number,
+				is_last_block,
+				(FLAC__OggEncoderAspectWriteCallbackProxy)encoder->private_->write_callback,
+				encoder,
+				encoder->private_->client_data
+			)
 		);
 	}
 	else
 #endif
-	status = encoder->private_->write_callback(encoder, buffer, bytes, samples, encoder->private_->current_frame_number, encoder->private_->client_data);
+	FLAC__STATISTICS_TIME(&encoder->private_->statistics, FLAC__STREAM_ENCODER_STAGE_WRITE_CALLBACK,
+		status = encoder->private_->write_callback(encoder, buffer, bytes, samples, encoder->private_->current_frame_number, encoder->private_->client_data));
 
 	if(status == FLAC__STREAM_ENCODER_WRITE_STATUS_OK) {
 		encoder->private_->bytes_written += bytes;
@@ -3079,49 +3787,59 @@ void update_ogg_metadata_(FLAC__StreamEncoder *encoder)
 
 FLAC__bool process_frame_(FLAC__StreamEncoder *encoder, FLAC__bool is_fractional_block, FLAC__bool is_last_block)
 {
-	FLAC__uint16 crc;
+	FLAC__StreamEncoderThreadTask *threadtask = encoder->private_->threadtask[0];
 	FLAC__ASSERT(encoder->protected_->state == FLAC__STREAM_ENCODER_OK);
 
 	/*
 	 * Accumulate raw signal to the MD5 signature
 	 */
-	if(encoder->protected_->do_md5 && !FLAC__MD5Accumulate(&encoder->private_->md5context, (const FLAC__int32 * const *)encoder->private_->integer_signal, encoder->protected_->channels, encoder->protected_->blocksize, (encoder->protected_->bits_per_sample+7) / 8)) {
-		encoder->protected_->state = FLAC__STREAM_ENCODER_MEMORY_ALLOCATION_ERROR;
-		return false;
-	}
-
-	/*
-	 * Process the frame header and subframes into the frame bitbuffer
-	 */
-	if(!process_subframes_(encoder, is_fractional_block)) {
-		/* the above function sets the state for us in case of an error */
-		return false;
+	if(encoder->protected_->do_md5) {
+		const FLAC__int32 * const *signal = (const FLAC__int32 * const *)threadtask->integer_signal;
+		const uint32_t bytes_per_sample = (encoder->protected_->bits_per_sample+7) / 8;
+		FLAC__bool ok;
+#ifdef HAVE_PTHREAD
+		if(0 != encoder->private_->md5_worker)
+			FLAC__STATISTICS_TIME(&encoder->private_->statistics, FLAC__STREAM_ENCODER_STAGE_MD5,
+				ok = FLAC__MD5WorkerAccumulate(encoder->private_->md5_worker, signal, encoder->protected_->channels, encoder->protected_->blocksize, bytes_per_sample));
+		else
+#endif
+		FLAC__STATISTICS_TIME(&encoder->private_->statistics, FLAC__STREAM_ENCODER_STAGE_MD5,
+			ok = FLAC__MD5Accumulate(&encoder->private_->md5context, signal, encoder->protected_->channels, encoder->protected_->blocksize, bytes_per_sample));
+		if(!ok) {
+			encoder->protected_->state = FLAC__STREAM_ENCODER_MEMORY_ALLOCATION_ERROR;
+			return false;
+		}
 	}
 
+#ifdef HAVE_PTHREAD
 	/*
-	 * Zero-pad the frame to a byte_boundary
+	 * Hand the block to the worker threads; the last block is always
+	 * done here, after all the others have been written
 	 */
-	if(!FLAC__bitwriter_zero_pad_to_byte_boundary(encoder->private_->frame)) {
-		encoder->protected_->state = FLAC__STREAM_ENCODER_MEMORY_ALLOCATION_ERROR;
-		return false;
+	if(encoder->private_->num_threadtasks > 1 && !is_last_block) {
+		if(!queue_frame_(encoder)) {
+			/* the above function sets the state for us in case of an error */
+			return false;
+		}
+		encoder->private_->current_sample_number = 0;
+		encoder->private_->streaminfo.data.stream_info.total_samples += (FLAC__uint64)encoder->protected_->blocksize;
+		return true;
 	}
+#endif
 
 	/*
-	 * CRC-16 the whole thing
+	 * Process the frame header, subframes and footer into the frame bitbuffer
 	 */
-	FLAC__ASSERT(FLAC__bitwriter_is_byte_aligned(encoder->private_->frame));
-	if(
-		!FLAC__bitwriter_get_write_crc16(encoder->private_->frame, &crc) ||
-		!FLAC__bitwriter_write_raw_uint32(encoder->private_->frame, crc, FLAC__FRAME_FOOTER_CRC_LEN)
-	) {
-		encoder->protected_->state = FLAC__STREAM_ENCODER_MEMORY_ALLOCATION_ERROR;
+	threadtask->frame_number = encoder->private_->current_frame_number;
+	if(!encode_frame_(encoder, threadtask, is_fractional_block)) {
+		encoder->protected_->state = threadtask->error;
 		return false;
 	}
 
 	/*
 	 * Write it
 	 */
-	if(!write_bitbuffer_(encoder, encoder->protected_->blocksize, is_last_block)) {
+	if(!write_bitbuffer_(encoder, threadtask, encoder->protected_->blocksize, is_last_block)) {
 		/* the above function sets the state for us in case of an error */
 		return false;
 	}
@@ -3136,11 +3854,307 @@ FLAC__bool process_frame_(FLAC__StreamEncoder *encoder, FLAC__bool is_fractional
 	return true;
 }
 
-FLAC__bool process_subframes_(FLAC__StreamEncoder *encoder, FLAC__bool is_fractional_block)
+FLAC__bool encode_frame_(FLAC__StreamEncoder *encoder, FLAC__StreamEncoderThreadTask *threadtask, FLAC__bool is_fractional_block)
+{
+	FLAC__uint16 crc;
+	FLAC__bool ok;
+
+	/*
+	 * Process the frame header and subframes into the frame bitbuffer
+	 */
+	if(!process_subframes_(encoder, threadtask, is_fractional_block)) {
+		/* the above function sets threadtask->error for us */
+		return false;
+	}
+
+	/*
+	 * Zero-pad the frame to a byte_boundary, then CRC-16 the whole thing
+	 */
+	FLAC__STATISTICS_TIME(&threadtask->scratch.statistics, FLAC__STREAM_ENCODER_STAGE_PACKING,
+		ok =
+			FLAC__bitwriter_zero_pad_to_byte_boundary(threadtask->frame) &&
+			FLAC__bitwriter_get_write_crc16(threadtask->frame, &crc) &&
+			FLAC__bitwriter_write_raw_uint32(threadtask->frame, crc, FLAC__FRAME_FOOTER_CRC_LEN)
+	);
+	if(!ok) {
+		threadtask->error = FLAC__STREAM_ENCODER_MEMORY_ALLOCATION_ERROR;
+		return false;
+	}
+
+	return true;
+}
+
+#ifdef HAVE_PTHREAD
+FLAC__bool start_threads_(FLAC__StreamEncoder *encoder)
+{
+	FLAC__StreamEncoderPrivate *private_ = encoder->private_;
+	void *(*thread_function)(void *);
+	uint32_t i, num_threads;
+
+	FLAC__ASSERT(private_->num_threadtasks > 1 || private_->num_subframe_scratch > 0);
+	FLAC__ASSERT(private_->num_started_threads == 0);
+
+	if(private_->num_subframe_scratch > 0) {
+		/* one worker per extra scratch space; the main thread joins in with threadtask[0]->scratch */
+		num_threads = private_->num_subframe_scratch;
+		thread_function = process_subframes_thread_;
+	}
+	else {
+		num_threads = encoder->protected_->num_threads;
+		thread_function = process_frame_thread_;
+	}
+
+	if(pthread_mutex_init(&private_->mutex_work_queue, 0) != 0) {
+		encoder->protected_->state = FLAC__STREAM_ENCODER_MEMORY_ALLOCATION_ERROR;
+		return false;
+	}
+	if(pthread_cond_init(&private_->cond_work_available, 0) != 0) {
+		pthread_mutex_destroy(&private_->mutex_work_queue);
+		encoder->protected_->state = FLAC__STREAM_ENCODER_MEMORY_ALLOCATION_ERROR;
+		return false;
+	}
+	if(pthread_cond_init(&private_->cond_task_done, 0) != 0) {
+		pthread_cond_destroy(&private_->cond_work_available);
+		pthread_mutex_destroy(&private_->mutex_work_queue);
+		encoder->protected_->state = FLAC__STREAM_ENCODER_MEMORY_ALLOCATION_ERROR;
+		return false;
+	}
+
+	private_->next_task_to_work = 1;
+	private_->num_tasks_queued = 0;
+	private_->finish_work_threads = false;
+	private_->next_task_to_fill = 1;
+	private_->next_task_to_write = 1;
+	private_->num_tasks_in_flight = 0;
+	private_->subframe_jobs.num_jobs = 0;
+	private_->subframe_jobs.next_job = 0;
+	private_->subframe_jobs.num_jobs_done = 0;
+	private_->subframe_jobs.num_scratch_taken = 0;
+
+	for(i = 0; i < num_threads; i++) {
+		if(pthread_create(&private_->thread[i], 0, thread_function, encoder) != 0)
+			break;
+		private_->num_started_threads++;
+	}
+	if(private_->num_started_threads < num_threads) {
+		/* a pool that is smaller than asked for would still work, but the failure most likely means we are out of resources */
+		encoder->protected_->state = FLAC__STREAM_ENCODER_MEMORY_ALLOCATION_ERROR;
+		if(private_->num_started_threads == 0) {
+			pthread_cond_destroy(&private_->cond_task_done);
+			pthread_cond_destroy(&private_->cond_work_available);
+			pthread_mutex_destroy(&private_->mutex_work_queue);
+		}
+		return false;
+	}
+
+	return true;
+}
+
+void stop_threads_(FLAC__StreamEncoder *encoder)
+{
+	FLAC__StreamEncoderPrivate *private_ = encoder->private_;
+	uint32_t i;
+
+	pthread_mutex_lock(&private_->mutex_work_queue);
+	private_->finish_work_threads = true;
+	pthread_cond_broadcast(&private_->cond_work_available);
+	pthread_mutex_unlock(&private_->mutex_work_queue);
+
+	for(i = 0; i < private_->num_started_threads; i++)
+		pthread_join(private_->thread[i], 0);
+	private_->num_started_threads = 0;
+
+	pthread_cond_destroy(&private_->cond_task_done);
+	pthread_cond_destroy(&private_->cond_work_available);
+	pthread_mutex_destroy(&private_->mutex_work_queue);
+}
+
+void *process_frame_thread_(void *arg)
+{
+	FLAC__StreamEncoder *encoder = (FLAC__StreamEncoder *)arg;
+	FLAC__StreamEncoderPrivate *private_ = encoder->private_;
+	FLAC__StreamEncoderThreadTask *threadtask;
+	FLAC__bool ok;
+
+	for(;;) {
+		pthread_mutex_lock(&private_->mutex_work_queue);
+		while(private_->num_tasks_queued == 0 && !private_->finish_work_threads)
+			pthread_cond_wait(&private_->cond_work_available, &private_->mutex_work_queue);
+		if(private_->num_tasks_queued == 0) {
+			pthread_mutex_unlock(&private_->mutex_work_queue);
+			break;
+		}
+		threadtask = private_->threadtask[private_->next_task_to_work];
+		if(++private_->next_task_to_work == private_->num_threadtasks)
+			private_->next_task_to_work = 1;
+		private_->num_tasks_queued--;
+		pthread_mutex_unlock(&private_->mutex_work_queue);
+
+		ok = encode_frame_(encoder, threadtask, /*is_fractional_block=*/false);
+
+		pthread_mutex_lock(&private_->mutex_work_queue);
+		threadtask->returnvalue = ok;
+		threadtask->done = true;
+		pthread_cond_broadcast(&private_->cond_task_done);
+		pthread_mutex_unlock(&private_->mutex_work_queue);
+	}
+
+	return 0;
+}
+
+void *process_subframes_thread_(void *arg)
+{
+	FLAC__StreamEncoder *encoder = (FLAC__StreamEncoder *)arg;
+	FLAC__StreamEncoderPrivate *private_ = encoder->private_;
+	FLAC__StreamEncoderSubframeScratch *scratch;
+
+	/* every worker keeps one scratch space for as long as it runs */
+	pthread_mutex_lock(&private_->mutex_work_queue);
+	FLAC__ASSERT(private_->subframe_jobs.num_scratch_taken < private_->num_subframe_scratch);
+	scratch = private_->subframe_scratch[private_->subframe_jobs.num_scratch_taken++];
+	pthread_mutex_unlock(&private_->mutex_work_queue);
+
+	for(;;) {
+		pthread_mutex_lock(&private_->mutex_work_queue);
+		while(private_->subframe_jobs.next_job == private_->subframe_jobs.num_jobs && !private_->finish_work_threads)
+			pthread_cond_wait(&private_->cond_work_available, &private_->mutex_work_queue);
+		if(private_->subframe_jobs.next_job == private_->subframe_jobs.num_jobs) {
+			pthread_mutex_unlock(&private_->mutex_work_queue);
+			break;
+		}
+		pthread_mutex_unlock(&private_->mutex_work_queue);
+
+		run_subframe_jobs_(encoder, scratch);
+	}
+
+	return 0;
+}
+
+/* Takes subframe jobs of the current frame and runs them with the given
+ * scratch space until none are left to take.  Called by the workers and
+ * by the main thread.
+ */
+void run_subframe_jobs_(FLAC__StreamEncoder *encoder, FLAC__StreamEncoderSubframeScratch *scratch)
+{
+	FLAC__StreamEncoderPrivate *private_ = encoder->private_;
+	uint32_t job;
+	FLAC__bool ok;
+
+	for(;;) {
+		pthread_mutex_lock(&private_->mutex_work_queue);
+		if(private_->subframe_jobs.next_job == private_->subframe_jobs.num_jobs) {
+			pthread_mutex_unlock(&private_->mutex_work_queue);
+			return;
+		}
+		job = private_->subframe_jobs.next_job++;
+		pthread_mutex_unlock(&private_->mutex_work_queue);
+
+		ok = process_subframe_job_(
+			encoder,
+			private_->subframe_jobs.threadtask,
+			scratch,
+			private_->subframe_jobs.min_partition_order,
+			private_->subframe_jobs.max_partition_order,
+			private_->subframe_jobs.frame_header,
+			job < private_->subframe_jobs.num_independent? job : job - private_->subframe_jobs.num_independent,
+			/*is_mid_side=*/job >= private_->subframe_jobs.num_independent
+		);
+
+		pthread_mutex_lock(&private_->mutex_work_queue);
+		if(!ok)
+			private_->subframe_jobs.ok = false;
+		if(++private_->subframe_jobs.num_jobs_done == private_->subframe_jobs.num_jobs)
+			pthread_cond_broadcast(&private_->cond_task_done);
+		pthread_mutex_unlock(&private_->mutex_work_queue);
+	}
+}
+
+/* Copies the block in threadtask[0] into the next free task and queues it
+ * for the worker threads.  If all tasks are in use, the oldest one is
+ * written out first.
+ */
+FLAC__bool queue_frame_(FLAC__StreamEncoder *encoder)
+{
+	FLAC__StreamEncoderPrivate *private_ = encoder->private_;
+	FLAC__StreamEncoderThreadTask *threadtask;
+	const uint32_t blocksize = encoder->protected_->blocksize;
+	uint32_t channel;
+
+	if(private_->num_tasks_in_flight == private_->num_threadtasks - 1) {
+		FLAC__ASSERT(private_->next_task_to_write == private_->next_task_to_fill);
+		if(!write_finished_frames_(encoder, /*wait_for_all=*/false))
+			return false;
+	}
+
+	threadtask = private_->threadtask[private_->next_task_to_fill];
+	for(channel = 0; channel < encoder->protected_->channels; channel++)
+		memcpy(threadtask->integer_signal[channel], private_->threadtask[0]->integer_signal[channel], sizeof(FLAC__int32) * blocksize);
+	if(encoder->protected_->do_mid_side_stereo) {
+		memcpy(threadtask->integer_signal_mid_side[0], private_->threadtask[0]->integer_signal_mid_side[0], sizeof(FLAC__int32) * blocksize);
+		memcpy(threadtask->integer_signal_mid_side[1], private_->threadtask[0]->integer_signal_mid_side[1], sizeof(FLAC__int32) * blocksize);
+	}
+	threadtask->frame_number = private_->current_frame_number + private_->num_tasks_in_flight;
+	threadtask->done = false;
+	if(++private_->next_task_to_fill == private_->num_threadtasks)
+		private_->next_task_to_fill = 1;
+	private_->num_tasks_in_flight++;
+
+	pthread_mutex_lock(&private_->mutex_work_queue);
+	private_->num_tasks_queued++;
+	pthread_cond_signal(&private_->cond_work_available);
+	pthread_mutex_unlock(&private_->mutex_work_queue);
+
+	/* don't wait, but pass on whatever is ready so the output keeps flowing */
+	return write_finished_frames_(encoder, /*wait_for_all=*/false);
+}
+
+/* Writes the finished tasks in frame order.  Waits for the oldest task if
+ * all tasks are in use, or for every task if wait_for_all is set.
+ */
+FLAC__bool write_finished_frames_(FLAC__StreamEncoder *encoder, FLAC__bool wait_for_all)
+{
+	FLAC__StreamEncoderPrivate *private_ = encoder->private_;
+	FLAC__StreamEncoderThreadTask *threadtask;
+
+	while(private_->num_tasks_in_flight > 0) {
+		const FLAC__bool must_wait = wait_for_all || private_->num_tasks_in_flight == private_->num_threadtasks - 1;
+		threadtask = private_->threadtask[private_->next_task_to_write];
+
+		pthread_mutex_lock(&private_->mutex_work_queue);
+		if(!threadtask->done && !must_wait) {
+			pthread_mutex_unlock(&private_->mutex_work_queue);
+			break;
+		}
+		while(!threadtask->done)
+			pthread_cond_wait(&private_->cond_task_done, &private_->mutex_work_queue);
+		pthread_mutex_unlock(&private_->mutex_work_queue);
+
+		if(++private_->next_task_to_write == private_->num_threadtasks)
+			private_->next_task_to_write = 1;
+		private_->num_tasks_in_flight--;
+
+		if(!threadtask->returnvalue) {
+			encoder->protected_->state = threadtask->error;
+			FLAC__bitwriter_clear(threadtask->frame);
+			return false;
+		}
+		FLAC__ASSERT(threadtask->frame_number == private_->current_frame_number);
+		if(!write_bitbuffer_(encoder, threadtask, encoder->protected_->blocksize, /*is_last_block=*/false)) {
+			/* the above function sets the state for us in case of an error */
+			return false;
+		}
+		private_->current_frame_number++;
+	}
+
+	return true;
+}
+#endif
+
+FLAC__bool process_subframes_(FLAC__StreamEncoder *encoder, FLAC__StreamEncoderThreadTask *threadtask, FLAC__bool is_fractional_block)
 {
 	FLAC__FrameHeader frame_header;
 	uint32_t channel, min_partition_order = encoder->protected_->min_residual_partition_order, max_partition_order;
-	FLAC__bool do_independent, do_mid_side;
+	FLAC__bool do_independent, do_mid_side, ok;
 
 	/*
 	 * Calculate the min,max Rice partition orders
@@ -3163,7 +4177,7 @@ FLAC__bool process_subframes_(FLAC__StreamEncoder *encoder, FLAC__bool is_fracti
 	frame_header.channel_assignment = FLAC__CHANNEL_ASSIGNMENT_INDEPENDENT; /* the default unless the encoder determines otherwise */
 	frame_header.bits_per_sample = encoder->protected_->bits_per_sample;
 	frame_header.number_type = FLAC__FRAME_NUMBER_TYPE_FRAME_NUMBER;
-	frame_header.number.frame_number = encoder->private_->current_frame_number;
+	frame_header.number.frame_number = threadtask->frame_number;
 
 	/*
 	 * Figure out what channel assignments to try
@@ -3196,73 +4210,83 @@ FLAC__bool process_subframes_(FLAC__StreamEncoder *encoder, FLAC__bool is_fracti
 	 */
 	if(do_independent) {
 		for(channel = 0; channel < encoder->protected_->channels; channel++) {
-			uint32_t w = get_wasted_bits_(encoder->private_->integer_signal[channel], encoder->protected_->blocksize);
+			uint32_t w = get_wasted_bits_(threadtask->integer_signal[channel], encoder->protected_->blocksize);
 			if (w > encoder->protected_->bits_per_sample) {
 				w = encoder->protected_->bits_per_sample;
 			}
-			encoder->private_->subframe_workspace[channel][0].wasted_bits = encoder->private_->subframe_workspace[channel][1].wasted_bits = w;
-			encoder->private_->subframe_bps[channel] = encoder->protected_->bits_per_sample - w;
+			threadtask->subframe_workspace[channel][0].wasted_bits = threadtask->subframe_workspace[channel][1].wasted_bits = w;
+			threadtask->subframe_bps[channel] = encoder->protected_->bits_per_sample - w;
 		}
 	}
 	if(do_mid_side) {
 		FLAC__ASSERT(encoder->protected_->channels == 2);
 		for(channel = 0; channel < 2; channel++) {
-			uint32_t w = get_wasted_bits_(encoder->private_->integer_signal_mid_side[channel], encoder->protected_->blocksize);
+			uint32_t w = get_wasted_bits_(threadtask->integer_signal_mid_side[channel], encoder->protected_->blocksize);
 			if (w > encoder->protected_->bits_per_sample) {
 				w = encoder->protected_->bits_per_sample;
 			}
-			encoder->private_->subframe_workspace_mid_side[channel][0].wasted_bits = encoder->private_->subframe_workspace_mid_side[channel][1].wasted_bits = w;
-			encoder->private_->subframe_bps_mid_side[channel] = encoder->protected_->bits_per_sample - w + (channel==0? 0:1);
+			threadtask->subframe_workspace_mid_side[channel][0].wasted_bits = threadtask->subframe_workspace_mid_side[channel][1].wasted_bits = w;
+			threadtask->subframe_bps_mid_side[channel] = encoder->protected_->bits_per_sample - w + (channel==0? 0:1);
 		}
 	}
 
+#ifdef HAVE_PTHREAD
 	/*
-	 * First do a normal encoding pass of each independent channel
+	 * Search all channels at once, the main thread taking part
 	 */
-	if(do_independent) {
-		for(channel = 0; channel < encoder->protected_->channels; channel++) {
-			if(!
-				process_subframe_(
-					encoder,
-					min_partition_order,
-					max_partition_order,
-					&frame_header,
-					encoder->private_->subframe_bps[channel],
-					encoder->private_->integer_signal[channel],
-					encoder->private_->subframe_workspace_ptr[channel],
-					encoder->private_->partitioned_rice_contents_workspace_ptr[channel],
-					encoder->private_->residual_workspace[channel],
-					encoder->private_->best_subframe+channel,
-					encoder->private_->best_subframe_bits+channel
-				)
-			)
-				return false;
-		}
+	if(encoder->private_->num_started_threads > 0 && encoder->private_->num_subframe_scratch > 0) {
+		FLAC__StreamEncoderPrivate *private_ = encoder->private_;
+
+		FLAC__ASSERT(threadtask == private_->threadtask[0]);
+		FLAC__ASSERT(!do_mid_side || encoder->protected_->channels == 2);
+
+		pthread_mutex_lock(&private_->mutex_work_queue);
+		private_->subframe_jobs.threadtask = threadtask;
+		private_->subframe_jobs.frame_header = &frame_header;
+		private_->subframe_jobs.min_partition_order = min_partition_order;
+		private_->subframe_jobs.max_partition_order = max_partition_order;
+		private_->subframe_jobs.num_independent = do_independent? encoder->protected_->channels : 0;
+		private_->subframe_jobs.num_jobs = private_->subframe_jobs.num_independent + (do_mid_side? 2 : 0);
+		private_->subframe_jobs.next_job = 0;
+		private_->subframe_jobs.num_jobs_done = 0;
+		private_->subframe_jobs.ok = true;
+		pthread_cond_broadcast(&private_->cond_work_available);
+		pthread_mutex_unlock(&private_->mutex_work_queue);
+
+		run_subframe_jobs_(encoder, &threadtask->scratch);
+
+		pthread_mutex_lock(&private_->mutex_work_queue);
+		while(private_->subframe_jobs.num_jobs_done < private_->subframe_jobs.num_jobs)
+			pthread_cond_wait(&private_->cond_task_done, &private_->mutex_work_queue);
+		ok = private_->subframe_jobs.ok;
+		pthread_mutex_unlock(&private_->mutex_work_queue);
+
+		if(!ok)
+			return false;
 	}
+	else
+#endif
+	{
+		/*
+		 * First do a normal encoding pass of each independent channel
+		 */
+		if(do_independent) {
+			for(channel = 0; channel < encoder->protected_->channels; channel++) {
+				if(!process_subframe_job_(encoder, threadtask, &threadtask->scratch, min_partition_order, max_partition_order, &frame_header, channel, /*is_mid_side=*/false))
+					return false;
+			}
+		}
 
-	/*
-	 * Now do mid and side channels if requested
-	 */
-	if(do_mid_side) {
-		FLAC__ASSERT(encoder->protected_->channels == 2);
+		/*
+		 * Now do mid and side channels if requested
+		 */
+		if(do_mid_side) {
+			FLAC__ASSERT(encoder->protected_->channels == 2);
 
-		for(channel = 0; channel < 2; channel++) {
-			if(!
-				process_subframe_(
-					encoder,
-					min_partition_order,
-					max_partition_order,
-					&frame_header,
-					encoder->private_->subframe_bps_mid_side[channel],
-					encoder->private_->integer_signal_mid_side[channel],
-					encoder->private_->subframe_workspace_ptr_mid_side[channel],
-					encoder->private_->partitioned_rice_contents_workspace_ptr_mid_side[channel],
-					encoder->private_->residual_workspace_mid_side[channel],
-					encoder->private_->best_subframe_mid_side+channel,
-					encoder->private_->best_subframe_bits_mid_side+channel
-				)
-			)
-				return false;
+			for(channel = 0; channel < 2; channel++) {
+				if(!process_subframe_job_(encoder, threadtask, &threadtask->scratch, min_partition_order, max_partition_order, &frame_header, channel, /*is_mid_side=*/true))
+					return false;
+			}
 		}
 	}
 
@@ -3291,10 +4315,10 @@ FLAC__bool process_subframes_(FLAC__StreamEncoder *encoder, FLAC__bool is_fracti
 			FLAC__ASSERT(do_independent && do_mid_side);
 
 			/* We have to figure out which channel assignent results in the smallest frame */
-			bits[FLAC__CHANNEL_ASSIGNMENT_INDEPENDENT] = encoder->private_->best_subframe_bits         [0] + encoder->private_->best_subframe_bits         [1];
-			bits[FLAC__CHANNEL_ASSIGNMENT_LEFT_SIDE  ] = encoder->private_->best_subframe_bits         [0] + encoder->private_->best_subframe_bits_mid_side[1];
-			bits[FLAC__CHANNEL_ASSIGNMENT_RIGHT_SIDE ] = encoder->private_->best_subframe_bits         [1] + encoder->private_->best_subframe_bits_mid_side[1];
-			bits[FLAC__CHANNEL_ASSIGNMENT_MID_SIDE   ] = encoder->private_->best_subframe_bits_mid_side[0] + encoder->private_->best_subframe_bits_mid_side[1];
+			bits[FLAC__CHANNEL_ASSIGNMENT_INDEPENDENT] = threadtask->best_subframe_bits         [0] + threadtask->best_subframe_bits         [1];
+			bits[FLAC__CHANNEL_ASSIGNMENT_LEFT_SIDE  ] = threadtask->best_subframe_bits         [0] + threadtask->best_subframe_bits_mid_side[1];
+			bits[FLAC__CHANNEL_ASSIGNMENT_RIGHT_SIDE ] = threadtask->best_subframe_bits         [1] + threadtask->best_subframe_bits_mid_side[1];
+			bits[FLAC__CHANNEL_ASSIGNMENT_MID_SIDE   ] = threadtask->best_subframe_bits_mid_side[0] + threadtask->best_subframe_bits_mid_side[1];
 
 			channel_assignment = FLAC__CHANNEL_ASSIGNMENT_INDEPENDENT;
 			min_bits = bits[channel_assignment];
@@ -3308,27 +4332,29 @@ FLAC__bool process_subframes_(FLAC__StreamEncoder *encoder, FLAC__bool is_fracti
 
 		frame_header.channel_assignment = channel_assignment;
 
-		if(!FLAC__frame_add_header(&frame_header, encoder->private_->frame)) {
-			encoder->protected_->state = FLAC__STREAM_ENCODER_FRAMING_ERROR;
+		FLAC__STATISTICS_TIME(&threadtask->scratch.statistics, FLAC__STREAM_ENCODER_STAGE_PACKING,
+			ok = FLAC__frame_add_header(&frame_header, threadtask->frame));
+		if(!ok) {
+			threadtask->error = FLAC__STREAM_ENCODER_FRAMING_ERROR;
 			return false;
 		}
 
 		switch(channel_assignment) {
 			case FLAC__CHANNEL_ASSIGNMENT_INDEPENDENT:
-				left_subframe  = &encoder->private_->subframe_workspace         [0][encoder->private_->best_subframe         [0]];
-				right_subframe = &encoder->private_->subframe_workspace         [1][encoder->private_->best_subframe         [1]];
+				left_subframe  = &threadtask->subframe_workspace         [0][threadtask->best_subframe         [0]];
+				right_subframe = &threadtask->subframe_workspace         [1][threadtask->best_subframe         [1]];
 				break;
 			case FLAC__CHANNEL_ASSIGNMENT_LEFT_SIDE:
-				left_subframe  = &encoder->private_->subframe_workspace         [0][encoder->private_->best_subframe         [0]];
-				right_subframe = &encoder->private_->subframe_workspace_mid_side[1][encoder->private_->best_subframe_mid_side[1]];
+				left_subframe  = &threadtask->subframe_workspace         [0][threadtask->best_subframe         [0]];
+				right_subframe = &threadtask->subframe_workspace_mid_side[1][threadtask->best_subframe_mid_side[1]];
 				break;
 			case FLAC__CHANNEL_ASSIGNMENT_RIGHT_SIDE:
-				left_subframe  = &encoder->private_->subframe_workspace_mid_side[1][encoder->private_->best_subframe_mid_side[1]];
-				right_subframe = &encoder->private_->subframe_workspace         [1][encoder->private_->best_subframe         [1]];
+				left_subframe  = &threadtask->subframe_workspace_mid_side[1][threadtask->best_subframe_mid_side[1]];
+				right_subframe = &threadtask->subframe_workspace         [1][threadtask->best_subframe         [1]];
 				break;
 			case FLAC__CHANNEL_ASSIGNMENT_MID_SIDE:
-				left_subframe  = &encoder->private_->subframe_workspace_mid_side[0][encoder->private_->best_subframe_mid_side[0]];
-				right_subframe = &encoder->private_->subframe_workspace_mid_side[1][encoder->private_->best_subframe_mid_side[1]];
+				left_subframe  = &threadtask->subframe_workspace_mid_side[0][threadtask->best_subframe_mid_side[0]];
+				right_subframe = &threadtask->subframe_workspace_mid_side[1][threadtask->best_subframe_mid_side[1]];
 				break;
 			default:
 				FLAC__ASSERT(0);
@@ -3336,58 +4362,112 @@ FLAC__bool process_subframes_(FLAC__StreamEncoder *encoder, FLAC__bool is_fracti
 
 		switch(channel_assignment) {
 			case FLAC__CHANNEL_ASSIGNMENT_INDEPENDENT:
-				left_bps  = encoder->private_->subframe_bps         [0];
-				right_bps = encoder->private_->subframe_bps         [1];
+				left_bps  = threadtask->subframe_bps         [0];
+				right_bps = threadtask->subframe_bps         [1];
 				break;
 			case FLAC__CHANNEL_ASSIGNMENT_LEFT_SIDE:
-				left_bps  = encoder->private_->subframe_bps         [0];
-				right_bps = encoder->private_->subframe_bps_mid_side[1];
+				left_bps  = threadtask->subframe_bps         [0];
+				right_bps = threadtask->subframe_bps_mid_side[1];
 				break;
 			case FLAC__CHANNEL_ASSIGNMENT_RIGHT_SIDE:
-				left_bps  = encoder->private_->subframe_bps_mid_side[1];
-				right_bps = encoder->private_->subframe_bps         [1];
+				left_bps  = threadtask->subframe_bps_mid_side[1];
+				right_bps = threadtask->subframe_bps         [1];
 				break;
 			case FLAC__CHANNEL_ASSIGNMENT_MID_SIDE:
-				left_bps  = encoder->private_->subframe_bps_mid_side[0];
-				right_bps = encoder->private_->subframe_bps_mid_side[1];
+				left_bps  = threadtask->subframe_bps_mid_side[0];
+				right_bps = threadtask->subframe_bps_mid_side[1];
 				break;
 			default:
 				FLAC__ASSERT(0);
 		}
 
-		/* note that encoder_add_subframe_ sets the state for us in case of an error */
-		if(!add_subframe_(encoder, frame_header.blocksize, left_bps , left_subframe , encoder->private_->frame))
-			return false;
-		if(!add_subframe_(encoder, frame_header.blocksize, right_bps, right_subframe, encoder->private_->frame))
+		FLAC__STATISTICS_TIME(&threadtask->scratch.statistics, FLAC__STREAM_ENCODER_STAGE_PACKING,
+			ok =
+				add_subframe_(frame_header.blocksize, left_bps , left_subframe , threadtask->frame) &&
+				add_subframe_(frame_header.blocksize, right_bps, right_subframe, threadtask->frame)
+		);
+		if(!ok) {
+			threadtask->error = FLAC__STREAM_ENCODER_FRAMING_ERROR;
 			return false;
+		}
 	}
 	else {
-		if(!FLAC__frame_add_header(&frame_header, encoder->private_->frame)) {
-			encoder->protected_->state = FLAC__STREAM_ENCODER_FRAMING_ERROR;
+		FLAC__STATISTICS_TIME(&threadtask->scratch.statistics, FLAC__STREAM_ENCODER_STAGE_PACKING,
+			ok = FLAC__frame_add_header(&frame_header, threadtask->frame));
+		if(!ok) {
+			threadtask->error = FLAC__STREAM_ENCODER_FRAMING_ERROR;
 			return false;
 		}
 
 		for(channel = 0; channel < encoder->protected_->channels; channel++) {
-			if(!add_subframe_(encoder, frame_header.blocksize, encoder->private_->subframe_bps[channel], &encoder->private_->subframe_workspace[channel][encoder->private_->best_subframe[channel]], encoder->private_->frame)) {
-				/* the above function sets the state for us in case of an error */
+			FLAC__STATISTICS_TIME(&threadtask->scratch.statistics, FLAC__STREAM_ENCODER_STAGE_PACKING,
+				ok = add_subframe_(frame_header.blocksize, threadtask->subframe_bps[channel], &threadtask->subframe_workspace[channel][threadtask->best_subframe[channel]], threadtask->frame));
+			if(!ok) {
+				threadtask->error = FLAC__STREAM_ENCODER_FRAMING_ERROR;
 				return false;
 			}
 		}
 	}
 
+	/* only loose mid-side stereo looks back at earlier frames; with several worker threads it is off */
 	if(encoder->protected_->loose_mid_side_stereo) {
 		encoder->private_->loose_mid_side_stereo_frame_count++;
 		if(encoder->private_->loose_mid_side_stereo_frame_count >= encoder->private_->loose_mid_side_stereo_frames)
 			encoder->private_->loose_mid_side_stereo_frame_count = 0;
+		encoder->private_->last_channel_assignment = frame_header.channel_assignment;
 	}
 
-	encoder->private_->last_channel_assignment = frame_header.channel_assignment;
-
 	return true;
 }
 
+FLAC__bool process_subframe_job_(
+	FLAC__StreamEncoder *encoder,
+	FLAC__StreamEncoderThreadTask *threadtask,
+	FLAC__StreamEncoderSubframeScratch *scratch,
+	uint32_t min_partition_order,
+	uint32_t max_partition_order,
+	const FLAC__FrameHeader *frame_header,
+	uint32_t channel,
+	FLAC__bool is_mid_side
+)
+{
+	if(is_mid_side) {
+		return process_subframe_(
+			encoder,
+			scratch,
+			min_partition_order,
+			max_partition_order,
+			frame_header,
+			threadtask->subframe_bps_mid_side[channel],
+			threadtask->integer_signal_mid_side[channel],
+			threadtask->subframe_workspace_ptr_mid_side[channel],
+			threadtask->partitioned_rice_contents_workspace_ptr_mid_side[channel],
+			threadtask->residual_workspace_mid_side[channel],
+			threadtask->best_subframe_mid_side+channel,
+			threadtask->best_subframe_bits_mid_side+channel
+		);
+	}
+	else {
+		return process_subframe_(
+			encoder,
+			scratch,
+			min_partition_order,
+			max_partition_order,
+			frame_header,
+			threadtask->subframe_bps[channel],
+			threadtask->integer_signal[channel],
+			threadtask->subframe_workspace_ptr[channel],
+			threadtask->partitioned_rice_contents_workspace_ptr[channel],
+			threadtask->residual_workspace[channel],
+			threadtask->best_subframe+channel,
+			threadtask->best_subframe_bits+channel
+		);
+	}
+}
+
 FLAC__bool process_subframe_(
 	FLAC__StreamEncoder *encoder,
+	FLAC__StreamEncoderSubframeScratch *scratch,
 	uint32_t min_partition_order,
 	uint32_t max_partition_order,
 	const FLAC__FrameHeader *frame_header,
@@ -3492,10 +4572,11 @@ FLAC__bool process_subframe_(
 					_candidate_bits =
 						evaluate_fixed_subframe_(
 							encoder,
+							scratch,
 							integer_signal,
 							residual[!_best_subframe],
-							encoder->private_->abs_residual_partition_sums,
-							encoder->private_->raw_bits_per_partition,
+							scratch->abs_residual_partition_sums,
+							scratch->raw_bits_per_partition,
 							frame_header->blocksize,
 							subframe_bps,
 							fixed_order,
@@ -3525,11 +4606,14 @@ FLAC__bool process_subframe_(
 				if(max_lpc_order > 0) {
 					uint32_t a;
 					for (a = 0; a < encoder->protected_->num_apodizations; a++) {
-						FLAC__lpc_window_data(integer_signal, encoder->private_->window[a], encoder->private_->windowed_signal, frame_header->blocksize);
-						encoder->private_->local_lpc_compute_autocorrelation(encoder->private_->windowed_signal, frame_header->blocksize, max_lpc_order+1, autoc);
+						FLAC__STATISTICS_TIME(&scratch->statistics, FLAC__STREAM_ENCODER_STAGE_WINDOW,
+							FLAC__lpc_window_data(integer_signal, encoder->private_->window[a], scratch->windowed_signal, frame_header->blocksize));
+						FLAC__STATISTICS_TIME(&scratch->statistics, FLAC__STREAM_ENCODER_STAGE_AUTOCORRELATION,
+							encoder->private_->local_lpc_compute_autocorrelation(scratch->windowed_signal, frame_header->blocksize, max_lpc_order+1, autoc));
 						/* if autoc[0] == 0.0, the signal is constant and we usually won't get here, but it can happen */
 						if(autoc[0] != 0.0) {
-							FLAC__lpc_compute_lp_coefficients(autoc, &max_lpc_order, encoder->private_->lp_coeff, lpc_error);
+							FLAC__STATISTICS_TIME(&scratch->statistics, FLAC__STREAM_ENCODER_STAGE_LP_COEFFICIENTS,
+								FLAC__lpc_compute_lp_coefficients(autoc, &max_lpc_order, scratch->lp_coeff, lpc_error));
 							if(encoder->protected_->do_exhaustive_model_search) {
 								min_lpc_order = 1;
 							}
@@ -3578,11 +4662,12 @@ FLAC__bool process_subframe_(
 									_candidate_bits =
 										evaluate_lpc_subframe_(
 											encoder,
+											scratch,
 											integer_signal,
 											residual[!_best_subframe],
-											encoder->private_->abs_residual_partition_sums,
-											encoder->private_->raw_bits_per_partition,
-											encoder->private_->lp_coeff[lpc_order-1],
+											scratch->abs_residual_partition_sums,
+											scratch->raw_bits_per_partition,
+											scratch->lp_coeff[lpc_order-1],
 											frame_header->blocksize,
 											subframe_bps,
 											lpc_order,
@@ -3625,7 +4710,6 @@ FLAC__bool process_subframe_(
 }
 
 FLAC__bool add_subframe_(
-	FLAC__StreamEncoder *encoder,
 	uint32_t blocksize,
 	uint32_t subframe_bps,
 	const FLAC__Subframe *subframe,
@@ -3635,25 +4719,21 @@ FLAC__bool add_subframe_(
 	switch(subframe->type) {
 		case FLAC__SUBFRAME_TYPE_CONSTANT:
 			if(!FLAC__subframe_add_constant(&(subframe->data.constant), subframe_bps, subframe->wasted_bits, frame)) {
-				encoder->protected_->state = FLAC__STREAM_ENCODER_FRAMING_ERROR;
 				return false;
 			}
 			break;
 		case FLAC__SUBFRAME_TYPE_FIXED:
 			if(!FLAC__subframe_add_fixed(&(subframe->data.fixed), blocksize - subframe->data.fixed.order, subframe_bps, subframe->wasted_bits, frame)) {
-				encoder->protected_->state = FLAC__STREAM_ENCODER_FRAMING_ERROR;
 				return false;
 			}
 			break;
 		case FLAC__SUBFRAME_TYPE_LPC:
 			if(!FLAC__subframe_add_lpc(&(subframe->data.lpc), blocksize - subframe->data.lpc.order, subframe_bps, subframe->wasted_bits, frame)) {
-				encoder->protected_->state = FLAC__STREAM_ENCODER_FRAMING_ERROR;
 				return false;
 			}
 			break;
 		case FLAC__SUBFRAME_TYPE_VERBATIM:
 			if(!FLAC__subframe_add_verbatim(&(subframe->data.verbatim), blocksize, subframe_bps, subframe->wasted_bits, frame)) {
-				encoder->protected_->state = FLAC__STREAM_ENCODER_FRAMING_ERROR;
 				return false;
 			}
 			break;
@@ -3675,7 +4755,7 @@ static void spotcheck_subframe_estimate_(
 )
 {
 	FLAC__bool ret;
-	FLAC__BitWriter *frame = FLAC__bitwriter_new();
+	FLAC__BitWriter *frame = FLAC__bitwriter_new(&encoder->private_->allocator);
 	if(frame == 0) {
 		fprintf(stderr, "EST: can't allocate frame\n");
 		return;
@@ -3684,7 +4764,7 @@ static void spotcheck_subframe_estimate_(
 		fprintf(stderr, "EST: can't init frame\n");
 		return;
 	}
-	ret = add_subframe_(encoder, blocksize, subframe_bps, subframe, frame);
+	ret = add_subframe_(blocksize, subframe_bps, subframe, frame);
 	FLAC__ASSERT(ret);
 	{
 		const uint32_t actual = FLAC__bitwriter_get_input_bits_unconsumed(frame);
@@ -3720,6 +4800,7 @@ uint32_t evaluate_constant_subframe_(
 
 uint32_t evaluate_fixed_subframe_(
 	FLAC__StreamEncoder *encoder,
+	FLAC__StreamEncoderSubframeScratch *scratch,
 	const FLAC__int32 signal[],
 	FLAC__int32 residual[],
 	FLAC__uint64 abs_residual_partition_sums[],
@@ -3740,7 +4821,8 @@ uint32_t evaluate_fixed_subframe_(
 	uint32_t i, residual_bits, estimate;
 	const uint32_t residual_samples = blocksize - order;
 
-	FLAC__fixed_compute_residual(signal+order, residual_samples, order, residual);
+	FLAC__STATISTICS_TIME(&scratch->statistics, FLAC__STREAM_ENCODER_STAGE_RESIDUAL,
+		FLAC__fixed_compute_residual(signal+order, residual_samples, order, residual));
 
 	subframe->type = FLAC__SUBFRAME_TYPE_FIXED;
 
@@ -3751,6 +4833,7 @@ uint32_t evaluate_fixed_subframe_(
 	residual_bits =
 		find_best_partition_order_(
 			encoder->private_,
+			scratch,
 			residual,
 			abs_residual_partition_sums,
 			raw_bits_per_partition,
@@ -3782,6 +4865,7 @@ uint32_t evaluate_fixed_subframe_(
 #ifndef FLAC__INTEGER_ONLY_LIBRARY
 uint32_t evaluate_lpc_subframe_(
 	FLAC__StreamEncoder *encoder,
+	FLAC__StreamEncoderSubframeScratch *scratch,
 	const FLAC__int32 signal[],
 	FLAC__int32 residual[],
 	FLAC__uint64 abs_residual_partition_sums[],
@@ -3813,17 +4897,20 @@ uint32_t evaluate_lpc_subframe_(
 		qlp_coeff_precision = flac_min(qlp_coeff_precision, 32 - subframe_bps - FLAC__bitmath_ilog2(order));
 	}
 
-	ret = FLAC__lpc_quantize_coefficients(lp_coeff, order, qlp_coeff_precision, qlp_coeff, &quantization);
+	FLAC__STATISTICS_TIME(&scratch->statistics, FLAC__STREAM_ENCODER_STAGE_QUANTIZATION,
+		ret = FLAC__lpc_quantize_coefficients(lp_coeff, order, qlp_coeff_precision, qlp_coeff, &quantization));
 	if(ret != 0)
 		return 0; /* this is a hack to indicate to the caller that we can't do lp at this order on this subframe */
 
-	if(subframe_bps + qlp_coeff_precision + FLAC__bitmath_ilog2(order) <= 32)
-		if(subframe_bps <= 16 && qlp_coeff_precision <= 16)
-			encoder->private_->local_lpc_compute_residual_from_qlp_coefficients_16bit(signal+order, residual_samples, qlp_coeff, order, quantization, residual);
+	FLAC__STATISTICS_TIME(&scratch->statistics, FLAC__STREAM_ENCODER_STAGE_RESIDUAL,
+		if(subframe_bps + qlp_coeff_precision + FLAC__bitmath_ilog2(order) <= 32)
+			if(subframe_bps <= 16 && qlp_coeff_precision <= 16)
+				encoder->private_->local_lpc_compute_residual_from_qlp_coefficients_16bit(signal+order, residual_samples, qlp_coeff, order, quantization, residual);
+			else
+				encoder->private_->local_lpc_compute_residual_from_qlp_coefficients(signal+order, residual_samples, qlp_coeff, order, quantization, residual);
 		else
-			encoder->private_->local_lpc_compute_residual_from_qlp_coefficients(signal+order, residual_samples, qlp_coeff, order, quantization, residual);
-	else
-		encoder->private_->local_lpc_compute_residual_from_qlp_coefficients_64bit(signal+order, residual_samples, qlp_coeff, order, quantization, residual);
+			encoder->private_->local_lpc_compute_residual_from_qlp_coefficients_64bit(signal+order, residual_samples, qlp_coeff, order, quantization, residual)
+	);
 
 	subframe->type = FLAC__SUBFRAME_TYPE_LPC;
 
@@ -3834,6 +4921,7 @@ uint32_t evaluate_lpc_subframe_(
 	residual_bits =
 		find_best_partition_order_(
 			encoder->private_,
+			scratch,
 			residual,
 			abs_residual_partition_sums,
 			raw_bits_per_partition,
@@ -3893,6 +4981,7 @@ uint32_t evaluate_verbatim_subframe_(
 
 uint32_t find_best_partition_order_(
 	FLAC__StreamEncoderPrivate *private_,
+	FLAC__StreamEncoderSubframeScratch *scratch,
 	const FLAC__int32 residual[],
 	FLAC__uint64 abs_residual_partition_sums[],
 	uint32_t raw_bits_per_partition[],
@@ -3916,14 +5005,19 @@ uint32_t find_best_partition_order_(
 	max_partition_order = FLAC__format_get_max_rice_partition_order_from_blocksize_limited_max_and_predictor_order(max_partition_order, blocksize, predictor_order);
 	min_partition_order = flac_min(min_partition_order, max_partition_order);
 
-	private_->local_precompute_partition_info_sums(residual, abs_residual_partition_sums, residual_samples, predictor_order, min_partition_order, max_partition_order, bps);
-
-	if(do_escape_coding)
-		precompute_partition_info_escapes_(residual, raw_bits_per_partition, residual_samples, predictor_order, min_partition_order, max_partition_order);
+	FLAC__STATISTICS_TIME(&scratch->statistics, FLAC__STREAM_ENCODER_STAGE_PARTITION_SUMS,
+		private_->local_precompute_partition_info_sums(residual, abs_residual_partition_sums, residual_samples, predictor_order, min_partition_order, max_partition_order, bps);
+		if(do_escape_coding)
+			precompute_partition_info_escapes_(residual, raw_bits_per_partition, residual_samples, predictor_order, min_partition_order, max_partition_order)
+	);
 
 	{
 		int partition_order;
 		uint32_t sum;
+#ifdef FLAC__ENABLE_STATISTICS
+		/* not FLAC__STATISTICS_TIME(): there is an #ifdef in the loop */
+		const FLAC__uint64 search_start = FLAC__statistics_clock();
+#endif
 
 		for(partition_order = (int)max_partition_order, sum = 0; partition_order >= (int)min_partition_order; partition_order--) {
 			if(!
@@ -3940,7 +5034,8 @@ uint32_t find_best_partition_order_(
 					rice_parameter_search_dist,
 					(uint32_t)partition_order,
 					do_escape_coding,
-					&private_->partitioned_rice_contents_extra[!best_parameters_index],
+					&scratch->partitioned_rice_contents_extra[!best_parameters_index],
+					scratch->allocator,
 					&residual_bits
 				)
 			)
@@ -3955,6 +5050,10 @@ uint32_t find_best_partition_order_(
 				best_partition_order = partition_order;
 			}
 		}
+#ifdef FLAC__ENABLE_STATISTICS
+		scratch->statistics.nanoseconds[FLAC__STREAM_ENCODER_STAGE_RICE_SEARCH] += FLAC__statistics_clock() - search_start;
+		scratch->statistics.calls[FLAC__STREAM_ENCODER_STAGE_RICE_SEARCH]++;
+#endif
 	}
 
 	best_ecm->data.partitioned_rice.order = best_partition_order;
@@ -3968,10 +5067,10 @@ uint32_t find_best_partition_order_(
 		uint32_t partition;
 
 		/* save best parameters and raw_bits */
-		FLAC__format_entropy_coding_method_partitioned_rice_contents_ensure_size(prc, flac_max(6u, best_partition_order));
-		memcpy(prc->parameters, private_->partitioned_rice_contents_extra[best_parameters_index].parameters, sizeof(uint32_t)*(1<<(best_partition_order)));
+		FLAC__format_entropy_coding_method_partitioned_rice_contents_ensure_size(prc, flac_max(6u, best_partition_order), scratch->allocator);
+		memcpy(prc->parameters, scratch->partitioned_rice_contents_extra[best_parameters_index].parameters, sizeof(uint32_t)*(1<<(best_partition_order)));
 		if(do_escape_coding)
-			memcpy(prc->raw_bits, private_->partitioned_rice_contents_extra[best_parameters_index].raw_bits, sizeof(uint32_t)*(1<<(best_partition_order)));
+			memcpy(prc->raw_bits, scratch->partitioned_rice_contents_extra[best_parameters_index].raw_bits, sizeof(uint32_t)*(1<<(best_partition_order)));
 		/*
 		 * Now need to check if the type should be changed to
 		 * FLAC__ENTROPY_CODING_METHOD_PARTITIONED_RICE2 based on the
@@ -4158,6 +5257,7 @@ FLAC__bool set_partitioned_rice_(
 	const uint32_t partition_order,
 	const FLAC__bool search_for_escapes,
 	FLAC__EntropyCodingMethod_PartitionedRiceContents *partitioned_rice_contents,
+	const FLAC__Allocator *allocator,
 	uint32_t *bits
 )
 {
@@ -4174,7 +5274,7 @@ FLAC__bool set_partitioned_rice_(
 	FLAC__ASSERT(suggested_rice_parameter < FLAC__ENTROPY_CODING_METHOD_PARTITIONED_RICE2_ESCAPE_PARAMETER);
 	FLAC__ASSERT(rice_parameter_limit <= FLAC__ENTROPY_CODING_METHOD_PARTITIONED_RICE2_ESCAPE_PARAMETER);
 
-	FLAC__format_entropy_coding_method_partitioned_rice_contents_ensure_size(partitioned_rice_contents, flac_max(6u, partition_order));
+	FLAC__format_entropy_coding_method_partitioned_rice_contents_ensure_size(partitioned_rice_contents, flac_max(6u, partition_order), allocator);
 	parameters = partitioned_rice_contents->parameters;
 	raw_bits = partitioned_rice_contents->raw_bits;
 
@@ -4457,7 +5557,7 @@ FLAC__StreamDecoderWriteStatus verify_write_callback_(const FLAC__StreamDecoder
 	}
 	/* dequeue the frame from the fifo */
 	encoder->private_->verify.input_fifo.tail -= blocksize;
-	FLAC__ASSERT(encoder->private_->verify.input_fifo.tail <= OVERREAD_);
+	FLAC__ASSERT(encoder->private_->verify.input_fifo.tail <= encoder->private_->verify.input_fifo.size - blocksize);
 	for(channel = 0; channel < channels; channel++)
 		memmove(&encoder->private_->verify.input_fifo.data[channel][0], &encoder->private_->verify.input_fifo.data[channel][blocksize], encoder->private_->verify.input_fifo.tail * sizeof(encoder->private_->verify.input_fifo.data[0][0]));
 	return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
@@ -4559,6 +5659,69 @@ FLAC__StreamEncoderWriteStatus file_write_callback_(const FLAC__StreamEncoder *e
 		return FLAC__STREAM_ENCODER_WRITE_STATUS_FATAL_ERROR;
 }
 
+FLAC__StreamEncoderSeekStatus memory_seek_callback_(const FLAC__StreamEncoder *encoder, FLAC__uint64 absolute_byte_offset, void *client_data)
+{
+	(void)client_data;
+
+	/* only ever used to go back and rewrite the metadata */
+	if(absolute_byte_offset > encoder->private_->memory_length)
+		return FLAC__STREAM_ENCODER_SEEK_STATUS_ERROR;
+	encoder->private_->memory_position = (size_t)absolute_byte_offset;
+	return FLAC__STREAM_ENCODER_SEEK_STATUS_OK;
+}
+
+FLAC__StreamEncoderTellStatus memory_tell_callback_(const FLAC__StreamEncoder *encoder, FLAC__uint64 *absolute_byte_offset, void *client_data)
+{
+	(void)client_data;
+
+	*absolute_byte_offset = encoder->private_->memory_position;
+	return FLAC__STREAM_ENCODER_TELL_STATUS_OK;
+}
+
+FLAC__StreamEncoderWriteStatus memory_write_callback_(const FLAC__StreamEncoder *encoder, const FLAC__byte buffer[], size_t bytes, uint32_t samples, uint32_t current_frame, void *client_data)
+{
+	FLAC__StreamEncoderPrivate *private_ = encoder->private_;
+	const size_t end = private_->memory_position + bytes;
+
+	(void)client_data, (void)current_frame;
+
+	if(end < private_->memory_position)
+		return FLAC__STREAM_ENCODER_WRITE_STATUS_FATAL_ERROR;
+
+	if(end > private_->memory_capacity) {
+		/* grow geometrically so a stream costs O(log n) reallocs; the
+		 * first allocation is sized from the total samples estimate
+		 * (at half the PCM size) when there is one
+		 */
+		size_t capacity = private_->memory_capacity;
+		FLAC__byte *memory;
+		if(capacity == 0) {
+			const FLAC__uint64 guess = encoder->protected_->total_samples_estimate * encoder->protected_->channels * ((encoder->protected_->bits_per_sample + 7) / 8) / 2;
+			capacity = guess > 65536 && guess < ((size_t)(-1) >> 1)? (size_t)guess : 65536;
+		}
+		while(capacity < end) {
+			if(capacity > ((size_t)(-1) >> 1))
+				return FLAC__STREAM_ENCODER_WRITE_STATUS_FATAL_ERROR;
+			capacity *= 2;
+		}
+		if(0 == (memory = FLAC__memory_realloc(&private_->allocator, private_->memory, capacity)))
+			return FLAC__STREAM_ENCODER_WRITE_STATUS_FATAL_ERROR;
+		private_->memory = memory;
+		private_->memory_capacity = capacity;
+	}
+
+	memcpy(private_->memory + private_->memory_position, buffer, bytes);
+	private_->memory_position = end;
+	if(end > private_->memory_length)
+		private_->memory_length = end;
+
+	/* see file_write_callback_() for why the stats are adjusted */
+	if(0 != private_->progress_callback && samples > 0)
+		private_->progress_callback(encoder, private_->bytes_written+bytes, private_->samples_written+samples, private_->frames_written+1, private_->total_frames_estimate, private_->client_data);
+
+	return FLAC__STREAM_ENCODER_WRITE_STATUS_OK;
+}
+
 /*
  * This will forcibly set stdout to binary mode (for OSes that require it)
  */
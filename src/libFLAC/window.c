@@ -35,9 +35,13 @@
 #endif
 
 #include <math.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 #include "share/compat.h"
 #include "FLAC/assert.h"
 #include "FLAC/format.h"
+#include "private/memory.h"
 #include "private/window.h"
 
 #ifndef FLAC__INTEGER_ONLY_LIBRARY
@@ -279,4 +283,219 @@ void FLAC__window_welch(FLAC__real *window, const FLAC__int32 L)
 	}
 }
 
+void FLAC__window_compute(FLAC__real *window, const FLAC__int32 L, const FLAC__ApodizationSpecification *spec)
+{
+	switch(spec->type) {
+		case FLAC__APODIZATION_BARTLETT:
+			FLAC__window_bartlett(window, L);
+			break;
+		case FLAC__APODIZATION_BARTLETT_HANN:
+			FLAC__window_bartlett_hann(window, L);
+			break;
+		case FLAC__APODIZATION_BLACKMAN:
+			FLAC__window_blackman(window, L);
+			break;
+		case FLAC__APODIZATION_BLACKMAN_HARRIS_4TERM_92DB_SIDELOBE:
+			FLAC__window_blackman_harris_4term_92db_sidelobe(window, L);
+			break;
+		case FLAC__APODIZATION_CONNES:
+			FLAC__window_connes(window, L);
+			break;
+		case FLAC__APODIZATION_FLATTOP:
+			FLAC__window_flattop(window, L);
+			break;
+		case FLAC__APODIZATION_GAUSS:
+			FLAC__window_gauss(window, L, spec->parameters.gauss.stddev);
+			break;
+		case FLAC__APODIZATION_HAMMING:
+			FLAC__window_hamming(window, L);
+			break;
+		case FLAC__APODIZATION_HANN:
+			FLAC__window_hann(window, L);
+			break;
+		case FLAC__APODIZATION_KAISER_BESSEL:
+			FLAC__window_kaiser_bessel(window, L);
+			break;
+		case FLAC__APODIZATION_NUTTALL:
+			FLAC__window_nuttall(window, L);
+			break;
+		case FLAC__APODIZATION_RECTANGLE:
+			FLAC__window_rectangle(window, L);
+			break;
+		case FLAC__APODIZATION_TRIANGLE:
+			FLAC__window_triangle(window, L);
+			break;
+		case FLAC__APODIZATION_TUKEY:
+			FLAC__window_tukey(window, L, spec->parameters.tukey.p);
+			break;
+		case FLAC__APODIZATION_PARTIAL_TUKEY:
+			FLAC__window_partial_tukey(window, L, spec->parameters.multiple_tukey.p, spec->parameters.multiple_tukey.start, spec->parameters.multiple_tukey.end);
+			break;
+		case FLAC__APODIZATION_PUNCHOUT_TUKEY:
+			FLAC__window_punchout_tukey(window, L, spec->parameters.multiple_tukey.p, spec->parameters.multiple_tukey.start, spec->parameters.multiple_tukey.end);
+			break;
+		case FLAC__APODIZATION_WELCH:
+			FLAC__window_welch(window, L);
+			break;
+		default:
+			FLAC__ASSERT(0);
+			/* double protection */
+			FLAC__window_hann(window, L);
+			break;
+	}
+}
+
+/*
+ * The window cache.  Entries are kept in a list, most recently acquired
+ * first.  When the last user releases one it stays in the list so that
+ * the next encoder with the same settings finds it, but only as long as
+ * the idle entries number no more than WINDOW_CACHE_MAX_IDLE_ and hold
+ * no more than WINDOW_CACHE_MAX_IDLE_BYTES_ between them; past that the
+ * least recently acquired ones are freed.  Without threads there is no
+ * lock to guard the list, so then every caller gets its own window,
+ * which is freed with its last user.  Entries outlive the encoders that
+ * use them, so they come from the global allocator, and each remembers
+ * the one it came from in case that is changed later.
+ */
+
+#define WINDOW_CACHE_MAX_IDLE_ FLAC__MAX_APODIZATION_FUNCTIONS
+#define WINDOW_CACHE_MAX_IDLE_BYTES_ (1u << 20)
+
+struct FLAC__WindowCacheEntry {
+	FLAC__ApodizationSpecification spec;
+	FLAC__int32 L;
+	uint32_t refcount;
+	FLAC__real *window; /* aligned */
+	FLAC__real *window_unaligned;
+	FLAC__Allocator allocator;
+	struct FLAC__WindowCacheEntry *next;
+};
+
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t window_cache_mutex_ = PTHREAD_MUTEX_INITIALIZER;
+static FLAC__WindowCacheEntry *window_cache_ = 0;
+
+static FLAC__bool same_window_(const FLAC__WindowCacheEntry *entry, const FLAC__ApodizationSpecification *spec, FLAC__int32 L)
+{
+	if(entry->L != L || entry->spec.type != spec->type)
+		return false;
+	switch(spec->type) {
+		case FLAC__APODIZATION_GAUSS:
+			return entry->spec.parameters.gauss.stddev == spec->parameters.gauss.stddev;
+		case FLAC__APODIZATION_TUKEY:
+			return entry->spec.parameters.tukey.p == spec->parameters.tukey.p;
+		case FLAC__APODIZATION_PARTIAL_TUKEY:
+		case FLAC__APODIZATION_PUNCHOUT_TUKEY:
+			return
+				entry->spec.parameters.multiple_tukey.p == spec->parameters.multiple_tukey.p &&
+				entry->spec.parameters.multiple_tukey.start == spec->parameters.multiple_tukey.start &&
+				entry->spec.parameters.multiple_tukey.end == spec->parameters.multiple_tukey.end;
+		default:
+			return true;
+	}
+}
+#endif
+
+FLAC__WindowCacheEntry *FLAC__window_cache_acquire(const FLAC__ApodizationSpecification *spec, const FLAC__int32 L)
+{
+	FLAC__WindowCacheEntry *entry;
+#ifdef HAVE_PTHREAD
+	FLAC__WindowCacheEntry **link;
+#endif
+
+	FLAC__ASSERT(0 != spec);
+	FLAC__ASSERT(L > 0);
+
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&window_cache_mutex_);
+	for(link = &window_cache_; 0 != *link; link = &(*link)->next) {
+		if(same_window_(*link, spec, L)) {
+			/* move it to the front */
+			entry = *link;
+			*link = entry->next;
+			entry->next = window_cache_;
+			window_cache_ = entry;
+			entry->refcount++;
+			pthread_mutex_unlock(&window_cache_mutex_);
+			return entry;
+		}
+	}
+#endif
+
+	if(0 != (entry = FLAC__memory_calloc(0, 1, sizeof(FLAC__WindowCacheEntry)))) {
+		FLAC__memory_get_allocator(&entry->allocator, 0);
+		if(FLAC__memory_alloc_aligned_real_array(&entry->allocator, L, &entry->window_unaligned, &entry->window)) {
+			entry->spec = *spec;
+			entry->L = L;
+			entry->refcount = 1;
+			FLAC__window_compute(entry->window, L, spec);
+#ifdef HAVE_PTHREAD
+			entry->next = window_cache_;
+			window_cache_ = entry;
+#endif
+		}
+		else {
+			FLAC__memory_free(&entry->allocator, entry);
+			entry = 0;
+		}
+	}
+
+#ifdef HAVE_PTHREAD
+	pthread_mutex_unlock(&window_cache_mutex_);
+#endif
+	return entry;
+}
+
+const FLAC__real *FLAC__window_cache_get_window(const FLAC__WindowCacheEntry *entry)
+{
+	FLAC__ASSERT(0 != entry);
+	return entry->window;
+}
+
+void FLAC__window_cache_release(FLAC__WindowCacheEntry *entry)
+{
+#ifdef HAVE_PTHREAD
+	FLAC__WindowCacheEntry **link, *victims = 0;
+	uint32_t idle = 0;
+	size_t idle_bytes = 0;
+#endif
+
+	FLAC__ASSERT(0 != entry);
+	FLAC__ASSERT(entry->refcount > 0);
+
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&window_cache_mutex_);
+	if(--entry->refcount == 0) {
+		/* unlink the least recently acquired idle entries that go over either limit */
+		for(link = &window_cache_; 0 != *link; ) {
+			if((*link)->refcount == 0) {
+				if(idle + 1 > WINDOW_CACHE_MAX_IDLE_ || idle_bytes + sizeof(FLAC__real) * (*link)->L > WINDOW_CACHE_MAX_IDLE_BYTES_) {
+					entry = *link;
+					*link = entry->next;
+					entry->next = victims;
+					victims = entry;
+					continue;
+				}
+				idle++;
+				idle_bytes += sizeof(FLAC__real) * (*link)->L;
+			}
+			link = &(*link)->next;
+		}
+	}
+	pthread_mutex_unlock(&window_cache_mutex_);
+
+	while(0 != victims) {
+		entry = victims;
+		victims = entry->next;
+		FLAC__memory_free(&entry->allocator, entry->window_unaligned);
+		FLAC__memory_free(&entry->allocator, entry);
+	}
+#else
+	if(--entry->refcount == 0) {
+		FLAC__memory_free(&entry->allocator, entry->window_unaligned);
+		FLAC__memory_free(&entry->allocator, entry);
+	}
+#endif
+}
+
 #endif /* !defined FLAC__INTEGER_ONLY_LIBRARY */
@@ -331,6 +331,35 @@ bool StreamDecoder::test_respond(bool is_ogg)
 	}
 	printf("OK\n");
 
+	printf("testing get_statistics()... ");
+	{
+		::FLAC__StreamDecoderStatistics statistics;
+#ifdef FLAC__ENABLE_STATISTICS
+		const bool expect = true;
+#else
+		const bool expect = false;
+#endif
+		if(get_statistics(&statistics) != expect) {
+			printf("FAILED, expected %s\n", expect? "true" : "false");
+			return false;
+		}
+	}
+	printf("OK\n");
+
+	printf("testing get_kernel()... ");
+	if(0 == get_kernel(::FLAC__STREAM_DECODER_KERNEL_LPC_RESTORE)) {
+		printf("FAILED, returned NULL\n");
+		return false;
+	}
+	printf("OK\n");
+
+	printf("testing get_footprint()... ");
+	if(get_footprint() <= sizeof(::FLAC__StreamDecoder)) {
+		printf("FAILED, returned %u\n", (uint32_t)get_footprint());
+		return false;
+	}
+	printf("OK\n");
+
 	printf("testing finish()... ");
 	if(!finish()) {
 		State state = get_state();
@@ -551,6 +580,26 @@ static bool test_stream_decoder(Layer layer, bool is_ogg)
 		return false;
 	}
 
+	if(!decoder->set_threaded_md5(false)) {
+		printf("FAILED at set_threaded_md5(), returned false\n");
+		return false;
+	}
+
+	if(!decoder->set_interleaved_format(::FLAC__STREAM_DECODER_INTERLEAVED_INT16)) {
+		printf("FAILED at set_interleaved_format(), returned false\n");
+		return false;
+	}
+
+	if(!decoder->set_low_footprint(false)) {
+		printf("FAILED at set_low_footprint(), returned false\n");
+		return false;
+	}
+
+	if(!decoder->set_frame_index(0)) {
+		printf("FAILED at set_frame_index(), returned false\n");
+		return false;
+	}
+
 	switch(layer) {
 		case LAYER_STREAM:
 		case LAYER_SEEKABLE_STREAM:
@@ -610,6 +659,34 @@ static bool test_stream_decoder(Layer layer, bool is_ogg)
 	}
 	printf("OK\n");
 
+	printf("testing get_threaded_md5()... ");
+	if(decoder->get_threaded_md5()) {
+		printf("FAILED, returned true, expected false\n");
+		return false;
+	}
+	printf("OK\n");
+
+	printf("testing get_interleaved_format()... ");
+	if(decoder->get_interleaved_format() != ::FLAC__STREAM_DECODER_INTERLEAVED_INT16) {
+		printf("FAILED, returned %s, expected %s\n", ::FLAC__StreamDecoderInterleavedFormatString[decoder->get_interleaved_format()], ::FLAC__StreamDecoderInterleavedFormatString[::FLAC__STREAM_DECODER_INTERLEAVED_INT16]);
+		return false;
+	}
+	printf("OK\n");
+
+	printf("testing get_low_footprint()... ");
+	if(decoder->get_low_footprint()) {
+		printf("FAILED, returned true, expected false\n");
+		return false;
+	}
+	printf("OK\n");
+
+	printf("testing get_frame_index()... ");
+	if(decoder->get_frame_index() != 0) {
+		printf("FAILED, returned an index, expected NULL\n");
+		return false;
+	}
+	printf("OK\n");
+
 	printf("testing process_until_end_of_metadata()... ");
 	if(!decoder->process_until_end_of_metadata())
 		return die_s_("returned false", decoder);
@@ -656,6 +733,17 @@ static bool test_stream_decoder(Layer layer, bool is_ogg)
 		return die_s_(expect? "returned false" : "returned true", decoder);
 	printf("OK\n");
 
+	if(expect) {
+		::FLAC__StreamDecoderSeekStats stats;
+		printf("testing get_seek_stats()... ");
+		decoder->get_seek_stats(&stats);
+		if(stats.iterations == 0 || stats.frames_decoded == 0) {
+			printf("FAILED, got %u iterations and %u frames for the last seek\n", stats.iterations, stats.frames_decoded);
+			return false;
+		}
+		printf("OK\n");
+	}
+
 	printf("testing get_channels()... ");
 	{
 		uint32_t channels = decoder->get_channels();
@@ -723,6 +811,27 @@ static bool test_stream_decoder(Layer layer, bool is_ogg)
 		if(!decoder->process_until_end_of_stream())
 			return die_s_("returned false", decoder);
 		printf("OK\n");
+
+		printf("testing reset()... ");
+		if(!decoder->reset())
+			return die_s_("returned false", decoder);
+		printf("OK\n");
+
+		if(layer == LAYER_STREAM) {
+			printf("rewinding input... ");
+			if(fseeko(dynamic_cast<StreamDecoder*>(decoder)->file_, 0, SEEK_SET) < 0) {
+				printf("FAILED, errno = %d\n", errno);
+				return false;
+			}
+			printf("OK\n");
+		}
+
+		dynamic_cast<DecoderCommon*>(decoder)->current_metadata_number_ = 0;
+
+		printf("testing process_parallel()... ");
+		if(!decoder->process_parallel(4))
+			return die_s_("returned false", decoder);
+		printf("OK\n");
 	}
 
 	printf("testing finish()... ");
@@ -199,6 +199,7 @@ static bool test_stream_encoder(Layer layer, bool is_ogg)
 	::FLAC__StreamEncoderInitStatus init_status;
 	FILE *file = 0;
 	FLAC__int32 samples[1024];
+	FLAC__int16 samples16[1024];
 	FLAC__int32 *samples_array[1] = { samples };
 	uint32_t i;
 
@@ -312,6 +313,26 @@ static bool test_stream_encoder(Layer layer, bool is_ogg)
 		return die_s_("returned false", encoder);
 	printf("OK\n");
 
+	printf("testing set_num_threads()... ");
+	if(!encoder->set_num_threads(1))
+		return die_s_("returned false", encoder);
+	printf("OK\n");
+
+	printf("testing set_parallel_subframes()... ");
+	if(!encoder->set_parallel_subframes(false))
+		return die_s_("returned false", encoder);
+	printf("OK\n");
+
+	printf("testing set_threaded_md5()... ");
+	if(!encoder->set_threaded_md5(false))
+		return die_s_("returned false", encoder);
+	printf("OK\n");
+
+	printf("testing set_keep_buffers()... ");
+	if(!encoder->set_keep_buffers(false))
+		return die_s_("returned false", encoder);
+	printf("OK\n");
+
 	printf("testing set_total_samples_estimate()... ");
 	if(!encoder->set_total_samples_estimate(streaminfo_.data.stream_info.total_samples))
 		return die_s_("returned false", encoder);
@@ -491,6 +512,34 @@ static bool test_stream_encoder(Layer layer, bool is_ogg)
 	}
 	printf("OK\n");
 
+	printf("testing get_num_threads()... ");
+	if(encoder->get_num_threads() != 1) {
+		printf("FAILED, expected %d, got %u\n", 1, encoder->get_num_threads());
+		return false;
+	}
+	printf("OK\n");
+
+	printf("testing get_parallel_subframes()... ");
+	if(encoder->get_parallel_subframes() != false) {
+		printf("FAILED, expected false, got true\n");
+		return false;
+	}
+	printf("OK\n");
+
+	printf("testing get_threaded_md5()... ");
+	if(encoder->get_threaded_md5() != false) {
+		printf("FAILED, expected false, got true\n");
+		return false;
+	}
+	printf("OK\n");
+
+	printf("testing get_keep_buffers()... ");
+	if(encoder->get_keep_buffers() != false) {
+		printf("FAILED, expected false, got true\n");
+		return false;
+	}
+	printf("OK\n");
+
 	printf("testing get_total_samples_estimate()... ");
 	if(encoder->get_total_samples_estimate() != streaminfo_.data.stream_info.total_samples) {
 		printf("FAILED, expected %" PRIu64 ", got %" PRIu64 "\n", streaminfo_.data.stream_info.total_samples, encoder->get_total_samples_estimate());
@@ -498,9 +547,33 @@ static bool test_stream_encoder(Layer layer, bool is_ogg)
 	}
 	printf("OK\n");
 
-	/* init the dummy sample buffer */
-	for(i = 0; i < sizeof(samples) / sizeof(FLAC__int32); i++)
+	printf("testing get_statistics()... ");
+	{
+		::FLAC__StreamEncoderStatistics statistics;
+#ifdef FLAC__ENABLE_STATISTICS
+		const bool expect = true;
+#else
+		const bool expect = false;
+#endif
+		if(encoder->get_statistics(&statistics) != expect) {
+			printf("FAILED, expected %s\n", expect? "true" : "false");
+			return false;
+		}
+	}
+	printf("OK\n");
+
+	printf("testing get_kernel()... ");
+	if(0 == encoder->get_kernel(::FLAC__STREAM_ENCODER_KERNEL_FIXED_BEST_PREDICTOR)) {
+		printf("FAILED, returned NULL\n");
+		return false;
+	}
+	printf("OK\n");
+
+	/* init the dummy sample buffers */
+	for(i = 0; i < sizeof(samples) / sizeof(FLAC__int32); i++) {
 		samples[i] = i & 7;
+		samples16[i] = static_cast<FLAC__int16>(samples[i]);
+	}
 
 	printf("testing process()... ");
 	if(!encoder->process(samples_array, sizeof(samples) / sizeof(FLAC__int32)))
@@ -512,6 +585,11 @@ static bool test_stream_encoder(Layer layer, bool is_ogg)
 		return die_s_("returned false", encoder);
 	printf("OK\n");
 
+	printf("testing process_interleaved_int16()... ");
+	if(!encoder->process_interleaved_int16(samples16, sizeof(samples16) / sizeof(FLAC__int16)))
+		return die_s_("returned false", encoder);
+	printf("OK\n");
+
 	printf("testing finish()... ");
 	if(!encoder->finish()) {
 		state = encoder->get_state();
@@ -24,6 +24,8 @@
 #include "FLAC/assert.h"
 #include "share/compat.h"
 #include "private/bitreader.h" /* from the libFLAC private include area */
+#include "private/bitwriter.h" /* from the libFLAC private include area */
+#include "private/cpu.h" /* from the libFLAC private include area */
 #include "bitreader.h"
 #include <stdio.h>
 #include <string.h> /* for memcpy() */
@@ -59,11 +61,20 @@ struct FLAC__BitReader {
 	uint32_t read_crc16; /* the running frame CRC */
 	uint32_t crc16_offset; /* the number of words in the current buffer that should not be CRC'd */
 	uint32_t crc16_align; /* the number of bits in the current consumed word that should not be CRC'd */
+	FLAC__bool use_pclmul; /* see FLAC__bitreader_set_cpu_info() */
+	FLAC__bool use_sse2;
+#if FLAC__BYTES_PER_WORD == 4
+	FLAC__uint64 *rice_table; /* multi-code lookup tables for the smallest Rice parameters, built on demand */
+	uint32_t rice_table_built; /* bit n set when the table for parameter n is filled in */
+#endif
 	FLAC__BitReaderReadCallback read_callback;
+	FLAC__BitReaderBorrowCallback borrow_callback;
 	void *client_data;
 };
 
 static FLAC__bool read_callback(FLAC__byte buffer[], size_t *bytes, void *data);
+static FLAC__bool test_rice_block(FLAC__bool (*read_rice_signed_block)(FLAC__BitReader *br, int vals[], uint32_t nvals, uint32_t parameter));
+static FLAC__bool test_frame_sync(FLAC__bool use_asm);
 
 FLAC__bool test_bitreader(void)
 {
@@ -87,7 +98,7 @@ FLAC__bool test_bitreader(void)
 	 * test new -> delete
 	 */
 	printf("testing new... ");
-	br = FLAC__bitreader_new();
+	br = FLAC__bitreader_new(0);
 	if(0 == br) {
 		printf("FAILED, returned NULL\n");
 		return false;
@@ -102,7 +113,7 @@ FLAC__bool test_bitreader(void)
 	 * test new -> init -> delete
 	 */
 	printf("testing new... ");
-	br = FLAC__bitreader_new();
+	br = FLAC__bitreader_new(0);
 	if(0 == br) {
 		printf("FAILED, returned NULL\n");
 		return false;
@@ -124,7 +135,7 @@ FLAC__bool test_bitreader(void)
 	 * test new -> init -> clear -> delete
 	 */
 	printf("testing new... ");
-	br = FLAC__bitreader_new();
+	br = FLAC__bitreader_new(0);
 	if(0 == br) {
 		printf("FAILED, returned NULL\n");
 		return false;
@@ -153,7 +164,7 @@ FLAC__bool test_bitreader(void)
 	 * test normal usage
 	 */
 	printf("testing new... ");
-	br = FLAC__bitreader_new();
+	br = FLAC__bitreader_new(0);
 	if(0 == br) {
 		printf("FAILED, returned NULL\n");
 		return false;
@@ -305,6 +316,34 @@ FLAC__bool test_bitreader(void)
 	FLAC__bitreader_delete(br);
 	printf("OK\n");
 
+	printf("testing rice block reads... ");
+	if(!test_rice_block(FLAC__bitreader_read_rice_signed_block))
+		return false;
+	printf("OK\n");
+
+#if (defined FLAC__CPU_IA32 || defined FLAC__CPU_X86_64) && FLAC__HAS_X86INTRIN && defined FLAC__BMI2_SUPPORTED && !defined FLAC__NO_ASM && (ENABLE_64_BIT_WORDS == 0)
+	{
+		FLAC__CPUInfo cpuinfo;
+		FLAC__cpu_info(&cpuinfo);
+		if(cpuinfo.use_asm && cpuinfo.x86.bmi2 && cpuinfo.x86.lzcnt) {
+			printf("testing rice block reads with BMI2... ");
+			if(!test_rice_block(FLAC__bitreader_read_rice_signed_block_bmi2))
+				return false;
+			printf("OK\n");
+		}
+	}
+#endif
+
+	printf("testing frame sync search... ");
+	if(!test_frame_sync(false))
+		return false;
+	printf("OK\n");
+
+	printf("testing frame sync search with CPU specific routines... ");
+	if(!test_frame_sync(true))
+		return false;
+	printf("OK\n");
+
 	printf("\nPASSED!\n");
 	return true;
 }
@@ -320,3 +359,181 @@ static FLAC__bool read_callback(FLAC__byte buffer[], size_t *bytes, void *data)
 
 	return true;
 }
+
+static const FLAC__byte *rice_data_;
+static size_t rice_data_bytes_;
+
+static FLAC__bool rice_read_callback(FLAC__byte buffer[], size_t *bytes, void *data)
+{
+	/* hand the data over in odd-sized pieces so that codes straddle the end of the buffered input */
+	(void)data;
+	if (*bytes > 37)
+		*bytes = 37;
+	if (*bytes > rice_data_bytes_)
+		*bytes = rice_data_bytes_;
+	if (*bytes == 0)
+		return false;
+
+	memcpy(buffer, rice_data_, *bytes);
+	rice_data_ += *bytes;
+	rice_data_bytes_ -= *bytes;
+
+	return true;
+}
+
+static FLAC__bool test_rice_block(FLAC__bool (*read_rice_signed_block)(FLAC__BitReader *br, int vals[], uint32_t nvals, uint32_t parameter))
+{
+	static const uint32_t block_sizes[] = { 1, 3, 4, 5, 64, 1000, 1 };
+	enum { NVALS = 3000 };
+	static int vals[NVALS], decoded[NVALS];
+	FLAC__BitWriter *bw;
+	FLAC__BitReader *br;
+	FLAC__uint32 seed = 1, val_uint32;
+	const FLAC__byte *buffer;
+	size_t bytes;
+	uint32_t parameter, i, n;
+
+	for(parameter = 0; parameter < 20; parameter++) {
+		/* mostly values that fit the parameter, with the occasional long unary run */
+		for(i = 0; i < NVALS; i++) {
+			seed = seed * 1103515245 + 12345;
+			vals[i] = (int)((seed >> 8) & ((2u << parameter) - 1)) - (1 << parameter);
+			if(i % 97 == 0)
+				vals[i] *= 1 + (int)(seed >> 28) * 16;
+		}
+
+		if(0 == (bw = FLAC__bitwriter_new(0)) || !FLAC__bitwriter_init(bw)) {
+			printf("FAILED, could not create bitwriter\n");
+			return false;
+		}
+		if(
+			!FLAC__bitwriter_write_raw_uint32(bw, 5, 3) ||
+			!FLAC__bitwriter_write_rice_signed_block(bw, vals, NVALS, parameter) ||
+			!FLAC__bitwriter_write_raw_uint32(bw, 0x1234, 16) ||
+			!FLAC__bitwriter_zero_pad_to_byte_boundary(bw) ||
+			!FLAC__bitwriter_get_buffer(bw, &buffer, &bytes)
+		) {
+			printf("FAILED, could not write parameter %u\n", parameter);
+			return false;
+		}
+		rice_data_ = buffer;
+		rice_data_bytes_ = bytes;
+
+		if(0 == (br = FLAC__bitreader_new(0)) || !FLAC__bitreader_init(br, rice_read_callback, 0)) {
+			printf("FAILED, could not create bitreader\n");
+			return false;
+		}
+		if(!FLAC__bitreader_read_raw_uint32(br, &val_uint32, 3) || val_uint32 != 5) {
+			printf("FAILED, parameter %u: bad header\n", parameter);
+			return false;
+		}
+		for(i = 0, n = 0; i < NVALS; i += n) {
+			n = block_sizes[(i + parameter) % (sizeof(block_sizes)/sizeof(block_sizes[0]))];
+			if(n > NVALS - i)
+				n = NVALS - i;
+			if(!read_rice_signed_block(br, decoded + i, n, parameter)) {
+				printf("FAILED, parameter %u: read returned false\n", parameter);
+				return false;
+			}
+		}
+		if(memcmp(vals, decoded, sizeof(vals))) {
+			printf("FAILED, parameter %u: decoded values do not match\n", parameter);
+			return false;
+		}
+		if(!FLAC__bitreader_read_raw_uint32(br, &val_uint32, 16) || val_uint32 != 0x1234) {
+			printf("FAILED, parameter %u: bad trailer\n", parameter);
+			return false;
+		}
+
+		FLAC__bitreader_delete(br);
+		FLAC__bitwriter_delete(bw);
+	}
+
+	return true;
+}
+
+static const FLAC__byte *sync_data_;
+static size_t sync_data_bytes_;
+
+static FLAC__bool sync_read_callback(FLAC__byte buffer[], size_t *bytes, void *data)
+{
+	/* odd-sized pieces again, but big enough for whole blocks to be scanned at once */
+	(void)data;
+	if (*bytes > 1001)
+		*bytes = 1001;
+	if (*bytes > sync_data_bytes_)
+		*bytes = sync_data_bytes_;
+	if (*bytes == 0)
+		return false;
+
+	memcpy(buffer, sync_data_, *bytes);
+	sync_data_ += *bytes;
+	sync_data_bytes_ -= *bytes;
+
+	return true;
+}
+
+static FLAC__bool test_frame_sync(FLAC__bool use_asm)
+{
+	/* sync codes placed around word, block and read boundaries, with decoys in between */
+	static const uint32_t offsets[] = { 0, 2, 7, 9, 31, 33, 63, 997, 999, 1001, 2047, 4000, 9990 };
+	enum { NBYTES = 10000 };
+	static FLAC__byte data[NBYTES];
+	FLAC__BitReader *br;
+	FLAC__CPUInfo cpuinfo;
+	FLAC__uint32 seed = 1, val_uint32;
+	uint32_t i, pos, skipped;
+
+	for(i = 0; i < NBYTES; i++) {
+		seed = seed * 1103515245 + 12345;
+		data[i] = (FLAC__byte)(seed >> 16);
+		if(data[i] == 0xff)
+			data[i] = 0xfe;
+	}
+	/* 0xff not followed by a sync byte */
+	for(i = 100; i + 1 < NBYTES; i += 293) {
+		data[i] = 0xff;
+		data[i + 1] = 0xf0;
+	}
+	for(i = 0; i < sizeof(offsets)/sizeof(offsets[0]); i++) {
+		data[offsets[i]] = 0xff;
+		data[offsets[i] + 1] = (FLAC__byte)(0xf8 | (i & 1));
+	}
+	/* a doubled 0xff in front of a sync code */
+	data[4000 - 1] = 0xff;
+
+	sync_data_ = data;
+	sync_data_bytes_ = NBYTES;
+	if(0 == (br = FLAC__bitreader_new(0)) || !FLAC__bitreader_init(br, sync_read_callback, 0)) {
+		printf("FAILED, could not create bitreader\n");
+		return false;
+	}
+	FLAC__cpu_info(&cpuinfo);
+	cpuinfo.use_asm = cpuinfo.use_asm && use_asm;
+	FLAC__bitreader_set_cpu_info(br, &cpuinfo);
+
+	for(i = 0, pos = 0; i < sizeof(offsets)/sizeof(offsets[0]); i++) {
+		if(!FLAC__bitreader_skip_to_frame_sync_no_crc(br, &skipped)) {
+			printf("FAILED, returned false looking for sync code #%u\n", i);
+			return false;
+		}
+		pos += skipped;
+		if(pos != offsets[i]) {
+			printf("FAILED, sync code #%u found at %u, expected %u\n", i, pos, offsets[i]);
+			return false;
+		}
+		/* step over the sync code, as the decoder does */
+		if(!FLAC__bitreader_read_raw_uint32(br, &val_uint32, 8) || val_uint32 != 0xff || !FLAC__bitreader_read_raw_uint32(br, &val_uint32, 8) || val_uint32 != data[pos + 1]) {
+			printf("FAILED, read at sync code #%u\n", i);
+			return false;
+		}
+		pos += 2;
+	}
+	if(FLAC__bitreader_skip_to_frame_sync_no_crc(br, &skipped)) {
+		printf("FAILED, found a sync code past the last one\n");
+		return false;
+	}
+
+	FLAC__bitreader_delete(br);
+	return true;
+}
@@ -24,6 +24,7 @@
 #include "FLAC/assert.h"
 #include "share/compat.h"
 #include "private/bitwriter.h" /* from the libFLAC private include area */
+#include "private/cpu.h" /* from the libFLAC private include area */
 #include "bitwriter.h"
 #include <stdio.h>
 #include <string.h> /* for memcmp() */
@@ -55,12 +56,72 @@ struct FLAC__BitWriter {
 	uint32_t capacity; /* capacity of buffer in words */
 	uint32_t words; /* # of complete words in buffer */
 	uint32_t bits; /* # of used bits in accum */
+	FLAC__bool use_bmi2; /* see FLAC__bitwriter_set_cpu_info() */
+	FLAC__bool use_pclmul; /* ditto */
 };
 
 #define WORDS_TO_BITS(words) ((words) * FLAC__BITS_PER_WORD)
 #define TOTAL_BITS(bw) (WORDS_TO_BITS((bw)->words) + (bw)->bits)
 
 
+static FLAC__bool test_rice_block(FLAC__bool use_cpu_info)
+{
+	enum { NVALS = 3000 };
+	static FLAC__int32 vals[NVALS];
+	FLAC__BitWriter *bw_block, *bw_single;
+	FLAC__uint32 seed = 1;
+	const FLAC__byte *buffer_block, *buffer_single;
+	size_t bytes_block, bytes_single;
+	uint32_t parameter, i;
+	FLAC__bool ok = true;
+
+	for(parameter = 0; parameter < 20 && ok; parameter++) {
+		/* mostly values that fit the parameter, with the occasional long unary run */
+		for(i = 0; i < NVALS; i++) {
+			seed = seed * 1103515245 + 12345;
+			vals[i] = (FLAC__int32)((seed >> 8) & ((2u << parameter) - 1)) - (1 << parameter);
+			if(i % 97 == 0)
+				vals[i] *= 1 + (FLAC__int32)(seed >> 28) * 16;
+		}
+
+		bw_block = FLAC__bitwriter_new(0);
+		bw_single = FLAC__bitwriter_new(0);
+		if(0 == bw_block || 0 == bw_single || !FLAC__bitwriter_init(bw_block) || !FLAC__bitwriter_init(bw_single)) {
+			printf("FAILED, could not create bitwriter\n");
+			return false;
+		}
+		if(use_cpu_info) {
+			FLAC__CPUInfo cpuinfo;
+			FLAC__cpu_info(&cpuinfo);
+			FLAC__bitwriter_set_cpu_info(bw_block, &cpuinfo);
+		}
+
+		/* the block version must produce exactly what writing one value at a time does */
+		ok = FLAC__bitwriter_write_raw_uint32(bw_block, 5, 3) && FLAC__bitwriter_write_raw_uint32(bw_single, 5, 3);
+		for(i = 0; i < NVALS && ok; i += 1 + i % 300) {
+			const uint32_t n = 1 + i % 300 < NVALS - i? 1 + i % 300 : NVALS - i;
+			uint32_t j;
+			ok = FLAC__bitwriter_write_rice_signed_block(bw_block, vals + i, n, parameter);
+			for(j = 0; j < n && ok; j++)
+				ok = FLAC__bitwriter_write_rice_signed(bw_single, vals[i + j], parameter);
+		}
+		ok = ok &&
+			FLAC__bitwriter_zero_pad_to_byte_boundary(bw_block) &&
+			FLAC__bitwriter_zero_pad_to_byte_boundary(bw_single) &&
+			FLAC__bitwriter_get_buffer(bw_block, &buffer_block, &bytes_block) &&
+			FLAC__bitwriter_get_buffer(bw_single, &buffer_single, &bytes_single) &&
+			bytes_block == bytes_single &&
+			0 == memcmp(buffer_block, buffer_single, bytes_block);
+		if(!ok)
+			printf("FAILED, parameter %u\n", parameter);
+
+		FLAC__bitwriter_delete(bw_block);
+		FLAC__bitwriter_delete(bw_single);
+	}
+
+	return ok;
+}
+
 FLAC__bool test_bitwriter(void)
 {
 	FLAC__BitWriter *bw;
@@ -89,7 +150,7 @@ FLAC__bool test_bitwriter(void)
 	 * test new -> delete
 	 */
 	printf("testing new... ");
-	bw = FLAC__bitwriter_new();
+	bw = FLAC__bitwriter_new(0);
 	if(0 == bw) {
 		printf("FAILED, returned NULL\n");
 		return false;
@@ -104,7 +165,7 @@ FLAC__bool test_bitwriter(void)
 	 * test new -> init -> delete
 	 */
 	printf("testing new... ");
-	bw = FLAC__bitwriter_new();
+	bw = FLAC__bitwriter_new(0);
 	if(0 == bw) {
 		printf("FAILED, returned NULL\n");
 		return false;
@@ -126,7 +187,7 @@ FLAC__bool test_bitwriter(void)
 	 * test new -> init -> clear -> delete
 	 */
 	printf("testing new... ");
-	bw = FLAC__bitwriter_new();
+	bw = FLAC__bitwriter_new(0);
 	if(0 == bw) {
 		printf("FAILED, returned NULL\n");
 		return false;
@@ -152,7 +213,7 @@ FLAC__bool test_bitwriter(void)
 	 * test normal usage
 	 */
 	printf("testing new... ");
-	bw = FLAC__bitwriter_new();
+	bw = FLAC__bitwriter_new(0);
 	if(0 == bw) {
 		printf("FAILED, returned NULL\n");
 		return false;
@@ -652,6 +713,16 @@ FLAC__bool test_bitwriter(void)
 	}
 	printf("capacity = %u\n", bw->capacity);
 
+	printf("testing rice block writes... ");
+	if(!test_rice_block(/*use_cpu_info=*/false))
+		return false;
+	printf("OK\n");
+
+	printf("testing rice block writes with CPU specific routines... ");
+	if(!test_rice_block(/*use_cpu_info=*/true))
+		return false;
+	printf("OK\n");
+
 	printf("testing free... ");
 	FLAC__bitwriter_free(bw);
 	printf("OK\n");
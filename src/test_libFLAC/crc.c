@@ -24,9 +24,14 @@
 
 #include "FLAC/assert.h"
 #include "share/compat.h"
+#include "private/cpu.h"
 #include "private/crc.h"
 #include "crc.h"
 
+#if (defined FLAC__CPU_IA32 || defined FLAC__CPU_X86_64) && FLAC__HAS_X86INTRIN && defined FLAC__PCLMUL_SUPPORTED && !defined FLAC__NO_ASM
+#define TEST_CRC16_PCLMUL 1
+#endif
+
 static FLAC__uint8 crc8_update_ref(FLAC__byte byte, FLAC__uint8 crc);
 static FLAC__uint16 crc16_update_ref(FLAC__byte byte, FLAC__uint16 crc);
 
@@ -35,6 +40,9 @@ static FLAC__bool test_crc16(const FLAC__byte *data, size_t size);
 static FLAC__bool test_crc16_update(const FLAC__byte *data, size_t size);
 static FLAC__bool test_crc16_32bit_words(const FLAC__uint32 *words, size_t size);
 static FLAC__bool test_crc16_64bit_words(const FLAC__uint64 *words, size_t size);
+#ifdef TEST_CRC16_PCLMUL
+static FLAC__bool test_crc16_pclmul(const FLAC__byte *data, size_t size);
+#endif
 
 #define DATA_SIZE 32768
 
@@ -64,6 +72,11 @@ FLAC__bool test_crc(void)
 	if (! test_crc16_64bit_words((FLAC__uint64 *)data, DATA_SIZE / 8))
 		return false;
 
+#ifdef TEST_CRC16_PCLMUL
+	if (! test_crc16_pclmul(data, DATA_SIZE))
+		return false;
+#endif
+
 	printf("\nPASSED!\n");
 	return true;
 }
@@ -272,3 +285,86 @@ static FLAC__bool test_crc16_64bit_words(const FLAC__uint64 *words, size_t size)
 
 	return true;
 }
+
+#ifdef TEST_CRC16_PCLMUL
+static FLAC__bool test_crc16_pclmul(const FLAC__byte *data, size_t size)
+{
+	static const FLAC__uint16 seeds[] = { 0, 1, 0x8005, 0xFFFF };
+	const FLAC__uint32 *words32 = (const FLAC__uint32 *)data;
+	const FLAC__uint64 *words64 = (const FLAC__uint64 *)data;
+	FLAC__CPUInfo cpuinfo;
+	uint32_t n,i,s;
+	FLAC__uint16 crc0,crc1;
+
+	FLAC__cpu_info(&cpuinfo);
+	if (! cpuinfo.x86.pclmul || ! cpuinfo.x86.ssse3) {
+		printf("testing PCLMUL CRC-16 ... skipped, not supported by this CPU\n");
+		return true;
+	}
+
+	printf("testing FLAC__crc16_intrin_pclmul ... ");
+
+	for (n = 0; n <= 512; n++) {
+		for (i = 0; i < 4; i++) {
+			crc0 = FLAC__crc16(data + i, n);
+			crc1 = FLAC__crc16_intrin_pclmul(data + i, n);
+
+			if (crc1 != crc0) {
+				printf("FAILED, FLAC__crc16_intrin_pclmul result did not match FLAC__crc16 for %u bytes of test data at offset %u\n", n, i);
+				return false;
+			}
+		}
+	}
+
+	if (FLAC__crc16_intrin_pclmul(data, size) != FLAC__crc16(data, size)) {
+		printf("FAILED, FLAC__crc16_intrin_pclmul result did not match FLAC__crc16 for %u bytes of test data\n", (uint32_t)size);
+		return false;
+	}
+
+	printf("OK\n");
+
+	printf("testing FLAC__crc16_update_words32_intrin_pclmul ... ");
+
+	for (s = 0; s < sizeof(seeds) / sizeof(seeds[0]); s++) {
+		for (n = 0; n <= 128; n++) {
+			crc0 = FLAC__crc16_update_words32(words32 + 1, n, seeds[s]);
+			crc1 = FLAC__crc16_update_words32_intrin_pclmul(words32 + 1, n, seeds[s]);
+
+			if (crc1 != crc0) {
+				printf("FAILED, FLAC__crc16_update_words32_intrin_pclmul result did not match FLAC__crc16_update_words32 for %u words of test data, seed 0x%04X\n", n, seeds[s]);
+				return false;
+			}
+		}
+	}
+
+	if (FLAC__crc16_update_words32_intrin_pclmul(words32, size / 4, 0x1234) != FLAC__crc16_update_words32(words32, size / 4, 0x1234)) {
+		printf("FAILED, FLAC__crc16_update_words32_intrin_pclmul result did not match FLAC__crc16_update_words32 for %u words of test data\n", (uint32_t)size / 4);
+		return false;
+	}
+
+	printf("OK\n");
+
+	printf("testing FLAC__crc16_update_words64_intrin_pclmul ... ");
+
+	for (s = 0; s < sizeof(seeds) / sizeof(seeds[0]); s++) {
+		for (n = 0; n <= 64; n++) {
+			crc0 = FLAC__crc16_update_words64(words64 + 1, n, seeds[s]);
+			crc1 = FLAC__crc16_update_words64_intrin_pclmul(words64 + 1, n, seeds[s]);
+
+			if (crc1 != crc0) {
+				printf("FAILED, FLAC__crc16_update_words64_intrin_pclmul result did not match FLAC__crc16_update_words64 for %u words of test data, seed 0x%04X\n", n, seeds[s]);
+				return false;
+			}
+		}
+	}
+
+	if (FLAC__crc16_update_words64_intrin_pclmul(words64, size / 8, 0x1234) != FLAC__crc16_update_words64(words64, size / 8, 0x1234)) {
+		printf("FAILED, FLAC__crc16_update_words64_intrin_pclmul result did not match FLAC__crc16_update_words64 for %u words of test data\n", (uint32_t)size / 8);
+		return false;
+	}
+
+	printf("OK\n");
+
+	return true;
+}
+#endif
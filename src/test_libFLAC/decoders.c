@@ -27,7 +27,9 @@
 #include <string.h>
 #include "decoders.h"
 #include "FLAC/assert.h"
+#include "FLAC/metadata.h"
 #include "FLAC/stream_decoder.h"
+#include "FLAC/stream_encoder.h"
 #include "share/grabbag.h"
 #include "share/compat.h"
 #include "share/safe_str.h"
@@ -38,20 +40,26 @@ typedef enum {
 	LAYER_STREAM = 0, /* FLAC__stream_decoder_init_[ogg_]stream() without seeking */
 	LAYER_SEEKABLE_STREAM, /* FLAC__stream_decoder_init_[ogg_]stream() with seeking */
 	LAYER_FILE, /* FLAC__stream_decoder_init_[ogg_]FILE() */
-	LAYER_FILENAME /* FLAC__stream_decoder_init_[ogg_]file() */
+	LAYER_FILENAME, /* FLAC__stream_decoder_init_[ogg_]file() */
+	LAYER_MEMORY, /* FLAC__stream_decoder_init_memory() */
+	LAYER_MMAP /* FLAC__stream_decoder_init_mmap() */
 } Layer;
 
 static const char * const LayerString[] = {
 	"Stream",
 	"Seekable Stream",
 	"FILE*",
-	"Filename"
+	"Filename",
+	"Memory",
+	"Memory-mapped file"
 };
 
 typedef struct {
 	Layer layer;
 	FILE *file;
 	char filename[512];
+	FLAC__byte *data; /* the whole file, for LAYER_MEMORY */
+	size_t data_length;
 	uint32_t current_metadata_number;
 	FLAC__bool ignore_errors;
 	FLAC__bool error_occurred;
@@ -59,6 +67,11 @@ typedef struct {
 
 static FLAC__StreamMetadata streaminfo_, padding_, seektable_, application1_, application2_, vorbiscomment_, cuesheet_, picture_, unknown_;
 static FLAC__StreamMetadata *expected_metadata_sequence_[9];
+#ifdef HAVE_PTHREAD
+static const FLAC__bool threaded_md5_ = true;
+#else
+static const FLAC__bool threaded_md5_ = false;
+#endif
 static uint32_t num_expected_;
 static FLAC__off_t flacfilesize_;
 
@@ -93,6 +106,23 @@ static void open_test_file(StreamDecoderClientData * pdcd, int is_ogg, const cha
 	safe_strncpy(pdcd->filename, flacfilename(is_ogg), sizeof (pdcd->filename));
 }
 
+static FLAC__bool load_test_file(StreamDecoderClientData * pdcd, int is_ogg)
+{
+	pdcd->data = 0;
+	pdcd->data_length = 0;
+	open_test_file(pdcd, is_ogg, "rb");
+	if(0 == pdcd->file)
+		return false;
+	if(0 == (pdcd->data = malloc((size_t)flacfilesize_)) || fread(pdcd->data, 1, (size_t)flacfilesize_, pdcd->file) != (size_t)flacfilesize_) {
+		fclose(pdcd->file);
+		return false;
+	}
+	pdcd->data_length = (size_t)flacfilesize_;
+	fclose(pdcd->file);
+	pdcd->file = 0;
+	return true;
+}
+
 static void init_metadata_blocks_(void)
 {
 	mutils__init_metadata_blocks(&streaminfo_, &padding_, &seektable_, &application1_, &application2_, &vorbiscomment_, &cuesheet_, &picture_, &unknown_);
@@ -246,8 +276,6 @@ static FLAC__StreamDecoderWriteStatus stream_decoder_write_callback_(const FLAC_
 {
 	StreamDecoderClientData *dcd = (StreamDecoderClientData*)client_data;
 
-	(void)decoder, (void)buffer;
-
 	if(0 == dcd) {
 		printf("ERROR: client_data in write callback is NULL\n");
 		return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
@@ -256,6 +284,32 @@ static FLAC__StreamDecoderWriteStatus stream_decoder_write_callback_(const FLAC_
 	if(dcd->error_occurred)
 		return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
 
+	if(FLAC__stream_decoder_get_interleaved_format(decoder) == FLAC__STREAM_DECODER_INTERLEAVED_INT24) {
+		const FLAC__byte *interleaved = FLAC__stream_decoder_get_interleaved_buffer(decoder);
+		const uint32_t bps = frame->header.bits_per_sample;
+		uint32_t i, channel;
+		if(0 == interleaved) {
+			printf("ERROR: FLAC__stream_decoder_get_interleaved_buffer() returned NULL in write callback\n");
+			dcd->error_occurred = true;
+			return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+		}
+		for(i = 0; i < frame->header.blocksize; i++) {
+			for(channel = 0; channel < frame->header.channels; channel++, interleaved += 3) {
+				const FLAC__int32 x = bps <= 24? (FLAC__int32)((FLAC__uint32)buffer[channel][i] << (24 - bps)) : buffer[channel][i] >> (bps - 24);
+#if WORDS_BIGENDIAN
+				const FLAC__int32 y = (FLAC__int32)(((FLAC__uint32)interleaved[0] << 24) | ((FLAC__uint32)interleaved[1] << 16) | ((FLAC__uint32)interleaved[2] << 8)) >> 8;
+#else
+				const FLAC__int32 y = (FLAC__int32)(((FLAC__uint32)interleaved[2] << 24) | ((FLAC__uint32)interleaved[1] << 16) | ((FLAC__uint32)interleaved[0] << 8)) >> 8;
+#endif
+				if(x != y) {
+					printf("ERROR: interleaved sample %u of channel %u is %d, expected %d\n", i, channel, y, x);
+					dcd->error_occurred = true;
+					return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+				}
+			}
+		}
+	}
+
 	if(
 		(frame->header.number_type == FLAC__FRAME_NUMBER_TYPE_FRAME_NUMBER && frame->header.number.frame_number == 0) ||
 		(frame->header.number_type == FLAC__FRAME_NUMBER_TYPE_SAMPLE_NUMBER && frame->header.number.sample_number == 0)
@@ -364,6 +418,14 @@ static FLAC__bool stream_decoder_test_respond_(FLAC__StreamDecoder *decoder, Str
 				FLAC__stream_decoder_init_ogg_file(decoder, flacfilename(is_ogg), stream_decoder_write_callback_, stream_decoder_metadata_callback_, stream_decoder_error_callback_, dcd) :
 				FLAC__stream_decoder_init_file(decoder, flacfilename(is_ogg), stream_decoder_write_callback_, stream_decoder_metadata_callback_, stream_decoder_error_callback_, dcd);
 			break;
+		case LAYER_MEMORY:
+			printf("testing FLAC__stream_decoder_init_memory()... ");
+			init_status = FLAC__stream_decoder_init_memory(decoder, dcd->data, dcd->data_length, stream_decoder_write_callback_, stream_decoder_metadata_callback_, stream_decoder_error_callback_, dcd);
+			break;
+		case LAYER_MMAP:
+			printf("testing FLAC__stream_decoder_init_mmap()... ");
+			init_status = FLAC__stream_decoder_init_mmap(decoder, flacfilename(is_ogg), stream_decoder_write_callback_, stream_decoder_metadata_callback_, stream_decoder_error_callback_, dcd);
+			break;
 		default:
 			die_("internal error 000");
 			return false;
@@ -384,6 +446,32 @@ static FLAC__bool stream_decoder_test_respond_(FLAC__StreamDecoder *decoder, Str
 		return die_s_("returned false", decoder);
 	printf("OK\n");
 
+	printf("testing FLAC__stream_decoder_get_statistics()... ");
+	{
+		FLAC__StreamDecoderStatistics statistics;
+#ifdef FLAC__ENABLE_STATISTICS
+		FLAC__uint64 frames = 0;
+		uint32_t i;
+		if(!FLAC__stream_decoder_get_statistics(decoder, &statistics)) {
+			printf("FAILED, returned false\n");
+			return false;
+		}
+		for(i = 0; i < sizeof(statistics.blocksizes) / sizeof(statistics.blocksizes[0]); i++)
+			frames += statistics.blocksizes[i];
+		/* the test stream is clean and is not seeked in, so every frame is written once */
+		if(frames == 0 || frames != statistics.calls[FLAC__STREAM_DECODER_STAGE_WRITE_CALLBACK] || frames != statistics.calls[FLAC__STREAM_DECODER_STAGE_FRAME_HEADER]) {
+			printf("FAILED, %" PRIu64 " frames by blocksize, %" PRIu64 " headers, %" PRIu64 " writes\n", frames, statistics.calls[FLAC__STREAM_DECODER_STAGE_FRAME_HEADER], statistics.calls[FLAC__STREAM_DECODER_STAGE_WRITE_CALLBACK]);
+			return false;
+		}
+#else
+		if(FLAC__stream_decoder_get_statistics(decoder, &statistics)) {
+			printf("FAILED, returned true without statistics\n");
+			return false;
+		}
+#endif
+	}
+	printf("OK\n");
+
 	printf("testing FLAC__stream_decoder_finish()... ");
 	if(!FLAC__stream_decoder_finish(decoder))
 		return die_s_("returned false", decoder);
@@ -444,6 +532,14 @@ static FLAC__bool test_stream_decoder(Layer layer, FLAC__bool is_ogg)
 				FLAC__stream_decoder_init_ogg_file(decoder, flacfilename(is_ogg), 0, 0, 0, 0) :
 				FLAC__stream_decoder_init_file(decoder, flacfilename(is_ogg), 0, 0, 0, 0);
 			break;
+		case LAYER_MEMORY:
+			printf("testing FLAC__stream_decoder_init_memory()... ");
+			init_status = FLAC__stream_decoder_init_memory(decoder, 0, 0, 0, 0, 0, 0);
+			break;
+		case LAYER_MMAP:
+			printf("testing FLAC__stream_decoder_init_mmap()... ");
+			init_status = FLAC__stream_decoder_init_mmap(decoder, flacfilename(is_ogg), 0, 0, 0, 0);
+			break;
 		default:
 			die_("internal error 003");
 			return false;
@@ -479,6 +575,16 @@ static FLAC__bool test_stream_decoder(Layer layer, FLAC__bool is_ogg)
 		return die_s_("returned false", decoder);
 	printf("OK\n");
 
+	printf("testing FLAC__stream_decoder_set_threaded_md5()... ");
+	if(!FLAC__stream_decoder_set_threaded_md5(decoder, threaded_md5_))
+		return die_s_("returned false", decoder);
+	printf("OK\n");
+
+	printf("testing FLAC__stream_decoder_set_interleaved_format()... ");
+	if(!FLAC__stream_decoder_set_interleaved_format(decoder, FLAC__STREAM_DECODER_INTERLEAVED_INT24))
+		return die_s_("returned false", decoder);
+	printf("OK\n");
+
 	if(layer < LAYER_FILENAME) {
 		printf("opening %sFLAC file... ", is_ogg? "Ogg ":"");
 		open_test_file(&decoder_client_data, is_ogg, "rb");
@@ -488,6 +594,14 @@ static FLAC__bool test_stream_decoder(Layer layer, FLAC__bool is_ogg)
 		}
 		printf("OK\n");
 	}
+	else if(layer == LAYER_MEMORY) {
+		printf("loading FLAC file into memory... ");
+		if(!load_test_file(&decoder_client_data, is_ogg)) {
+			printf("ERROR (%s)\n", strerror(errno));
+			return false;
+		}
+		printf("OK\n");
+	}
 
 	switch(layer) {
 		case LAYER_STREAM:
@@ -514,6 +628,14 @@ static FLAC__bool test_stream_decoder(Layer layer, FLAC__bool is_ogg)
 				FLAC__stream_decoder_init_ogg_file(decoder, flacfilename(is_ogg), stream_decoder_write_callback_, stream_decoder_metadata_callback_, stream_decoder_error_callback_, &decoder_client_data) :
 				FLAC__stream_decoder_init_file(decoder, flacfilename(is_ogg), stream_decoder_write_callback_, stream_decoder_metadata_callback_, stream_decoder_error_callback_, &decoder_client_data);
 			break;
+		case LAYER_MEMORY:
+			printf("testing FLAC__stream_decoder_init_memory()... ");
+			init_status = FLAC__stream_decoder_init_memory(decoder, decoder_client_data.data, decoder_client_data.data_length, stream_decoder_write_callback_, stream_decoder_metadata_callback_, stream_decoder_error_callback_, &decoder_client_data);
+			break;
+		case LAYER_MMAP:
+			printf("testing FLAC__stream_decoder_init_mmap()... ");
+			init_status = FLAC__stream_decoder_init_mmap(decoder, flacfilename(is_ogg), stream_decoder_write_callback_, stream_decoder_metadata_callback_, stream_decoder_error_callback_, &decoder_client_data);
+			break;
 		default:
 			die_("internal error 009");
 			return false;
@@ -526,6 +648,19 @@ static FLAC__bool test_stream_decoder(Layer layer, FLAC__bool is_ogg)
 	state = FLAC__stream_decoder_get_state(decoder);
 	printf("returned state = %u (%s)... OK\n", state, FLAC__StreamDecoderStateString[state]);
 
+	printf("testing FLAC__stream_decoder_get_kernel()... ");
+	{
+		uint32_t kernel;
+		for(kernel = 0; kernel < FLAC__STREAM_DECODER_KERNEL_COUNT; kernel++) {
+			/* the interleaving routine is set because of FLAC__stream_decoder_set_interleaved_format() above */
+			if(0 == FLAC__stream_decoder_get_kernel(decoder, (FLAC__StreamDecoderKernel)kernel)) {
+				printf("FAILED, no routine for %s\n", FLAC__StreamDecoderKernelString[kernel]);
+				return false;
+			}
+		}
+	}
+	printf("OK\n");
+
 	decoder_client_data.current_metadata_number = 0;
 	decoder_client_data.ignore_errors = false;
 	decoder_client_data.error_occurred = false;
@@ -537,6 +672,20 @@ static FLAC__bool test_stream_decoder(Layer layer, FLAC__bool is_ogg)
 	}
 	printf("OK\n");
 
+	printf("testing FLAC__stream_decoder_get_threaded_md5()... ");
+	if(FLAC__stream_decoder_get_threaded_md5(decoder) != threaded_md5_) {
+		printf("FAILED, expected %s, got %s\n", threaded_md5_? "true" : "false", threaded_md5_? "false" : "true");
+		return false;
+	}
+	printf("OK\n");
+
+	printf("testing FLAC__stream_decoder_get_interleaved_format()... ");
+	if(FLAC__stream_decoder_get_interleaved_format(decoder) != FLAC__STREAM_DECODER_INTERLEAVED_INT24) {
+		printf("FAILED, expected %s, got %s\n", FLAC__StreamDecoderInterleavedFormatString[FLAC__STREAM_DECODER_INTERLEAVED_INT24], FLAC__StreamDecoderInterleavedFormatString[FLAC__stream_decoder_get_interleaved_format(decoder)]);
+		return false;
+	}
+	printf("OK\n");
+
 	printf("testing FLAC__stream_decoder_process_until_end_of_metadata()... ");
 	if(!FLAC__stream_decoder_process_until_end_of_metadata(decoder))
 		return die_s_("returned false", decoder);
@@ -552,7 +701,7 @@ static FLAC__bool test_stream_decoder(Layer layer, FLAC__bool is_ogg)
 		return die_s_("returned false", decoder);
 	printf("OK\n");
 
-	if(layer < LAYER_FILE) {
+	if(layer < LAYER_FILE || layer >= LAYER_MEMORY) {
 		printf("testing FLAC__stream_decoder_flush()... ");
 		if(!FLAC__stream_decoder_flush(decoder))
 			return die_s_("returned false", decoder);
@@ -628,7 +777,7 @@ static FLAC__bool test_stream_decoder(Layer layer, FLAC__bool is_ogg)
 		printf("returned %u (%s)... OK\n", (uint32_t)ca, FLAC__ChannelAssignmentString[ca]);
 	}
 
-	if(layer < LAYER_FILE) {
+	if(layer < LAYER_FILE || layer >= LAYER_MEMORY) {
 		printf("testing FLAC__stream_decoder_reset()... ");
 		if(!FLAC__stream_decoder_reset(decoder)) {
 			state = FLAC__stream_decoder_get_state(decoder);
@@ -653,6 +802,27 @@ static FLAC__bool test_stream_decoder(Layer layer, FLAC__bool is_ogg)
 		if(!FLAC__stream_decoder_process_until_end_of_stream(decoder))
 			return die_s_("returned false", decoder);
 		printf("OK\n");
+
+		printf("testing FLAC__stream_decoder_reset()... ");
+		if(!FLAC__stream_decoder_reset(decoder))
+			return die_s_("returned false", decoder);
+		printf("OK\n");
+
+		if(layer == LAYER_STREAM) {
+			printf("rewinding input... ");
+			if(fseeko(decoder_client_data.file, 0, SEEK_SET) < 0) {
+				printf("FAILED, errno = %d\n", errno);
+				return false;
+			}
+			printf("OK\n");
+		}
+
+		decoder_client_data.current_metadata_number = 0;
+
+		printf("testing FLAC__stream_decoder_process_parallel()... ");
+		if(!FLAC__stream_decoder_process_parallel(decoder, 4))
+			return die_s_("returned false", decoder);
+		printf("OK\n");
 	}
 
 	printf("testing FLAC__stream_decoder_finish()... ");
@@ -1013,6 +1183,8 @@ static FLAC__bool test_stream_decoder(Layer layer, FLAC__bool is_ogg)
 
 	if(layer < LAYER_FILE) /* for LAYER_FILE, FLAC__stream_decoder_finish() closes the file */
 		fclose(decoder_client_data.file);
+	if(layer == LAYER_MEMORY)
+		free(decoder_client_data.data);
 
 	printf("testing FLAC__stream_decoder_delete()... ");
 	FLAC__stream_decoder_delete(decoder);
@@ -1023,6 +1195,718 @@ static FLAC__bool test_stream_decoder(Layer layer, FLAC__bool is_ogg)
 	return true;
 }
 
+static void pull_error_callback_(const FLAC__StreamDecoder *decoder, FLAC__StreamDecoderErrorStatus status, void *client_data)
+{
+	(void)decoder, (void)client_data;
+	printf("ERROR: got error callback: err = %u (%s)\n", (uint32_t)status, FLAC__StreamDecoderErrorStatusString[status]);
+}
+
+static FLAC__bool pull_compare_(FLAC__int32 * const buffer[], const FLAC__int32 *expected, uint32_t first, uint32_t samples)
+{
+	uint32_t i, channel;
+	for(i = 0; i < samples; i++) {
+		for(channel = 0; channel < 2; channel++) {
+			if(buffer[channel][i] != expected[(first + i) * 2 + channel]) {
+				printf("FAILED, sample %u of channel %u is %d, expected %d\n", first + i, channel, buffer[channel][i], expected[(first + i) * 2 + channel]);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/* encodes a noisy stereo 16-bit test signal of 'total' samples to memory, optionally recording a frame index */
+static FLAC__bool encode_pull_stream_(FLAC__int32 **signal, uint32_t total, uint32_t blocksize, FLAC__StreamMetadata *frame_index, FLAC__byte **data, size_t *length)
+{
+	FLAC__StreamEncoder *encoder;
+	FLAC__uint32 x = 0x12345678;
+	uint32_t i;
+
+	if(0 == (*signal = malloc(sizeof(FLAC__int32) * total * 2)))
+		return die_("malloc failed");
+	for(i = 0; i < total; i++) {
+		x = x * 1103515245 + 12345;
+		(*signal)[i * 2] = (FLAC__int32)(i % 200) * 100 - 10000 + (FLAC__int32)(x >> 24);
+		(*signal)[i * 2 + 1] = (*signal)[i * 2] / 2 - (FLAC__int32)(x >> 26);
+	}
+
+	printf("encoding the test stream to memory... ");
+	if(0 == (encoder = FLAC__stream_encoder_new()))
+		return die_("FLAC__stream_encoder_new() returned NULL");
+	if(!FLAC__stream_encoder_set_channels(encoder, 2) || !FLAC__stream_encoder_set_bits_per_sample(encoder, 16) || !FLAC__stream_encoder_set_blocksize(encoder, blocksize) || !FLAC__stream_encoder_set_compression_level(encoder, 5))
+		return die_("setting the encoder format failed");
+	if(!FLAC__stream_encoder_set_frame_index(encoder, frame_index))
+		return die_("FLAC__stream_encoder_set_frame_index() failed");
+	if(FLAC__stream_encoder_init_memory(encoder, /*progress_callback=*/0, /*client_data=*/0) != FLAC__STREAM_ENCODER_INIT_STATUS_OK)
+		return die_("FLAC__stream_encoder_init_memory() failed");
+	if(!FLAC__stream_encoder_process_interleaved(encoder, *signal, total))
+		return die_("FLAC__stream_encoder_process_interleaved() failed");
+	if(!FLAC__stream_encoder_finish_memory(encoder, data, length) || 0 == *data)
+		return die_("FLAC__stream_encoder_finish_memory() failed");
+	FLAC__stream_encoder_delete(encoder);
+	printf("OK\n");
+	return true;
+}
+
+static FLAC__bool test_stream_decoder_read_samples_(void)
+{
+	/* chunk sizes smaller than, equal to and larger than the blocksize */
+	static const uint32_t chunks[] = { 7, 1152, 4000, 1, 3 * 1152 + 5, 500 };
+	const uint32_t total = 20000, blocksize = 1152, seek_target = 12345;
+	FLAC__StreamDecoder *decoder;
+	FLAC__StreamDecoderSeekStats stats;
+	FLAC__int32 *signal, *buffer[2];
+	FLAC__byte *data;
+	size_t length;
+	uint32_t i, n, got, done;
+
+	printf("\n+++ libFLAC unit test: FLAC__StreamDecoder (pull mode)\n\n");
+
+	if(0 == (buffer[0] = malloc(sizeof(FLAC__int32) * total)) || 0 == (buffer[1] = malloc(sizeof(FLAC__int32) * total)))
+		return die_("malloc failed");
+	if(!encode_pull_stream_(&signal, total, blocksize, /*frame_index=*/0, &data, &length))
+		return false;
+
+	printf("testing FLAC__stream_decoder_new()... ");
+	if(0 == (decoder = FLAC__stream_decoder_new()))
+		return die_("returned NULL");
+	printf("OK\n");
+
+	printf("testing FLAC__stream_decoder_set_md5_checking()... ");
+	if(!FLAC__stream_decoder_set_md5_checking(decoder, true))
+		return die_s_("returned false", decoder);
+	printf("OK\n");
+
+	printf("testing FLAC__stream_decoder_init_memory() with no write callback... ");
+	if(FLAC__stream_decoder_init_memory(decoder, data, length, /*write_callback=*/0, /*metadata_callback=*/0, pull_error_callback_, /*client_data=*/0) != FLAC__STREAM_DECODER_INIT_STATUS_OK)
+		return die_s_(0, decoder);
+	printf("OK\n");
+
+	printf("testing FLAC__stream_decoder_read_samples() in uneven chunks... ");
+	for(done = 0, i = 0; done < total; done += got, i++) {
+		n = chunks[i % (sizeof(chunks) / sizeof(chunks[0]))];
+		if(n > total - done)
+			n = total - done;
+		got = FLAC__stream_decoder_read_samples(decoder, buffer, n);
+		if(got != n) {
+			printf("FAILED, returned %u, expected %u, state = %s\n", got, n, FLAC__stream_decoder_get_resolved_state_string(decoder));
+			return false;
+		}
+		if(!pull_compare_(buffer, signal, done, got))
+			return false;
+	}
+	printf("OK\n");
+
+	printf("testing FLAC__stream_decoder_read_samples() at the end of the stream... ");
+	if(0 != (got = FLAC__stream_decoder_read_samples(decoder, buffer, 100)) || FLAC__stream_decoder_get_state(decoder) != FLAC__STREAM_DECODER_END_OF_STREAM) {
+		printf("FAILED, returned %u with state %s\n", got, FLAC__stream_decoder_get_resolved_state_string(decoder));
+		return false;
+	}
+	printf("OK\n");
+
+	printf("testing FLAC__stream_decoder_seek_absolute()... ");
+	if(!FLAC__stream_decoder_seek_absolute(decoder, seek_target))
+		return die_s_("returned false", decoder);
+	printf("OK\n");
+
+	printf("testing FLAC__stream_decoder_read_samples() after the seek... ");
+	/* one chunk to finish the partial frame, then one big enough to take whole frames directly */
+	n = blocksize - seek_target % blocksize;
+	if((got = FLAC__stream_decoder_read_samples(decoder, buffer, n)) != n || !pull_compare_(buffer, signal, seek_target, got)) {
+		printf("FAILED, returned %u, expected %u\n", got, n);
+		return false;
+	}
+	n = total - seek_target - got;
+	if((got = FLAC__stream_decoder_read_samples(decoder, buffer, total)) != n || !pull_compare_(buffer, signal, total - n, got)) {
+		printf("FAILED, returned %u, expected %u\n", got, n);
+		return false;
+	}
+	printf("OK\n");
+
+	printf("testing FLAC__stream_decoder_get_seek_stats()... ");
+	if(!FLAC__stream_decoder_seek_absolute(decoder, seek_target))
+		return die_s_("FLAC__stream_decoder_seek_absolute() returned false", decoder);
+	FLAC__stream_decoder_get_seek_stats(decoder, &stats);
+	if(stats.iterations == 0 || stats.frames_decoded == 0 || stats.seek_callbacks == 0 || stats.read_callbacks == 0 || stats.bytes_read == 0) {
+		printf("FAILED, got %u iterations, %u frames, %u seeks, %u reads, %" PRIu64 " bytes\n", stats.iterations, stats.frames_decoded, stats.seek_callbacks, stats.read_callbacks, stats.bytes_read);
+		return false;
+	}
+	printf("OK\n");
+
+	printf("testing a seek to the frame boundary found by the last seek... ");
+	n = (seek_target / blocksize + 1) * blocksize;
+	if(!FLAC__stream_decoder_seek_absolute(decoder, n))
+		return die_s_("FLAC__stream_decoder_seek_absolute() returned false", decoder);
+	FLAC__stream_decoder_get_seek_stats(decoder, &stats);
+	if(stats.iterations != 1 || stats.frames_decoded != 1) {
+		printf("FAILED, took %u iterations and %u frames, expected 1\n", stats.iterations, stats.frames_decoded);
+		return false;
+	}
+	if((got = FLAC__stream_decoder_read_samples(decoder, buffer, 10)) != 10 || !pull_compare_(buffer, signal, n, got)) {
+		printf("FAILED, returned %u, expected 10\n", got);
+		return false;
+	}
+	printf("OK\n");
+
+	printf("testing FLAC__stream_decoder_reset() and one FLAC__stream_decoder_read_samples() for the whole stream... ");
+	if(!FLAC__stream_decoder_reset(decoder))
+		return die_s_("FLAC__stream_decoder_reset() returned false", decoder);
+	if((got = FLAC__stream_decoder_read_samples(decoder, buffer, total)) != total || !pull_compare_(buffer, signal, 0, got)) {
+		printf("FAILED, returned %u, expected %u\n", got, total);
+		return false;
+	}
+	printf("OK\n");
+
+	printf("testing FLAC__stream_decoder_finish()... ");
+	if(!FLAC__stream_decoder_finish(decoder))
+		return die_s_("returned false, MD5 mismatch", decoder);
+	printf("OK\n");
+
+	printf("testing FLAC__stream_decoder_read_samples() with a write callback... ");
+	if(FLAC__stream_decoder_init_memory(decoder, data, length, stream_decoder_write_callback_, /*metadata_callback=*/0, pull_error_callback_, /*client_data=*/0) != FLAC__STREAM_DECODER_INIT_STATUS_OK)
+		return die_s_(0, decoder);
+	if(0 != (got = FLAC__stream_decoder_read_samples(decoder, buffer, total))) {
+		printf("FAILED, returned %u, expected 0\n", got);
+		return false;
+	}
+	printf("OK\n");
+
+	FLAC__stream_decoder_delete(decoder);
+	free(data);
+	free(signal);
+	free(buffer[0]);
+	free(buffer[1]);
+
+	printf("\nPASSED!\n");
+	return true;
+}
+
+/* compares point by point, since memcmp() would also compare the padding in FLAC__StreamMetadata_SeekPoint */
+static FLAC__bool seek_tables_match_(const FLAC__StreamMetadata_SeekTable *a, const FLAC__StreamMetadata_SeekTable *b)
+{
+	uint32_t i;
+
+	if(a->num_points != b->num_points)
+		return false;
+	for(i = 0; i < a->num_points; i++) {
+		if(a->points[i].sample_number != b->points[i].sample_number || a->points[i].stream_offset != b->points[i].stream_offset || a->points[i].frame_samples != b->points[i].frame_samples)
+			return false;
+	}
+	return true;
+}
+
+static FLAC__bool test_stream_decoder_frame_index_(void)
+{
+	static const FLAC__uint64 targets[] = { 12345, 0, 19999, 1151, 1152, 3500, 7000 };
+	const uint32_t total = 20000, blocksize = 1152, num_frames = (total + blocksize - 1) / blocksize;
+	FLAC__StreamDecoder *decoder;
+	FLAC__StreamMetadata *index, *bad_index;
+	const FLAC__StreamMetadata *built;
+	FLAC__int32 *signal, *buffer[2];
+	FLAC__byte *data;
+	size_t length;
+	uint32_t i, pass, got;
+
+	printf("\n+++ libFLAC unit test: FLAC__StreamDecoder (frame index)\n\n");
+
+	if(0 == (index = FLAC__metadata_object_new(FLAC__METADATA_TYPE_SEEKTABLE)))
+		return die_("FLAC__metadata_object_new() returned NULL");
+	if(0 == (buffer[0] = malloc(sizeof(FLAC__int32) * total)) || 0 == (buffer[1] = malloc(sizeof(FLAC__int32) * total)))
+		return die_("malloc failed");
+	if(!encode_pull_stream_(&signal, total, blocksize, index, &data, &length))
+		return false;
+
+	printf("testing the frame index recorded by the encoder... ");
+	if(index->data.seek_table.num_points != num_frames) {
+		printf("FAILED, has %u points, expected %u\n", index->data.seek_table.num_points, num_frames);
+		return false;
+	}
+	for(i = 0; i < num_frames; i++) {
+		const FLAC__StreamMetadata_SeekPoint *point = &index->data.seek_table.points[i];
+		if(point->sample_number != (FLAC__uint64)i * blocksize || point->frame_samples != (i < num_frames - 1? blocksize : total - i * blocksize) || (i > 0 && point->stream_offset <= point[-1].stream_offset)) {
+			printf("FAILED, point %u is sample %" PRIu64 ", offset %" PRIu64 ", %u samples\n", i, point->sample_number, point->stream_offset, point->frame_samples);
+			return false;
+		}
+	}
+	if(index->data.seek_table.points[0].stream_offset != 0 || !FLAC__format_seektable_is_legal(&index->data.seek_table)) {
+		printf("FAILED, not a legal SEEKTABLE starting at the first frame\n");
+		return false;
+	}
+	printf("OK\n");
+
+	printf("testing FLAC__stream_decoder_build_frame_index()... ");
+	if(0 == (decoder = FLAC__stream_decoder_new()))
+		return die_("FLAC__stream_decoder_new() returned NULL");
+	if(FLAC__stream_decoder_init_memory(decoder, data, length, /*write_callback=*/0, /*metadata_callback=*/0, pull_error_callback_, /*client_data=*/0) != FLAC__STREAM_DECODER_INIT_STATUS_OK)
+		return die_s_(0, decoder);
+	if(!FLAC__stream_decoder_build_frame_index(decoder))
+		return die_s_("returned false", decoder);
+	if(0 == (built = FLAC__stream_decoder_get_frame_index(decoder)) || built->data.seek_table.num_points != num_frames || !seek_tables_match_(&built->data.seek_table, &index->data.seek_table)) {
+		printf("FAILED, the index does not match the one recorded by the encoder\n");
+		return false;
+	}
+	if((got = FLAC__stream_decoder_read_samples(decoder, buffer, total)) != total || !pull_compare_(buffer, signal, 0, got)) {
+		printf("FAILED, decoding from the first frame afterwards returned %u samples, expected %u\n", got, total);
+		return false;
+	}
+	FLAC__stream_decoder_delete(decoder);
+	printf("OK\n");
+
+	/* an index with the offsets of two frames swapped, to check that seeking recovers from a bad one */
+	if(0 == (bad_index = FLAC__metadata_object_clone(index)))
+		return die_("FLAC__metadata_object_clone() returned NULL");
+	bad_index->data.seek_table.points[10].stream_offset = index->data.seek_table.points[3].stream_offset;
+	bad_index->data.seek_table.points[3].stream_offset = index->data.seek_table.points[10].stream_offset;
+
+	for(pass = 0; pass < 2; pass++) {
+		printf("testing FLAC__stream_decoder_set_frame_index() with %s index... ", pass? "a wrong" : "the");
+		if(0 == (decoder = FLAC__stream_decoder_new()))
+			return die_("FLAC__stream_decoder_new() returned NULL");
+		if(!FLAC__stream_decoder_set_frame_index(decoder, pass? bad_index : index))
+			return die_s_("returned false", decoder);
+		if(FLAC__stream_decoder_get_frame_index(decoder) != (pass? bad_index : index))
+			return die_s_("FLAC__stream_decoder_get_frame_index() returned the wrong index", decoder);
+		if(FLAC__stream_decoder_init_memory(decoder, data, length, /*write_callback=*/0, /*metadata_callback=*/0, pull_error_callback_, /*client_data=*/0) != FLAC__STREAM_DECODER_INIT_STATUS_OK)
+			return die_s_(0, decoder);
+		printf("OK\n");
+
+		for(i = 0; i < sizeof(targets) / sizeof(targets[0]); i++) {
+			const uint32_t n = total - (uint32_t)targets[i] < 500? total - (uint32_t)targets[i] : 500;
+			printf("testing FLAC__stream_decoder_seek_absolute(%" PRIu64 ")... ", targets[i]);
+			if(!FLAC__stream_decoder_seek_absolute(decoder, targets[i]))
+				return die_s_("returned false", decoder);
+			if((got = FLAC__stream_decoder_read_samples(decoder, buffer, n)) != n || !pull_compare_(buffer, signal, (uint32_t)targets[i], got)) {
+				printf("FAILED, read %u samples, expected %u\n", got, n);
+				return false;
+			}
+			printf("OK\n");
+		}
+		FLAC__stream_decoder_delete(decoder);
+	}
+
+	FLAC__metadata_object_delete(bad_index);
+	FLAC__metadata_object_delete(index);
+	free(data);
+	free(signal);
+	free(buffer[0]);
+	free(buffer[1]);
+
+	printf("\nPASSED!\n");
+	return true;
+}
+
+static FLAC__bool test_stream_decoder_low_footprint_(void)
+{
+	const uint32_t total = 20000, blocksize = 1152;
+	FLAC__StreamDecoder *decoder;
+	FLAC__int32 *signal, *buffer[2];
+	FLAC__byte *data;
+	size_t length, footprint[2];
+	uint32_t got, pass;
+
+	printf("\n+++ libFLAC unit test: FLAC__StreamDecoder (low footprint)\n\n");
+
+	if(0 == (buffer[0] = malloc(sizeof(FLAC__int32) * total)) || 0 == (buffer[1] = malloc(sizeof(FLAC__int32) * total)))
+		return die_("malloc failed");
+	if(!encode_pull_stream_(&signal, total, blocksize, /*frame_index=*/0, &data, &length))
+		return false;
+
+	for(pass = 0; pass < 2; pass++) {
+		printf("testing FLAC__stream_decoder_set_low_footprint(%s)... ", pass? "true" : "false");
+		if(0 == (decoder = FLAC__stream_decoder_new()))
+			return die_("FLAC__stream_decoder_new() returned NULL");
+		if(!FLAC__stream_decoder_set_md5_checking(decoder, true))
+			return die_s_("FLAC__stream_decoder_set_md5_checking() returned false", decoder);
+		if(!FLAC__stream_decoder_set_low_footprint(decoder, pass))
+			return die_s_("returned false", decoder);
+		if(FLAC__stream_decoder_get_low_footprint(decoder) != (FLAC__bool)pass)
+			return die_s_("FLAC__stream_decoder_get_low_footprint() returned the wrong value", decoder);
+		if(FLAC__stream_decoder_init_memory(decoder, data, length, /*write_callback=*/0, /*metadata_callback=*/0, pull_error_callback_, /*client_data=*/0) != FLAC__STREAM_DECODER_INIT_STATUS_OK)
+			return die_s_(0, decoder);
+		if(FLAC__stream_decoder_set_low_footprint(decoder, !pass))
+			return die_s_("FLAC__stream_decoder_set_low_footprint() returned true after init", decoder);
+		printf("OK\n");
+
+		printf("testing FLAC__stream_decoder_read_samples()... ");
+		/* a chunk that ends mid-frame so the samples are decoded into the decoder's own buffers */
+		if((got = FLAC__stream_decoder_read_samples(decoder, buffer, 1000)) != 1000 || !pull_compare_(buffer, signal, 0, got)) {
+			printf("FAILED, returned %u, expected 1000\n", got);
+			return false;
+		}
+		printf("OK\n");
+
+		printf("testing FLAC__stream_decoder_get_footprint()... ");
+		footprint[pass] = FLAC__stream_decoder_get_footprint(decoder);
+		if(footprint[pass] < sizeof(FLAC__int32) * blocksize * 2) {
+			printf("FAILED, returned %u, which does not even cover the decoded samples\n", (uint32_t)footprint[pass]);
+			return false;
+		}
+		if(pass && footprint[1] >= footprint[0]) {
+			printf("FAILED, returned %u, not less than the %u of a regular decoder\n", (uint32_t)footprint[1], (uint32_t)footprint[0]);
+			return false;
+		}
+		printf("OK (%u bytes)\n", (uint32_t)footprint[pass]);
+
+		printf("testing FLAC__stream_decoder_read_samples() for the rest of the stream... ");
+		if((got = FLAC__stream_decoder_read_samples(decoder, buffer, total)) != total - 1000 || !pull_compare_(buffer, signal, 1000, got)) {
+			printf("FAILED, returned %u, expected %u\n", got, total - 1000);
+			return false;
+		}
+		printf("OK\n");
+
+		printf("testing FLAC__stream_decoder_finish()... ");
+		if(!FLAC__stream_decoder_finish(decoder))
+			return die_s_("returned false, MD5 mismatch", decoder);
+		if(FLAC__stream_decoder_get_footprint(decoder) >= footprint[pass])
+			return die_s_("FLAC__stream_decoder_get_footprint() did not drop", decoder);
+		printf("OK\n");
+
+		FLAC__stream_decoder_delete(decoder);
+	}
+
+	free(data);
+	free(signal);
+	free(buffer[0]);
+	free(buffer[1]);
+
+	printf("\nPASSED!\n");
+	return true;
+}
+
+/* an allocator that can be told to fail, to make init fail part way through */
+static void *failing_allocate_(void *context, size_t bytes)
+{
+	return *(const FLAC__bool*)context? 0 : malloc(bytes);
+}
+
+static void *failing_reallocate_(void *context, void *address, size_t bytes)
+{
+	return *(const FLAC__bool*)context? 0 : realloc(address, bytes);
+}
+
+static void failing_release_(void *context, void *address)
+{
+	(void)context;
+	free(address);
+}
+
+/* true if the file is still mapped into the process; always false where that cannot be told */
+static FLAC__bool is_mapped_(const char *filename)
+{
+	char line[1024];
+	FLAC__bool found = false;
+	FILE *maps = fopen("/proc/self/maps", "r");
+	if(0 == maps)
+		return false;
+	while(!found && 0 != fgets(line, sizeof(line), maps))
+		found = 0 != strstr(line, filename);
+	fclose(maps);
+	return found;
+}
+
+static FLAC__bool test_stream_decoder_init_failure_(void)
+{
+	static const char *filename = "init_failure.flac";
+	const uint32_t total = 20000, blocksize = 1152;
+	FLAC__StreamDecoder *decoder;
+	FLAC__StreamDecoderInitStatus init_status;
+	FLAC__Allocator allocator;
+	FLAC__bool fail = false;
+	FLAC__int32 *signal, *buffer[2];
+	FLAC__byte *data;
+	size_t length;
+	FILE *file;
+	uint32_t pass, got;
+
+	printf("\n+++ libFLAC unit test: FLAC__StreamDecoder (failed init from memory)\n\n");
+
+	if(0 == (buffer[0] = malloc(sizeof(FLAC__int32) * total)) || 0 == (buffer[1] = malloc(sizeof(FLAC__int32) * total)))
+		return die_("malloc failed");
+	if(!encode_pull_stream_(&signal, total, blocksize, /*frame_index=*/0, &data, &length))
+		return false;
+	if(0 == (file = flac_fopen(filename, "wb")) || fwrite(data, 1, length, file) != length || fclose(file) != 0)
+		return die_("writing the test file failed");
+
+	allocator.allocate = failing_allocate_;
+	allocator.reallocate = failing_reallocate_;
+	allocator.release = failing_release_;
+	allocator.context = &fail;
+
+	for(pass = 0; pass < 2; pass++) {
+		const char *name = pass? "FLAC__stream_decoder_init_mmap()" : "FLAC__stream_decoder_init_memory()";
+
+		if(0 == (decoder = FLAC__stream_decoder_new_with_allocator(&allocator)))
+			return die_("FLAC__stream_decoder_new_with_allocator() returned NULL");
+
+		printf("testing %s with an allocator that fails... ", name);
+		fail = true;
+		if(pass)
+			init_status = FLAC__stream_decoder_init_mmap(decoder, filename, /*write_callback=*/0, /*metadata_callback=*/0, pull_error_callback_, /*client_data=*/0);
+		else
+			init_status = FLAC__stream_decoder_init_memory(decoder, data, length, /*write_callback=*/0, /*metadata_callback=*/0, pull_error_callback_, /*client_data=*/0);
+		fail = false;
+		if(init_status != FLAC__STREAM_DECODER_INIT_STATUS_MEMORY_ALLOCATION_ERROR) {
+			printf("FAILED, returned %u (%s), expected FLAC__STREAM_DECODER_INIT_STATUS_MEMORY_ALLOCATION_ERROR\n", (uint32_t)init_status, FLAC__StreamDecoderInitStatusString[init_status]);
+			return false;
+		}
+		if(is_mapped_(filename))
+			return die_("the file is still mapped after the failed init");
+		printf("OK\n");
+
+		printf("testing FLAC__stream_decoder_finish()... ");
+		FLAC__stream_decoder_finish(decoder);
+		if(FLAC__stream_decoder_get_state(decoder) != FLAC__STREAM_DECODER_UNINITIALIZED)
+			return die_s_("the decoder is not uninitialized", decoder);
+		printf("OK\n");
+
+		printf("testing %s again... ", name);
+		if(pass)
+			init_status = FLAC__stream_decoder_init_mmap(decoder, filename, /*write_callback=*/0, /*metadata_callback=*/0, pull_error_callback_, /*client_data=*/0);
+		else
+			init_status = FLAC__stream_decoder_init_memory(decoder, data, length, /*write_callback=*/0, /*metadata_callback=*/0, pull_error_callback_, /*client_data=*/0);
+		if(init_status != FLAC__STREAM_DECODER_INIT_STATUS_OK)
+			return die_s_(0, decoder);
+		if((got = FLAC__stream_decoder_read_samples(decoder, buffer, total)) != total || !pull_compare_(buffer, signal, 0, got)) {
+			printf("FAILED, returned %u, expected %u\n", got, total);
+			return false;
+		}
+		if(!FLAC__stream_decoder_finish(decoder))
+			return die_s_("FLAC__stream_decoder_finish() returned false", decoder);
+		printf("OK\n");
+
+		FLAC__stream_decoder_delete(decoder);
+	}
+
+	(void) grabbag__file_remove_file(filename);
+	free(data);
+	free(signal);
+	free(buffer[0]);
+	free(buffer[1]);
+
+	printf("\nPASSED!\n");
+	return true;
+}
+
+typedef struct {
+	const FLAC__int32 *signal;
+	FLAC__uint64 *frame_ends;                         /* byte offset just past each frame, from the serial pass only */
+	FLAC__uint64 *frame_starts;                       /* sample number of each frame, in write callback order */
+	uint32_t num_frames;
+	uint32_t max_frames;
+	uint32_t num_errors;
+	FLAC__StreamDecoderErrorStatus last_error;
+	FLAC__bool mismatch;
+} ParallelClientData;
+
+static FLAC__StreamDecoderWriteStatus parallel_write_callback_(const FLAC__StreamDecoder *decoder, const FLAC__Frame *frame, const FLAC__int32 * const buffer[], void *client_data)
+{
+	ParallelClientData *pcd = (ParallelClientData*)client_data;
+	const FLAC__uint64 first = frame->header.number.sample_number;
+	uint32_t i, channel;
+
+	if(pcd->num_frames == pcd->max_frames)
+		return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+	if(0 != pcd->frame_ends && !FLAC__stream_decoder_get_decode_position(decoder, &pcd->frame_ends[pcd->num_frames]))
+		return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+	pcd->frame_starts[pcd->num_frames++] = first;
+	for(i = 0; i < frame->header.blocksize; i++) {
+		for(channel = 0; channel < 2; channel++) {
+			if(buffer[channel][i] != pcd->signal[(first + i) * 2 + channel])
+				pcd->mismatch = true;
+		}
+	}
+	return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+}
+
+static void parallel_error_callback_(const FLAC__StreamDecoder *decoder, FLAC__StreamDecoderErrorStatus status, void *client_data)
+{
+	(void)decoder;
+	((ParallelClientData*)client_data)->num_errors++;
+	((ParallelClientData*)client_data)->last_error = status;
+}
+
+static FLAC__bool test_stream_decoder_parallel_chunks_(void)
+{
+	/* FLAC__stream_decoder_process_parallel() splits the input into chunks of 1 MiB or more */
+	static const FLAC__uint64 chunk_size = 1u << 20;
+	static const uint32_t threads[] = { 2, 3, 4 };
+	const uint32_t total = 2000000, blocksize = 4096;
+	FLAC__StreamDecoder *decoder;
+	ParallelClientData serial, parallel;
+	FLAC__int32 *signal;
+	FLAC__byte *data;
+	FLAC__uint64 boundary;
+	size_t length;
+	uint32_t i, frame;
+	FLAC__bool mid_frame;
+
+	printf("\n+++ libFLAC unit test: FLAC__StreamDecoder (parallel decoding of several chunks)\n\n");
+
+	if(!encode_pull_stream_(&signal, total, blocksize, /*frame_index=*/0, &data, &length))
+		return false;
+
+	memset(&serial, 0, sizeof(serial));
+	memset(&parallel, 0, sizeof(parallel));
+	serial.signal = parallel.signal = signal;
+	serial.max_frames = parallel.max_frames = total / blocksize + 1;
+	if(
+		0 == (serial.frame_ends = malloc(sizeof(FLAC__uint64) * serial.max_frames)) ||
+		0 == (serial.frame_starts = malloc(sizeof(FLAC__uint64) * serial.max_frames)) ||
+		0 == (parallel.frame_starts = malloc(sizeof(FLAC__uint64) * parallel.max_frames))
+	)
+		return die_("malloc failed");
+
+	printf("decoding the stream with FLAC__stream_decoder_process_until_end_of_stream()... ");
+	if(0 == (decoder = FLAC__stream_decoder_new()))
+		return die_("FLAC__stream_decoder_new() returned NULL");
+	if(!FLAC__stream_decoder_set_md5_checking(decoder, true))
+		return die_s_("FLAC__stream_decoder_set_md5_checking() returned false", decoder);
+	if(FLAC__stream_decoder_init_memory(decoder, data, length, parallel_write_callback_, /*metadata_callback=*/0, parallel_error_callback_, &serial) != FLAC__STREAM_DECODER_INIT_STATUS_OK)
+		return die_s_(0, decoder);
+	if(!FLAC__stream_decoder_process_until_end_of_stream(decoder) || !FLAC__stream_decoder_finish(decoder))
+		return die_s_("returned false", decoder);
+	if(serial.mismatch || serial.num_errors != 0 || serial.num_frames != serial.max_frames) {
+		printf("FAILED, %u frames, %u errors%s\n", serial.num_frames, serial.num_errors, serial.mismatch? ", decoded samples differ from the signal" : "");
+		return false;
+	}
+	FLAC__stream_decoder_delete(decoder);
+	printf("OK\n");
+
+	/* make sure the chunks really do split the stream, and that at least one boundary falls inside a frame */
+	printf("checking the chunk boundaries... ");
+	if(length <= 2 * chunk_size) {
+		printf("FAILED, the stream is only %u bytes long\n", (uint32_t)length);
+		return false;
+	}
+	mid_frame = false;
+	for(boundary = chunk_size; boundary < length; boundary += chunk_size) {
+		for(frame = 0; frame < serial.num_frames && serial.frame_ends[frame] < boundary; frame++)
+			;
+		if(frame < serial.num_frames && serial.frame_ends[frame] > boundary && (frame == 0 || serial.frame_ends[frame-1] < boundary))
+			mid_frame = true;
+	}
+	if(!mid_frame)
+		return die_("no chunk boundary falls inside a frame");
+	printf("OK (%u bytes)\n", (uint32_t)length);
+
+	for(i = 0; i < sizeof(threads)/sizeof(threads[0]); i++) {
+		printf("testing FLAC__stream_decoder_process_parallel() with %u threads... ", threads[i]);
+		parallel.num_frames = parallel.num_errors = 0;
+		parallel.mismatch = false;
+		if(0 == (decoder = FLAC__stream_decoder_new()))
+			return die_("FLAC__stream_decoder_new() returned NULL");
+		if(!FLAC__stream_decoder_set_md5_checking(decoder, true))
+			return die_s_("FLAC__stream_decoder_set_md5_checking() returned false", decoder);
+		if(FLAC__stream_decoder_init_memory(decoder, data, length, parallel_write_callback_, /*metadata_callback=*/0, parallel_error_callback_, &parallel) != FLAC__STREAM_DECODER_INIT_STATUS_OK)
+			return die_s_(0, decoder);
+		if(!FLAC__stream_decoder_process_parallel(decoder, threads[i]))
+			return die_s_("returned false", decoder);
+		if(!FLAC__stream_decoder_finish(decoder))
+			return die_s_("FLAC__stream_decoder_finish() returned false, MD5 mismatch", decoder);
+		if(parallel.mismatch || parallel.num_errors != serial.num_errors || parallel.num_frames != serial.num_frames) {
+			printf("FAILED, %u frames, %u errors%s, expected %u frames\n", parallel.num_frames, parallel.num_errors, parallel.mismatch? ", decoded samples differ from the signal" : "", serial.num_frames);
+			return false;
+		}
+		for(frame = 0; frame < serial.num_frames; frame++) {
+			if(parallel.frame_starts[frame] != serial.frame_starts[frame]) {
+				printf("FAILED, frame %u starts at sample %u, expected %u\n", frame, (uint32_t)parallel.frame_starts[frame], (uint32_t)serial.frame_starts[frame]);
+				return false;
+			}
+		}
+		FLAC__stream_decoder_delete(decoder);
+		printf("OK\n");
+	}
+
+	free(serial.frame_ends);
+	free(serial.frame_starts);
+	free(parallel.frame_starts);
+	free(data);
+	free(signal);
+
+	printf("\nPASSED!\n");
+	return true;
+}
+
+static FLAC__bool test_stream_decoder_bad_header_crc_(void)
+{
+	const uint32_t total = 20000, blocksize = 1152;
+	FLAC__StreamDecoder *decoder;
+	ParallelClientData pcd;
+	FLAC__int32 *signal;
+	FLAC__byte *data, *corrupted;
+	size_t length, offset;
+
+	printf("\n+++ libFLAC unit test: FLAC__StreamDecoder (frame header with a bad CRC-8)\n\n");
+
+	if(!encode_pull_stream_(&signal, total, blocksize, /*frame_index=*/0, &data, &length))
+		return false;
+
+	memset(&pcd, 0, sizeof(pcd));
+	pcd.signal = signal;
+	pcd.max_frames = (total + blocksize - 1) / blocksize;
+	if(0 == (pcd.frame_ends = malloc(sizeof(FLAC__uint64) * pcd.max_frames)) || 0 == (pcd.frame_starts = malloc(sizeof(FLAC__uint64) * pcd.max_frames)))
+		return die_("malloc failed");
+
+	printf("finding the second frame... ");
+	if(0 == (decoder = FLAC__stream_decoder_new()))
+		return die_("FLAC__stream_decoder_new() returned NULL");
+	if(FLAC__stream_decoder_init_memory(decoder, data, length, parallel_write_callback_, /*metadata_callback=*/0, parallel_error_callback_, &pcd) != FLAC__STREAM_DECODER_INIT_STATUS_OK)
+		return die_s_(0, decoder);
+	if(!FLAC__stream_decoder_process_until_end_of_stream(decoder) || !FLAC__stream_decoder_finish(decoder))
+		return die_s_("returned false", decoder);
+	FLAC__stream_decoder_delete(decoder);
+	if(pcd.mismatch || pcd.num_errors != 0 || pcd.num_frames != pcd.max_frames) {
+		printf("FAILED, %u frames, %u errors\n", pcd.num_frames, pcd.num_errors);
+		return false;
+	}
+	offset = (size_t)pcd.frame_ends[0];
+	/* sync code, blocksize 1152, 44.1kHz, frame number 1: a header of 5 bytes and the CRC-8 */
+	if(offset + 6 > length || data[offset] != 0xff || data[offset + 2] != 0x39 || data[offset + 4] != 0x01)
+		return die_("the second frame does not start with the expected header");
+	printf("OK (at byte %u)\n", (uint32_t)offset);
+
+	/* a copy of the second frame's header with a broken CRC-8, right in front of the real one */
+	if(0 == (corrupted = malloc(length + 6)))
+		return die_("malloc failed");
+	memcpy(corrupted, data, offset);
+	memcpy(corrupted + offset, data + offset, 6);
+	corrupted[offset + 5] ^= 0x01;
+	memcpy(corrupted + offset + 6, data + offset, length - offset);
+
+	printf("testing FLAC__stream_decoder_process_until_end_of_stream()... ");
+	free(pcd.frame_ends);
+	pcd.frame_ends = 0;
+	pcd.num_frames = pcd.num_errors = 0;
+	if(0 == (decoder = FLAC__stream_decoder_new()))
+		return die_("FLAC__stream_decoder_new() returned NULL");
+	if(!FLAC__stream_decoder_set_md5_checking(decoder, true))
+		return die_s_("FLAC__stream_decoder_set_md5_checking() returned false", decoder);
+	if(FLAC__stream_decoder_init_memory(decoder, corrupted, length + 6, parallel_write_callback_, /*metadata_callback=*/0, parallel_error_callback_, &pcd) != FLAC__STREAM_DECODER_INIT_STATUS_OK)
+		return die_s_(0, decoder);
+	if(!FLAC__stream_decoder_process_until_end_of_stream(decoder))
+		return die_s_("returned false", decoder);
+	if(!FLAC__stream_decoder_finish(decoder))
+		return die_s_("FLAC__stream_decoder_finish() returned false, MD5 mismatch", decoder);
+	FLAC__stream_decoder_delete(decoder);
+	if(pcd.num_errors != 1 || pcd.last_error != FLAC__STREAM_DECODER_ERROR_STATUS_BAD_HEADER) {
+		printf("FAILED, %u error callbacks, expected only one with %s\n", pcd.num_errors, FLAC__StreamDecoderErrorStatusString[FLAC__STREAM_DECODER_ERROR_STATUS_BAD_HEADER]);
+		return false;
+	}
+	if(pcd.mismatch || pcd.num_frames != pcd.max_frames) {
+		printf("FAILED, %u frames%s, expected %u\n", pcd.num_frames, pcd.mismatch? ", decoded samples differ from the signal" : "", pcd.max_frames);
+		return false;
+	}
+	printf("OK\n");
+
+	free(pcd.frame_starts);
+	free(corrupted);
+	free(data);
+	free(signal);
+
+	printf("\nPASSED!\n");
+	return true;
+}
+
 FLAC__bool test_decoders(void)
 {
 	FLAC__bool is_ogg = false;
@@ -1045,6 +1929,12 @@ FLAC__bool test_decoders(void)
 		if(!test_stream_decoder(LAYER_FILENAME, is_ogg))
 			return false;
 
+		if(!is_ogg && !test_stream_decoder(LAYER_MEMORY, is_ogg))
+			return false;
+
+		if(!is_ogg && !test_stream_decoder(LAYER_MMAP, is_ogg))
+			return false;
+
 		(void) grabbag__file_remove_file(flacfilename(is_ogg));
 
 		free_metadata_blocks_();
@@ -1054,5 +1944,23 @@ FLAC__bool test_decoders(void)
 		is_ogg = true;
 	}
 
+	if(!test_stream_decoder_read_samples_())
+		return false;
+
+	if(!test_stream_decoder_frame_index_())
+		return false;
+
+	if(!test_stream_decoder_low_footprint_())
+		return false;
+
+	if(!test_stream_decoder_init_failure_())
+		return false;
+
+	if(!test_stream_decoder_parallel_chunks_())
+		return false;
+
+	if(!test_stream_decoder_bad_header_crc_())
+		return false;
+
 	return true;
 }
@@ -25,8 +25,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 #include "encoders.h"
 #include "FLAC/assert.h"
+#include "FLAC/metadata.h"
+#include "FLAC/stream_decoder.h"
 #include "FLAC/stream_encoder.h"
 #include "share/grabbag.h"
 #include "share/compat.h"
@@ -37,19 +42,26 @@ typedef enum {
 	LAYER_STREAM = 0, /* FLAC__stream_encoder_init_[ogg_]stream() without seeking */
 	LAYER_SEEKABLE_STREAM, /* FLAC__stream_encoder_init_[ogg_]stream() with seeking */
 	LAYER_FILE, /* FLAC__stream_encoder_init_[ogg_]FILE() */
-	LAYER_FILENAME /* FLAC__stream_encoder_init_[ogg_]file() */
+	LAYER_FILENAME, /* FLAC__stream_encoder_init_[ogg_]file() */
+	LAYER_MEMORY /* FLAC__stream_encoder_init_memory() */
 } Layer;
 
 static const char * const LayerString[] = {
 	"Stream",
 	"Seekable Stream",
 	"FILE*",
-	"Filename"
+	"Filename",
+	"Memory"
 };
 
 static FLAC__StreamMetadata streaminfo_, padding_, seektable_, application1_, application2_, vorbiscomment_, cuesheet_, picture_, unknown_;
 static FLAC__StreamMetadata *metadata_sequence_[] = { &vorbiscomment_, &padding_, &seektable_, &application1_, &application2_, &cuesheet_, &picture_, &unknown_ };
 static const uint32_t num_metadata_ = sizeof(metadata_sequence_) / sizeof(metadata_sequence_[0]);
+#ifdef HAVE_PTHREAD
+static const FLAC__bool threaded_md5_ = true;
+#else
+static const FLAC__bool threaded_md5_ = false;
+#endif
 
 static const char *flacfilename(FLAC__bool is_ogg)
 {
@@ -150,6 +162,154 @@ static void stream_encoder_progress_callback_(const FLAC__StreamEncoder *encoder
 	(void)encoder, (void)bytes_written, (void)samples_written, (void)frames_written, (void)total_frames_estimate, (void)client_data;
 }
 
+#ifdef HAVE_PTHREAD
+typedef struct {
+	FLAC__byte *data;
+	size_t length, capacity;
+} EncodedStream;
+
+static FLAC__StreamEncoderWriteStatus encoded_stream_write_callback_(const FLAC__StreamEncoder *encoder, const FLAC__byte buffer[], size_t bytes, uint32_t samples, uint32_t current_frame, void *client_data)
+{
+	EncodedStream *stream = (EncodedStream*)client_data;
+	(void)encoder, (void)samples, (void)current_frame;
+	if(stream->length + bytes > stream->capacity) {
+		FLAC__byte *data;
+		size_t capacity = stream->capacity? stream->capacity : 65536;
+		while(capacity < stream->length + bytes)
+			capacity *= 2;
+		if(0 == (data = realloc(stream->data, capacity)))
+			return FLAC__STREAM_ENCODER_WRITE_STATUS_FATAL_ERROR;
+		stream->data = data;
+		stream->capacity = capacity;
+	}
+	memcpy(stream->data + stream->length, buffer, bytes);
+	stream->length += bytes;
+	return FLAC__STREAM_ENCODER_WRITE_STATUS_OK;
+}
+
+/* interleaved 16-bit samples that the encoder has something to predict in */
+static FLAC__int32 *random_walk_(uint32_t channels, uint32_t samples)
+{
+	FLAC__int32 *signal;
+	FLAC__uint32 seed = 1;
+	uint32_t i;
+
+	if(0 == (signal = malloc(sizeof(FLAC__int32) * channels * samples)))
+		return 0;
+	for(i = 0; i < channels * samples; i++) {
+		seed = seed * 1103515245 + 12345;
+		signal[i] = (i < channels? 0 : signal[i - channels]) + (FLAC__int32)((seed >> 16) % 257) - 128;
+		if(signal[i] > 32767 || signal[i] < -32768)
+			signal[i] = signal[i] > 0? 32767 : -32768;
+	}
+	return signal;
+}
+
+static FLAC__bool encode_threaded_(const FLAC__int32 *signal, uint32_t channels, uint32_t samples, uint32_t compression_level, uint32_t num_threads, FLAC__bool parallel_subframes, EncodedStream *stream)
+{
+	FLAC__StreamEncoder *encoder;
+	uint32_t pos, chunk;
+
+	memset(stream, 0, sizeof(*stream));
+	if(0 == (encoder = FLAC__stream_encoder_new()))
+		return die_("FLAC__stream_encoder_new() returned NULL");
+	if(
+		!FLAC__stream_encoder_set_channels(encoder, channels) ||
+		!FLAC__stream_encoder_set_compression_level(encoder, compression_level) ||
+		!FLAC__stream_encoder_set_verify(encoder, true) ||
+		!FLAC__stream_encoder_set_num_threads(encoder, num_threads) ||
+		!FLAC__stream_encoder_set_parallel_subframes(encoder, parallel_subframes) ||
+		!FLAC__stream_encoder_set_total_samples_estimate(encoder, samples)
+	)
+		return die_s_("setting up the encoder failed", encoder);
+	if(FLAC__stream_encoder_init_stream(encoder, encoded_stream_write_callback_, /*seek_callback=*/0, /*tell_callback=*/0, /*metadata_callback=*/0, stream) != FLAC__STREAM_ENCODER_INIT_STATUS_OK)
+		return die_s_("FLAC__stream_encoder_init_stream() failed", encoder);
+	/* uneven pieces, so that the blocks handed to the threads straddle the calls */
+	for(pos = 0; pos < samples; pos += chunk) {
+		chunk = 1000 + pos % 3001;
+		if(chunk > samples - pos)
+			chunk = samples - pos;
+		if(!FLAC__stream_encoder_process_interleaved(encoder, signal + pos * channels, chunk))
+			return die_s_("FLAC__stream_encoder_process_interleaved() failed", encoder);
+	}
+	if(!FLAC__stream_encoder_finish(encoder))
+		return die_s_("FLAC__stream_encoder_finish() failed", encoder);
+	FLAC__stream_encoder_delete(encoder);
+	return true;
+}
+
+static FLAC__bool test_stream_encoder_threads_(void)
+{
+	static const uint32_t levels[] = { 0, 5, 8 }, threads[] = { 2, 4 };
+	const uint32_t channels = 2, total = 100000;
+	FLAC__int32 *signal;
+	EncodedStream expected, stream;
+	uint32_t i, j;
+
+	printf("\n+++ libFLAC unit test: FLAC__StreamEncoder (threads)\n\n");
+
+	if(0 == (signal = random_walk_(channels, total)))
+		return die_("malloc failed");
+
+	for(i = 0; i < sizeof(levels)/sizeof(levels[0]); i++) {
+		if(!encode_threaded_(signal, channels, total, levels[i], 1, /*parallel_subframes=*/false, &expected))
+			return false;
+		for(j = 0; j < sizeof(threads)/sizeof(threads[0]); j++) {
+			printf("testing compression level %u with %u threads against 1 thread... ", levels[i], threads[j]);
+			if(!encode_threaded_(signal, channels, total, levels[i], threads[j], /*parallel_subframes=*/false, &stream))
+				return false;
+			if(stream.length != expected.length || memcmp(stream.data, expected.data, stream.length)) {
+				printf("FAILED, the streams differ\n");
+				return false;
+			}
+			free(stream.data);
+			printf("OK\n");
+		}
+		free(expected.data);
+	}
+
+	free(signal);
+
+	printf("\nPASSED!\n");
+	return true;
+}
+
+static FLAC__bool test_stream_encoder_parallel_subframes_(void)
+{
+	/* loose mid-side stereo (level 4) stays on with parallel subframes, so it must match too */
+	static const uint32_t channels[] = { 2, 6 }, levels[] = { 4, 5, 8 };
+	const uint32_t total = 50000;
+	FLAC__int32 *signal;
+	EncodedStream expected, stream;
+	uint32_t i, j;
+
+	printf("\n+++ libFLAC unit test: FLAC__StreamEncoder (parallel subframes)\n\n");
+
+	for(i = 0; i < sizeof(channels)/sizeof(channels[0]); i++) {
+		if(0 == (signal = random_walk_(channels[i], total)))
+			return die_("malloc failed");
+		for(j = 0; j < sizeof(levels)/sizeof(levels[0]); j++) {
+			printf("testing %u channels at compression level %u with 4 threads against 1 thread... ", channels[i], levels[j]);
+			if(!encode_threaded_(signal, channels[i], total, levels[j], 1, /*parallel_subframes=*/false, &expected))
+				return false;
+			if(!encode_threaded_(signal, channels[i], total, levels[j], 4, /*parallel_subframes=*/true, &stream))
+				return false;
+			if(stream.length != expected.length || memcmp(stream.data, expected.data, stream.length)) {
+				printf("FAILED, the streams differ\n");
+				return false;
+			}
+			free(expected.data);
+			free(stream.data);
+			printf("OK\n");
+		}
+		free(signal);
+	}
+
+	printf("\nPASSED!\n");
+	return true;
+}
+#endif
+
 static FLAC__bool test_stream_encoder(Layer layer, FLAC__bool is_ogg)
 {
 	FLAC__StreamEncoder *encoder;
@@ -159,6 +319,9 @@ static FLAC__bool test_stream_encoder(Layer layer, FLAC__bool is_ogg)
 	FILE *file = 0;
 	FLAC__int32 samples[1024];
 	FLAC__int32 *samples_array[1];
+	FLAC__int16 samples16[1024];
+	FLAC__byte samples24[3*1024];
+	float samplesf[1024];
 	uint32_t i;
 
 	samples_array[0] = samples;
@@ -265,6 +428,23 @@ static FLAC__bool test_stream_encoder(Layer layer, FLAC__bool is_ogg)
 		return die_s_("returned false", encoder);
 	printf("OK\n");
 
+	printf("testing FLAC__stream_encoder_set_num_threads()... ");
+	if(!FLAC__stream_encoder_set_num_threads(encoder, 1))
+		return die_s_("returned false", encoder);
+	if(FLAC__stream_encoder_set_num_threads(encoder, 0))
+		return die_s_("returned true for 0 threads", encoder);
+	printf("OK\n");
+
+	printf("testing FLAC__stream_encoder_set_parallel_subframes()... ");
+	if(!FLAC__stream_encoder_set_parallel_subframes(encoder, false))
+		return die_s_("returned false", encoder);
+	printf("OK\n");
+
+	printf("testing FLAC__stream_encoder_set_threaded_md5()... ");
+	if(!FLAC__stream_encoder_set_threaded_md5(encoder, threaded_md5_))
+		return die_s_("returned false", encoder);
+	printf("OK\n");
+
 	printf("testing FLAC__stream_encoder_set_total_samples_estimate()... ");
 	if(!FLAC__stream_encoder_set_total_samples_estimate(encoder, streaminfo_.data.stream_info.total_samples))
 		return die_s_("returned false", encoder);
@@ -310,6 +490,10 @@ static FLAC__bool test_stream_encoder(Layer layer, FLAC__bool is_ogg)
 				FLAC__stream_encoder_init_ogg_file(encoder, flacfilename(is_ogg), stream_encoder_progress_callback_, /*client_data=*/0) :
 				FLAC__stream_encoder_init_file(encoder, flacfilename(is_ogg), stream_encoder_progress_callback_, /*client_data=*/0);
 			break;
+		case LAYER_MEMORY:
+			printf("testing FLAC__stream_encoder_init_memory()... ");
+			init_status = FLAC__stream_encoder_init_memory(encoder, stream_encoder_progress_callback_, /*client_data=*/0);
+			break;
 		default:
 			die_("internal error 001");
 			return false;
@@ -322,6 +506,22 @@ static FLAC__bool test_stream_encoder(Layer layer, FLAC__bool is_ogg)
 	state = FLAC__stream_encoder_get_state(encoder);
 	printf("returned state = %u (%s)... OK\n", (uint32_t)state, FLAC__StreamEncoderStateString[state]);
 
+	printf("testing FLAC__stream_encoder_get_kernel()... ");
+	{
+		uint32_t kernel;
+		for(kernel = 0; kernel < FLAC__STREAM_ENCODER_KERNEL_COUNT; kernel++) {
+#ifdef FLAC__INTEGER_ONLY_LIBRARY
+			if(kernel != FLAC__STREAM_ENCODER_KERNEL_FIXED_BEST_PREDICTOR && kernel != FLAC__STREAM_ENCODER_KERNEL_FIXED_BEST_PREDICTOR_WIDE && kernel != FLAC__STREAM_ENCODER_KERNEL_PARTITION_SUMS && kernel != FLAC__STREAM_ENCODER_KERNEL_PCM_DEINTERLEAVE_INT16 && kernel != FLAC__STREAM_ENCODER_KERNEL_PCM_DEINTERLEAVE_INT24)
+				continue;
+#endif
+			if(0 == FLAC__stream_encoder_get_kernel(encoder, (FLAC__StreamEncoderKernel)kernel)) {
+				printf("FAILED, no routine for %s\n", FLAC__StreamEncoderKernelString[kernel]);
+				return false;
+			}
+		}
+	}
+	printf("OK\n");
+
 	printf("testing FLAC__stream_encoder_get_verify_decoder_state()... ");
 	dstate = FLAC__stream_encoder_get_verify_decoder_state(encoder);
 	printf("returned state = %u (%s)... OK\n", (uint32_t)dstate, FLAC__StreamDecoderStateString[dstate]);
@@ -449,6 +649,27 @@ static FLAC__bool test_stream_encoder(Layer layer, FLAC__bool is_ogg)
 	}
 	printf("OK\n");
 
+	printf("testing FLAC__stream_encoder_get_num_threads()... ");
+	if(FLAC__stream_encoder_get_num_threads(encoder) != 1) {
+		printf("FAILED, expected %d, got %u\n", 1, FLAC__stream_encoder_get_num_threads(encoder));
+		return false;
+	}
+	printf("OK\n");
+
+	printf("testing FLAC__stream_encoder_get_parallel_subframes()... ");
+	if(FLAC__stream_encoder_get_parallel_subframes(encoder) != false) {
+		printf("FAILED, expected false, got true\n");
+		return false;
+	}
+	printf("OK\n");
+
+	printf("testing FLAC__stream_encoder_get_threaded_md5()... ");
+	if(FLAC__stream_encoder_get_threaded_md5(encoder) != threaded_md5_) {
+		printf("FAILED, expected %s, got %s\n", threaded_md5_? "true" : "false", threaded_md5_? "false" : "true");
+		return false;
+	}
+	printf("OK\n");
+
 	printf("testing FLAC__stream_encoder_get_total_samples_estimate()... ");
 	if(FLAC__stream_encoder_get_total_samples_estimate(encoder) != streaminfo_.data.stream_info.total_samples) {
 		printf("FAILED, expected %" PRIu64 ", got %" PRIu64 "\n", streaminfo_.data.stream_info.total_samples, FLAC__stream_encoder_get_total_samples_estimate(encoder));
@@ -456,9 +677,14 @@ static FLAC__bool test_stream_encoder(Layer layer, FLAC__bool is_ogg)
 	}
 	printf("OK\n");
 
-	/* init the dummy sample buffer */
-	for(i = 0; i < sizeof(samples) / sizeof(FLAC__int32); i++)
+	/* init the dummy sample buffers */
+	for(i = 0; i < sizeof(samples) / sizeof(FLAC__int32); i++) {
 		samples[i] = i & 7;
+		samples16[i] = (FLAC__int16)samples[i];
+		samples24[3*i] = (FLAC__byte)samples[i];
+		samples24[3*i+1] = samples24[3*i+2] = 0;
+		samplesf[i] = (float)samples[i] / (float)(1u << (streaminfo_.data.stream_info.bits_per_sample - 1));
+	}
 
 	printf("testing FLAC__stream_encoder_process()... ");
 	if(!FLAC__stream_encoder_process(encoder, (const FLAC__int32 * const *)samples_array, sizeof(samples) / sizeof(FLAC__int32)))
@@ -470,11 +696,75 @@ static FLAC__bool test_stream_encoder(Layer layer, FLAC__bool is_ogg)
 		return die_s_("returned false", encoder);
 	printf("OK\n");
 
-	printf("testing FLAC__stream_encoder_finish()... ");
-	if(!FLAC__stream_encoder_finish(encoder))
+	printf("testing FLAC__stream_encoder_process_interleaved_int16()... ");
+	if(!FLAC__stream_encoder_process_interleaved_int16(encoder, samples16, sizeof(samples16) / sizeof(FLAC__int16)))
 		return die_s_("returned false", encoder);
 	printf("OK\n");
 
+	printf("testing FLAC__stream_encoder_process_interleaved_int24()... ");
+	if(!FLAC__stream_encoder_process_interleaved_int24(encoder, samples24, sizeof(samples24) / 3))
+		return die_s_("returned false", encoder);
+	printf("OK\n");
+
+#ifndef FLAC__INTEGER_ONLY_LIBRARY
+	printf("testing FLAC__stream_encoder_process_interleaved_float32()... ");
+	if(!FLAC__stream_encoder_process_interleaved_float32(encoder, samplesf, sizeof(samplesf) / sizeof(float)))
+		return die_s_("returned false", encoder);
+	printf("OK\n");
+#endif
+
+	if(layer == LAYER_MEMORY) {
+		FLAC__byte *data, *expected;
+		size_t length;
+
+		printf("testing FLAC__stream_encoder_finish_memory()... ");
+		if(!FLAC__stream_encoder_finish_memory(encoder, &data, &length))
+			return die_s_("returned false", encoder);
+		printf("OK\n");
+
+		/* the stream must match what the Filename layer wrote, metadata fixups included */
+		printf("comparing the stream to %s... ", flacfilename(is_ogg));
+		if(0 == (file = flac_fopen(flacfilename(is_ogg), "rb")) || 0 == (expected = malloc(length + 1))) {
+			printf("ERROR (%s)\n", strerror(errno));
+			return false;
+		}
+		if(fread(expected, 1, length + 1, file) != length || memcmp(expected, data, length)) {
+			printf("FAILED, contents differ\n");
+			return false;
+		}
+		fclose(file);
+		free(expected);
+		free(data);
+		printf("OK\n");
+	}
+	else {
+		printf("testing FLAC__stream_encoder_finish()... ");
+		if(!FLAC__stream_encoder_finish(encoder))
+			return die_s_("returned false", encoder);
+		printf("OK\n");
+	}
+
+	printf("testing FLAC__stream_encoder_get_statistics()... ");
+	{
+		FLAC__StreamEncoderStatistics statistics;
+#ifdef FLAC__ENABLE_STATISTICS
+		if(!FLAC__stream_encoder_get_statistics(encoder, &statistics)) {
+			printf("FAILED, returned false\n");
+			return false;
+		}
+		if(statistics.calls[FLAC__STREAM_ENCODER_STAGE_PACKING] == 0 || statistics.calls[FLAC__STREAM_ENCODER_STAGE_WRITE_CALLBACK] == 0) {
+			printf("FAILED, packing/write callback calls %" PRIu64 "/%" PRIu64 "\n", statistics.calls[FLAC__STREAM_ENCODER_STAGE_PACKING], statistics.calls[FLAC__STREAM_ENCODER_STAGE_WRITE_CALLBACK]);
+			return false;
+		}
+#else
+		if(FLAC__stream_encoder_get_statistics(encoder, &statistics)) {
+			printf("FAILED, returned true without statistics\n");
+			return false;
+		}
+#endif
+	}
+	printf("OK\n");
+
 	if(layer < LAYER_FILE)
 		fclose(file);
 
@@ -487,6 +777,474 @@ static FLAC__bool test_stream_encoder(Layer layer, FLAC__bool is_ogg)
 	return true;
 }
 
+static FLAC__bool test_stream_encoder_out_of_range_(void)
+{
+	FLAC__StreamEncoder *encoder;
+	FLAC__int16 samples16[64] = { 0 };
+#ifndef FLAC__INTEGER_ONLY_LIBRARY
+	float samplesf[64] = { 0.0f };
+#endif
+	uint32_t pass;
+
+	printf("\n+++ libFLAC unit test: FLAC__StreamEncoder (out-of-range input)\n\n");
+
+	for(pass = 0; pass < 2; pass++) {
+		FLAC__bool ok = true;
+
+		if(0 == (encoder = FLAC__stream_encoder_new()))
+			return die_("FLAC__stream_encoder_new() returned NULL");
+		if(!FLAC__stream_encoder_set_channels(encoder, 2) || !FLAC__stream_encoder_set_bits_per_sample(encoder, 12))
+			return die_s_("setting the format failed", encoder);
+		if(FLAC__stream_encoder_init_memory(encoder, /*progress_callback=*/0, /*client_data=*/0) != FLAC__STREAM_ENCODER_INIT_STATUS_OK)
+			return die_s_("FLAC__stream_encoder_init_memory() failed", encoder);
+
+		if(pass == 0) {
+			printf("testing FLAC__stream_encoder_process_interleaved_int16() with a sample that does not fit... ");
+			samples16[45] = 2048;
+			ok = FLAC__stream_encoder_process_interleaved_int16(encoder, samples16, 32);
+		}
+		else {
+#ifndef FLAC__INTEGER_ONLY_LIBRARY
+			printf("testing FLAC__stream_encoder_process_interleaved_float32() with a sample that is not an integer... ");
+			samplesf[45] = 0.5f + 1.0f / 65536.0f;
+			ok = FLAC__stream_encoder_process_interleaved_float32(encoder, samplesf, 32);
+#else
+			FLAC__stream_encoder_delete(encoder);
+			break;
+#endif
+		}
+		if(ok || FLAC__stream_encoder_get_state(encoder) != FLAC__STREAM_ENCODER_CLIENT_ERROR) {
+			printf("FAILED, expected false with state FLAC__STREAM_ENCODER_CLIENT_ERROR, got %s with state %s\n", ok? "true" : "false", FLAC__stream_encoder_get_resolved_state_string(encoder));
+			return false;
+		}
+		printf("OK\n");
+
+		FLAC__stream_encoder_delete(encoder);
+	}
+
+	printf("\nPASSED!\n");
+	return true;
+}
+
+/* true if the encoder uses a routine that needs SSE2 or anything that extends it */
+static FLAC__bool uses_sse2_or_later_(const FLAC__StreamEncoder *encoder)
+{
+	static const char * const extensions[] = { "sse2", "sse3", "ssse3", "sse41", "sse42", "pclmul", "avx" };
+	const char *kernel;
+	uint32_t k, i;
+
+	for(k = 0; k < FLAC__STREAM_ENCODER_KERNEL_COUNT; k++) {
+		if(0 == (kernel = FLAC__stream_encoder_get_kernel(encoder, (FLAC__StreamEncoderKernel)k)))
+			continue;
+		for(i = 0; i < sizeof(extensions)/sizeof(extensions[0]); i++) {
+			if(0 != strstr(kernel, extensions[i])) {
+				printf("FAILED, %s is used\n", kernel);
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+static FLAC__bool test_stream_encoder_cpu_feature_mask_(void)
+{
+	static const FLAC__uint32 sse2_and_later =
+		FLAC__CPU_FEATURE_X86_SSE2 | FLAC__CPU_FEATURE_X86_SSE3 | FLAC__CPU_FEATURE_X86_SSSE3 | FLAC__CPU_FEATURE_X86_SSE41 | FLAC__CPU_FEATURE_X86_SSE42 |
+		FLAC__CPU_FEATURE_X86_PCLMUL | FLAC__CPU_FEATURE_X86_AVX | FLAC__CPU_FEATURE_X86_AVX2 | FLAC__CPU_FEATURE_X86_FMA;
+	FLAC__StreamEncoder *encoder;
+	const char *kernel;
+	FLAC__uint32 features;
+
+	printf("\n+++ libFLAC unit test: FLAC__StreamEncoder (CPU feature mask)\n\n");
+
+	printf("testing FLAC__set_cpu_feature_mask(0)... ");
+	FLAC__set_cpu_feature_mask(0);
+	if(FLAC__get_cpu_feature_mask() != 0 || FLAC__get_cpu_features() != 0) {
+		printf("FAILED, mask = 0x%08x, features = 0x%08x\n", FLAC__get_cpu_feature_mask(), FLAC__get_cpu_features());
+		FLAC__set_cpu_feature_mask(FLAC__CPU_FEATURE_ALL);
+		return false;
+	}
+	printf("OK\n");
+
+	printf("testing that the encoder falls back to the C routines... ");
+	if(0 == (encoder = FLAC__stream_encoder_new())) {
+		FLAC__set_cpu_feature_mask(FLAC__CPU_FEATURE_ALL);
+		return die_("FLAC__stream_encoder_new() returned NULL");
+	}
+	if(FLAC__stream_encoder_init_memory(encoder, /*progress_callback=*/0, /*client_data=*/0) != FLAC__STREAM_ENCODER_INIT_STATUS_OK) {
+		FLAC__set_cpu_feature_mask(FLAC__CPU_FEATURE_ALL);
+		return die_s_("FLAC__stream_encoder_init_memory() failed", encoder);
+	}
+	FLAC__set_cpu_feature_mask(FLAC__CPU_FEATURE_ALL);
+	kernel = FLAC__stream_encoder_get_kernel(encoder, FLAC__STREAM_ENCODER_KERNEL_FIXED_BEST_PREDICTOR);
+	if(0 == kernel || strcmp(kernel, "FLAC__fixed_compute_best_predictor")) {
+		printf("FAILED, got %s\n", kernel? kernel : "NULL");
+		return false;
+	}
+	kernel = FLAC__stream_encoder_get_kernel(encoder, FLAC__STREAM_ENCODER_KERNEL_PARTITION_SUMS);
+	if(0 == kernel || strcmp(kernel, "precompute_partition_info_sums_")) {
+		printf("FAILED, got %s\n", kernel? kernel : "NULL");
+		return false;
+	}
+	printf("OK\n");
+
+	FLAC__stream_encoder_delete(encoder);
+
+	printf("testing FLAC__set_cpu_feature_mask() without SSE2... ");
+	features = FLAC__get_cpu_features();
+	FLAC__set_cpu_feature_mask(FLAC__CPU_FEATURE_ALL & ~FLAC__CPU_FEATURE_X86_SSE2);
+	if(FLAC__get_cpu_features() != (features & ~sse2_and_later)) {
+		printf("FAILED, features = 0x%08x, expected 0x%08x\n", FLAC__get_cpu_features(), features & ~sse2_and_later);
+		FLAC__set_cpu_feature_mask(FLAC__CPU_FEATURE_ALL);
+		return false;
+	}
+	printf("OK\n");
+
+	printf("testing that the encoder uses none of the SSE4.1 and AVX2 routines... ");
+	if(0 == (encoder = FLAC__stream_encoder_new())) {
+		FLAC__set_cpu_feature_mask(FLAC__CPU_FEATURE_ALL);
+		return die_("FLAC__stream_encoder_new() returned NULL");
+	}
+	if(FLAC__stream_encoder_init_memory(encoder, /*progress_callback=*/0, /*client_data=*/0) != FLAC__STREAM_ENCODER_INIT_STATUS_OK) {
+		FLAC__set_cpu_feature_mask(FLAC__CPU_FEATURE_ALL);
+		return die_s_("FLAC__stream_encoder_init_memory() failed", encoder);
+	}
+	FLAC__set_cpu_feature_mask(FLAC__CPU_FEATURE_ALL);
+	if(uses_sse2_or_later_(encoder))
+		return false;
+	FLAC__stream_encoder_delete(encoder);
+	printf("OK\n");
+
+	/* and the same settings without the mask do pick them, where the CPU has them */
+	if(features & (FLAC__CPU_FEATURE_X86_SSE41 | FLAC__CPU_FEATURE_X86_AVX2)) {
+		printf("testing that the encoder uses them without the mask... ");
+		if(0 == (encoder = FLAC__stream_encoder_new()))
+			return die_("FLAC__stream_encoder_new() returned NULL");
+		if(FLAC__stream_encoder_init_memory(encoder, /*progress_callback=*/0, /*client_data=*/0) != FLAC__STREAM_ENCODER_INIT_STATUS_OK)
+			return die_s_("FLAC__stream_encoder_init_memory() failed", encoder);
+		kernel = FLAC__stream_encoder_get_kernel(encoder, FLAC__STREAM_ENCODER_KERNEL_LPC_RESIDUAL);
+		if(0 == kernel || (0 == strstr(kernel, "sse41") && 0 == strstr(kernel, "avx2"))) {
+			printf("FAILED, got %s\n", kernel? kernel : "NULL");
+			return false;
+		}
+		FLAC__stream_encoder_delete(encoder);
+		printf("OK (%s)\n", kernel);
+	}
+
+	printf("\nPASSED!\n");
+	return true;
+}
+
+/* An allocator that counts blocks and tags them, so that a block freed
+ * by the wrong allocator is caught.  The encoder's worker threads
+ * allocate too, hence the lock.
+ */
+#define ALLOCATION_HEADER_ 16
+#define ALLOCATION_TAG_ 0x464c4143u
+
+typedef struct {
+	uint32_t allocations, releases, foreign_releases;
+#ifdef HAVE_PTHREAD
+	pthread_mutex_t mutex;
+#endif
+} AllocationCounts;
+
+static void count_(AllocationCounts *counts, uint32_t *counter)
+{
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&counts->mutex);
+#else
+	(void)counts;
+#endif
+	(*counter)++;
+#ifdef HAVE_PTHREAD
+	pthread_mutex_unlock(&counts->mutex);
+#endif
+}
+
+static void *counting_allocate_(void *context, size_t bytes)
+{
+	FLAC__byte *x = malloc(ALLOCATION_HEADER_ + bytes);
+	if(0 == x)
+		return 0;
+	*(FLAC__uint32*)x = ALLOCATION_TAG_;
+	count_((AllocationCounts*)context, &((AllocationCounts*)context)->allocations);
+	return x + ALLOCATION_HEADER_;
+}
+
+static void *counting_reallocate_(void *context, void *address, size_t bytes)
+{
+	FLAC__byte *x = (FLAC__byte*)address - ALLOCATION_HEADER_;
+	(void)context;
+	FLAC__ASSERT(*(FLAC__uint32*)x == ALLOCATION_TAG_);
+	if(0 == (x = realloc(x, ALLOCATION_HEADER_ + bytes)))
+		return 0;
+	return x + ALLOCATION_HEADER_;
+}
+
+static void counting_release_(void *context, void *address)
+{
+	AllocationCounts *counts = (AllocationCounts*)context;
+	FLAC__byte *x = (FLAC__byte*)address - ALLOCATION_HEADER_;
+	if(*(FLAC__uint32*)x != ALLOCATION_TAG_) {
+		count_(counts, &counts->foreign_releases);
+		return;
+	}
+	*(FLAC__uint32*)x = 0;
+	free(x);
+	count_(counts, &counts->releases);
+}
+
+static FLAC__bool check_counts_(const AllocationCounts *counts)
+{
+	if(counts->allocations == 0 || counts->allocations != counts->releases || counts->foreign_releases != 0) {
+		printf("FAILED, %u allocations, %u releases, %u foreign releases\n", counts->allocations, counts->releases, counts->foreign_releases);
+		return false;
+	}
+	printf("OK (%u allocations)\n", counts->allocations);
+	return true;
+}
+
+static void allocator_error_callback_(const FLAC__StreamDecoder *decoder, FLAC__StreamDecoderErrorStatus status, void *client_data)
+{
+	(void)decoder, (void)status;
+	*(FLAC__bool*)client_data = true;
+}
+
+static FLAC__bool test_stream_encoder_allocator_(void)
+{
+	const uint32_t total = 20000;
+	AllocationCounts counts;
+	FLAC__Allocator allocator;
+	FLAC__StreamEncoder *encoder;
+	FLAC__StreamDecoder *decoder;
+	FLAC__StreamMetadata *block;
+	FLAC__StreamMetadata_VorbisComment_Entry entry;
+	FLAC__int32 *signal, *buffer[2];
+	FLAC__byte *data;
+	size_t length;
+	FLAC__bool decode_error = false;
+	uint32_t allocations, i;
+
+	printf("\n+++ libFLAC unit test: FLAC__StreamEncoder (allocator)\n\n");
+
+	memset(&counts, 0, sizeof(counts));
+#ifdef HAVE_PTHREAD
+	if(pthread_mutex_init(&counts.mutex, 0) != 0)
+		return die_("pthread_mutex_init() failed");
+#endif
+	allocator.allocate = counting_allocate_;
+	allocator.reallocate = counting_reallocate_;
+	allocator.release = counting_release_;
+	allocator.context = &counts;
+
+	if(0 == (signal = malloc(sizeof(FLAC__int32) * 2 * total)) || 0 == (buffer[0] = malloc(sizeof(FLAC__int32) * total)) || 0 == (buffer[1] = malloc(sizeof(FLAC__int32) * total)))
+		return die_("malloc failed");
+	for(i = 0; i < 2 * total; i++)
+		signal[i] = (FLAC__int32)((i * 7919u) % 4001u) - 2000;
+
+	printf("testing FLAC__stream_encoder_new_with_allocator()... ");
+	if(0 == (encoder = FLAC__stream_encoder_new_with_allocator(&allocator)))
+		return die_("returned NULL");
+	if(!FLAC__stream_encoder_set_verify(encoder, true) || !FLAC__stream_encoder_set_threaded_md5(encoder, threaded_md5_) || !FLAC__stream_encoder_set_total_samples_estimate(encoder, total))
+		return die_s_("setting up the encoder failed", encoder);
+#ifdef HAVE_PTHREAD
+	if(!FLAC__stream_encoder_set_num_threads(encoder, 2))
+		return die_s_("FLAC__stream_encoder_set_num_threads() failed", encoder);
+#endif
+	if(FLAC__stream_encoder_init_memory(encoder, /*progress_callback=*/0, /*client_data=*/0) != FLAC__STREAM_ENCODER_INIT_STATUS_OK)
+		return die_s_("FLAC__stream_encoder_init_memory() failed", encoder);
+	if(!FLAC__stream_encoder_process_interleaved(encoder, signal, total))
+		return die_s_("FLAC__stream_encoder_process_interleaved() failed", encoder);
+	if(!FLAC__stream_encoder_finish_memory(encoder, &data, &length))
+		return die_s_("FLAC__stream_encoder_finish_memory() failed", encoder);
+	FLAC__stream_encoder_delete(encoder);
+	/* the stream is the only block left, and it is the caller's to release */
+	if(counts.allocations != counts.releases + 1) {
+		printf("FAILED, %u allocations, %u releases\n", counts.allocations, counts.releases);
+		return false;
+	}
+	printf("OK\n");
+
+	printf("testing FLAC__stream_decoder_new_with_allocator()... ");
+	if(0 == (decoder = FLAC__stream_decoder_new_with_allocator(&allocator)))
+		return die_("returned NULL");
+	if(!FLAC__stream_decoder_set_md5_checking(decoder, true) || !FLAC__stream_decoder_set_threaded_md5(decoder, threaded_md5_))
+		return die_("setting up the decoder failed");
+	if(FLAC__stream_decoder_init_memory(decoder, data, length, /*write_callback=*/0, /*metadata_callback=*/0, allocator_error_callback_, &decode_error) != FLAC__STREAM_DECODER_INIT_STATUS_OK)
+		return die_("FLAC__stream_decoder_init_memory() failed");
+	/* the index the decoder builds is its own memory too */
+	allocations = counts.allocations;
+	if(!FLAC__stream_decoder_build_frame_index(decoder) || 0 == FLAC__stream_decoder_get_frame_index(decoder) || counts.allocations == allocations)
+		return die_("FLAC__stream_decoder_build_frame_index() did not use the allocator");
+	if(FLAC__stream_decoder_read_samples(decoder, buffer, total) != total || decode_error)
+		return die_("FLAC__stream_decoder_read_samples() failed");
+	for(i = 0; i < total; i++) {
+		if(buffer[0][i] != signal[2*i] || buffer[1][i] != signal[2*i+1]) {
+			printf("FAILED, sample %u differs\n", i);
+			return false;
+		}
+	}
+	if(!FLAC__stream_decoder_finish(decoder))
+		return die_("MD5 mismatch");
+	FLAC__stream_decoder_delete(decoder);
+
+	/* a reset part way through must not leak the buffer the MD5 context hashes from */
+	if(0 == (decoder = FLAC__stream_decoder_new_with_allocator(&allocator)))
+		return die_("FLAC__stream_decoder_new_with_allocator() returned NULL");
+	if(!FLAC__stream_decoder_set_md5_checking(decoder, true) || !FLAC__stream_decoder_set_threaded_md5(decoder, false))
+		return die_("setting up the decoder failed");
+	if(FLAC__stream_decoder_init_memory(decoder, data, length, /*write_callback=*/0, /*metadata_callback=*/0, allocator_error_callback_, &decode_error) != FLAC__STREAM_DECODER_INIT_STATUS_OK)
+		return die_("FLAC__stream_decoder_init_memory() failed");
+	if(FLAC__stream_decoder_read_samples(decoder, buffer, total / 2) != total / 2 || decode_error)
+		return die_("FLAC__stream_decoder_read_samples() failed");
+	if(!FLAC__stream_decoder_reset(decoder))
+		return die_("FLAC__stream_decoder_reset() failed");
+	if(FLAC__stream_decoder_read_samples(decoder, buffer, total) != total || decode_error)
+		return die_("FLAC__stream_decoder_read_samples() failed after FLAC__stream_decoder_reset()");
+	if(!FLAC__stream_decoder_finish(decoder))
+		return die_("MD5 mismatch after FLAC__stream_decoder_reset()");
+	FLAC__stream_decoder_delete(decoder);
+	allocator.release(allocator.context, data);
+	if(!check_counts_(&counts))
+		return false;
+
+	printf("testing FLAC__set_allocator()... ");
+	counts.allocations = counts.releases = counts.foreign_releases = 0;
+	FLAC__set_allocator(&allocator);
+	if(0 == (block = FLAC__metadata_object_new(FLAC__METADATA_TYPE_VORBIS_COMMENT))) {
+		FLAC__set_allocator(0);
+		return die_("FLAC__metadata_object_new() returned NULL");
+	}
+	if(!FLAC__metadata_object_vorbiscomment_entry_from_name_value_pair(&entry, "TITLE", "allocator") || !FLAC__metadata_object_vorbiscomment_append_comment(block, entry, /*copy=*/false)) {
+		FLAC__set_allocator(0);
+		return die_("adding a comment failed");
+	}
+	FLAC__metadata_object_delete(block);
+	FLAC__set_allocator(0);
+	if(!check_counts_(&counts))
+		return false;
+
+#ifdef HAVE_PTHREAD
+	pthread_mutex_destroy(&counts.mutex);
+#endif
+	free(signal);
+	free(buffer[0]);
+	free(buffer[1]);
+
+	printf("\nPASSED!\n");
+	return true;
+}
+
+static FLAC__bool keep_buffers_encode_(FLAC__StreamEncoder *encoder, FLAC__bool keep, uint32_t level, uint32_t channels, const FLAC__int32 *signal, uint32_t samples, FLAC__byte **data, size_t *length)
+{
+	if(!FLAC__stream_encoder_set_keep_buffers(encoder, keep) || !FLAC__stream_encoder_set_compression_level(encoder, level) || !FLAC__stream_encoder_set_channels(encoder, channels))
+		return die_s_("setting up the encoder failed", encoder);
+	if(FLAC__stream_encoder_init_memory(encoder, /*progress_callback=*/0, /*client_data=*/0) != FLAC__STREAM_ENCODER_INIT_STATUS_OK)
+		return die_s_("FLAC__stream_encoder_init_memory() failed", encoder);
+	if(!FLAC__stream_encoder_process_interleaved(encoder, signal, samples))
+		return die_s_("FLAC__stream_encoder_process_interleaved() failed", encoder);
+	if(!FLAC__stream_encoder_finish_memory(encoder, data, length))
+		return die_s_("FLAC__stream_encoder_finish_memory() failed", encoder);
+	return true;
+}
+
+static FLAC__bool test_stream_encoder_keep_buffers_(void)
+{
+	/* all at blocksize 4096, each needing buffers the one before did not: -5 adds mid-side to -3, and stereo adds a channel to mono */
+	static const struct { uint32_t level, channels; } settings[] = { { 3, 2 }, { 5, 2 }, { 5, 1 }, { 5, 2 } };
+	const uint32_t total = 20000;
+	AllocationCounts counts;
+	FLAC__Allocator allocator;
+	FLAC__StreamEncoder *encoder, *fresh;
+	FLAC__int32 *signal;
+	FLAC__byte *data[3], *fresh_data;
+	size_t length[3], fresh_length;
+	uint32_t allocations[3], i;
+
+	printf("\n+++ libFLAC unit test: FLAC__StreamEncoder (keep buffers)\n\n");
+
+	memset(&counts, 0, sizeof(counts));
+#ifdef HAVE_PTHREAD
+	if(pthread_mutex_init(&counts.mutex, 0) != 0)
+		return die_("pthread_mutex_init() failed");
+#endif
+	allocator.allocate = counting_allocate_;
+	allocator.reallocate = counting_reallocate_;
+	allocator.release = counting_release_;
+	allocator.context = &counts;
+
+	if(0 == (signal = malloc(sizeof(FLAC__int32) * 2 * total)))
+		return die_("malloc failed");
+	for(i = 0; i < 2 * total; i++)
+		signal[i] = (FLAC__int32)((i * 7919u) % 4001u) - 2000;
+
+	if(0 == (encoder = FLAC__stream_encoder_new_with_allocator(&allocator)))
+		return die_("FLAC__stream_encoder_new_with_allocator() returned NULL");
+
+	/* the first two encodes keep their buffers, the last one frees them */
+	for(i = 0; i < 3; i++) {
+		printf("testing encode #%u with FLAC__stream_encoder_set_keep_buffers(%s)... ", i+1, i < 2? "true" : "false");
+		allocations[i] = counts.allocations;
+		if(!FLAC__stream_encoder_set_keep_buffers(encoder, i < 2) || !FLAC__stream_encoder_set_compression_level(encoder, 5))
+			return die_s_("setting up the encoder failed", encoder);
+		if(FLAC__stream_encoder_get_keep_buffers(encoder) != (i < 2))
+			return die_s_("FLAC__stream_encoder_get_keep_buffers() returned the wrong value", encoder);
+		if(FLAC__stream_encoder_init_memory(encoder, /*progress_callback=*/0, /*client_data=*/0) != FLAC__STREAM_ENCODER_INIT_STATUS_OK)
+			return die_s_("FLAC__stream_encoder_init_memory() failed", encoder);
+		if(!FLAC__stream_encoder_process_interleaved(encoder, signal, total))
+			return die_s_("FLAC__stream_encoder_process_interleaved() failed", encoder);
+		if(!FLAC__stream_encoder_finish_memory(encoder, &data[i], &length[i]))
+			return die_s_("FLAC__stream_encoder_finish_memory() failed", encoder);
+		allocations[i] = counts.allocations - allocations[i];
+		if(FLAC__stream_encoder_get_keep_buffers(encoder))
+			return die_s_("FLAC__stream_encoder_finish() did not reset the flag", encoder);
+		if(i > 0 && (length[i] != length[0] || memcmp(data[i], data[0], length[0]))) {
+			printf("FAILED, the stream differs from the first one\n");
+			return false;
+		}
+		if(i == 1 && allocations[1] >= allocations[0]) {
+			printf("FAILED, %u allocations, the first encode had %u\n", allocations[1], allocations[0]);
+			return false;
+		}
+		printf("OK (%u allocations)\n", allocations[i]);
+	}
+	for(i = 0; i < 3; i++)
+		allocator.release(allocator.context, data[i]);
+
+
+	for(i = 0; i < sizeof(settings)/sizeof(settings[0]); i++) {
+		printf("testing kept buffers with -%u, %s... ", settings[i].level, settings[i].channels == 1? "mono" : "stereo");
+		if(!keep_buffers_encode_(encoder, /*keep=*/true, settings[i].level, settings[i].channels, signal, total, &data[0], &length[0]))
+			return false;
+		if(0 == (fresh = FLAC__stream_encoder_new_with_allocator(&allocator)))
+			return die_("FLAC__stream_encoder_new_with_allocator() returned NULL");
+		if(!keep_buffers_encode_(fresh, /*keep=*/false, settings[i].level, settings[i].channels, signal, total, &fresh_data, &fresh_length))
+			return false;
+		FLAC__stream_encoder_delete(fresh);
+		if(length[0] != fresh_length || memcmp(data[0], fresh_data, fresh_length)) {
+			printf("FAILED, the stream differs from the one of a fresh encoder\n");
+			return false;
+		}
+		allocator.release(allocator.context, data[0]);
+		allocator.release(allocator.context, fresh_data);
+		printf("OK\n");
+	}
+
+	printf("testing FLAC__stream_encoder_delete()... ");
+	FLAC__stream_encoder_delete(encoder);
+	if(!check_counts_(&counts))
+		return false;
+
+#ifdef HAVE_PTHREAD
+	pthread_mutex_destroy(&counts.mutex);
+#endif
+	free(signal);
+
+	printf("\nPASSED!\n");
+	return true;
+}
+
 FLAC__bool test_encoders(void)
 {
 	FLAC__bool is_ogg = false;
@@ -506,6 +1264,21 @@ FLAC__bool test_encoders(void)
 		if(!test_stream_encoder(LAYER_FILENAME, is_ogg))
 			return false;
 
+		if(!is_ogg && !test_stream_encoder(LAYER_MEMORY, is_ogg))
+			return false;
+
+		if(!is_ogg && !test_stream_encoder_out_of_range_())
+			return false;
+
+		if(!is_ogg && !test_stream_encoder_cpu_feature_mask_())
+			return false;
+
+		if(!is_ogg && !test_stream_encoder_allocator_())
+			return false;
+
+		if(!is_ogg && !test_stream_encoder_keep_buffers_())
+			return false;
+
 		(void) grabbag__file_remove_file(flacfilename(is_ogg));
 
 		free_metadata_blocks_();
@@ -515,5 +1288,13 @@ FLAC__bool test_encoders(void)
 		is_ogg = true;
 	}
 
+#ifdef HAVE_PTHREAD
+	if(!test_stream_encoder_threads_())
+		return false;
+
+	if(!test_stream_encoder_parallel_subframes_())
+		return false;
+#endif
+
 	return true;
 }
@@ -0,0 +1,213 @@
+/* test_libFLAC - Unit tester for libFLAC
+ * Copyright (C) 2014-2018  Xiph.Org Foundation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "FLAC/assert.h"
+#include "FLAC/format.h"
+#include "private/bitmath.h"
+#include "private/cpu.h"
+#include "private/lpc.h"
+#include "lpc.h"
+
+#if (defined FLAC__CPU_IA32 || defined FLAC__CPU_X86_64) && FLAC__HAS_X86INTRIN && !defined FLAC__NO_ASM && !defined FLAC__INTEGER_ONLY_LIBRARY
+# ifdef FLAC__AVX2_SUPPORTED
+#  define TEST_LPC_AVX2 1
+# endif
+# if defined FLAC__AVX2_SUPPORTED && defined FLAC__FMA_SUPPORTED
+#  define TEST_LPC_AVX2_FMA 1
+# endif
+#endif
+
+#if defined TEST_LPC_AVX2 || defined TEST_LPC_AVX2_FMA
+#define MAX_SAMPLES 4100
+
+static FLAC__uint32 seed_ = 12345;
+
+static FLAC__uint32 random_(void)
+{
+	seed_ = seed_ * 1103515245u + 12345u;
+	return seed_ ^ (seed_ >> 13);
+}
+#endif
+
+#ifdef TEST_LPC_AVX2_FMA
+/* block sizes around multiples of the vector width, plus a couple of typical ones */
+static const uint32_t autocorrelation_lengths_[] = { 1, 2, 7, 8, 9, 15, 16, 17, 31, 32, 33, 34, 35, 36, 41, 63, 64, 65, 100, 576, 1152, 4095, 4096, 4097 };
+
+static FLAC__real autocorrelation_data_[MAX_SAMPLES];
+
+static FLAC__bool test_autocorrelation(const char *name, void (*f)(const FLAC__real data[], uint32_t data_len, uint32_t lag, FLAC__real autoc[]))
+{
+	FLAC__real expect[FLAC__MAX_LPC_ORDER+2], got[FLAC__MAX_LPC_ORDER+2];
+	uint32_t n, lag, i, k;
+
+	printf("testing %s ... ", name);
+
+	for(i = 0; i < MAX_SAMPLES; i++)
+		autocorrelation_data_[i] = (FLAC__real)((FLAC__int32)(random_() & 0xffff) - 0x8000);
+
+	for(n = 0; n < sizeof(autocorrelation_lengths_)/sizeof(autocorrelation_lengths_[0]); n++) {
+		const uint32_t data_len = autocorrelation_lengths_[n];
+		for(lag = 1; lag <= FLAC__MAX_LPC_ORDER+1 && lag <= data_len; lag++) {
+			FLAC__lpc_compute_autocorrelation(autocorrelation_data_, data_len, lag, expect);
+			for(k = 0; k < FLAC__MAX_LPC_ORDER+2; k++)
+				got[k] = -1.0f;
+			f(autocorrelation_data_, data_len, lag, got);
+			for(k = 0; k < lag; k++) {
+				/* the summation order differs, so allow for the rounding of a float sum of data_len terms */
+				double bound = 0.0;
+				for(i = 0; i + k < data_len; i++)
+					bound += fabs((double)autocorrelation_data_[i] * (double)autocorrelation_data_[i+k]);
+				if(fabs((double)got[k] - (double)expect[k]) > bound * 1e-5) {
+					printf("FAILED, autoc[%u] is %f, expected %f, for %u samples, lag %u\n", k, (double)got[k], (double)expect[k], data_len, lag);
+					return false;
+				}
+			}
+			for(k = lag; k < FLAC__MAX_LPC_ORDER+2; k++) {
+				if(got[k] != -1.0f) {
+					printf("FAILED, wrote autoc[%u] for %u samples, lag %u\n", k, data_len, lag);
+					return false;
+				}
+			}
+		}
+	}
+
+	printf("OK\n");
+	return true;
+}
+#endif /* TEST_LPC_AVX2_FMA */
+
+#ifdef TEST_LPC_AVX2
+typedef enum {
+	RESTORE_16BIT, /* for bps <= 16 and qlp_coeff_precision <= 16, if the sum fits in 32 bits */
+	RESTORE_32BIT, /* if the sum fits in 32 bits */
+	RESTORE_64BIT
+} RestoreKind;
+
+/* the data lengths straddle the blocks of 8 (or 4) samples the vector routines restore at a time */
+static const uint32_t restore_lengths_[] = { 1, 3, 4, 7, 8, 9, 15, 17, 100, 1000, 4064 };
+
+static FLAC__int32 signal_[FLAC__MAX_LPC_ORDER + MAX_SAMPLES], restored_[FLAC__MAX_LPC_ORDER + MAX_SAMPLES + 1], residual_[MAX_SAMPLES];
+
+/* Checks that f() undoes FLAC__lpc_compute_residual_from_qlp_coefficients[_wide]()
+ * for every order, at the largest and smallest bit depths and the largest
+ * coefficient precision for which the decoder would pick the routine.
+ */
+static FLAC__bool test_restore(const char *name, void (*f)(const FLAC__int32 residual[], uint32_t data_len, const FLAC__int32 qlp_coeff[], uint32_t order, int lp_quantization, FLAC__int32 data[]), RestoreKind kind)
+{
+	static const uint32_t bps_16bit[] = { 4, 8, 16 }, bps_32bit[] = { 4, 16, 24 }, bps_64bit[] = { 16, 24, 30 };
+	const uint32_t *bps_list = kind == RESTORE_16BIT? bps_16bit : kind == RESTORE_32BIT? bps_32bit : bps_64bit;
+	FLAC__int32 qlp_coeff[FLAC__MAX_LPC_ORDER];
+	uint32_t order, b, n, i;
+
+	printf("testing %s ... ", name);
+
+	for(order = 1; order <= FLAC__MAX_LPC_ORDER; order++) {
+		for(b = 0; b < 3; b++) {
+			const uint32_t bps = bps_list[b];
+			int precision = FLAC__MAX_QLP_COEFF_PRECISION, lp_quantization;
+			FLAC__int32 max_coeff;
+
+			if(kind != RESTORE_64BIT && bps + precision + FLAC__bitmath_ilog2(order) > 32)
+				precision = (int)(32 - bps - FLAC__bitmath_ilog2(order));
+			lp_quantization = precision - 1;
+			/* keep the prediction within twice the signal range, so the residual still fits in 32 bits */
+			max_coeff = (FLAC__int32)((1u << (lp_quantization + 1)) / order);
+			if(max_coeff > (1 << (precision - 1)) - 1)
+				max_coeff = (1 << (precision - 1)) - 1;
+
+			for(i = 0; i < order; i++)
+				qlp_coeff[i] = (FLAC__int32)(random_() % (2 * (FLAC__uint32)max_coeff + 1)) - max_coeff;
+			for(i = 0; i < FLAC__MAX_LPC_ORDER + MAX_SAMPLES; i++) {
+				/* sign-extend a random bps-bit value, forcing the extremes in now and then */
+				if(i % 61 == 5)
+					signal_[i] = -(FLAC__int32)(1u << (bps - 1));
+				else if(i % 61 == 6)
+					signal_[i] = (FLAC__int32)((1u << (bps - 1)) - 1);
+				else
+					signal_[i] = (FLAC__int32)(random_() << (32 - bps)) >> (32 - bps);
+			}
+
+			for(n = 0; n < sizeof(restore_lengths_)/sizeof(restore_lengths_[0]); n++) {
+				const uint32_t data_len = restore_lengths_[n];
+				if(kind == RESTORE_64BIT)
+					FLAC__lpc_compute_residual_from_qlp_coefficients_wide(signal_ + order, data_len, qlp_coeff, order, lp_quantization, residual_);
+				else
+					FLAC__lpc_compute_residual_from_qlp_coefficients(signal_ + order, data_len, qlp_coeff, order, lp_quantization, residual_);
+				memcpy(restored_, signal_, sizeof(FLAC__int32) * order);
+				restored_[order + data_len] = 0x5A5A5A5A;
+				f(residual_, data_len, qlp_coeff, order, lp_quantization, restored_ + order);
+				for(i = 0; i < data_len; i++) {
+					if(restored_[order + i] != signal_[order + i]) {
+						printf("FAILED, sample %u is %d, expected %d, for order %u, %u bps, precision %d, %u samples\n", i, restored_[order + i], signal_[order + i], order, bps, precision, data_len);
+						return false;
+					}
+				}
+				if(restored_[order + data_len] != 0x5A5A5A5A) {
+					printf("FAILED, wrote past the end of the data for order %u, %u bps, %u samples\n", order, bps, data_len);
+					return false;
+				}
+			}
+		}
+	}
+
+	printf("OK\n");
+	return true;
+}
+#endif /* TEST_LPC_AVX2 */
+
+FLAC__bool test_lpc(void)
+{
+#if defined TEST_LPC_AVX2 || defined TEST_LPC_AVX2_FMA
+	FLAC__CPUInfo cpuinfo;
+	FLAC__cpu_info(&cpuinfo);
+#endif
+
+	printf("\n+++ libFLAC unit test: lpc\n\n");
+
+#ifdef TEST_LPC_AVX2_FMA
+	if(cpuinfo.x86.avx2 && cpuinfo.x86.fma) {
+		if(!test_autocorrelation("FLAC__lpc_compute_autocorrelation_intrin_avx2_fma", FLAC__lpc_compute_autocorrelation_intrin_avx2_fma))
+			return false;
+	}
+	else
+		printf("AVX2 and FMA not supported by this CPU, skipping the AVX2/FMA routines\n");
+#endif
+#ifdef TEST_LPC_AVX2
+	if(cpuinfo.x86.avx2) {
+		if(!test_restore("FLAC__lpc_restore_signal_16_intrin_avx2", FLAC__lpc_restore_signal_16_intrin_avx2, RESTORE_16BIT))
+			return false;
+		if(!test_restore("FLAC__lpc_restore_signal_intrin_avx2", FLAC__lpc_restore_signal_intrin_avx2, RESTORE_32BIT))
+			return false;
+		if(!test_restore("FLAC__lpc_restore_signal_wide_intrin_avx2", FLAC__lpc_restore_signal_wide_intrin_avx2, RESTORE_64BIT))
+			return false;
+	}
+	else
+		printf("AVX2 not supported by this CPU, skipping the AVX2 routines\n");
+#endif
+
+	printf("\nPASSED!\n");
+	return true;
+}
@@ -28,8 +28,10 @@
 #include "encoders.h"
 #include "endswap.h"
 #include "format.h"
+#include "lpc.h"
 #include "metadata.h"
 #include "md5.h"
+#include "pcm.h"
 
 int main(void)
 {
@@ -48,6 +50,12 @@ int main(void)
 	if(!test_bitwriter())
 		return 1;
 
+	if(!test_pcm())
+		return 1;
+
+	if(!test_lpc())
+		return 1;
+
 	if(!test_format())
 		return 1;
 
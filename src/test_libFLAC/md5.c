@@ -58,7 +58,7 @@ static FLAC__bool test_md5_clear_context(void)
 	char * cptr;
 
 	printf("testing FLAC__MD5Init ... ");
-	FLAC__MD5Init (&ctx);
+	FLAC__MD5Init (&ctx, 0);
 	if (ctx.buf[0] != 0x67452301) {
 		printf("FAILED!\n");
 		return false;
@@ -199,7 +199,7 @@ static FLAC__bool test_md5_accumulate(const FLAC__int32 * const * signal, uint32
 
 	printf("testing FLAC__MD5Accumulate (samples=%u, channels=%u, bytes_per_sample=%u) ... ", samples, channels, bytes_per_sample);
 
-	FLAC__MD5Init(&ctx);
+	FLAC__MD5Init(&ctx, 0);
 	FLAC__MD5Accumulate(&ctx, signal, channels, samples, bytes_per_sample);
 	FLAC__MD5Final(digest, &ctx);
 
@@ -0,0 +1,307 @@
+/* test_libFLAC - Unit tester for libFLAC
+ * Copyright (C) 2014-2018  Xiph.Org Foundation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "FLAC/assert.h"
+#include "share/compat.h"
+#include "private/cpu.h"
+#include "private/pcm.h"
+#include "pcm.h"
+
+#if (defined FLAC__CPU_IA32 || defined FLAC__CPU_X86_64) && FLAC__HAS_X86INTRIN && !defined FLAC__NO_ASM
+# ifdef FLAC__SSE2_SUPPORTED
+#  define TEST_PCM_SSE2 1
+# endif
+# ifdef FLAC__SSSE3_SUPPORTED
+#  define TEST_PCM_SSSE3 1
+# endif
+#endif
+
+#define MAX_CHANNELS 3
+#define MAX_SAMPLES 67
+
+static FLAC__int32 input_[MAX_CHANNELS][MAX_SAMPLES];
+static FLAC__byte expect_[MAX_CHANNELS * MAX_SAMPLES * 4 + 16];
+static FLAC__byte got_[MAX_CHANNELS * MAX_SAMPLES * 4 + 16];
+
+static const uint32_t bps_[] = { 4, 8, 12, 16, 20, 24, 28, 32 };
+
+static void make_input(uint32_t bps)
+{
+	static FLAC__uint32 seed = 12345;
+	uint32_t channel, i;
+
+	for(channel = 0; channel < MAX_CHANNELS; channel++) {
+		for(i = 0; i < MAX_SAMPLES; i++) {
+			seed = seed * 1103515245u + 12345u;
+			/* sign-extend a random bps-bit value, forcing the extremes in now and then */
+			if(i == 1)
+				input_[channel][i] = -(FLAC__int32)(((FLAC__uint32)1 << (bps - 1)) - 1) - 1;
+			else if(i == 2)
+				input_[channel][i] = (FLAC__int32)(((FLAC__uint32)1 << (bps - 1)) - 1);
+			else
+				input_[channel][i] = (FLAC__int32)((seed ^ (seed >> 13)) << (32 - bps)) >> (32 - bps);
+		}
+	}
+}
+
+/* the obvious per-sample conversion, to check the library's generic routines against */
+static void interleave_ref(const FLAC__int32 * const input[], uint32_t channels, uint32_t samples, uint32_t bps, uint32_t bytes, FLAC__bool is_float, FLAC__byte *out)
+{
+	uint32_t i, channel;
+
+	for(i = 0; i < samples; i++) {
+		for(channel = 0; channel < channels; channel++) {
+			const FLAC__int64 x = input[channel][i];
+			if(is_float) {
+				const float f = (float)((double)x / (double)((FLAC__int64)1 << (bps - 1)));
+				memcpy(out, &f, 4);
+			}
+			else {
+				const uint32_t width = bytes * 8;
+				const FLAC__int32 y = (FLAC__int32)(bps <= width? x * ((FLAC__int64)1 << (width - bps)) : x / ((FLAC__int64)1 << (bps - width)) - (x < 0 && x % ((FLAC__int64)1 << (bps - width)) != 0));
+				if(bytes == 2) {
+					const FLAC__int16 z = (FLAC__int16)y;
+					memcpy(out, &z, 2);
+				}
+				else if(bytes == 4)
+					memcpy(out, &y, 4);
+				else {
+#if WORDS_BIGENDIAN
+					out[0] = (FLAC__byte)(y >> 16);
+					out[1] = (FLAC__byte)(y >> 8);
+					out[2] = (FLAC__byte)y;
+#else
+					out[0] = (FLAC__byte)y;
+					out[1] = (FLAC__byte)(y >> 8);
+					out[2] = (FLAC__byte)(y >> 16);
+#endif
+				}
+			}
+			out += bytes;
+		}
+	}
+}
+
+static FLAC__bool test_interleave(const char *name, FLAC__PCMInterleaveFunction f, uint32_t bytes, FLAC__bool is_float, FLAC__bool against_ref)
+{
+	const FLAC__int32 *input[MAX_CHANNELS];
+	uint32_t b, channels, samples, channel;
+
+	printf("testing %s ... ", name);
+
+	for(b = 0; b < sizeof(bps_)/sizeof(bps_[0]); b++) {
+		make_input(bps_[b]);
+		for(channels = 1; channels <= MAX_CHANNELS; channels++) {
+			for(samples = 0; samples < MAX_SAMPLES; samples++) {
+				/* start at an odd offset now and then to check unaligned loads */
+				for(channel = 0; channel < channels; channel++)
+					input[channel] = input_[channel] + (samples & 1);
+				if(against_ref)
+					interleave_ref(input, channels, samples, bps_[b], bytes, is_float, expect_);
+				else if(bytes == 2)
+					FLAC__pcm_interleave_int16(input, channels, samples, bps_[b], expect_);
+				else if(bytes == 3)
+					FLAC__pcm_interleave_int24(input, channels, samples, bps_[b], expect_);
+#ifndef FLAC__INTEGER_ONLY_LIBRARY
+				else if(is_float)
+					FLAC__pcm_interleave_float32(input, channels, samples, bps_[b], expect_);
+#endif
+				else
+					FLAC__pcm_interleave_int32(input, channels, samples, bps_[b], expect_);
+				memset(got_, 0xA5, sizeof(got_));
+				f(input, channels, samples, bps_[b], got_);
+				if(memcmp(got_, expect_, channels * samples * bytes) != 0) {
+					printf("FAILED, output mismatch for %u channels, %u samples, %u bps\n", channels, samples, bps_[b]);
+					return false;
+				}
+				if(got_[channels * samples * bytes] != 0xA5) {
+					printf("FAILED, wrote past the end of the output for %u channels, %u samples, %u bps\n", channels, samples, bps_[b]);
+					return false;
+				}
+			}
+		}
+	}
+
+	printf("OK\n");
+	return true;
+}
+
+/* builds the interleaved input for the deinterleave routines from input_[] */
+static void make_interleaved(uint32_t channels, uint32_t samples, uint32_t bps, uint32_t bytes, FLAC__bool is_float, FLAC__byte *out)
+{
+	uint32_t i, channel;
+
+	for(i = 0; i < samples; i++) {
+		for(channel = 0; channel < channels; channel++, out += bytes) {
+			const FLAC__int32 x = input_[channel][i];
+			if(is_float) {
+				const float f = (float)x / (float)((FLAC__uint32)1 << (bps - 1));
+				memcpy(out, &f, 4);
+			}
+			else if(bytes == 2) {
+				const FLAC__int16 y = (FLAC__int16)x;
+				memcpy(out, &y, 2);
+			}
+			else {
+				out[0] = (FLAC__byte)x;
+				out[1] = (FLAC__byte)(x >> 8);
+				out[2] = (FLAC__byte)(x >> 16);
+			}
+		}
+	}
+}
+
+static FLAC__bool test_deinterleave(const char *name, FLAC__PCMDeinterleaveFunction f, uint32_t bytes, FLAC__bool is_float)
+{
+	static FLAC__int32 output_[MAX_CHANNELS][MAX_SAMPLES + 1];
+	FLAC__int32 *output[MAX_CHANNELS];
+	const uint32_t max_bps = is_float? 24 : bytes * 8;
+	uint32_t b, channels, samples, channel, i;
+
+	printf("testing %s ... ", name);
+
+	for(channel = 0; channel < MAX_CHANNELS; channel++)
+		output[channel] = output_[channel];
+
+	for(b = 0; b < sizeof(bps_)/sizeof(bps_[0]) && bps_[b] <= max_bps; b++) {
+		const uint32_t bps = bps_[b];
+		make_input(bps);
+		for(channels = 1; channels <= MAX_CHANNELS; channels++) {
+			for(samples = 1; samples < MAX_SAMPLES; samples++) {
+				const uint32_t bad[2] = { channels * samples / 2, channels * samples - 1 };
+				make_interleaved(channels, samples, bps, bytes, is_float, got_);
+				for(channel = 0; channel < channels; channel++)
+					output_[channel][samples] = 0x5A5A5A5A;
+				if(!f(got_, channels, samples, bps, output)) {
+					printf("FAILED, returned false for %u channels, %u samples, %u bps\n", channels, samples, bps);
+					return false;
+				}
+				for(channel = 0; channel < channels; channel++) {
+					if(memcmp(output_[channel], input_[channel], samples * sizeof(FLAC__int32)) != 0) {
+						printf("FAILED, output mismatch for %u channels, %u samples, %u bps\n", channels, samples, bps);
+						return false;
+					}
+					if(output_[channel][samples] != 0x5A5A5A5A) {
+						printf("FAILED, wrote past the end of the output for %u channels, %u samples, %u bps\n", channels, samples, bps);
+						return false;
+					}
+				}
+				/* one bad sample, in the vector part and in the tail */
+				for(i = 0; i < 2; i++) {
+					FLAC__byte *p = got_ + bad[i] * bytes;
+					FLAC__byte save[4];
+					if(!is_float && bps == bytes * 8)
+						break; /* every value fits */
+					memcpy(save, p, bytes);
+					if(is_float) {
+						/* either out of range or not an integer once scaled */
+						const float x = (bps & 4)? 1.0f : 0.25f / (float)((FLAC__uint32)1 << (bps - 1));
+						memcpy(p, &x, 4);
+					}
+					else if(bytes == 2) {
+						const FLAC__int16 y = (FLAC__int16)(1 << (bps - 1));
+						memcpy(p, &y, 2);
+					}
+					else {
+						p[0] = (FLAC__byte)(1 << (bps - 1));
+						p[1] = (FLAC__byte)((1 << (bps - 1)) >> 8);
+						p[2] = (FLAC__byte)((1 << (bps - 1)) >> 16);
+					}
+					if(f(got_, channels, samples, bps, output)) {
+						printf("FAILED, returned true for a bad sample at %u with %u channels, %u samples, %u bps\n", bad[i], channels, samples, bps);
+						return false;
+					}
+					memcpy(p, save, bytes);
+				}
+			}
+		}
+	}
+
+	printf("OK\n");
+	return true;
+}
+
+FLAC__bool test_pcm(void)
+{
+#if defined TEST_PCM_SSE2 || defined TEST_PCM_SSSE3
+	FLAC__CPUInfo cpuinfo;
+	FLAC__cpu_info(&cpuinfo);
+#endif
+
+	printf("\n+++ libFLAC unit test: pcm\n\n");
+
+	if(!test_interleave("FLAC__pcm_interleave_int16", FLAC__pcm_interleave_int16, 2, false, true))
+		return false;
+	if(!test_interleave("FLAC__pcm_interleave_int24", FLAC__pcm_interleave_int24, 3, false, true))
+		return false;
+	if(!test_interleave("FLAC__pcm_interleave_int32", FLAC__pcm_interleave_int32, 4, false, true))
+		return false;
+#ifndef FLAC__INTEGER_ONLY_LIBRARY
+	if(!test_interleave("FLAC__pcm_interleave_float32", FLAC__pcm_interleave_float32, 4, true, true))
+		return false;
+#endif
+	if(!test_deinterleave("FLAC__pcm_deinterleave_int16", FLAC__pcm_deinterleave_int16, 2, false))
+		return false;
+	if(!test_deinterleave("FLAC__pcm_deinterleave_int24", FLAC__pcm_deinterleave_int24, 3, false))
+		return false;
+#ifndef FLAC__INTEGER_ONLY_LIBRARY
+	if(!test_deinterleave("FLAC__pcm_deinterleave_float32", FLAC__pcm_deinterleave_float32, 4, true))
+		return false;
+#endif
+
+#ifdef TEST_PCM_SSE2
+	if(cpuinfo.x86.sse2) {
+		if(!test_interleave("FLAC__pcm_interleave_int16_intrin_sse2", FLAC__pcm_interleave_int16_intrin_sse2, 2, false, false))
+			return false;
+		if(!test_interleave("FLAC__pcm_interleave_int32_intrin_sse2", FLAC__pcm_interleave_int32_intrin_sse2, 4, false, false))
+			return false;
+# ifndef FLAC__INTEGER_ONLY_LIBRARY
+		if(!test_interleave("FLAC__pcm_interleave_float32_intrin_sse2", FLAC__pcm_interleave_float32_intrin_sse2, 4, true, false))
+			return false;
+# endif
+		if(!test_deinterleave("FLAC__pcm_deinterleave_int16_intrin_sse2", FLAC__pcm_deinterleave_int16_intrin_sse2, 2, false))
+			return false;
+# ifndef FLAC__INTEGER_ONLY_LIBRARY
+		if(!test_deinterleave("FLAC__pcm_deinterleave_float32_intrin_sse2", FLAC__pcm_deinterleave_float32_intrin_sse2, 4, true))
+			return false;
+# endif
+	}
+	else
+		printf("SSE2 not supported by this CPU, skipping the SSE2 routines\n");
+#endif
+#ifdef TEST_PCM_SSSE3
+	if(cpuinfo.x86.ssse3) {
+		if(!test_interleave("FLAC__pcm_interleave_int24_intrin_ssse3", FLAC__pcm_interleave_int24_intrin_ssse3, 3, false, false))
+			return false;
+		if(!test_deinterleave("FLAC__pcm_deinterleave_int24_intrin_ssse3", FLAC__pcm_deinterleave_int24_intrin_ssse3, 3, false))
+			return false;
+	}
+	else
+		printf("SSSE3 not supported by this CPU, skipping the SSSE3 routines\n");
+#endif
+
+	printf("\nPASSED!\n");
+	return true;
+}